@@ -0,0 +1,11 @@
+#version 330 core
+uniform samplerCube tEnvironment;
+
+in vec3 passRay;
+
+out vec4 outColor;
+
+void main()
+{
+	outColor = vec4(textureLod(tEnvironment, normalize(passRay), 0.0).rgb, 1.0);
+}
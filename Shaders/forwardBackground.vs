@@ -0,0 +1,13 @@
+#version 330 core
+uniform mat3 invViewMat;
+uniform vec2 inverseProjectionScale;	// 1 / projMat[0][0], 1 / projMat[1][1]
+
+layout (location=0) in vec3 inPosition;
+
+out vec3 passRay;
+
+void main()
+{
+	gl_Position = vec4(inPosition.xy, 0.0, 1.0);
+	passRay = invViewMat * vec3(inPosition.xy * inverseProjectionScale, -1.0);
+}
@@ -0,0 +1,162 @@
+#version 330 core
+#define TILE_SIZE 16	// LightGrid::tileSize
+
+uniform sampler2D colorMap;
+uniform sampler2D normalMap;
+uniform sampler2D roughnessMap;
+uniform sampler2D metalMap;
+uniform mat3 invViewMat;
+uniform samplerCube tEnvironment;
+uniform samplerCube tDiffuseEnvironment;
+uniform float environmentMipMaps;
+uniform sampler2D environmentLUT;
+uniform bool environmentLighting;	// False when no environment is set
+
+// Light grid, see LightGrid::upload
+uniform usamplerBuffer tileRanges;	// x = first index, y = light count, per cluster
+uniform usamplerBuffer lightIndices;
+uniform samplerBuffer lights;		// (position, radius), (color * brightness, 0)
+uniform int tileCountX;
+uniform int depthSliceCount;
+uniform float depthSliceScale;		// Slice at view depth d is log(d) * scale + bias
+uniform float depthSliceBias;
+
+in vec3 passPosition;
+in vec3 passNormal;
+in vec3 passTangent;
+in vec3 passBitangent;
+in vec2 passUVCoords;
+
+out vec4 outColor;
+
+float fresnelSchlick(float f0, float cosineFactor)
+{
+	return f0 + (1.0 - f0) * exp2((-5.55473 * cosineFactor - 6.98316) * cosineFactor); // UE4 method
+}
+
+float distributionGGX(float NdotH, float alpha)
+{
+	float alphaSq = alpha * alpha;
+	float denom = (NdotH * NdotH) * (alphaSq - 1.0) + 1.0;
+	return alphaSq / (3.14159 * denom * denom);
+}
+
+float G1Schlick(float cosineFactor, float roughness)
+{
+	float k = (roughness * roughness) / 2.0;
+	return cosineFactor / (cosineFactor * (1.0 - k) + k);
+}
+
+float geometrySmith(float NdotV, float NdotL, float roughness)
+{
+	return G1Schlick(NdotV, roughness) * G1Schlick(NdotL, roughness);
+}
+
+float brdfSpec(float f0, float NdotH, float NdotV, float NdotL, float HdotV, float roughness)
+{
+	float alpha = roughness * roughness;
+	float f = fresnelSchlick(f0, HdotV);
+	float d = distributionGGX(NdotH, alpha);
+	float g = geometrySmith(NdotV, NdotL, roughness);
+
+	return f * d * g / (4.0 * NdotL * NdotV);
+}
+
+vec3 brdfLambert(vec3 reflectivity)
+{
+	return reflectivity / 3.14159;
+}
+
+vec3 blendMaterial(vec3 diffuse, vec3 specular, vec3 color, float metallic, float fresnel)
+{
+	return diffuse * (1.0 - metallic) * (1.0 - fresnel) + specular * mix(vec3(fresnel), color, metallic);
+}
+
+// Same as lightPass.fs, with the light read from the grid's buffer
+vec3 calculateLightContribution(int lightIndex, vec3 view, vec3 normal, float NdotV, vec3 position, vec3 color, float metallic, float roughness)
+{
+	vec4 positionRadius = texelFetch(lights, lightIndex * 2);
+	vec3 lightColor = texelFetch(lights, lightIndex * 2 + 1).rgb;
+
+	// Calculate light value based on distance and attenuation
+	vec3 pixelToLight = positionRadius.xyz - position;
+	float dist = length(pixelToLight);
+	float falloff = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+	falloff = falloff * falloff / (dist * dist + 1.0);
+
+	vec3 lightValue = lightColor * falloff;
+
+	// Calculate light and half vectors
+	vec3 light = normalize(pixelToLight);
+	vec3 halfVector = normalize(light + view);
+
+	// Calculate required dot products, clamped
+	float NdotH = max(dot(normal, halfVector), 0.001);
+	float NdotL = max(dot(normal, light), 0.001);
+	float HdotV = max(dot(halfVector, view), 0.001);
+
+	float specular = brdfSpec(metallic, NdotH, NdotV, NdotL, HdotV, roughness);
+	vec3 diffuse = brdfLambert(color);
+	float fresnel = fresnelSchlick(metallic, NdotV);
+
+	return blendMaterial(diffuse, vec3(specular), color, metallic, fresnel) * lightValue * NdotL;
+}
+
+vec3 approximateSpecIBL(vec3 specular, float roughness, vec3 normal, vec3 view)
+{
+	float NdotV = max(dot(normal, view), 0.001);
+	vec3 ray = 2.0 * dot(normal, view) * normal - view;
+
+	vec3 prefilteredColor = textureLod(tEnvironment, ray, roughness * environmentMipMaps).rgb;
+	vec2 envBRDF = texture(environmentLUT, vec2(NdotV, roughness)).rg;
+
+	return prefilteredColor * (specular * envBRDF.x + envBRDF.y);
+}
+
+void main()
+{
+	mat3 TBN = mat3(
+		normalize(passTangent),
+		normalize(passBitangent),
+		normalize(passNormal));
+
+	// Material, clamped like the g-buffer and light pass clamp it
+	vec3 color = texture(colorMap, passUVCoords).rgb; // No support for alpha channel yet
+	vec3 normal = normalize(TBN * (texture(normalMap, passUVCoords).xyz * 2.0 - vec3(1.0)));
+	float metallic = clamp(texture(metalMap, passUVCoords).x, 0.0334, 0.99);
+	float roughness = clamp(texture(roughnessMap, passUVCoords).x, 0.01, 1.0);
+
+	vec3 view = normalize(-passPosition); // in view space already
+	vec3 viewWorld = invViewMat * view;
+	vec3 normalWorld = invViewMat * normal;
+	float NdotV = max(dot(normal, view), 0.001);
+
+	// Only the lights binned into this fragment's cluster
+	ivec2 tile = ivec2(gl_FragCoord.xy) / TILE_SIZE;
+	int slice = clamp(int(floor(log(-passPosition.z) * depthSliceScale + depthSliceBias)), 0, depthSliceCount - 1);
+	uvec2 range = texelFetch(tileRanges, (tile.y * tileCountX + tile.x) * depthSliceCount + slice).xy;
+
+	vec3 totalLightContribution = vec3(0.0);
+	for(uint i = 0u; i < range.y; i++)
+	{
+		int lightIndex = int(texelFetch(lightIndices, int(range.x + i)).x);
+		totalLightContribution += calculateLightContribution(lightIndex, view, normal, NdotV, passPosition, color, metallic, roughness);
+	}
+
+	if(environmentLighting)
+	{
+		float fresnel = mix(fresnelSchlick(metallic, NdotV), 0.03, roughness);
+		vec3 spec = approximateSpecIBL(mix(vec3(1.0), color, metallic), roughness, normalWorld, viewWorld);
+		vec3 diff = textureLod(tDiffuseEnvironment, normalWorld, 0.0).rgb * color;
+		totalLightContribution += blendMaterial(diff, spec, color, metallic, fresnel);
+	}
+
+	// Tone mapping
+	vec3 toneMappedColor = totalLightContribution / (totalLightContribution + vec3(1.0));
+
+	// Gamma correction
+	vec3 gamma = vec3(1.0 / 2.2);
+	vec3 finalColor = pow(toneMappedColor, gamma);
+
+	outColor = vec4(finalColor, 1.0);
+}
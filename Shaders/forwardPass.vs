@@ -0,0 +1,32 @@
+#version 330 core
+uniform mat4 viewMat;
+uniform mat4 projMat;
+uniform mat4x3 modelMat;
+uniform mat3 normalMat;
+
+layout (location=0) in vec3 inPosition;
+layout (location=1) in vec3 inNormal;
+layout (location=2) in vec3 inTangent;
+layout (location=3) in vec3 inBitangent;
+layout (location=4) in vec2 inUVCoords;
+
+out vec3 passPosition;		// View space
+out vec3 passNormal;
+out vec3 passTangent;
+out vec3 passBitangent;
+out vec2 passUVCoords;
+
+invariant gl_Position;		// The depth prepass must produce the same depth
+
+void main()
+{
+	vec4 viewPosition = viewMat * vec4(modelMat * vec4(inPosition, 1.0), 1.0);
+	mat3 viewMat3 = mat3(viewMat);
+
+	gl_Position = projMat * viewPosition;
+	passPosition = viewPosition.xyz;
+	passNormal = viewMat3 * normalMat * inNormal;
+	passTangent = viewMat3 * inTangent;
+	passBitangent = viewMat3 * inBitangent;
+	passUVCoords = inUVCoords;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMat;
+	mat4 projMat;
+	float near;
+};
+
+layout (location=0) in vec3 inPosition;
+layout (location=7) in mat4x3 modelMat;		// Per instance
+
+invariant gl_Position;		// Must match geometryPass.vs, the g-buffer pass tests depth for equality
+
+void main()
+{
+	gl_Position = projMat * viewMat * vec4(modelMat * vec4(inPosition, 1.0), 1.0);
+}
\ No newline at end of file
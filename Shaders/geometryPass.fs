@@ -1,35 +1,45 @@
 #version 330 core
 #extension GL_ARB_explicit_uniform_location : enable
-layout (location=16) uniform sampler2D colorMap;
-layout (location=17) uniform sampler2D normalMap;
-layout (location=18) uniform sampler2D roughnessMap;
-layout (location=19) uniform sampler2D metalMap;
+layout (location=781) uniform sampler2D colorMap;
+layout (location=782) uniform sampler2D normalMap;
+layout (location=783) uniform sampler2D roughnessMap;
+layout (location=784) uniform sampler2D metalMap;
+layout (location=786) uniform sampler2DArray colorMaps;
+layout (location=787) uniform sampler2DArray normalMaps;
+layout (location=788) uniform sampler2DArray roughnessMaps;
+layout (location=789) uniform sampler2DArray metalMaps;
+layout (location=790) uniform int surfaceInAlbedo;	// Metal and roughness go in albedo alpha instead of outSurface
+
+struct MaterialRecord
+{
+	ivec4 layers;		// Color, normal, roughness, metal, -1 where the factor is used instead
+	vec4 colorFactor;
+	vec4 normalFactor;
+	vec4 surfaceFactor;	// x = roughness, y = metal
+};
+
+layout (std140) uniform MaterialBlock
+{
+	MaterialRecord materials[256];
+};
 
-in float passDepthZ;
-in float passDepthW;
 in vec3 passNormal;
 in vec3 passTangent;
 in vec3 passBitangent;
 in vec2 passUVCoords;
+flat in int passMaterialIndex;	// -1 for materials outside the material library
 
-out vec4 outAlbedo;
-out vec2 outNormal;
-out vec4 outDepth;
-out vec4 outMisc;		// x = metal, y = roughness, zw unused
-
-vec4 encodeDepth(float depth)
-{
-	const vec4 bitShift = vec4(256.0*256.0*256.0, 256.0*256.0, 256.0, 1.0);
-	const vec4 bitMask = vec4(0.0, 1.0/256.0, 1.0/256.0, 1.0/256.0);
-	vec4 res = fract(depth * bitShift);
-	res -= res.xxyz * bitMask;
-	return res;
-}
+layout (location=0) out vec4 outAlbedo;
+layout (location=1) out vec2 outNormal;
+layout (location=2) out vec2 outSurface;	// x = metal, y = roughness
 
+// Octahedral encoding, the view space normal projected onto an octahedron and unfolded into a square
 vec2 encodeNormal(vec3 normal)
 {
-	float f = sqrt(8.0 * normal.z + 8.0);
-	return normal.xy / f + vec2(0.5);
+	normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+	if(normal.z < 0.0)
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	return normal.xy * 0.5 + vec2(0.5);
 }
 
 void main()
@@ -39,11 +49,36 @@ void main()
 		normalize(passBitangent),
 		normalize(passNormal));
 	
-	vec3 tangentNormal = texture(normalMap, passUVCoords).xyz * 2.0 - vec3(1.0);
+	vec4 albedo;
+	vec3 normalTexel;
+	float roughness;
+	float metal;
+	if (passMaterialIndex < 0)
+	{
+		albedo = texture(colorMap, passUVCoords);
+		normalTexel = texture(normalMap, passUVCoords).xyz;
+		roughness = texture(roughnessMap, passUVCoords).x;
+		metal = texture(metalMap, passUVCoords).x;
+	}
+	else
+	{
+		MaterialRecord material = materials[passMaterialIndex];
+		albedo = material.layers.x >= 0 ? texture(colorMaps, vec3(passUVCoords, material.layers.x)) : material.colorFactor;
+		normalTexel = material.layers.y >= 0 ? texture(normalMaps, vec3(passUVCoords, material.layers.y)).xyz : material.normalFactor.xyz;
+		roughness = material.layers.z >= 0 ? texture(roughnessMaps, vec3(passUVCoords, material.layers.z)).x : material.surfaceFactor.x;
+		metal = material.layers.w >= 0 ? texture(metalMaps, vec3(passUVCoords, material.layers.w)).x : material.surfaceFactor.y;
+	}
+
+	vec3 tangentNormal = normalTexel * 2.0 - vec3(1.0);
 
-	outAlbedo = texture(colorMap, passUVCoords);
+	metal = clamp(metal, 0.03, 0.99);
+
+	outAlbedo = albedo;
 	//outNormal = encodeNormal(normalize(passNormal)); // No normal map
     outNormal = encodeNormal(normalize(TBN * tangentNormal));
-	outDepth = encodeDepth(passDepthZ / passDepthW);
-	outMisc = vec4(clamp(texture(metalMap, passUVCoords).x, 0.03, 0.99), texture(roughnessMap, passUVCoords).x, 0.0, 0.0);
+	outSurface = vec2(metal, roughness);
+
+	// 4 bits each, metal in the high nibble
+	if(surfaceInAlbedo != 0)
+		outAlbedo.a = (round(metal * 15.0) * 16.0 + round(roughness * 15.0)) / 255.0;
 }
\ No newline at end of file
@@ -1,19 +1,9 @@
 #version 330 core
 #extension GL_ARB_explicit_uniform_location : enable
-#define LIGHT_COUNT 1
-
-struct PointLight // 4 uniform locations
-{
-	vec3 position;
-	vec3 color;
-	float brightness;
-	float radius;
-};
-
 layout (location=0) uniform sampler2D tColor;
 layout (location=1) uniform sampler2D tNormal;
-layout (location=2) uniform sampler2D tDepth;
-layout (location=3) uniform sampler2D tMisc;
+layout (location=2) uniform sampler2D tDepth;		// The depth attachment
+layout (location=3) uniform sampler2D tSurface;
 layout (location=4) uniform float near;
 layout (location=5) uniform float far;
 layout (location=6) uniform mat3 invViewMat;
@@ -21,35 +11,45 @@ layout (location=9) uniform samplerCube tEnvironment;
 layout (location=10) uniform samplerCube tDiffuseEnvironment;
 layout (location=11) uniform float environmentMipMaps;
 layout (location=12) uniform sampler2D environmentLUT;
-layout (location=13) uniform PointLight light[LIGHT_COUNT];
+
+// Light clusters, see LightGrid::upload
+layout (location=13) uniform usamplerBuffer clusterRanges;	// x = first index, y = light count
+layout (location=14) uniform usamplerBuffer lightIndices;
+layout (location=15) uniform samplerBuffer lights;		// (position, radius), (color * brightness, 0)
+layout (location=16) uniform vec2 tileScale;			// Screen size in tiles
+layout (location=17) uniform int depthSliceCount;
+layout (location=18) uniform float depthSliceScale;
+layout (location=19) uniform float depthSliceBias;
+layout (location=20) uniform int surfaceInAlbedo;		// Metal and roughness packed into tColor's alpha, tSurface unbound
+layout (location=21) uniform vec2 uvScale;			// Rendered part of the g-buffer
+
+// Half resolution lighting: pass 1 writes diffuse and environment lighting at half
+// resolution, pass 2 upsamples it and adds point light specular. Pass 0 does it all
+layout (location=22) uniform int lightingPass;
+layout (location=23) uniform sampler2D tHalfDiffuse;
+layout (location=24) uniform sampler2D tHalfSpecular;
 
 in vec2 passUVCoords;
 in vec3 passFrustumRays;
 
-out vec4 outColor;
-
-float decodeDepth()
-{
-	const vec4 bitShift = vec4(1.0/(256.0*256.0*256.0), 1.0/(256.0*256.0), 1.0/256.0, 1.0);
-	return dot(texture(tDepth, passUVCoords), bitShift);
-}
+layout (location=0) out vec4 outColor;		// Pass 1 writes diffuse light, before the surface color
+layout (location=1) out vec4 outSpecular;	// Pass 1 only, the prefiltered environment
 
-vec3 decodeNormal()
+vec3 decodeNormal(vec2 encoded)
 {
-	vec2 fenc = texture(tNormal, passUVCoords).rg * 4.0 - 2.0;
-	float f = dot(fenc, fenc);
-	float g = sqrt(1.0 - f / 4.0);
-
-	vec3 normal;
-	normal.xy = fenc * g;
-	normal.z = 1.0 - f / 2.0;
-	return normal;
+	// Octahedral, see geometryPass.fs
+	vec2 f = encoded * 2.0 - vec2(1.0);
+	vec3 normal = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-normal.z, 0.0, 1.0);
+	normal.xy += vec2(normal.x >= 0.0 ? -t : t, normal.y >= 0.0 ? -t : t);
+	return normalize(normal);
 }
 
-float getDepth()
+float getDepth(float rawDepth)
 {
-	// Linearizes depth
-	return (2 * near) / (far + near - decodeDepth() * (far - near));
+	// Linearizes depth, as a fraction of far to scale the frustum rays
+	float z = rawDepth * 2.0 - 1.0;
+	return (2.0 * near) / (far + near - z * (far - near));
 }
 
 vec3 getPixelPosition(float depth)
@@ -106,36 +106,36 @@ vec3 blendMaterial(vec3 diffuse, vec3 specular, vec3 color, float metallic, floa
 	return diffuse * (1.0 - metallic) * (1.0 - fresnel) + specular * mix(vec3(fresnel), color, metallic);
 }
 
-vec3 calculateLightContribution(PointLight pl, vec3 view, vec3 normal, float NdotV, vec3 position, vec3 color, float metallic, float roughness)
+// Diffuse and specular light of one light, still to be weighted by the surface as in blendMaterial
+void calculateLightContribution(int lightIndex, vec3 view, vec3 normal, float NdotV, vec3 position, float metallic, float roughness,
+	bool withDiffuse, bool withSpecular, inout vec3 diffuseLight, inout vec3 specularLight)
 {
+	vec4 positionRadius = texelFetch(lights, lightIndex * 2);
+	vec3 lightColor = texelFetch(lights, lightIndex * 2 + 1).rgb;
+
 	// Calculate light value based on distance and attenuation
-	vec3 pixelToLight = pl.position - position;
+	vec3 pixelToLight = positionRadius.xyz - position;
 	float dist = length(pixelToLight);
-	float falloff = clamp(1.0 - pow(dist / pl.radius, 4.0), 0.0, 1.0);
+	float falloff = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
 	falloff = falloff * falloff / (dist * dist + 1.0);
 
-	//if(falloff <= 0.0) return vec3(0.0); // Continue?
-	vec3 lightValue = pl.color * pl.brightness * falloff;
+	vec3 lightValue = lightColor * falloff;
 
-	// Calculate light and half vectors
+	// Calculate light vector and its dot product, clamped
 	vec3 light = normalize(pixelToLight);
-	vec3 half = normalize(light + view);
-
-	// Calculate required dot products, clamped
-	float NdotH = max(dot(normal, half), 0.001);
 	float NdotL = max(dot(normal, light), 0.001);
-	float HdotV = max(dot(half, view), 0.001);
-
-	// Calculate specular lighting
-	float specular = brdfSpec(metallic, NdotH, NdotV, NdotL, HdotV, roughness);
 
-	// Calculate diffuse
-	vec3 diffuse = brdfLambert(color);
+	if(withDiffuse) diffuseLight += lightValue * NdotL;
+	if(!withSpecular) return;
 
-	// Calculate fresnel term
-	float fresnel = fresnelSchlick(metallic, NdotV);
+	// Calculate half vector and the remaining dot products
+	vec3 halfVector = normalize(light + view);
+	float NdotH = max(dot(normal, halfVector), 0.001);
+	float HdotV = max(dot(halfVector, view), 0.001);
 
-	return blendMaterial(diffuse, vec3(specular), color, metallic, fresnel) * NdotL;
+	// Calculate specular lighting
+	float specular = brdfSpec(metallic, NdotH, NdotV, NdotL, HdotV, roughness);
+	specularLight += specular * lightValue * NdotL;
 }
 
 float radicalInverse(uint bits)
@@ -161,13 +161,13 @@ vec3 importanceSampleGGX(vec2 Xi, float roughness, vec3 normal) // from UE4
 	float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (alpha * alpha - 1.0) * Xi.y));
 	float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
 
-	vec3 half = vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
+	vec3 halfVector = vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
 
 	vec3 up = abs(normal.y) < 0.999? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
 	vec3 tangentX = normalize(cross(up, normal));
 	vec3 tangentZ = cross(normal, tangentX);
 
-	return tangentX * half.x + normal * half.y + tangentZ * half.z;
+	return tangentX * halfVector.x + normal * halfVector.y + tangentZ * halfVector.z;
 }
 
 vec3 specIBL(vec3 specular, float roughness, vec3 normal, vec3 view) // from UE4
@@ -178,13 +178,13 @@ vec3 specIBL(vec3 specular, float roughness, vec3 normal, vec3 view) // from UE4
 	for(uint i = 0u; i < numSamples; i++)
 	{
 		vec2 Xi = Hammersley(i, numSamples);
-		vec3 half = importanceSampleGGX(Xi, roughness, normal);
-		vec3 light = 2 * dot(view, half) * half - view;
+		vec3 halfVector = importanceSampleGGX(Xi, roughness, normal);
+		vec3 light = 2 * dot(view, halfVector) * halfVector - view;
 
-		float NdotH = max(dot(normal, half), 0.001);
+		float NdotH = max(dot(normal, halfVector), 0.001);
 		float NdotV = max(dot(normal, view), 0.001);
 		float NdotL = max(dot(normal, light), 0.001);
-		float HdotV = max(dot(half, view), 0.001);
+		float HdotV = max(dot(halfVector, view), 0.001);
 
 		if(NdotL > 0.0)
 		{
@@ -206,47 +206,152 @@ vec3 diffIBL(vec3 baseColor, vec3 normal)
 	return texture(tDiffuseEnvironment, normal).rgb * baseColor;
 }
 
-vec3 approximateSpecIBL(vec3 specular, float roughness, vec3 normal, vec3 view)
+vec3 prefilteredEnvironment(float roughness, vec3 normal, vec3 view)
 {
-	float NdotV = max(dot(normal, view), 0.001);
 	vec3 ray = 2.0 * dot(normal, view) * normal - view;
+	return textureLod(tEnvironment, ray, roughness * environmentMipMaps).rgb;
+}
 
-	vec3 prefilteredColor = textureLod(tEnvironment, ray, roughness * environmentMipMaps).rgb;
+vec3 approximateSpecIBL(vec3 prefilteredColor, vec3 specular, float roughness, float NdotV)
+{
 	vec2 envBRDF = texture(environmentLUT, vec2(NdotV, roughness)).rg;
-
 	return prefilteredColor * (specular * envBRDF.x + envBRDF.y);
 }
 
+ivec2 getRenderSize()
+{
+	return ivec2(uvScale * vec2(textureSize(tDepth, 0)) + vec2(0.5));
+}
+
+// The g-buffer texel a half resolution texel is lit at
+ivec2 halfToFull(ivec2 halfTexel)
+{
+	return min(halfTexel * 2, getRenderSize() - ivec2(1));
+}
+
+// Depth and normal aware upsampling of pass 1. Of the four half resolution texels
+// around the pixel, those lit on another surface lose their bilinear weight
+void upsampleHalf(vec3 normal, float depth, out vec3 diffuse, out vec3 prefiltered)
+{
+	ivec2 halfSize = textureSize(tHalfDiffuse, 0);
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	ivec2 base = pixel / 2;
+	vec2 f = vec2(pixel - base * 2) * 0.5;
+
+	diffuse = vec3(0.0);
+	prefiltered = vec3(0.0);
+	float totalWeight = 0.0;
+	float bestWeight = -1.0;
+	ivec2 bestTexel = base;
+	for(int i = 0; i < 4; i++)
+	{
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 halfTexel = min(base + offset, halfSize - ivec2(1));
+		ivec2 fullTexel = halfToFull(halfTexel);
+
+		float tapDepth = getDepth(texelFetch(tDepth, fullTexel, 0).r);
+		vec3 tapNormal = decodeNormal(texelFetch(tNormal, fullTexel, 0).rg);
+		float surfaceWeight = exp(-abs(tapDepth - depth) / (0.02 * depth)) * pow(max(dot(tapNormal, normal), 0.0), 16.0);
+		vec2 bilinear = mix(vec2(1.0) - f, f, vec2(offset));
+		float weight = bilinear.x * bilinear.y * surfaceWeight;
+
+		diffuse += texelFetch(tHalfDiffuse, halfTexel, 0).rgb * weight;
+		prefiltered += texelFetch(tHalfSpecular, halfTexel, 0).rgb * weight;
+		totalWeight += weight;
+		if(surfaceWeight > bestWeight)
+		{
+			bestWeight = surfaceWeight;
+			bestTexel = halfTexel;
+		}
+	}
+
+	// Thin features none of the taps landed on take the closest match instead
+	if(totalWeight > 0.0001)
+	{
+		diffuse /= totalWeight;
+		prefiltered /= totalWeight;
+	}
+	else
+	{
+		diffuse = texelFetch(tHalfDiffuse, bestTexel, 0).rgb;
+		prefiltered = texelFetch(tHalfSpecular, bestTexel, 0).rgb;
+	}
+}
+
 void main()
 {
+	// Pass 1 lights the g-buffer texel it is upsampled from. Its position comes from the
+	// half resolution pixel's ray, within a texel of that, which diffuse light doesn't show
+	vec2 bufferUV = passUVCoords * uvScale;
+	if(lightingPass == 1) bufferUV = (vec2(halfToFull(ivec2(gl_FragCoord.xy))) + vec2(0.5)) / vec2(textureSize(tDepth, 0));
+
 	// Unpack G-buffer
-	float depth = getDepth();
+	float rawDepth = texture(tDepth, bufferUV).r;
+	float depth = getDepth(rawDepth);
 	vec3 position = getPixelPosition(depth);
 	vec3 view = normalize(-position); // in view space already
 	vec3 viewWorld = invViewMat * view;
 
-	if(depth > 0.0)
+	if(rawDepth < 1.0)
 	{
 		// Unpack rest of G-buffer
-		vec3 color = texture(tColor, passUVCoords).rgb; // No support for alpha channel yet
-		vec3 normal = decodeNormal();
+		vec4 albedo = texture(tColor, bufferUV); // No support for transparency yet
+		vec3 color = albedo.rgb;
+		vec3 normal = decodeNormal(texture(tNormal, bufferUV).rg);
 		vec3 normalWorld = invViewMat * normal;
 
-		vec2 misc = texture(tMisc, passUVCoords).xy;
-		float metallic = clamp(misc.x, 0.0334, 0.99);
-		float roughness = clamp(misc.y, 0.01, 1.0);
+		vec2 surface;
+		if(surfaceInAlbedo != 0)
+		{
+			float packedSurface = round(albedo.a * 255.0);
+			surface = vec2(floor(packedSurface / 16.0), mod(packedSurface, 16.0)) / 15.0;
+		}
+		else surface = texture(tSurface, bufferUV).xy;
+		float metallic = clamp(surface.x, 0.0334, 0.99);
+		float roughness = clamp(surface.y, 0.01, 1.0);
 
 		float NdotV = max(dot(normal, view), 0.001);
+		float fresnel = fresnelSchlick(metallic, NdotV);
+		float fresnelIBL = mix(fresnel, 0.03, roughness);
+
+		// Calculate dynamic lighting, only from the lights binned into this pixel's cluster
+		ivec2 tileCount = ivec2(ceil(tileScale));
+		ivec2 tile = min(ivec2(passUVCoords * tileScale), tileCount - 1);
+		int slice = clamp(int(floor(log(-position.z) * depthSliceScale + depthSliceBias)), 0, depthSliceCount - 1);
+		uvec2 range = texelFetch(clusterRanges, (tile.y * tileCount.x + tile.x) * depthSliceCount + slice).xy;
+
+		// Pass 2 takes diffuse light from pass 1, so only accumulates specular here
+		vec3 diffuseLight = vec3(0.0);
+		vec3 specularLight = vec3(0.0);
+		for(uint i = 0u; i < range.y; i++)
+		{
+			int lightIndex = int(texelFetch(lightIndices, int(range.x + i)).x);
+			calculateLightContribution(lightIndex, view, normal, NdotV, position, metallic, roughness, lightingPass != 2, lightingPass != 1,
+				diffuseLight, specularLight);
+		}
 
-		// Calculate dynamic lighting
-		vec3 totalLightContribution = vec3(0.0);
-		for(int i = 0; i < LIGHT_COUNT; i++)
-			totalLightContribution += calculateLightContribution(light[i], view, normal, NdotV, position, color, metallic, roughness);
+		// Diffuse light and the prefiltered environment, both before the surface color
+		vec3 diffuse;
+		vec3 prefiltered;
+		if(lightingPass == 2) upsampleHalf(normal, depth, diffuse, prefiltered);
+		else
+		{
+			vec3 environmentDiffuse = textureLod(tDiffuseEnvironment, normalWorld, 0.0).rgb;
+			diffuse = (brdfLambert(vec3(1.0)) * diffuseLight * (1.0 - fresnel) + environmentDiffuse * (1.0 - fresnelIBL)) * (1.0 - metallic);
+			prefiltered = prefilteredEnvironment(roughness, normalWorld, viewWorld);
+		}
 
-		float fresnel = mix(fresnelSchlick(metallic, NdotV), 0.03, roughness);
-		vec3 spec = approximateSpecIBL(mix(vec3(1.0), color, metallic), roughness, normalWorld, viewWorld);
-		vec3 diff = textureLod(tDiffuseEnvironment, normalWorld, 0.0).rgb * color;
-		totalLightContribution += blendMaterial(diff, spec, color, metallic, fresnel);
+		if(lightingPass == 1)
+		{
+			outColor = vec4(diffuse, 1.0);
+			outSpecular = vec4(prefiltered, 1.0);
+			return;
+		}
+
+		vec3 totalLightContribution = diffuse * color;
+		totalLightContribution += specularLight * mix(vec3(fresnel), color, metallic);
+		vec3 spec = approximateSpecIBL(prefiltered, mix(vec3(1.0), color, metallic), roughness, NdotV);
+		totalLightContribution += spec * mix(vec3(fresnelIBL), color, metallic);
 
 		// Tone mapping
 		vec3 toneMappedColor = totalLightContribution / (totalLightContribution + vec3(1.0));
@@ -257,5 +362,6 @@ void main()
 
 		outColor = vec4(finalColor, 1.0);
 	}
+	else if(lightingPass == 1) outColor = vec4(0.0);
 	else outColor = vec4(textureLod(tEnvironment, viewWorld, 0.0).rgb, 1.0);
-}
+}
\ No newline at end of file
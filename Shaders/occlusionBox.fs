@@ -0,0 +1,6 @@
+#version 330 core
+
+// Color writes are masked off, only the depth test result counts
+void main()
+{
+}
\ No newline at end of file
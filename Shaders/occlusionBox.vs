@@ -0,0 +1,12 @@
+#version 330 core
+#extension GL_ARB_explicit_uniform_location : enable
+layout (location=0) uniform mat4 viewProjMat;
+layout (location=4) uniform vec3 center;
+layout (location=5) uniform vec3 extents;
+
+layout (location=0) in vec3 inPosition;
+
+void main()
+{
+	gl_Position = viewProjMat * vec4(center + inPosition * extents, 1.0);
+}
\ No newline at end of file
@@ -40,13 +40,13 @@ vec3 importanceSampleGGX(vec2 Xi, float roughness, vec3 normal) // from UE4
 	float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (alpha * alpha - 1.0) * Xi.y));
 	float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
 	
-	vec3 half = vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
+	vec3 halfVector = vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
 	
 	vec3 up = abs(normal.y) < 0.999? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
 	vec3 tangentX = normalize(cross(up, normal));
 	vec3 tangentZ = cross(normal, tangentX);
 	
-	return tangentX * half.x + normal * half.y + tangentZ * half.z;
+	return tangentX * halfVector.x + normal * halfVector.y + tangentZ * halfVector.z;
 }
 
 vec3 prefilter(vec3 ray)
@@ -61,8 +61,8 @@ vec3 prefilter(vec3 ray)
 	for(uint i = 0u; i < numSamples; i++)
 	{
 		vec2 Xi = hammersley(i, numSamples);
-		vec3 half = importanceSampleGGX(Xi, data.roughness, normal);
-		vec3 light = 2.0 * dot(view, half) * half - view;
+		vec3 halfVector = importanceSampleGGX(Xi, data.roughness, normal);
+		vec3 light = 2.0 * dot(view, halfVector) * halfVector - view;
 		
 		float NdotL = dot(normal, light);
 		if(NdotL > 0.0)
@@ -0,0 +1,44 @@
+#version 330 core
+#extension GL_ARB_explicit_uniform_location : enable
+layout (location=0) uniform sampler2D sceneColor;	// Filtered linearly
+layout (location=1) uniform vec2 uvScale;		// Rendered part of sceneColor
+layout (location=2) uniform vec2 texelSize;		// Of sceneColor
+layout (location=3) uniform int edgeAware;
+
+in vec2 passUVCoords;
+
+out vec4 outColor;
+
+float luminance(vec3 color)
+{
+	return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+	// Kept half a texel inside the rendered part so nothing outside it bleeds in
+	vec2 uv = clamp(passUVCoords * uvScale, texelSize * 0.5, uvScale - texelSize * 0.5);
+	vec4 bilinear = texture(sceneColor, uv);
+	if(edgeAware == 0)
+	{
+		outColor = bilinear;
+		return;
+	}
+
+	// The four texels the bilinear result blends, fetched at their centers
+	vec2 position = uv / texelSize - vec2(0.5);
+	vec2 f = fract(position);
+	vec2 base = (floor(position) + vec2(0.5)) * texelSize;
+	vec4 c00 = textureLod(sceneColor, base, 0.0);
+	vec4 c10 = textureLod(sceneColor, base + vec2(texelSize.x, 0.0), 0.0);
+	vec4 c01 = textureLod(sceneColor, base + vec2(0.0, texelSize.y), 0.0);
+	vec4 c11 = textureLod(sceneColor, base + texelSize, 0.0);
+
+	// Taps unlike the blend lose weight, so across an edge the result leans to the
+	// side the pixel is mostly on instead of smearing. Flat areas stay bilinear
+	float l = luminance(bilinear.rgb);
+	vec4 difference = abs(vec4(luminance(c00.rgb), luminance(c10.rgb), luminance(c01.rgb), luminance(c11.rgb)) - vec4(l));
+	vec4 weights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y) / (difference + vec4(0.05));
+
+	outColor = (c00 * weights.x + c10 * weights.y + c01 * weights.z + c11 * weights.w) / dot(weights, vec4(1.0));
+}
\ No newline at end of file
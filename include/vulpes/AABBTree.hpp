@@ -0,0 +1,82 @@
+#ifndef _VUL_AABBTREE_HPP
+#define _VUL_AABBTREE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+
+namespace vul {
+    // Dynamic bounding volume hierarchy. Leaves store boxes fattened by a margin
+    // so small movements don't touch the tree. As leaves are inserted and removed,
+    // each ancestor is rotated when that shrinks the surface area below it, or when
+    // one side is much taller and the rotation costs no area
+    class VEAPI AABBTree {
+    public:
+        // Return the new maximum distance to keep searching, or a negative value to stop
+        typedef std::function<float(uint32_t userData, float maxDistance)> RaycastFunction;
+
+        AABBTree(float margin = .1f);
+        ~AABBTree();
+
+        uint32_t createProxy(const glm::vec3& min, const glm::vec3& max, uint32_t userData);
+        void destroyProxy(uint32_t proxy);
+
+        // Reinserts only if the box left its fattened bounds, returns whether it did
+        bool moveProxy(uint32_t proxy, const glm::vec3& min, const glm::vec3& max);
+
+        uint32_t getUserData(uint32_t proxy) const;
+        void getFatBounds(uint32_t proxy, glm::vec3& min, glm::vec3& max) const;
+
+        // Queries append the user data of leaves whose fattened bounds pass
+        void queryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& results) const;
+        void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const;
+        void queryFrustum(const glm::vec4* planes, std::vector<uint32_t>& results) const; // 6 inward planes
+        void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+            const RaycastFunction& function) const;
+
+        // Distance along the ray where it enters the box, if within maxDistance
+        static bool intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance,
+            const glm::vec3& min, const glm::vec3& max, float& distance);
+
+        uint32_t getHeight() const;
+        uint32_t getProxyCount() const;
+        void clear();
+
+        const static uint32_t nullNode = 0xFFFFFFFF;
+
+    private:
+        struct Node {
+            glm::vec3 min;
+            glm::vec3 max;
+            uint32_t parent; // Next free node while on the free list
+            uint32_t child1;
+            uint32_t child2;
+            int32_t height; // Leaves are 0, free nodes -1
+            uint32_t userData;
+
+            bool isLeaf() const { return child1 == nullNode; }
+        };
+
+        std::vector<Node> m_nodes;
+        uint32_t m_root;
+        uint32_t m_freeList;
+        uint32_t m_proxyCount;
+        float m_margin;
+
+        uint32_t allocateNode();
+        void freeNode(uint32_t node);
+        void insertLeaf(uint32_t leaf);
+        void removeLeaf(uint32_t leaf);
+        void rotate(uint32_t node);
+        void refit(uint32_t node);
+        void collectLeaves(uint32_t node, std::vector<uint32_t>& results, std::vector<uint32_t>& stack) const;
+
+        static float getArea(const glm::vec3& min, const glm::vec3& max);
+    };
+}
+
+#endif // _VUL_AABBTREE_HPP
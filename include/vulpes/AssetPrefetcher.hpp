@@ -0,0 +1,54 @@
+#ifndef _VUL_ASSETPREFETCHER_HPP
+#define _VUL_ASSETPREFETCHER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace vul {
+    // Records the order in which asset files are touched and replays that
+    // order on later launches, pulling the files into the OS page cache on
+    // background threads before the synchronous loaders ask for them
+    class VEAPI AssetPrefetcher {
+    public:
+        AssetPrefetcher();
+        ~AssetPrefetcher();
+
+        bool loadManifest(const std::string& path);
+        bool saveManifest(const std::string& path, double startupTime, double coldStartupTime);
+
+        void start(uint32_t threadCount = 4);
+        void wait();
+
+        void record(const std::string& path);
+
+        uint32_t getManifestFileCount();
+        uint32_t getPrefetchedFileCount();
+        uint64_t getPrefetchedBytes();
+        double getManifestStartupTime(); // In milliseconds, 0 if unknown
+        double getManifestColdStartupTime(); // In milliseconds, 0 if unknown
+
+    private:
+        std::vector<std::string> m_manifestPaths;
+        double m_manifestStartupTime;
+        double m_manifestColdStartupTime;
+
+        std::vector<std::string> m_recordedPaths;
+        std::unordered_set<std::string> m_recordedSet;
+
+        std::vector<std::thread> m_threads;
+        std::atomic<uint32_t> m_nextFile;
+        std::atomic<uint32_t> m_prefetchedFiles;
+        std::atomic<uint64_t> m_prefetchedBytes;
+
+        void prefetchWorker();
+        static uint64_t prefetchFile(const std::string& path);
+    };
+}
+
+#endif // _VUL_ASSETPREFETCHER_HPP
@@ -32,6 +32,10 @@ namespace vul {
         glm::mat4 getProjMatrix();
         glm::mat4 getTranslationMatrix();
 
+        // Left, right, bottom, top, near, far. Normals point inward and are normalized,
+        // so dot(plane.xyz, p) + plane.w is the signed distance of p from the plane
+        const glm::vec4* getFrustumPlanes();
+
         float getNear();
         float getFar();
 
@@ -54,6 +58,7 @@ namespace vul {
         glm::mat4 m_projMatrix;
         glm::mat4 m_viewMatrix;
         glm::mat4 m_translateMatrix;
+        glm::vec4 m_frustumPlanes[6];
     };
 }
 
@@ -1,34 +1,56 @@
 #ifndef _VUL_DEFERREDRENDERER_HPP
 #define _VUL_DEFERREDRENDERER_HPP
 
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "DynamicResolution.hpp"
 #include "Export.hpp"
 #include "GBuffer.hpp"
 #include "Handle.hpp"
+#include "LightGrid.hpp"
+#include "MaterialLibrary.hpp"
 #include "Mesh.hpp"
+#include "OcclusionCuller.hpp"
+#include "OcclusionQueries.hpp"
+#include "RenderQueue.hpp"
 #include "RenderTarget.hpp"
+#include "RingBuffer.hpp"
 #include "Renderer.hpp"
 #include "ResourceLoader.hpp"
 #include "Shader.hpp"
+#include "StaticBatcher.hpp"
+#include "ThreadPool.hpp"
 
 namespace vul {
+    // Camera data is read from the FrameBlock uniform block instead
     enum struct DeferredGeometryUniformLocations {
-        ViewMatrix = 0,
-        ProjectionMatrix = 4,
-        ModelMatrix = 8,
-        NormalMatrix = 12,
-        Near = 15,
         BoneStateArray = 16,
         ColorMap = 781,
         NormalMap = 782,
         RoughnessMap = 783,
-        MetalMap = 784
+        MetalMap = 784,
+        ColorMaps = 786,
+        NormalMaps = 787,
+        RoughnessMaps = 788,
+        MetalMaps = 789,
+        SurfaceInAlbedo = 790
+    };
+
+    // Per-instance vertex attributes of the geometry pass, after the mesh's own
+    enum struct DeferredInstanceAttributeLocations {
+        ModelMatrix = 7, // mat4x3, 4 slots
+        NormalMatrix = 11, // mat3, 3 slots
+        MaterialIndex = 14 // int, the material library record or -1
     };
 
     enum struct DeferredLightUniformLocations {
         ColorBuffer = 0,
         NormalBuffer = 1,
-        DepthBuffer = 2,
-        MiscBuffer = 3,
+        DepthBuffer = 2, // The depth attachment
+        SurfaceBuffer = 3, // Metal and roughness, unused when they are in the albedo alpha
         Near = 4,
         Far = 5,
         InverseViewMatrix = 6,
@@ -36,7 +58,37 @@ namespace vul {
         DiffuseEnvironmentMap = 10,
         EnvironmentMipMaps = 11,
         EnvironmentLUT = 12,
-        LightArray = 13
+        ClusterRanges = 13,
+        LightIndices = 14,
+        Lights = 15,
+        TileScale = 16,
+        DepthSliceCount = 17,
+        DepthSliceScale = 18,
+        DepthSliceBias = 19,
+        SurfaceInAlbedo = 20,
+        UVScale = 21, // Render size over g-buffer size
+        LightingPass = 22, // 0 full resolution, 1 and 2 the half resolution lighting passes
+        HalfDiffuse = 23,
+        HalfSpecular = 24
+    };
+
+    // Uses lightPass.vs
+    enum struct DeferredUpscaleUniformLocations {
+        SceneColor = 0,
+        UVScale = 1,
+        TexelSize = 2,
+        EdgeAware = 3
+    };
+
+    enum struct UpscaleFilter {
+        Bilinear,
+        EdgeAware // Down-weights taps far in luminance from the bilinear result, keeping edges sharper
+    };
+
+    // G-buffer targets, position is always rebuilt from the depth attachment
+    enum struct GBufferLayout {
+        Compact, // Albedo RGBA8, octahedral normal RG16, metal and roughness RG8
+        Packed // Albedo RGB8 with metal and roughness at 4 bits each in alpha, octahedral normal RG16
     };
 
     class VEAPI DeferredRenderer : public Renderer {
@@ -54,10 +106,78 @@ namespace vul {
         void setWireframeMode(bool) override;
         void setClearColor(float r, float g, float b, float a = 1.f);
 
+        // Compact by default. Formats of single targets can be changed through getGBuffer,
+        // as long as they keep the channels the layout writes
+        void setGBufferLayout(GBufferLayout);
+        Handle<GBuffer> getGBuffer();
+
+        // Off by default. The g-buffer and light pass only cover the controller's share
+        // of the full resolution, then an upscale pass fills the target. Targets keep
+        // their full size so resolution changes never reallocate. Needs upscale.fs and
+        // the GPU profiler set first, frames are timed with it
+        void setDynamicResolution(bool);
+        Handle<DynamicResolution> getDynamicResolution();
+        void setUpscaleFilter(UpscaleFilter); // EdgeAware by default
+
+        // Off by default. Diffuse and environment lighting are evaluated at half resolution
+        // and upsampled with depth and normal aware weights, point light specular stays
+        // at full resolution
+        void setHalfResolutionLighting(bool);
+
+        // Off by default. Depth is laid down by a position only shader first, then the
+        // g-buffer pass tests for equality with depth writes off, shading each pixel once.
+        // Pays off with heavy overdraw such as dense foliage, whether it does for a scene
+        // shows in getGeometryPassTime with it on and off. Needs the geometryDepth shaders
+        void setDepthPrepass(bool);
+        double getGeometryPassTime(); // The GPU profiler's "geometry" pass, prepass included, 0 without a profiler
+
+        // Off by default, for debugging. Fragments the g-buffer pass shades are counted
+        // per pixel in a stencil buffer read back each frame, which stalls the pipeline
+        void setOverdrawStatistics(bool);
+        const uint8_t* getOverdrawCounts(); // Render size, bottom row first, saturating at 255
+        float getAverageOverdraw(); // Shaded fragments per covered pixel
+        uint32_t getMaxOverdraw();
+
+        // Off by default, only pays off when occluders hide a large part of the scene
+        void setOcclusionCulling(bool);
+        Handle<OcclusionCuller> getOcclusionCuller();
+
+        // Hardware queries from previous frames decide which objects are drawn,
+        // needs the occlusionBox shaders
+        void setOcclusionQueries(bool);
+        Handle<OcclusionQueries> getOcclusionQueries();
+
+        // On by default, objects sharing a mesh and material are drawn with one call
+        void setInstancing(bool);
+
+        // On by default, draws are ordered by state and depth instead of scene order
+        void setDrawSorting(bool);
+
+        // Culling and draw list building are split across the pool's threads, and so
+        // are occlusion culling and light clustering. GL calls stay on the calling thread
+        void setThreadPool(ThreadPool&);
+        double getDrawListTime(); // Milliseconds spent building last frame's draw list, part of the submit time
+        std::vector<uint32_t> getDrawOrder(); // Renderable indices of last frame's instances as drawn
+
+        // Once built, static objects it merged are drawn through it instead of one by one
+        Handle<StaticBatcher> getStaticBatcher();
+
+        // Once built, materials it contains are drawn from its texture arrays and records
+        Handle<MaterialLibrary> getMaterialLibrary();
+
+        // Point lights are binned into view space clusters each frame, the light pass
+        // only evaluates those in a pixel's cluster
+        Handle<LightGrid> getLightGrid();
+        double getLightCullTime(); // Milliseconds spent clustering lights last frame
+        double getLightPassTime(); // The GPU profiler's "light" pass, 0 without a profiler
+
     private:
         GBuffer m_gbuffer;
+        GBufferLayout m_gbufferLayout;
         Handle<Shader> m_geometryShader;
         Handle<Shader> m_lightShader;
+        Handle<Shader> m_upscaleShader;
+        Handle<Shader> m_depthShader;
         Handle<Texture> m_defaultColorMap;
         Handle<Texture> m_defaultNormalMap;
         Handle<Texture> m_defaultRoughnessMap;
@@ -69,8 +189,81 @@ namespace vul {
         float m_color[4];
         bool m_wireframe;
 
+        std::vector<uint8_t> m_cullResults; // Renderables that survived culling this frame
+        OcclusionCuller m_occlusionCuller;
+        bool m_occlusionCulling;
+        OcclusionQueries m_occlusionQueries;
+        bool m_useOcclusionQueries;
+
+        struct InstanceData {
+            glm::mat4x3 modelMatrix;
+            glm::mat3 normalMatrix;
+            int32_t materialIndex;
+        };
+
+        struct DrawBatch {
+            uint32_t meshID;
+            uint32_t materialID;
+            uint32_t firstInstance; // Into m_instanceData
+            uint32_t instanceCount;
+            uint32_t index; // Renderable index of the first instance
+            uint32_t id; // Renderable ID, only set for queried draws
+            QueryVisibility visibility;
+            bool queried;
+        };
+
+        // Draw packets and their sort keys, one list per scene chunk so none are locked
+        struct DrawList {
+            std::vector<DrawBatch> candidates;
+            std::vector<uint64_t> keys;
+            uint32_t culledCount;
+        };
+
+        std::vector<DrawList> m_drawLists;
+        RenderQueue m_renderQueue; // Values index m_drawCandidates
+        std::vector<DrawBatch> m_drawCandidates; // All lists merged
+        std::vector<DrawBatch> m_drawBatches;
+        std::vector<InstanceData> m_instanceData;
+        RingBuffer m_frameRing; // Per-frame data of the geometry pass
+        int32_t m_uniformAlignment;
+        bool m_instancing;
+        bool m_drawSorting;
+        StaticBatcher m_staticBatcher;
+        MaterialLibrary m_materialLibrary;
+        LightGrid m_lightGrid;
+        double m_lightCullTime;
+        double m_drawListTime;
+        ThreadPool* m_threadPool;
+
+        DynamicResolution m_dynamicResolution;
+        bool m_useDynamicResolution;
+        UpscaleFilter m_upscaleFilter;
+        uint32_t m_sceneColorFBO; // Light pass output when rendering below full resolution
+        uint32_t m_sceneColorTexture;
+
+        bool m_halfResolutionLighting;
+        uint32_t m_halfLightingFBO;
+        uint32_t m_halfLightingTextures[2]; // Diffuse light and prefiltered environment
+
+        bool m_depthPrepass;
+        bool m_overdrawStatistics;
+        std::vector<uint8_t> m_overdrawCounts;
+        float m_averageOverdraw;
+        uint32_t m_maxOverdraw;
+
+        void cullObjects();
+        bool isStaticBatched(uint32_t index, const uint16_t* flags);
+        int32_t materialRecordIndex(uint32_t materialID);
+        void buildDrawBatches();
         void geometryPass();
+        void readOverdraw();
         void lightPass(RenderTarget* renderTarget);
+        void upscalePass(RenderTarget* renderTarget);
+
+        bool createSceneColor();
+        void releaseSceneColor();
+        bool createHalfLighting();
+        void releaseHalfLighting();
 
         void createQuad();
     };
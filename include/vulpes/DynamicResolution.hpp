@@ -0,0 +1,61 @@
+#ifndef _VUL_DYNAMICRESOLUTION_HPP
+#define _VUL_DYNAMICRESOLUTION_HPP
+
+#include <cstdint>
+#include <deque>
+
+#include "Export.hpp"
+#include "GPUProfiler.hpp"
+
+namespace vul {
+    // Picks the internal render resolution to hold a target GPU frame time. Each
+    // frame's GPU work is timed as a pass of a GPUProfiler, so the scale reacts a few
+    // frames late but measuring never stalls. Cost is taken as proportional to pixel
+    // count, so the scale follows the square root of the time ratio, shrinking quickly
+    // when over budget and growing back slowly
+    class VEAPI DynamicResolution {
+    public:
+        DynamicResolution();
+        ~DynamicResolution();
+
+        bool initialize(GPUProfiler&);
+        void release();
+        bool isInitialized();
+
+        void setTargetFrameTime(double milliseconds); // 16.6 by default
+        double getTargetFrameTime();
+
+        // Per axis, 0.5 to 1 by default
+        void setScaleBounds(float minimum, float maximum);
+        float getMinimumScale();
+        float getMaximumScale();
+
+        // Current per axis scale, applied to the full resolution by the renderer
+        float getScale();
+
+        // Wrap the GPU work to measure, once per profiler frame, which the engine's
+        // profiler ends in Engine::swapFrameBuffers. beginFrame also adjusts the scale
+        // with any measurements that came back
+        void beginFrame();
+        void endFrame();
+
+        // One step of the controller from a frame rendered at timedScale, which may be
+        // older than the current scale. Returns the new scale
+        float update(double gpuTime, float timedScale);
+
+        double getGPUTime(); // Milliseconds, the latest measured frame
+
+        static const char* const framePass; // Name of the pass frames are timed under
+
+    private:
+        GPUProfiler* m_profiler;
+        uint64_t m_collectedCount; // Profiler samples already used
+        std::deque<float> m_timedScales; // Scale of each measured frame not collected yet, oldest first
+
+        double m_targetFrameTime;
+        float m_minimumScale, m_maximumScale;
+        float m_scale;
+    };
+}
+
+#endif // _VUL_DYNAMICRESOLUTION_HPP
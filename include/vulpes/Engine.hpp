@@ -2,8 +2,10 @@
 #define _VUL_ENGINE_HPP
 
 #include "Export.hpp"
+#include "GPUProfiler.hpp"
 #include "Handle.hpp"
 #include "InputHandler.hpp"
+#include "ThreadPool.hpp"
 #include "Window.hpp"
 #include "WindowCreationParameters.hpp"
 
@@ -24,10 +26,14 @@ namespace vul {
 
         Handle<Window> getWindow();
         Handle<InputHandler> getInputHandler();
+        Handle<ThreadPool> getThreadPool(); // One worker per spare hardware thread
+        Handle<GPUProfiler> getGPUProfiler(); // Frames end with swapFrameBuffers
 
     private:
-        Window m_window;
+        Window m_window; // First, so the context outlives everything holding GL objects
         InputHandler m_inputHandler;
+        ThreadPool m_threadPool;
+        GPUProfiler m_gpuProfiler;
         double m_deltaTime64;
         float m_deltaTime;
         uint32_t m_fps;
@@ -1,23 +1,103 @@
 #ifndef _VUL_FORWARDRENDERER_HPP
 #define _VUL_FORWARDRENDERER_HPP
 
+#include <cstdint>
+#include <vector>
+
 #include "Export.hpp"
 #include "Handle.hpp"
+#include "LightGrid.hpp"
+#include "Mesh.hpp"
+#include "RenderQueue.hpp"
+#include "RenderTarget.hpp"
 #include "Renderer.hpp"
+#include "ResourceLoader.hpp"
 #include "Shader.hpp"
 
 namespace vul {
+    // Forward+ rendering: an optional depth prepass, point lights binned into screen
+    // tiles on the CPU, then one pass shading each object with its tiles' lights.
+    // Lighting matches DeferredRenderer's, without its g-buffer bandwidth.
+    // Meshes carry no bone weights, so objects with a skeleton aren't drawn
     class VEAPI ForwardRenderer : public Renderer {
     public:
-        ForwardRenderer();
+        ForwardRenderer(ResourceLoader&);
         ~ForwardRenderer();
 
+        void setCamera(Camera&) override;
+        // Image based lighting is left out until both environments are set
+        void setActiveEnvironment(Handle<Texture>&);
+        void setActiveDiffuseEnvironment(Handle<Texture>&);
+
         void render() override;
+        void render(RenderTarget* renderTarget); // Given a depth buffer if it has none
 
         void setWireframeMode(bool) override;
+        void setClearColor(float r, float g, float b, float a = 1.f);
+
+        // Off by default, lays down depth first so only visible fragments are shaded
+        void setDepthPrepass(bool);
+
+        // Depth slices set on the grid are followed by the shading pass
+        Handle<LightGrid> getLightGrid();
+
+        // Milliseconds of CPU time spent on each stage last frame, culling and
+        // total submission are in getCullTime and getSubmitTime
+        double getPrepassTime();
+        double getLightCullTime();
+        double getShadingTime();
 
     private:
-        Handle<Shader> m_shader;
+        // Looked up by name once the shaders are loaded
+        struct ShadingUniforms {
+            int32_t viewMatrix, projectionMatrix, modelMatrix, normalMatrix;
+            int32_t colorMap, normalMap, roughnessMap, metalMap;
+            int32_t inverseViewMatrix, environmentMap, diffuseEnvironmentMap, environmentMipMaps, environmentLUT;
+            int32_t environmentLighting;
+            int32_t tileRanges, lightIndices, lights, tileCountX;
+            int32_t depthSliceCount, depthSliceScale, depthSliceBias;
+        };
+
+        struct DepthUniforms {
+            int32_t viewMatrix, projectionMatrix, modelMatrix;
+        };
+
+        struct BackgroundUniforms {
+            int32_t inverseViewMatrix, inverseProjectionScale, environmentMap;
+        };
+
+        Handle<Shader> m_shadingShader;
+        Handle<Shader> m_depthShader;
+        Handle<Shader> m_backgroundShader;
+        ShadingUniforms m_shadingUniforms;
+        DepthUniforms m_depthUniforms;
+        BackgroundUniforms m_backgroundUniforms;
+        Handle<Texture> m_defaultColorMap;
+        Handle<Texture> m_defaultNormalMap;
+        Handle<Texture> m_defaultRoughnessMap;
+        Handle<Texture> m_defaultMetalMap;
+        Handle<Texture> m_environmentMap;
+        Handle<Texture> m_diffuseEnvironmentMap;
+        Handle<Texture> m_environmentLUT;
+        Handle<Mesh> m_quad;
+        float m_color[4];
+        bool m_wireframe;
+        bool m_depthPrepass;
+
+        LightGrid m_lightGrid;
+        std::vector<uint8_t> m_cullResults;
+        RenderQueue m_renderQueue; // Values are renderable indices
+        double m_prepassTime;
+        double m_lightCullTime;
+        double m_shadingTime;
+
+        void cullObjects();
+        void depthPrepass();
+        void cullLights();
+        void shadingPass();
+        void drawBackground();
+
+        void cacheUniformLocations();
     };
 }
 
@@ -0,0 +1,27 @@
+#ifndef _VUL_FRUSTUMCULLER_HPP
+#define _VUL_FRUSTUMCULLER_HPP
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+
+namespace vul {
+    // Tests packed world space bounds against frustum planes, 4 objects at a time
+    // with SSE. Each object has a sphere (center, radius) and the half extents of
+    // a box sharing that center; it is culled if either lies outside any plane
+    class VEAPI FrustumCuller {
+    public:
+        // Sets results[i] to 1 for objects that may be visible and 0 for culled
+        // objects, for i in [begin, end). Planes are in Camera::getFrustumPlanes order
+        static void cull(const glm::vec4* planes, const glm::vec4* spheres, const glm::vec4* extents,
+            uint32_t begin, uint32_t end, uint8_t* results);
+
+        // Reference implementation, one object at a time
+        static void cullScalar(const glm::vec4* planes, const glm::vec4* spheres, const glm::vec4* extents,
+            uint32_t begin, uint32_t end, uint8_t* results);
+    };
+}
+
+#endif // _VUL_FRUSTUMCULLER_HPP
@@ -14,6 +14,24 @@ namespace vul {
         bool initialize(uint32_t windowWidth, uint32_t windowHeight, uint32_t scalingFactor = 1);
         void release();
 
+        // Color targets and their sized internal formats, such as GL_RGBA8 or GL_RG16.
+        // Changing either rebuilds an initialized g-buffer
+        void setTextureCount(uint32_t);
+        void setTextureFormat(uint32_t index, uint32_t internalFormat);
+        uint32_t getTextureCount();
+        uint32_t getTextureFormat(uint32_t index);
+
+        // Off by default, gives the depth attachment an 8 bit stencil
+        void setDepthStencil(bool);
+
+        // Part of the targets drawn and read, from the bottom left corner. Lowering it
+        // renders at a lower resolution without reallocating, the full size by default
+        void setRenderSize(uint32_t width, uint32_t height);
+        uint32_t getRenderWidth();
+        uint32_t getRenderHeight();
+        uint32_t getWidth(); // Allocated size
+        uint32_t getHeight();
+
         void bindWrite();
         void endWrite();
 
@@ -21,15 +39,19 @@ namespace vul {
         void setReadBuffer(uint32_t index);
 
         void bindTexture(uint32_t index);
+        void bindDepthTexture(); // Hardware depth, readable as a regular texture
 
     private:
         uint32_t m_fbo; // Frame buffer object
         const static uint32_t m_maxTextures = 8;
         uint32_t m_textureCount;
         uint32_t m_textures[m_maxTextures];
+        uint32_t m_formats[m_maxTextures];
         uint32_t m_depthTexture;
+        bool m_depthStencil;
         uint32_t m_windowWidth, m_windowHeight;
         uint32_t m_scalingFactor;
+        uint32_t m_renderWidth, m_renderHeight;
         bool m_loaded;
     };
 }
@@ -0,0 +1,90 @@
+#ifndef _VUL_GPUPROFILER_HPP
+#define _VUL_GPUPROFILER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace vul {
+    // GPU time of named passes, from timestamp queries around each of them. A frame's
+    // results are read once all of its queries are available, usually a few frames
+    // later, so profiling never stalls the pipeline. Passes running several times in a
+    // frame are summed, and each pass keeps a rolling history of per frame times.
+    // Queries are deleted on destruction, so it must go before the OpenGL context
+    class VEAPI GPUProfiler {
+    public:
+        GPUProfiler(uint32_t historyLength = 128);
+        ~GPUProfiler();
+
+        bool initialize();
+        void release();
+        bool isInitialized();
+
+        // Passes may nest, but the same pass can't be open twice at once
+        void begin(const std::string& pass);
+        void end(const std::string& pass);
+
+        // Closes the current frame and reads the ones whose queries came back
+        void endFrame();
+
+        // Begins a pass for as long as it is in scope, does nothing without a profiler
+        class VEAPI Scope {
+        public:
+            Scope(GPUProfiler*, const char* pass);
+            ~Scope();
+
+        private:
+            GPUProfiler* m_profiler;
+            const char* m_pass;
+        };
+
+        // In order of first use
+        std::vector<std::string> getPassNames();
+
+        // Milliseconds over the pass's history, 0 for passes without results yet
+        uint32_t getSampleCount(const std::string& pass);
+        double getLatest(const std::string& pass);
+        double getAverage(const std::string& pass);
+        double getPercentile(const std::string& pass, double percentile); // 0 to 100
+
+        // Results read since the pass was first used, neither capped by the history
+        // nor reset by clearHistory
+        uint64_t getTotalSampleCount(const std::string& pass);
+
+        void clearHistory();
+
+    private:
+        struct Pass {
+            std::string name;
+            std::vector<double> history; // Ring of per frame times
+            uint32_t next;
+            uint32_t count;
+            uint64_t totalCount;
+            double frameTime; // Sum of the frame being read
+        };
+
+        struct Interval {
+            uint32_t pass;
+            uint32_t start, end; // Timestamp queries
+        };
+
+        std::vector<Pass> m_passes;
+        std::unordered_map<std::string, uint32_t> m_passIndices;
+        std::deque<std::vector<Interval>> m_frames; // Pending frames, oldest first, then the current one
+        std::vector<uint32_t> m_openIntervals; // Into the current frame
+        std::vector<uint32_t> m_freeQueries;
+        std::vector<double> m_scratch;
+        uint32_t m_historyLength;
+        bool m_initialized;
+
+        Pass* findPass(const std::string& pass);
+        uint32_t getQuery();
+        bool readFrame(const std::vector<Interval>&);
+    };
+}
+
+#endif // _VUL_GPUPROFILER_HPP
@@ -42,6 +42,7 @@ namespace vul {
         bool isLoaded() { return m_loaded; }
 
         T* operator->() { return m_data; }
+        T& operator*() { return *m_data; }
 
         T makeCopy() const { return T(*m_data); }
 
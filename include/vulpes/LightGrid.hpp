@@ -0,0 +1,88 @@
+#ifndef _VUL_LIGHTGRID_HPP
+#define _VUL_LIGHTGRID_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+#include "ThreadPool.hpp"
+
+namespace vul {
+    class Scene;
+
+    // Clusters of the view frustum, each listing the point lights that may reach it.
+    // The screen is split into tiles of tileSize pixels and depth into slices spaced
+    // exponentially from near to far. Lights are bounded by spheres in view space and
+    // tested against the side planes of every tile column and row, 4 lights at a time
+    // with SSE; a cluster's list is what its column, row and slice share. With one
+    // slice, the default, the clusters are plain screen tiles
+    class VEAPI LightGrid {
+    public:
+        LightGrid();
+        ~LightGrid();
+
+        void setDepthSliceCount(uint32_t);
+        uint32_t getDepthSliceCount();
+
+        // Columns, rows and cluster lists are split across the pool's threads
+        void setThreadPool(ThreadPool&);
+
+        // Lights entirely in front of near or behind far are left out of every list
+        void build(Scene&, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
+            float near, float far, uint32_t width, uint32_t height);
+
+        // Copies the lists into buffer textures, read by shaders with texelFetch:
+        //  - cluster ranges, RG32UI (first index, light count), at
+        //    (tileY * tileCountX + tileX) * depthSliceCount + slice, tiles from the bottom left
+        //  - light indices, R32UI
+        //  - lights, RGBA32F, two texels each: (view position, radius), (color * brightness, 0)
+        void upload();
+        void bind(uint32_t firstUnit); // Cluster ranges, indices and lights on consecutive units
+        void release();
+
+        uint32_t getTileCountX();
+        uint32_t getTileCountY();
+        uint32_t getLightCount(); // Lights kept this frame
+        uint32_t getIndexCount(); // Sum of all clusters' list lengths
+
+        // The slice at view depth d is floor(log(d) * scale + bias)
+        float getDepthSliceScale();
+        float getDepthSliceBias();
+
+        // Indices into the kept lights, in scene order
+        uint32_t getTileLightCount(uint32_t tileX, uint32_t tileY, uint32_t slice = 0);
+        const uint32_t* getTileLights(uint32_t tileX, uint32_t tileY, uint32_t slice = 0);
+
+        static const uint32_t tileSize = 16;
+
+    private:
+        // Kept lights in view space, split by component and padded to a multiple of 4
+        std::vector<float> m_lightX, m_lightY, m_lightZ, m_lightRadius;
+        std::vector<glm::vec4> m_lightData;
+
+        // One bit per light, m_maskWords words for each column and row
+        std::vector<uint32_t> m_columnMasks, m_rowMasks;
+        std::vector<int32_t> m_lightSlices; // First and last slice of each light
+        std::vector<uint32_t> m_clusterRanges;
+        std::vector<uint32_t> m_lightIndices;
+        std::vector<std::vector<uint32_t>> m_rowIndices; // Lists of each tile row before merging
+        std::vector<std::vector<uint32_t>> m_scratch; // Per thread
+        uint32_t m_tileCountX, m_tileCountY;
+        uint32_t m_depthSliceCount;
+        float m_depthSliceScale, m_depthSliceBias;
+        uint32_t m_lightCount;
+        uint32_t m_maskWords;
+        ThreadPool* m_threadPool;
+
+        uint32_t m_buffers[3];
+        uint32_t m_textures[3];
+
+        // Sets the bits of lights on the inner side of both planes through the eye
+        void testPlanes(const glm::vec3& first, const glm::vec3& second, uint32_t* mask);
+        void buildRow(uint32_t tileY, std::vector<uint32_t>& tileLights);
+    };
+}
+
+#endif // _VUL_LIGHTGRID_HPP
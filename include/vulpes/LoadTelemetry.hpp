@@ -0,0 +1,60 @@
+#ifndef _VUL_LOADTELEMETRY_HPP
+#define _VUL_LOADTELEMETRY_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace vul {
+    enum struct AssetType {
+        Mesh,
+        Texture,
+        CubeMap,
+        Shader,
+        Skeleton,
+        Count
+    };
+
+    struct LoadRecord {
+        std::string path;
+        AssetType type = AssetType::Mesh;
+        bool cacheHit = false;
+        bool succeeded = false;
+        double readTime = 0.0; // In milliseconds
+        double parseTime = 0.0; // In milliseconds
+        double uploadTime = 0.0; // In milliseconds, CPU side of the GL calls only
+        uint64_t bytesRead = 0;
+        uint64_t bytesUploaded = 0;
+
+        double getTotalTime() const { return readTime + parseTime + uploadTime; }
+    };
+
+    class VEAPI LoadTelemetry {
+    public:
+        LoadTelemetry(uint32_t capacity = 1024);
+        ~LoadTelemetry();
+
+        void addRecord(const LoadRecord&);
+        void clear();
+
+        uint32_t getRecordCount();
+        LoadRecord getRecord(uint32_t index); // 0 is the oldest record still in the ring
+
+        bool dumpCSV(const std::string& path);
+        bool dumpJSON(const std::string& path);
+
+        // Slowest assets followed by totals per asset type
+        std::string getReport(uint32_t slowestCount = 10);
+
+        static const char* getAssetTypeName(AssetType);
+
+    private:
+        std::vector<LoadRecord> m_records; // Ring buffer
+        uint32_t m_next;
+        uint32_t m_count;
+    };
+}
+
+#endif // _VUL_LOADTELEMETRY_HPP
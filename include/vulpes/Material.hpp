@@ -0,0 +1,15 @@
+#ifndef _VUL_MATERIAL_HPP
+#define _VUL_MATERIAL_HPP
+
+#include "Texture.hpp"
+
+namespace vul {
+    struct Material {
+        Texture colorMap; // Analogous with albedo map
+        Texture normalMap;
+        Texture roughnessMap;
+        Texture metalMap;
+    };
+}
+
+#endif // _VUL_MATERIAL_HPP
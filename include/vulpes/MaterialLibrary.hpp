@@ -0,0 +1,86 @@
+#ifndef _VUL_MATERIALLIBRARY_HPP
+#define _VUL_MATERIALLIBRARY_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+
+namespace vul {
+    class Scene;
+
+    // Map slots of a material, in the order of Material's textures
+    enum struct MaterialMap {
+        Color = 0,
+        Normal = 1,
+        Roughness = 2,
+        Metal = 3
+    };
+
+    // Every scene material packed for the geometry pass. Maps of the same size and
+    // format share a texture array, 1x1 maps and missing ones become constant factors.
+    // Each material is a record in a uniform buffer indexed by its ID, so materials
+    // whose maps live in the same arrays draw without binding anything in between
+    class VEAPI MaterialLibrary {
+    public:
+        MaterialLibrary();
+        ~MaterialLibrary();
+
+        // Texture data is read back from GL, so this belongs in scene loading. Materials
+        // created afterwards aren't contained until it is called again. The original
+        // textures are left alone
+        bool build(Scene&);
+        void release();
+        bool isBuilt();
+        bool contains(uint32_t materialID);
+
+        // Array holding one of the material's maps, 0 when the map is a constant
+        uint32_t getArray(uint32_t materialID, MaterialMap);
+
+        // Uniform blocks are limited in size, so records are split into pages of
+        // recordsPerPage. Binds the material's page, whose records the shader indexes
+        // with getRecordIndex
+        uint32_t getPage(uint32_t materialID);
+        uint32_t getRecordIndex(uint32_t materialID);
+        void bindPage(uint32_t page, uint32_t blockBinding);
+
+        uint32_t getArrayCount();
+        uint32_t getPackedMapCount(); // Distinct textures copied into arrays
+        uint32_t getConstantMapCount(); // Maps turned into factors
+
+        static const uint32_t recordsPerPage = 256;
+
+    private:
+        // std140 layout, layers are -1 for maps given by their factor
+        struct Record {
+            glm::ivec4 layers;
+            glm::vec4 colorFactor;
+            glm::vec4 normalFactor; // Tangent space, encoded like a normal map texel
+            glm::vec4 surfaceFactor; // x = roughness, y = metal
+        };
+
+        struct Array {
+            uint32_t handle = 0;
+            uint32_t width;
+            uint32_t height;
+            int32_t internalFormat;
+            uint32_t levelCount;
+            bool compressed;
+            std::vector<uint32_t> textures; // Source texture of each layer
+        };
+
+        std::vector<Array> m_arrays;
+        std::vector<std::array<uint32_t, 4>> m_materialArrays; // Array handles by material ID
+        uint32_t m_buffer;
+        uint32_t m_pageStride; // Bytes, padded to the uniform buffer offset alignment
+        uint32_t m_materialCount;
+        uint32_t m_packedMapCount;
+        uint32_t m_constantMapCount;
+        bool m_built;
+    };
+}
+
+#endif // _VUL_MATERIALLIBRARY_HPP
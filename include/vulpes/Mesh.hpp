@@ -2,6 +2,9 @@
 #define _VUL_MESH_HPP
 
 #include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
 
 #include "Skeleton.hpp"
 
@@ -10,7 +13,15 @@ namespace vul {
         uint32_t vao = 0; // Handle to vertex array object
         uint32_t ib = 0; // Handle to index buffer
         uint32_t ic = 0; // Index count
+        glm::vec3 boundsMin; // Local space axis-aligned bounding box
+        glm::vec3 boundsMax;
+        glm::vec3 boundingCenter; // Local space bounding sphere
+        float boundingRadius = -1.f; // Negative if bounds are unknown, such meshes are never culled
         BoneNameToIndexMap boneNameToIndex;
+
+        // CPU copy of the triangles for software occlusion, only kept when requested at load
+        std::vector<glm::vec3> occluderVertices;
+        std::vector<uint32_t> occluderIndices;
     };
 }
 
@@ -0,0 +1,87 @@
+#ifndef _VUL_OCCLUSIONCULLER_HPP
+#define _VUL_OCCLUSIONCULLER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+#include "ThreadPool.hpp"
+
+namespace vul {
+    class Scene;
+
+    // Software occlusion culling. Renderables flagged as occluders are rasterized
+    // on the CPU into a small depth buffer of 1/w values (larger is closer), split
+    // into 8x8 tiles that keep their farthest and nearest depth. Object bounds are
+    // then rejected when every pixel they could cover already holds something closer
+    class VEAPI OcclusionCuller {
+    public:
+        // Sizes are rounded up to whole tiles
+        OcclusionCuller(uint32_t width = 256, uint32_t height = 128);
+        ~OcclusionCuller();
+
+        // Rasterization and testing are split across the pool's threads
+        void setThreadPool(ThreadPool&);
+
+        // results holds one entry per renderable in Scene index order, nonzero for
+        // objects still to be drawn (the frustum test output). Visible occluders are
+        // rasterized, then every remaining object that is hidden is set to 0.
+        // Returns the number of objects rejected
+        uint32_t cull(Scene&, const glm::mat4& viewProjection, uint8_t* results);
+
+        // Building blocks of cull, usable on their own
+        void clear();
+        void rasterizeOccluders(Scene&, const glm::mat4& viewProjection, const uint8_t* results);
+        bool isOccluded(const glm::vec3& center, const glm::vec3& extents, const glm::mat4& viewProjection) const;
+
+        uint32_t getWidth() const;
+        uint32_t getHeight() const;
+        const float* getDepthBuffer() const; // Row major, bottom row first
+
+        // Statistics for the last cull
+        uint32_t getOccluderCount();
+        uint32_t getTriangleCount(); // Occluder triangles that reached the depth buffer
+        uint32_t getTestedCount();
+        uint32_t getOccludedCount();
+        float getOcclusionRate(); // Occluded / tested
+        double getRasterTime(); // Milliseconds
+        double getTestTime(); // Milliseconds
+
+        static const char* getInstructionSet();
+
+    private:
+        struct Triangle {
+            float x[3], y[3]; // Screen space
+            float depth[3]; // 1/w
+        };
+
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_tilesX;
+        uint32_t m_tilesY;
+        std::vector<float> m_depth;
+        std::vector<float> m_tileFarthest;
+        std::vector<float> m_tileNearest;
+        ThreadPool* m_threadPool;
+
+        // Per thread scratch, merged by the band rasterizer
+        std::vector<std::vector<Triangle>> m_triangles;
+        std::vector<std::vector<glm::vec4>> m_clipVertices;
+        std::vector<uint32_t> m_occluderIndices;
+        std::vector<uint32_t> m_threadCounts;
+
+        uint32_t m_occluderCount;
+        uint32_t m_triangleCount;
+        uint32_t m_testedCount;
+        uint32_t m_occludedCount;
+        double m_rasterTime;
+        double m_testTime;
+
+        void setupTriangle(const glm::vec4* clip, std::vector<Triangle>& triangles) const;
+        void rasterizeBand(uint32_t tileRow);
+    };
+}
+
+#endif // _VUL_OCCLUSIONCULLER_HPP
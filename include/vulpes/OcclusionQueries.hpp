@@ -0,0 +1,95 @@
+#ifndef _VUL_OCCLUSIONQUERIES_HPP
+#define _VUL_OCCLUSIONQUERIES_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+#include "Handle.hpp"
+#include "Mesh.hpp"
+#include "ResourceLoader.hpp"
+#include "Shader.hpp"
+
+namespace vul {
+    enum struct OcclusionBoxUniformLocations {
+        ViewProjectionMatrix = 0,
+        Center = 4,
+        Extents = 5
+    };
+
+    // What the last finished query says about an object
+    enum struct QueryVisibility {
+        Visible, // Draw it inside a new query
+        Hidden, // Skip the draw and test its bounding box after the pass
+        Pending // Result not back yet, draw it with conditional rendering
+    };
+
+    // Hardware occlusion queries keyed by renderable ID. Each object's query from
+    // an earlier frame decides whether it is drawn, and results are only read once
+    // the GPU reports them available, so the pipeline never stalls
+    class VEAPI OcclusionQueries {
+    public:
+        OcclusionQueries();
+        ~OcclusionQueries();
+
+        bool initialize(ResourceLoader&);
+        void release();
+        bool isInitialized();
+
+        // Collects finished results, call once per frame before any of the below
+        void beginFrame();
+
+        QueryVisibility getVisibility(uint32_t id);
+
+        // Wrap the draw of a Visible object, or a Pending one with the conditional pair
+        void beginQuery(uint32_t id);
+        void endQuery();
+        void beginConditionalDraw(uint32_t id);
+        void endConditionalDraw();
+
+        // Hidden objects are not drawn, their world bounds are retested once all draws
+        // are done, with color and depth writes off so the boxes leave no trace
+        void skipDraw(uint32_t id, const glm::vec3& center, const glm::vec3& extents);
+        void testBoxes(const glm::mat4& viewProjection);
+
+        // Statistics for the last frame
+        uint32_t getQueryCount(); // Queries issued
+        uint32_t getSkippedDrawCount(); // Draws skipped because the object was hidden
+        uint32_t getConditionalDrawCount(); // Draws left for the GPU to decide
+
+    private:
+        struct Query {
+            uint32_t handle = 0;
+            uint64_t lastUsedFrame = 0;
+            bool pending = false;
+            bool visible = true;
+        };
+
+        struct BoxTest {
+            uint32_t id;
+            glm::vec3 center;
+            glm::vec3 extents;
+        };
+
+        std::unordered_map<uint32_t, Query> m_queries;
+        std::vector<uint32_t> m_freeHandles;
+        std::vector<BoxTest> m_boxTests;
+        Handle<Shader> m_boxShader;
+        Mesh m_boxMesh;
+        uint32_t m_boxVertexBuffer; // Mesh has no slot for it, the VAO only references it
+        uint64_t m_frame;
+        bool m_initialized;
+
+        uint32_t m_queryCount;
+        uint32_t m_skippedDrawCount;
+        uint32_t m_conditionalDrawCount;
+
+        Query& getQuery(uint32_t id);
+        void createBox();
+    };
+}
+
+#endif // _VUL_OCCLUSIONQUERIES_HPP
@@ -11,6 +11,9 @@ namespace vul {
     public:
         PointLight(uint32_t id);
         PointLight(const PointLight&);
+        PointLight& operator=(const PointLight&) = default; // Scene moves lights when removing
+
+        Transformation& getTransformation() override;
 
         void setColor(const glm::vec3&);
         void setBrightness(float);
@@ -21,6 +24,7 @@ namespace vul {
         float getRadius();
 
     private:
+        Transformation m_transformation;
         glm::vec3 m_color;
         float m_brightness; // In lumens
         float m_radius; // Distance until falloff is zero
@@ -0,0 +1,77 @@
+#ifndef _VUL_PROFILER_HPP
+#define _VUL_PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "Export.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VUL_PROFILE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif // _MSC_VER
+#endif
+
+// Zones only exist in builds with VULPES_PROFILING defined, otherwise the macros
+// expand to nothing. Zone names must be string literals or otherwise outlive the trace
+#ifdef VULPES_PROFILING
+#define VUL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VUL_PROFILE_CONCAT(a, b) VUL_PROFILE_CONCAT_IMPL(a, b)
+#define VUL_PROFILE_ZONE(name) ::vul::ProfileZone VUL_PROFILE_CONCAT(vulProfileZone, __LINE__)(name)
+#define VUL_PROFILE_FUNCTION() VUL_PROFILE_ZONE(__FUNCTION__)
+#define VUL_PROFILE_FRAME() ::vul::Profiler::markFrame()
+#else
+#define VUL_PROFILE_ZONE(name)
+#define VUL_PROFILE_FUNCTION()
+#define VUL_PROFILE_FRAME()
+#endif // VULPES_PROFILING
+
+namespace vul {
+    // Scoped CPU zones recorded into a ring per thread. Each ring has a single writer,
+    // its own thread, so recording takes no locks; only a thread's first zone
+    // registers its ring. Frame boundaries are marked once per frame, and the
+    // zones of the last few frames can be written out for chrome://tracing
+    class VEAPI Profiler {
+    public:
+        static void recordZone(const char* name, uint64_t start, uint64_t end);
+        static void markFrame();
+
+        // Chrome trace event JSON of the zones in the last frameCount complete frames,
+        // or of everything recorded until two frames have been marked. False without
+        // VULPES_PROFILING, as nothing is ever recorded
+        static bool writeChromeTrace(const std::string& path, uint32_t frameCount = 1);
+
+        static bool isEnabled();
+
+        // Time stamp counter ticks on x86, about half the cost of steady_clock, and
+        // nanoseconds elsewhere. Ticks are converted when the trace is written, which
+        // assumes an invariant counter as on any recent CPU
+        static uint64_t now() {
+#ifdef VUL_PROFILE_TSC
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif // VUL_PROFILE_TSC
+        }
+    };
+
+    class ProfileZone {
+    public:
+        explicit ProfileZone(const char* name) : m_name(name), m_start(Profiler::now()) {}
+        ~ProfileZone() { Profiler::recordZone(m_name, m_start, Profiler::now()); }
+
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_start;
+    };
+}
+
+#endif // _VUL_PROFILER_HPP
@@ -0,0 +1,50 @@
+#ifndef _VUL_RENDERQUEUE_HPP
+#define _VUL_RENDERQUEUE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace vul {
+    // Draws tagged with 64-bit sort keys, ordered with an LSD radix sort so that
+    // draws sharing state end up next to each other. Keys from makeKey order by
+    // layer, program, material (texture set), mesh, then front to back depth
+    class VEAPI RenderQueue {
+    public:
+        RenderQueue();
+
+        // Fields wider than their bits are truncated, which only affects ordering.
+        // Depth is in [0, 1], 0 at the camera
+        static uint64_t makeKey(uint32_t layer, uint32_t program, uint32_t materialID, uint32_t meshID, float depth);
+        static uint64_t setLayer(uint64_t key, uint32_t layer);
+
+        void clear();
+        void reserve(uint32_t count);
+        void push(uint64_t key, uint32_t value);
+
+        // Stable, equal keys keep the order they were pushed in
+        void sort();
+
+        uint32_t getSize() const;
+        uint64_t getKey(uint32_t i) const;
+        uint32_t getValue(uint32_t i) const;
+
+        static const uint32_t layerBits = 2;
+        static const uint32_t programBits = 4;
+        static const uint32_t materialBits = 20;
+        static const uint32_t meshBits = 20;
+        static const uint32_t depthBits = 18;
+
+    private:
+        struct Entry {
+            uint64_t key;
+            uint32_t value;
+        };
+
+        std::vector<Entry> m_entries;
+        std::vector<Entry> m_scratch;
+    };
+}
+
+#endif // _VUL_RENDERQUEUE_HPP
@@ -24,10 +24,15 @@ namespace vul {
 
         bool addTarget(Handle<Texture>&, uint32_t target, uint32_t level = 0);
 
+        // Needed by renderers that depth test into the target directly
+        bool addDepthBuffer();
+        bool hasDepthBuffer();
+
     private:
         int32_t m_defaultViewport[4]; // x, y, width, height
         uint32_t m_width, m_height;
         uint32_t m_fbo;
+        uint32_t m_depthBuffer;
         const static uint32_t m_maxTargets = 8;
         Handle<Texture> m_textures[m_maxTargets];
         bool m_texturesCached[m_maxTargets];
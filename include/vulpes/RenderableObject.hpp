@@ -9,6 +9,8 @@
 #include "Texture.hpp"
 
 namespace vul {
+    class Scene;
+
     enum struct RenderableObjectFlags {
         Visible = 1,
         MeshAttached = 2,
@@ -16,13 +18,24 @@ namespace vul {
         NormalMapAttached = 8,
         RoughnessMapAttached = 16,
         MetalMapAttached = 32,
-        SkeletonAttached = 64
+        SkeletonAttached = 64,
+        Occluder = 128, // Rasterized by OcclusionCuller, needs a mesh loaded with occluder data
+        Static = 256 // Never moves, merged into shared buffers by StaticBatcher
     };
 
+    // Lightweight view of a renderable, its data is packed into arrays owned by the Scene
     class VEAPI RenderableObject : public SceneObject {
     public:
-        RenderableObject(uint32_t id);
+        RenderableObject(Scene& scene, uint32_t id);
         RenderableObject(const RenderableObject&);
+        RenderableObject& operator=(const RenderableObject&) = default; // Scene moves views when removing
+
+        // The object is marked for a world matrix update when the reference is fetched,
+        // so fetch it again for every change instead of keeping it across frames. It
+        // also points into the scene's arrays, which move when objects are created or
+        // removed. setTransformation marks the object on each call
+        Transformation& getTransformation() override;
+        void setTransformation(const Transformation&);
 
         void attachMesh(const Handle<Mesh>&);
         void attachColorMap(const Handle<Texture>&);
@@ -31,6 +44,9 @@ namespace vul {
         void attachMetalMap(const Handle<Texture>&);
         void attachSkeleton(const Handle<Skeleton>&);
         void setVisible(bool visible);
+        void setParent(uint32_t parentID);
+        void setOccluder(bool occluder);
+        void setStatic(bool isStatic);
 
         Handle<Mesh> getMesh();
         Handle<Texture> getColorMap();
@@ -39,15 +55,17 @@ namespace vul {
         Handle<Texture> getMetalMap();
         Handle<Skeleton> getSkeleton();
         bool isVisible();
+        bool isOccluder();
+        bool isStatic();
+        uint32_t getParent();
+        const glm::mat4x3& getWorldMatrix(); // Brings the scene's world matrices up to date
 
     private:
-        Mesh m_mesh;
-        Texture m_colorMap; // Analogous with albedo map
-        Texture m_normalMap;
-        Texture m_roughnessMap;
-        Texture m_metalMap;
-        Handle<Skeleton> m_skeleton;
-        uint8_t m_flags; // Ensure space isn't wasted with many bools
+        Scene* m_scene;
+
+        uint32_t getIndex() const;
+        bool hasFlag(RenderableObjectFlags) const;
+        void setFlag(RenderableObjectFlags, bool);
     };
 }
 
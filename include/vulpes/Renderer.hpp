@@ -5,6 +5,7 @@
 
 #include "Camera.hpp"
 #include "Export.hpp"
+#include "GPUProfiler.hpp"
 #include "Scene.hpp"
 
 namespace vul {
@@ -19,13 +20,28 @@ namespace vul {
         virtual void render() = 0;
 
         virtual void setWireframeMode(bool) = 0;
+
+        // Passes are timed on the GPU under the renderer's pass names when set
+        void setGPUProfiler(GPUProfiler&);
+
         uint32_t getPolygonCount();
+        uint32_t getCulledObjectCount(); // Objects rejected by culling last frame
+        double getCullTime(); // Milliseconds spent culling last frame
+        uint32_t getDrawCallCount(); // Draw calls issued for scene geometry last frame
+        double getSubmitTime(); // Milliseconds of CPU time spent issuing geometry draws last frame
+        uint32_t getStateChangeCount(); // Program, texture set and vertex array binds last frame
 
     protected:
         Scene* m_scene;
         Camera* m_camera;
         uint32_t m_polycount;
+        uint32_t m_culledCount;
+        double m_cullTime;
+        uint32_t m_drawCallCount;
+        double m_submitTime;
+        uint32_t m_stateChangeCount;
         bool m_error; // So that error messages aren't logged for every attempted frame
+        GPUProfiler* m_gpuProfiler;
     };
 }
 
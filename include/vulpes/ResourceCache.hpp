@@ -28,6 +28,11 @@ namespace vul {
         Handle<Shader> getShader(const std::string& path);
         Handle<Skeleton> getSkeleton(const std::string& path);
 
+        // Reverse lookups, empty if the resource was not cached under a path
+        std::string getMeshPath(uint32_t vao);
+        std::string getTexturePath(uint32_t textureHandle);
+        std::string getSkeletonPath(Handle<Skeleton>);
+
     private:
         std::map<std::string, Handle<Mesh>> m_meshes;
         std::map<std::string, Handle<Texture>> m_textures;
@@ -1,12 +1,15 @@
 #ifndef _VUL_RESOURCELOADER_HPP
 #define _VUL_RESOURCELOADER_HPP
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "AssetPrefetcher.hpp"
 #include "Export.hpp"
 #include "ImageParser.hpp"
+#include "LoadTelemetry.hpp"
 #include "Mesh.hpp"
 #include "MeshData.hpp"
 #include "ResourceCache.hpp"
@@ -19,11 +22,18 @@
 namespace vul {
     class VEAPI ResourceLoader {
     public:
-        ResourceLoader();
+        // If a manifest path is given, files listed in it are prefetched in the background
+        // and the files touched until endStartup() are written back to it
+        ResourceLoader(const std::string& startupManifestPath = "");
         ~ResourceLoader();
 
-        Handle<Mesh> loadMeshFromFile(const std::string& path);
-        Handle<Mesh> loadMeshFromData(const MeshData&);
+        void endStartup();
+        double getStartupTime(); // In milliseconds
+
+        // keepOccluderData keeps a CPU copy of the triangles so the mesh can be used
+        // as an occluder. Meshes are cached by path, so the first load decides
+        Handle<Mesh> loadMeshFromFile(const std::string& path, bool keepOccluderData = false);
+        Handle<Mesh> loadMeshFromData(const MeshData&, bool keepOccluderData = false);
 
         Handle<Texture> loadTextureFromFile(const std::string& path);
         Handle<Texture> loadTextureFromColor(float red, float green, float blue);
@@ -49,9 +59,17 @@ namespace vul {
         Handle<Mesh> generateSkeletonMesh(Handle<Skeleton>);
 
         Handle<ResourceCache> getResourceCache();
+        Handle<LoadTelemetry> getLoadTelemetry();
 
     private:
         ResourceCache m_resourceCache;
+        LoadTelemetry m_telemetry;
+        uint64_t m_bytesUploaded; // Running total of bytes handed to GL, used for load telemetry
+        AssetPrefetcher m_prefetcher;
+        std::string m_manifestPath;
+        bool m_recordingStartup;
+        std::chrono::steady_clock::time_point m_startupBegin;
+        double m_startupTime;
         VEMParser m_parserVEM;
         VESParser m_parserVES;
         ImageParser m_imageParser;
@@ -67,7 +85,7 @@ namespace vul {
         std::vector<uint8_t> readFile(const std::string& path); // Return empty string if file not found
 
         bool loadCubeMapSide(const std::string& path, Handle<Texture> texture,
-            uint32_t side, uint32_t* width = nullptr);
+            uint32_t side, LoadRecord& record, uint32_t* width = nullptr);
         void prefilterCubeMap(Handle<Texture>&, uint32_t width);
     };
 }
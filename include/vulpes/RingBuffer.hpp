@@ -0,0 +1,58 @@
+#ifndef _VUL_RINGBUFFER_HPP
+#define _VUL_RINGBUFFER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace vul {
+    // One GL buffer split into sections that frames write to in turn, so the CPU
+    // fills one section while the GPU still reads the others. With ARB_buffer_storage
+    // the buffer stays mapped and fences keep a section from being overwritten too
+    // early, otherwise data is staged and uploaded with glBufferSubData
+    class VEAPI RingBuffer {
+    public:
+        RingBuffer();
+        ~RingBuffer();
+
+        bool initialize(uint32_t sectionSize, uint32_t sectionCount = 3);
+        void release();
+        bool isInitialized();
+        bool isPersistent();
+
+        // Grows the sections when a frame needs more than they hold, call before beginFrame
+        void reserve(uint32_t frameSize);
+
+        // Waits until the GPU is done with the next section and starts writing to it
+        void beginFrame();
+
+        // Space in the current section, null when it is full. offset is from the start
+        // of the buffer, ready for binding ranges or attribute pointers
+        void* allocate(uint32_t size, uint32_t alignment, uint32_t& offset);
+
+        // Makes what was written since the last flush visible to GL, only needed when
+        // the buffer isn't persistently mapped. Call before drawing from it
+        void flush();
+
+        // Fences the section, call after the last draw reading from it was issued
+        void endFrame();
+
+        uint32_t getHandle();
+        uint32_t getSectionSize();
+
+    private:
+        uint32_t m_buffer;
+        uint8_t* m_mapped; // Whole buffer when persistent, null otherwise
+        std::vector<uint8_t> m_staging; // Current section when not persistent
+        std::vector<void*> m_fences; // GLsync, one per section
+        uint32_t m_sectionSize;
+        uint32_t m_sectionCount;
+        uint32_t m_section;
+        uint32_t m_used;
+        uint32_t m_flushed;
+        bool m_persistent;
+    };
+}
+
+#endif // _VUL_RINGBUFFER_HPP
@@ -1,14 +1,25 @@
 #ifndef _VUL_SCENE_HPP
 #define _VUL_SCENE_HPP
 
+#include <array>
 #include <cstdint>
+#include <deque>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
+#include <glm/glm.hpp>
+
+#include "AABBTree.hpp"
 #include "Export.hpp"
 #include "Handle.hpp"
+#include "Material.hpp"
+#include "Mesh.hpp"
 #include "PointLight.hpp"
 #include "RenderableObject.hpp"
+#include "SlotMap.hpp"
+#include "ThreadPool.hpp"
+#include "TransformBatch.hpp"
 
 namespace vul {
     class VEAPI Scene {
@@ -18,21 +29,122 @@ namespace vul {
 
         uint32_t createSceneObject(SceneObjectType);
 
+        // IDs must be valid, use hasSceneObject to check IDs that may have been removed
         Handle<RenderableObject> getRenderableObject(uint32_t id);
         Handle<RenderableObject> getRenderableObjectByIndex(uint32_t index);
 
         Handle<PointLight> getPointLight(uint32_t id);
         Handle<PointLight> getPointLightByIndex(uint32_t index);
 
+        bool hasSceneObject(SceneObjectType, uint32_t id);
         uint32_t getSceneObjectCount(SceneObjectType);
         void removeSceneObject(SceneObjectType, uint32_t id);
+        void reserve(SceneObjectType, uint32_t count);
+
+        // Large transformation updates are split across the pool's threads
+        void setThreadPool(ThreadPool&);
+
+        // Renderable data packed by index, valid for [0, getSceneObjectCount(Renderable))
+        uint32_t getRenderableID(uint32_t index) const;
+        uint32_t getRenderableIndex(uint32_t id) const; // SlotMap::invalidID if the object was removed
+        const Transformation* getRenderableTransformations() const;
+        const uint16_t* getRenderableFlags() const; // RenderableObjectFlags
+        const uint32_t* getRenderableMeshIDs() const;
+        const uint32_t* getRenderableMaterialIDs() const;
+
+        // Hierarchy, children inherit their parent's world transformation
+        // Pass SlotMap::invalidID as the parent to detach an object
+        void setParent(uint32_t childID, uint32_t parentID);
+        uint32_t getParent(uint32_t id);
+
+        // Recomputes world matrices of objects whose transformation was accessed
+        // for writing or whose parent changed since the last update, along with
+        // everything below them
+        void updateWorldTransformations();
+        const glm::mat4x3* getRenderableWorldMatrices() const;
+        const glm::mat3* getRenderableWorldNormalMatrices() const;
+
+        // World space bounds kept in step with the world matrices. Spheres are
+        // (center, radius), extents are half sizes of a box around the same center.
+        // Objects without known bounds, or with a skeleton, get an unbounded radius
+        const glm::vec4* getRenderableWorldSpheres() const;
+        const glm::vec4* getRenderableWorldExtents() const;
+        static const float unboundedRadius;
+
+        // Spatial queries over renderables with known bounds, results are replaced
+        // with the IDs of objects whose world bounds pass the test
+        void queryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& ids);
+        void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& ids);
+        void queryFrustum(const glm::vec4* planes, std::vector<uint32_t>& ids); // Camera::getFrustumPlanes
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+            uint32_t& id, float& distance); // Closest hit
+        const AABBTree& getSpatialTree() const;
+
+        const Mesh& getMesh(uint32_t meshID) const; // ID 0 is an empty mesh
+        const Material& getMaterial(uint32_t materialID) const; // ID 0 has no maps attached
+        uint32_t getMaterialCount() const; // IDs are below this and never reused
 
     private:
-        std::vector<RenderableObject> m_renderableObjects;
+        friend class RenderableObject;
+        friend class SceneFile;
+
+        SlotMap m_renderableIDs;
+        std::vector<RenderableObject> m_renderableObjects; // Views handed out by getRenderableObject
+        std::vector<Transformation> m_transformations;
+        std::vector<uint16_t> m_renderableFlags;
+        std::vector<uint32_t> m_meshIDs;
+        std::vector<uint32_t> m_materialIDs;
+        std::unordered_map<uint32_t, Handle<Skeleton>> m_skeletons; // Few objects are skinned, keyed by ID
+        std::vector<uint32_t> m_parentIDs;
+        std::vector<glm::mat4x3> m_worldMatrices;
+        std::vector<glm::mat3> m_worldNormalMatrices;
+        std::vector<glm::vec4> m_worldSpheres;
+        std::vector<glm::vec4> m_worldExtents;
+        std::vector<uint32_t> m_treeProxies; // AABBTree::nullNode if the object has no bounds
+        AABBTree m_spatialTree;
+        std::vector<uint32_t> m_queryCandidates;
+        std::vector<uint8_t> m_transformationDirty;
+        std::vector<uint32_t> m_hierarchyPositions; // Index -> position in m_hierarchyOrder
+
+        // Objects in depth-first order so every subtree is one contiguous range with
+        // parents ahead of their children. Rebuilt lazily when the hierarchy changes
+        std::vector<uint32_t> m_hierarchyOrder; // Position -> index
+        std::vector<uint32_t> m_hierarchyParents; // Position -> parent index
+        std::vector<uint32_t> m_subtreeSizes; // Position -> size of subtree rooted there
+        std::vector<uint32_t> m_dirtyIDs;
+        std::vector<uint32_t> m_reparentedIDs; // Parent changed, including children of removed objects
+        bool m_hierarchyChanged;
+
+        // Scratch for batched updates, indexed like m_updatePositions
+        std::vector<uint32_t> m_updatePositions;
+        TransformBatch m_transformBatch;
+        std::vector<glm::mat4x3> m_localMatrices;
+        std::vector<glm::mat3> m_localNormalMatrices;
+        ThreadPool* m_threadPool;
+
+        // Shared between renderables, deques keep references stable as these grow
+        std::deque<Mesh> m_meshes;
+        std::unordered_map<uint32_t, uint32_t> m_meshLookup; // VAO -> mesh ID
+        std::deque<Material> m_materials;
+        std::map<std::array<uint32_t, 4>, uint32_t> m_materialLookup; // Texture handles -> material ID
+
+        SlotMap m_pointLightIDs;
         std::vector<PointLight> m_pointLights;
-        std::map<uint32_t, uint32_t> m_sceneIDs; // ID -> index
-        uint32_t m_nextID;
+
+        void markTransformationDirty(uint32_t index);
+        void updateWorldBounds(uint32_t index);
+        void rebuildHierarchy();
+        void updateWorldTransformations(const std::vector<uint32_t>& positions);
+
+        uint32_t createRenderables(uint32_t count); // Returns how many were created
+        uint32_t addMesh(const Mesh&);
+        uint32_t addMaterial(const Material&);
+
+        template <class T> static void swapRemove(std::vector<T>& v, uint32_t index) {
+            if (index + 1 < v.size()) v[index] = v.back();
+            v.pop_back();
+        }
     };
 }
 
-#endif // _VUL_DEFERREDSCENE_HPP
+#endif // _VUL_SCENE_HPP
@@ -0,0 +1,31 @@
+#ifndef _VUL_SCENEFILE_HPP
+#define _VUL_SCENEFILE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "Export.hpp"
+#include "ResourceLoader.hpp"
+#include "Scene.hpp"
+
+namespace vul {
+    // Versioned binary snapshot of a Scene's renderables and point lights. Assets
+    // are referenced by a hash of their path and each distinct one is resolved
+    // once through the ResourceLoader. Object data is stored as packed arrays and
+    // copied out of a memory-mapped file in bulk
+    class VEAPI SceneFile {
+    public:
+        // Appends the file's objects to the scene, their IDs are newly assigned
+        static bool load(const std::string& path, Scene&, ResourceLoader&);
+
+        // Meshes, textures and skeletons are saved by the path they were loaded
+        // from, anything created from data or colors is saved as not attached
+        static bool write(const std::string& path, Scene&, ResourceLoader&);
+
+        static uint64_t hashPath(const std::string& path); // 64-bit FNV-1a
+
+        const static uint32_t version = 2;
+    };
+}
+
+#endif // _VUL_SCENEFILE_HPP
@@ -1,6 +1,8 @@
 #ifndef _VUL_SCENEOBJECT_HPP
 #define _VUL_SCENEOBJECT_HPP
 
+#include <cstdint>
+
 #include "Export.hpp"
 #include "Transformation.hpp"
 
@@ -15,15 +17,16 @@ namespace vul {
     public:
         SceneObject(uint32_t id, SceneObjectType type);
         SceneObject(const SceneObject&);
+        SceneObject& operator=(const SceneObject&) = default;
+        virtual ~SceneObject() {}
 
         uint32_t getID() const;
         SceneObjectType getType() const;
-        Transformation& getTransformation();
+        virtual Transformation& getTransformation() = 0;
 
     protected:
         uint32_t m_id;
         SceneObjectType m_type;
-        Transformation m_transformation;
     };
 }
 
@@ -0,0 +1,48 @@
+#ifndef _VUL_SLOTMAP_HPP
+#define _VUL_SLOTMAP_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace vul {
+    // Maps generational IDs to indices into densely packed arrays. The low bits
+    // of an ID select a slot, the high bits hold the slot's generation so IDs of
+    // removed objects are never mistaken for the object that reuses the slot
+    class VEAPI SlotMap {
+    public:
+        SlotMap();
+        ~SlotMap();
+
+        // The new element lives at dense index getSize() - 1
+        uint32_t create();
+
+        // Returns the dense index of the removed element. Callers must move their
+        // last element into that index and pop the back, mirroring what was done here
+        uint32_t remove(uint32_t id);
+
+        bool contains(uint32_t id) const;
+        uint32_t getIndex(uint32_t id) const;
+        uint32_t getID(uint32_t index) const;
+        uint32_t getSize() const;
+
+        void reserve(uint32_t size);
+        void clear();
+
+        const static uint32_t invalidID = 0xFFFFFFFF;
+
+    private:
+        const static uint32_t m_slotBits = 20;
+        const static uint32_t m_slotMask = (1u << m_slotBits) - 1;
+        const static uint32_t m_generationMask = (1u << (32 - m_slotBits)) - 1;
+        const static uint32_t m_maxSlots = m_slotMask; // Slot m_slotMask is reserved for invalidID
+
+        std::vector<uint32_t> m_slotIndices; // Slot -> dense index
+        std::vector<uint32_t> m_slotGenerations;
+        std::vector<uint32_t> m_denseIDs; // Dense index -> ID
+        std::vector<uint32_t> m_freeSlots;
+    };
+}
+
+#endif // _VUL_SLOTMAP_HPP
@@ -0,0 +1,89 @@
+#ifndef _VUL_STATICBATCHER_HPP
+#define _VUL_STATICBATCHER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+
+namespace vul {
+    class Scene;
+
+    // Layout glMultiDrawElementsIndirect reads its commands in
+    struct DrawElementsIndirectCommand {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        uint32_t baseVertex;
+        uint32_t baseInstance;
+    };
+
+    // Static level geometry merged into one vertex and index buffer, grouped into a
+    // batch per material. Every static renderable's mesh is pre-transformed into world
+    // space and kept as an index sub-range with its own bounds, so objects are still
+    // culled one by one while each material is drawn with a single glMultiDrawElements,
+    // or several materials with one glMultiDrawElementsIndirect
+    class VEAPI StaticBatcher {
+    public:
+        StaticBatcher();
+        ~StaticBatcher();
+
+        // Merges every renderable flagged Static that has a mesh and no skeleton.
+        // Mesh data is read back from GL, so this belongs in scene loading. Call it
+        // again after static objects are added, removed or moved
+        bool build(Scene&);
+        void release();
+        bool isBuilt();
+        bool contains(uint32_t id); // Renderable ID merged by the last build
+
+        // Frustum culls the sub-ranges and gathers the visible ones for drawing,
+        // objects since removed or made invisible are skipped. Returns the number culled
+        uint32_t cull(Scene&, const glm::vec4* planes);
+
+        // Batches are drawn with world space vertices, so the identity is expected
+        // in place of the geometry pass's per-instance matrices
+        uint32_t getBatchCount();
+        uint32_t getBatchMaterialID(uint32_t batch);
+        uint32_t draw(uint32_t batch); // Returns the triangles drawn, 0 if nothing was visible
+
+        // Visible runs of a batch after cull, as indirect commands drawing one instance
+        // starting at baseInstance. Drawn with the shared vertex array bound
+        uint32_t getVertexArray();
+        uint32_t getDrawCount(uint32_t batch);
+        uint32_t getTriangleCount(uint32_t batch);
+        void writeCommands(uint32_t batch, uint32_t baseInstance, DrawElementsIndirectCommand*);
+
+        uint32_t getRangeCount();
+
+    private:
+        struct Batch {
+            uint32_t materialID;
+            uint32_t firstRange; // Into the range arrays
+            uint32_t rangeCount;
+            uint32_t firstDraw; // Into m_drawCounts and m_drawOffsets, filled by cull
+            uint32_t drawCount;
+            uint32_t triangleCount;
+        };
+
+        // Sub-range arrays, packed by range
+        std::vector<uint32_t> m_rangeIDs;
+        std::vector<uint32_t> m_rangeFirstIndices;
+        std::vector<uint32_t> m_rangeIndexCounts;
+        std::vector<glm::vec4> m_rangeSpheres;
+        std::vector<glm::vec4> m_rangeExtents;
+        std::vector<uint8_t> m_rangeResults;
+
+        std::vector<Batch> m_batches;
+        std::vector<uint32_t> m_sortedIDs;
+        std::vector<int32_t> m_drawCounts; // GLsizei
+        std::vector<const void*> m_drawOffsets;
+        uint32_t m_vao;
+        uint32_t m_vbo;
+        uint32_t m_ib;
+        bool m_built;
+    };
+}
+
+#endif // _VUL_STATICBATCHER_HPP
@@ -0,0 +1,53 @@
+#ifndef _VUL_THREADPOOL_HPP
+#define _VUL_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Export.hpp"
+
+namespace vul {
+    // Fixed set of worker threads for data-parallel loops. The calling thread
+    // joins in, so a pool without workers simply runs everything inline
+    class VEAPI ThreadPool {
+    public:
+        typedef std::function<void(uint32_t begin, uint32_t end, uint32_t threadIndex)> RangeFunction;
+
+        ThreadPool(); // No workers
+        explicit ThreadPool(uint32_t workerCount);
+        ~ThreadPool();
+
+        // Splits [0, count) into chunks of at least minChunk and blocks until all
+        // are done. threadIndex is below getThreadCount(), 0 is the calling thread.
+        // Only one thread may call this at a time and calls must not be nested
+        void parallelFor(uint32_t count, uint32_t minChunk, const RangeFunction& function);
+
+        uint32_t getThreadCount(); // Workers plus the calling thread
+
+        static uint32_t getDefaultWorkerCount();
+
+    private:
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        uint64_t m_generation;
+        uint32_t m_busyWorkers;
+        bool m_stopping;
+
+        const RangeFunction* m_function;
+        uint32_t m_count;
+        uint32_t m_chunk;
+        std::atomic<uint32_t> m_nextIndex;
+
+        void worker(uint32_t threadIndex);
+        void runChunks(uint32_t threadIndex);
+    };
+}
+
+#endif // _VUL_THREADPOOL_HPP
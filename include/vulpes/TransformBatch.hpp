@@ -0,0 +1,40 @@
+#ifndef _VUL_TRANSFORMBATCH_HPP
+#define _VUL_TRANSFORMBATCH_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Export.hpp"
+#include "Transformation.hpp"
+
+namespace vul {
+    // Positions, orientations and scales laid out component by component so
+    // matrices can be built for 4 (SSE) or 8 (AVX) objects per iteration
+    class VEAPI TransformBatch {
+    public:
+        TransformBatch();
+        ~TransformBatch();
+
+        void resize(uint32_t size);
+        uint32_t getSize() const;
+
+        void set(uint32_t index, const Transformation&);
+
+        // Writes affineMatrices[i] and normalMatrices[i] for i in [begin, end)
+        void compute(uint32_t begin, uint32_t end, glm::mat4x3* affineMatrices, glm::mat3* normalMatrices) const;
+
+        // Reference implementation, one object at a time
+        void computeScalar(uint32_t begin, uint32_t end, glm::mat4x3* affineMatrices, glm::mat3* normalMatrices) const;
+
+        static const char* getInstructionSet();
+
+    private:
+        std::vector<float> m_position[3];
+        std::vector<float> m_orientation[4]; // x, y, z, w
+        std::vector<float> m_scale[3];
+    };
+}
+
+#endif // _VUL_TRANSFORMBATCH_HPP
@@ -4,14 +4,16 @@
 #include <cstdint>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "Export.hpp"
 
 namespace vul {
+    // Stored as translation, rotation and scale only. Matrices are built when
+    // requested, so any number of setter calls between draws costs nothing extra
     class VEAPI Transformation {
     public:
         Transformation();
-        Transformation(const Transformation&);
 
         void setPosition(float x, float y, float z);
         void setPosition(const glm::vec3&);
@@ -21,37 +23,45 @@ namespace vul {
 
         const glm::vec3& getPosition() const;
 
+        // Euler angles in radians, applied in Y, X, Z order. The angles are kept as
+        // given, so per axis setters change only that axis
         void setRotation(float xRot, float yRot, float zRot);
         void setRotation(const glm::vec3&);
         void setXRotation(float xRot);
         void setYRotation(float yRot);
         void setZRotation(float zRot);
 
+        // As last set, or recovered from the orientation after setOrientation,
+        // in which case pitch is within [-pi/2, pi/2]
         const glm::vec3& getRotation() const;
 
+        void setOrientation(const glm::quat&);
+        const glm::quat& getOrientation() const;
+
         void setScale(float scale);
         void setScale(float xScale, float yScale, float zScale);
         void setScale(const glm::vec3&);
 
         const glm::vec3& getScale() const;
 
-        const glm::mat4& getTransformationMatrix() const;
-        const glm::mat3& getNormalMatrix() const;
+        glm::mat4x3 getAffineMatrix() const;
+        glm::mat4 getTransformationMatrix() const;
+        glm::mat3 getNormalMatrix() const;
+
+        // Set by every setter, cleared by whoever caches matrices built from this
+        bool isDirty() const;
+        void markDirty();
+        void clearDirty();
+
+        // parent * local for affine matrices, the implied last row is (0, 0, 0, 1)
+        static glm::mat4x3 combine(const glm::mat4x3& parent, const glm::mat4x3& local);
 
     private:
         glm::vec3 m_position;
-        glm::vec3 m_rotation; // Angles in radians
+        glm::quat m_orientation;
+        glm::vec3 m_rotation; // Euler angles matching m_orientation
         glm::vec3 m_scale;
-
-        glm::mat4 m_positionMatrix;
-        glm::mat4 m_rotationMatrix;
-        glm::mat4 m_scaleMatrix;
-        glm::mat4 m_transformationMatrix;
-        glm::mat3 m_normalMatrix;
-
-        void calculatePositionMatrix();
-        void calculateRotationMatrix();
-        void calculateScaleMatrix();
+        bool m_dirty;
     };
 }
 
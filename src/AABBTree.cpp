@@ -0,0 +1,383 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <cmath>
+
+#include <vulpes/AABBTree.hpp>
+
+namespace vul {
+    const uint32_t AABBTree::nullNode;
+
+    AABBTree::AABBTree(float margin) : m_root(nullNode), m_freeList(nullNode), m_proxyCount(0), m_margin(margin) {
+    }
+
+    AABBTree::~AABBTree() {
+    }
+
+    uint32_t AABBTree::createProxy(const glm::vec3& min, const glm::vec3& max, uint32_t userData) {
+        uint32_t proxy = allocateNode();
+        Node& node = m_nodes[proxy];
+        node.min = min - glm::vec3(m_margin);
+        node.max = max + glm::vec3(m_margin);
+        node.userData = userData;
+        node.height = 0;
+
+        insertLeaf(proxy);
+        m_proxyCount++;
+        return proxy;
+    }
+
+    void AABBTree::destroyProxy(uint32_t proxy) {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        m_proxyCount--;
+    }
+
+    bool AABBTree::moveProxy(uint32_t proxy, const glm::vec3& min, const glm::vec3& max) {
+        Node& node = m_nodes[proxy];
+        if (glm::all(glm::lessThanEqual(node.min, min)) && glm::all(glm::lessThanEqual(max, node.max)))
+            return false;
+
+        removeLeaf(proxy);
+        m_nodes[proxy].min = min - glm::vec3(m_margin);
+        m_nodes[proxy].max = max + glm::vec3(m_margin);
+        insertLeaf(proxy);
+        return true;
+    }
+
+    uint32_t AABBTree::getUserData(uint32_t proxy) const {
+        return m_nodes[proxy].userData;
+    }
+
+    void AABBTree::getFatBounds(uint32_t proxy, glm::vec3& min, glm::vec3& max) const {
+        min = m_nodes[proxy].min;
+        max = m_nodes[proxy].max;
+    }
+
+    void AABBTree::queryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& results) const {
+        if (m_root == nullNode) return;
+
+        std::vector<uint32_t> stack(1, m_root);
+        while (!stack.empty()) {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (glm::any(glm::lessThan(node.max, min)) || glm::any(glm::lessThan(max, node.min))) continue;
+
+            if (node.isLeaf()) {
+                results.push_back(node.userData);
+            }
+            else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    void AABBTree::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const {
+        if (m_root == nullNode) return;
+
+        const float radiusSquared = radius * radius;
+        std::vector<uint32_t> stack(1, m_root);
+        while (!stack.empty()) {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            glm::vec3 offset = center - glm::clamp(center, node.min, node.max);
+            if (glm::dot(offset, offset) > radiusSquared) continue;
+
+            if (node.isLeaf()) {
+                results.push_back(node.userData);
+            }
+            else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    void AABBTree::queryFrustum(const glm::vec4* planes, std::vector<uint32_t>& results) const {
+        if (m_root == nullNode) return;
+
+        std::vector<uint32_t> stack(1, m_root), subtreeStack;
+        while (!stack.empty()) {
+            uint32_t index = stack.back();
+            const Node& node = m_nodes[index];
+            stack.pop_back();
+
+            glm::vec3 center = (node.min + node.max) * .5f;
+            glm::vec3 extents = (node.max - node.min) * .5f;
+            bool outside = false, inside = true;
+            for (int p = 0; p < 6 && !outside; p++) {
+                glm::vec3 normal(planes[p]);
+                float distance = glm::dot(normal, center) + planes[p].w;
+                float radius = glm::dot(glm::abs(normal), extents);
+                outside = distance < -radius;
+                inside = inside && distance >= radius;
+            }
+
+            if (outside) continue;
+
+            // Nothing below a node that is entirely inside needs testing
+            if (inside || node.isLeaf()) {
+                collectLeaves(index, results, subtreeStack);
+            }
+            else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    void AABBTree::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+        const RaycastFunction& function) const {
+        if (m_root == nullNode) return;
+
+        glm::vec3 inverseDirection = 1.f / direction;
+        std::vector<uint32_t> stack(1, m_root);
+        while (!stack.empty()) {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            float distance;
+            if (!intersectRay(origin, inverseDirection, maxDistance, node.min, node.max, distance)) continue;
+
+            if (node.isLeaf()) {
+                distance = function(node.userData, maxDistance);
+                if (distance < 0.f) return;
+                maxDistance = std::min(maxDistance, distance);
+            }
+            else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    bool AABBTree::intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance,
+        const glm::vec3& min, const glm::vec3& max, float& distance) {
+        // Slab test, the ray is inside the box between the last entry and the first exit
+        glm::vec3 t1 = (min - origin) * inverseDirection;
+        glm::vec3 t2 = (max - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t1, t2), tFar = glm::max(t1, t2);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+        distance = enter;
+        return enter <= exit;
+    }
+
+    uint32_t AABBTree::getHeight() const {
+        return m_root == nullNode ? 0 : static_cast<uint32_t>(m_nodes[m_root].height);
+    }
+
+    uint32_t AABBTree::getProxyCount() const {
+        return m_proxyCount;
+    }
+
+    void AABBTree::clear() {
+        m_nodes.clear();
+        m_root = nullNode;
+        m_freeList = nullNode;
+        m_proxyCount = 0;
+    }
+
+    uint32_t AABBTree::allocateNode() {
+        uint32_t index;
+        if (m_freeList != nullNode) {
+            index = m_freeList;
+            m_freeList = m_nodes[index].parent;
+        }
+        else {
+            index = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.push_back(Node());
+        }
+
+        Node& node = m_nodes[index];
+        node.parent = node.child1 = node.child2 = nullNode;
+        node.height = 0;
+        node.userData = 0;
+        return index;
+    }
+
+    void AABBTree::freeNode(uint32_t node) {
+        m_nodes[node].parent = m_freeList;
+        m_nodes[node].height = -1;
+        m_freeList = node;
+    }
+
+    void AABBTree::insertLeaf(uint32_t leaf) {
+        if (m_root == nullNode) {
+            m_root = leaf;
+            m_nodes[leaf].parent = nullNode;
+            return;
+        }
+
+        // Descend towards the sibling that grows the total surface area the least
+        const glm::vec3 leafMin = m_nodes[leaf].min, leafMax = m_nodes[leaf].max;
+        uint32_t index = m_root;
+        while (!m_nodes[index].isLeaf()) {
+            const Node& node = m_nodes[index];
+            float area = getArea(node.min, node.max);
+            float combinedArea = getArea(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+            // Cost of pairing with this node, and the minimum cost pushed down to its children
+            float cost = 2.f * combinedArea;
+            float inheritanceCost = 2.f * (combinedArea - area);
+
+            float childCosts[2];
+            uint32_t children[2] = { node.child1, node.child2 };
+            for (int i = 0; i < 2; i++) {
+                const Node& child = m_nodes[children[i]];
+                float newArea = getArea(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+                childCosts[i] = (child.isLeaf() ? newArea : newArea - getArea(child.min, child.max)) + inheritanceCost;
+            }
+
+            if (cost < childCosts[0] && cost < childCosts[1]) break;
+            index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+        }
+
+        uint32_t sibling = index;
+        uint32_t oldParent = m_nodes[sibling].parent;
+        uint32_t newParent = allocateNode();
+        m_nodes[newParent].parent = oldParent;
+        m_nodes[newParent].min = glm::min(m_nodes[sibling].min, leafMin);
+        m_nodes[newParent].max = glm::max(m_nodes[sibling].max, leafMax);
+        m_nodes[newParent].height = m_nodes[sibling].height + 1;
+        m_nodes[newParent].child1 = sibling;
+        m_nodes[newParent].child2 = leaf;
+        m_nodes[sibling].parent = newParent;
+        m_nodes[leaf].parent = newParent;
+
+        if (oldParent == nullNode) m_root = newParent;
+        else if (m_nodes[oldParent].child1 == sibling) m_nodes[oldParent].child1 = newParent;
+        else m_nodes[oldParent].child2 = newParent;
+
+        refit(newParent);
+    }
+
+    void AABBTree::removeLeaf(uint32_t leaf) {
+        if (leaf == m_root) {
+            m_root = nullNode;
+            return;
+        }
+
+        uint32_t parent = m_nodes[leaf].parent;
+        uint32_t grandParent = m_nodes[parent].parent;
+        uint32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+        // The sibling takes the parent's place
+        if (grandParent == nullNode) {
+            m_root = sibling;
+            m_nodes[sibling].parent = nullNode;
+            freeNode(parent);
+            return;
+        }
+
+        if (m_nodes[grandParent].child1 == parent) m_nodes[grandParent].child1 = sibling;
+        else m_nodes[grandParent].child2 = sibling;
+        m_nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        refit(grandParent);
+    }
+
+    void AABBTree::refit(uint32_t index) {
+        // Walk to the root, rotating and recomputing bounds on the way
+        while (index != nullNode) {
+            rotate(index);
+
+            Node& node = m_nodes[index];
+            const Node& child1 = m_nodes[node.child1];
+            const Node& child2 = m_nodes[node.child2];
+            node.height = 1 + std::max(child1.height, child2.height);
+            node.min = glm::min(child1.min, child2.min);
+            node.max = glm::max(child1.max, child2.max);
+
+            index = node.parent;
+        }
+    }
+
+    void AABBTree::rotate(uint32_t iA) {
+        // Swaps a child of A with a grandchild on the other side when that shrinks the
+        // other child's surface area, A's own bounds stay the same
+        Node& a = m_nodes[iA];
+        if (a.isLeaf() || a.height < 2) return;
+
+        uint32_t bestChild = nullNode, bestGrandchild = nullNode;
+        float bestCost = 0.f;
+        auto consider = [&](uint32_t iChild, uint32_t iOther) {
+            const Node& other = m_nodes[iOther];
+            if (other.isLeaf()) return;
+
+            const Node& child = m_nodes[iChild];
+            const float area = getArea(other.min, other.max);
+            const uint32_t grandchildren[2] = { other.child1, other.child2 };
+            for (int i = 0; i < 2; i++) {
+                const Node& kept = m_nodes[grandchildren[1 - i]];
+                const float cost = getArea(glm::min(child.min, kept.min), glm::max(child.max, kept.max)) - area;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestChild = iChild;
+                    bestGrandchild = grandchildren[i];
+                }
+            }
+        };
+        consider(a.child1, a.child2);
+        consider(a.child2, a.child1);
+
+        // Coinciding boxes gain nothing from any swap and would chain into a list, so
+        // without a gain the shorter child trades places with the taller grandchild
+        // below the taller child, as long as that doesn't grow the area either
+        if (bestChild == nullNode) {
+            const uint32_t iTall = m_nodes[a.child1].height > m_nodes[a.child2].height ? a.child1 : a.child2;
+            const uint32_t iShort = iTall == a.child1 ? a.child2 : a.child1;
+            const Node& tall = m_nodes[iTall];
+            const Node& low = m_nodes[iShort];
+            if (tall.height - low.height < 2) return;
+
+            const bool firstTaller = m_nodes[tall.child1].height >= m_nodes[tall.child2].height;
+            const uint32_t iGrandchild = firstTaller ? tall.child1 : tall.child2;
+            const Node& kept = m_nodes[firstTaller ? tall.child2 : tall.child1];
+            if (getArea(glm::min(low.min, kept.min), glm::max(low.max, kept.max)) > getArea(tall.min, tall.max)) return;
+            bestChild = iShort;
+            bestGrandchild = iGrandchild;
+        }
+
+        const uint32_t iOther = a.child1 == bestChild ? a.child2 : a.child1;
+        Node& other = m_nodes[iOther];
+        if (a.child1 == bestChild) a.child1 = bestGrandchild;
+        else a.child2 = bestGrandchild;
+        if (other.child1 == bestGrandchild) other.child1 = bestChild;
+        else other.child2 = bestChild;
+        m_nodes[bestGrandchild].parent = iA;
+        m_nodes[bestChild].parent = iOther;
+
+        const Node& child1 = m_nodes[other.child1];
+        const Node& child2 = m_nodes[other.child2];
+        other.height = 1 + std::max(child1.height, child2.height);
+        other.min = glm::min(child1.min, child2.min);
+        other.max = glm::max(child1.max, child2.max);
+    }
+
+    void AABBTree::collectLeaves(uint32_t node, std::vector<uint32_t>& results, std::vector<uint32_t>& stack) const {
+        stack.assign(1, node);
+        while (!stack.empty()) {
+            const Node& current = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (current.isLeaf()) {
+                results.push_back(current.userData);
+            }
+            else {
+                stack.push_back(current.child1);
+                stack.push_back(current.child2);
+            }
+        }
+    }
+
+    float AABBTree::getArea(const glm::vec3& min, const glm::vec3& max) {
+        glm::vec3 size = max - min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+}
@@ -0,0 +1,153 @@
+#define VULPESENGINE_EXPORT
+
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <vulpes/AssetPrefetcher.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    AssetPrefetcher::AssetPrefetcher() : m_manifestStartupTime(0.0), m_manifestColdStartupTime(0.0),
+        m_nextFile(0), m_prefetchedFiles(0), m_prefetchedBytes(0) {
+    }
+
+    AssetPrefetcher::~AssetPrefetcher() {
+        // Skip whatever has not been started yet, then join
+        m_nextFile = static_cast<uint32_t>(m_manifestPaths.size());
+        wait();
+    }
+
+    bool AssetPrefetcher::loadManifest(const std::string& path) {
+        /* Manifest format (text)
+            Header line: "VULPREFETCH 1 <startup ms> <cold startup ms>"
+            One asset path per line, in the order the assets were first read
+        */
+        std::ifstream f(path);
+        if (!f) return false;
+
+        std::string header;
+        std::getline(f, header);
+
+        std::istringstream headerStream(header);
+        std::string magic;
+        uint32_t version = 0;
+        headerStream >> magic >> version >> m_manifestStartupTime >> m_manifestColdStartupTime;
+        if (magic != "VULPREFETCH" || version != 1) {
+            Logger::log("vul::AssetPrefetcher::loadManifest: Invalid manifest '%s'", path.c_str());
+            m_manifestStartupTime = m_manifestColdStartupTime = 0.0;
+            return false;
+        }
+
+        m_manifestPaths.clear();
+        std::string line;
+        while (std::getline(f, line)) {
+            if (!line.empty()) m_manifestPaths.push_back(line);
+        }
+
+        return true;
+    }
+
+    bool AssetPrefetcher::saveManifest(const std::string& path, double startupTime, double coldStartupTime) {
+        std::ofstream o(path, std::ofstream::out | std::ofstream::trunc);
+        if (!o) {
+            Logger::log("vul::AssetPrefetcher::saveManifest: Unable to open '%s'", path.c_str());
+            return false;
+        }
+
+        o << "VULPREFETCH 1 " << startupTime << ' ' << coldStartupTime << '\n';
+        for (auto& recordedPath : m_recordedPaths)
+            o << recordedPath << '\n';
+
+        return true;
+    }
+
+    void AssetPrefetcher::start(uint32_t threadCount) {
+        if (m_manifestPaths.empty() || !m_threads.empty()) return;
+
+        if (threadCount == 0) threadCount = 1;
+        if (threadCount > m_manifestPaths.size()) threadCount = static_cast<uint32_t>(m_manifestPaths.size());
+
+        m_nextFile = 0;
+        for (uint32_t i = 0; i < threadCount; i++)
+            m_threads.emplace_back(&AssetPrefetcher::prefetchWorker, this);
+    }
+
+    void AssetPrefetcher::wait() {
+        for (auto& thread : m_threads) {
+            if (thread.joinable()) thread.join();
+        }
+        m_threads.clear();
+    }
+
+    void AssetPrefetcher::record(const std::string& path) {
+        if (m_recordedSet.insert(path).second)
+            m_recordedPaths.push_back(path);
+    }
+
+    uint32_t AssetPrefetcher::getManifestFileCount() {
+        return static_cast<uint32_t>(m_manifestPaths.size());
+    }
+
+    uint32_t AssetPrefetcher::getPrefetchedFileCount() {
+        return m_prefetchedFiles;
+    }
+
+    uint64_t AssetPrefetcher::getPrefetchedBytes() {
+        return m_prefetchedBytes;
+    }
+
+    double AssetPrefetcher::getManifestStartupTime() {
+        return m_manifestStartupTime;
+    }
+
+    double AssetPrefetcher::getManifestColdStartupTime() {
+        return m_manifestColdStartupTime;
+    }
+
+    void AssetPrefetcher::prefetchWorker() {
+        // Files are handed out in manifest order so the earliest requests are warmed first
+        uint32_t index;
+        while ((index = m_nextFile++) < m_manifestPaths.size()) {
+            uint64_t size = prefetchFile(m_manifestPaths[index]);
+            if (size > 0) {
+                m_prefetchedFiles++;
+                m_prefetchedBytes += size;
+            }
+        }
+    }
+
+    uint64_t AssetPrefetcher::prefetchFile(const std::string& path) {
+        const uint32_t chunkSize = 64 * 1024;
+        static thread_local char buffer[chunkSize];
+        uint64_t total = 0;
+
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return 0;
+
+#ifdef POSIX_FADV_WILLNEED
+        // Queue readahead for the whole file, then touch it so it is resident when we return
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif // POSIX_FADV_WILLNEED
+
+        ssize_t bytesRead;
+        while ((bytesRead = read(fd, buffer, chunkSize)) > 0)
+            total += bytesRead;
+        close(fd);
+#else
+        std::ifstream f(path, std::ios::binary);
+        if (!f) return 0;
+
+        while (f.read(buffer, chunkSize) || f.gcount() > 0)
+            total += f.gcount();
+#endif // defined(__unix__) || defined(__APPLE__)
+
+        return total;
+    }
+}
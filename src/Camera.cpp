@@ -49,6 +49,17 @@ namespace vul {
             (float)m_width / (float)m_height, m_near, m_far);
         m_viewMatrix = glm::lookAt(m_position, m_target, m_up);
         m_translateMatrix = glm::translate(glm::mat4(1.f), m_position);
+
+        // Extract planes from the rows of the view-projection matrix
+        glm::mat4 viewProj = m_projMatrix * m_viewMatrix;
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+        for (int i = 0; i < 3; i++) {
+            m_frustumPlanes[i * 2] = rows[3] + rows[i];
+            m_frustumPlanes[i * 2 + 1] = rows[3] - rows[i];
+        }
+        for (auto& plane : m_frustumPlanes) plane /= glm::length(glm::vec3(plane));
     }
 
     glm::mat4 Camera::getViewMatrix() {
@@ -63,6 +74,10 @@ namespace vul {
         return m_translateMatrix;
     }
 
+    const glm::vec4* Camera::getFrustumPlanes() {
+        return m_frustumPlanes;
+    }
+
     float Camera::getNear() {
         return m_near;
     }
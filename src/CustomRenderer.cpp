@@ -21,6 +21,7 @@ namespace vul {
 
     void CustomRenderer::render(RenderTarget* rt) {
         if (!m_shader.isLoaded()) return;
+        GPUProfiler::Scope profile(m_gpuProfiler, "custom");
         glUseProgram(m_shader->programHandle);
 
         glClearColor(m_color[0], m_color[1], m_color[2], m_color[3]);
@@ -1,27 +1,120 @@
 #define VULPESENGINE_EXPORT
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
 #include <GL/glew.h>
 
 #include <vulpes/Camera.hpp>
 #include <vulpes/DeferredRenderer.hpp>
+#include <vulpes/FrustumCuller.hpp>
 #include <vulpes/Mesh.hpp>
+#include <vulpes/Profiler.hpp>
 #include <vulpes/Scene.hpp>
 
 #include "Logger.h"
 
 namespace vul {
-    DeferredRenderer::DeferredRenderer(ResourceLoader& rl) : m_gbuffer(4), m_wireframe(false) {
+    namespace {
+        // Smallest share of the scene handed to a thread when culling and building draws
+        const uint32_t minCullChunk = 4096;
+
+        // Runs function(begin, end, chunk) over chunkCount equal slices of [0, count),
+        // spread across the pool when there is one
+        template <typename Function>
+        void forEachChunk(ThreadPool* threadPool, uint32_t count, uint32_t chunkCount, const Function& function) {
+            const uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+            auto runChunks = [&](uint32_t begin, uint32_t end, uint32_t) {
+                VUL_PROFILE_ZONE("DeferredRenderer::chunks");
+                for (uint32_t chunk = begin; chunk < end; chunk++)
+                    function(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize), chunk);
+            };
+
+            if (threadPool && chunkCount > 1) threadPool->parallelFor(chunkCount, 1, runChunks);
+            else runChunks(0, chunkCount, 0);
+        }
+
+        // Material library records are read through this uniform buffer binding,
+        // its arrays from the texture units after the individual maps
+        const GLuint materialBlockBinding = 0;
+        const GLuint frameBlockBinding = 1;
+        const GLint firstArrayUnit = 6;
+
+        // std140 FrameBlock of the geometry pass
+        struct FrameData {
+            glm::mat4 viewMatrix;
+            glm::mat4 projectionMatrix;
+            float near;
+            float padding[3];
+        };
+
+        // Enough for a frame without static batches or visible objects
+        const uint32_t initialRingSectionSize = 64 * 1024;
+
+        // Light clusters, read by the light pass from the units after the environment
+        const uint32_t lightDepthSlices = 16;
+        const GLint firstLightGridUnit = 7;
+
+        // Outputs of the half resolution lighting pass, read by the full resolution one
+        const GLint firstHalfLightingUnit = 10;
+    }
+
+    DeferredRenderer::DeferredRenderer(ResourceLoader& rl) : m_gbuffer(3), m_gbufferLayout(GBufferLayout::Compact), m_wireframe(false), m_occlusionCulling(false), m_useOcclusionQueries(false),
+        m_uniformAlignment(256), m_instancing(true), m_drawSorting(true), m_lightCullTime(0.0), m_drawListTime(0.0), m_threadPool(nullptr),
+        m_useDynamicResolution(false), m_upscaleFilter(UpscaleFilter::EdgeAware), m_sceneColorFBO(0), m_sceneColorTexture(0),
+        m_halfResolutionLighting(false), m_halfLightingFBO(0), m_depthPrepass(false), m_overdrawStatistics(false),
+        m_averageOverdraw(0.f), m_maxOverdraw(0) {
+        m_halfLightingTextures[0] = m_halfLightingTextures[1] = 0;
+        setGBufferLayout(GBufferLayout::Compact);
+
         m_geometryShader = rl.loadShaderFromFile("data/geometryPass.vs", "data/geometryPass.fs");
         if (!m_geometryShader.isLoaded()) {
             Logger::log("vul::DeferredRenderer::DeferredRenderer: Unable to open geometry shader");
             m_error = true;
         }
+        else {
+            const GLuint program = m_geometryShader->programHandle;
+            GLuint blockIndex = glGetUniformBlockIndex(program, "MaterialBlock");
+            if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, blockIndex, materialBlockBinding);
+            blockIndex = glGetUniformBlockIndex(program, "FrameBlock");
+            if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, blockIndex, frameBlockBinding);
+
+            // TODO: use map or similar for better readability of uniform locations
+            //		 and stop using layout (location) on uniforms -- just look up the
+            //		 names when the shader is specified and cache locations
+            // Texture units are fixed, only the bound textures change between draws
+            glUseProgram(program);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::ColorMap), 0);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::NormalMap), 1);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::RoughnessMap), 2);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::MetalMap), 3);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::ColorMaps), firstArrayUnit);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::NormalMaps), firstArrayUnit + 1);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::RoughnessMaps), firstArrayUnit + 2);
+            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::MetalMaps), firstArrayUnit + 3);
+            glUseProgram(0);
+        }
+
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_uniformAlignment);
+        m_frameRing.initialize(initialRingSectionSize);
 
         m_lightShader = rl.loadShaderFromFile("data/lightPass.vs", "data/lightPass.fs");
         if (!m_lightShader.isLoaded()) {
             Logger::log("vul::DeferredRenderer::DeferredRenderer: Unable to open light shader");
             m_error = true;
         }
+        m_lightGrid.setDepthSliceCount(lightDepthSlices);
+
+        // Optional, only the depth prepass needs it
+        m_depthShader = rl.loadShaderFromFile("data/geometryDepth.vs", "data/geometryDepth.fs");
+        if (m_depthShader.isLoaded()) {
+            const GLuint blockIndex = glGetUniformBlockIndex(m_depthShader->programHandle, "FrameBlock");
+            if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(m_depthShader->programHandle, blockIndex, frameBlockBinding);
+        }
+
+        // Optional, only dynamic resolution needs it
+        m_upscaleShader = rl.loadShaderFromFile("data/lightPass.vs", "data/upscale.fs");
 
         m_defaultColorMap = rl.loadTextureFromColor(1.f, 1.f, 1.f);
         m_defaultNormalMap = rl.loadTextureFromColor(.5f, .5f, 1.f);
@@ -30,16 +123,23 @@ namespace vul {
 
         m_environmentLUT = rl.loadTextureFromFile("__vul_IBLLUT");
 
+        // Optional, the renderer works without the box shader
+        m_occlusionQueries.initialize(rl);
+
         for (int i = 0; i < 4; i++) m_color[i] = 1.f;
     }
 
     DeferredRenderer::~DeferredRenderer() {
+        releaseSceneColor();
+        releaseHalfLighting();
     }
 
     void DeferredRenderer::setCamera(Camera& camera) {
         m_camera = &camera;
         createQuad();
         m_gbuffer.initialize(camera.getWidth(), camera.getHeight());
+        if (m_useDynamicResolution && !createSceneColor()) m_useDynamicResolution = false;
+        if (m_halfResolutionLighting && !createHalfLighting()) m_halfResolutionLighting = false;
     }
 
     void DeferredRenderer::setActiveEnvironment(Handle<Texture>& environmentMap) {
@@ -57,6 +157,8 @@ namespace vul {
     void DeferredRenderer::render(RenderTarget* rt) {
         if (m_error) return;
 
+        VUL_PROFILE_ZONE("DeferredRenderer::render");
+
         if (!m_geometryShader.isLoaded()) {
             Logger::log("vul::DeferredRenderer::render: Geometry shader not loaded");
             m_error = true;
@@ -81,8 +183,21 @@ namespace vul {
             return;
         }
 
+        // The scale measured from earlier frames decides how much of the g-buffer is used
+        if (m_useDynamicResolution) {
+            m_dynamicResolution.beginFrame();
+            const float scale = m_dynamicResolution.getScale();
+            m_gbuffer.setRenderSize(static_cast<uint32_t>(m_gbuffer.getWidth() * scale + .5f),
+                static_cast<uint32_t>(m_gbuffer.getHeight() * scale + .5f));
+        }
+
         geometryPass();
         lightPass(rt);
+
+        if (m_useDynamicResolution) {
+            upscalePass(rt);
+            m_dynamicResolution.endFrame();
+        }
     }
 
     void DeferredRenderer::setWireframeMode(bool wireframe) {
@@ -96,106 +211,637 @@ namespace vul {
         m_color[3] = a;
     }
 
+    void DeferredRenderer::setGBufferLayout(GBufferLayout layout) {
+        m_gbufferLayout = layout;
+        m_gbuffer.setTextureFormat(0, GL_RGBA8);
+        m_gbuffer.setTextureFormat(1, GL_RG16);
+        m_gbuffer.setTextureFormat(2, GL_RG8);
+        m_gbuffer.setTextureCount(layout == GBufferLayout::Packed ? 2 : 3);
+    }
+
+    Handle<GBuffer> DeferredRenderer::getGBuffer() {
+        return Handle<GBuffer>(m_gbuffer);
+    }
+
+    void DeferredRenderer::setDynamicResolution(bool dynamicResolution) {
+        if (dynamicResolution == m_useDynamicResolution) return;
+
+        if (dynamicResolution) {
+            if (!m_upscaleShader.isLoaded()) {
+                Logger::log("vul::DeferredRenderer::setDynamicResolution: Upscale shader not loaded");
+                return;
+            }
+            if (!m_gpuProfiler) {
+                Logger::log("vul::DeferredRenderer::setDynamicResolution: No GPU profiler set to time frames with");
+                return;
+            }
+            if (!m_dynamicResolution.initialize(*m_gpuProfiler)) return;
+            if (m_camera && !createSceneColor()) return;
+        }
+        else {
+            releaseSceneColor();
+            m_dynamicResolution.release();
+            m_gbuffer.setRenderSize(m_gbuffer.getWidth(), m_gbuffer.getHeight());
+        }
+
+        m_useDynamicResolution = dynamicResolution;
+    }
+
+    Handle<DynamicResolution> DeferredRenderer::getDynamicResolution() {
+        return Handle<DynamicResolution>(m_dynamicResolution);
+    }
+
+    void DeferredRenderer::setUpscaleFilter(UpscaleFilter upscaleFilter) {
+        m_upscaleFilter = upscaleFilter;
+    }
+
+    void DeferredRenderer::setHalfResolutionLighting(bool halfResolutionLighting) {
+        if (halfResolutionLighting == m_halfResolutionLighting) return;
+
+        if (!halfResolutionLighting) releaseHalfLighting();
+        else if (m_camera && !createHalfLighting()) return;
+        m_halfResolutionLighting = halfResolutionLighting;
+    }
+
+    void DeferredRenderer::setDepthPrepass(bool depthPrepass) {
+        if (depthPrepass && !m_depthShader.isLoaded()) {
+            Logger::log("vul::DeferredRenderer::setDepthPrepass: Depth shader not loaded");
+            return;
+        }
+        m_depthPrepass = depthPrepass;
+    }
+
+    double DeferredRenderer::getGeometryPassTime() {
+        return m_gpuProfiler ? m_gpuProfiler->getLatest("geometry") : 0.0;
+    }
+
+    void DeferredRenderer::setOverdrawStatistics(bool overdrawStatistics) {
+        m_overdrawStatistics = overdrawStatistics;
+        m_gbuffer.setDepthStencil(overdrawStatistics);
+        if (!overdrawStatistics) m_overdrawCounts.clear();
+    }
+
+    const uint8_t* DeferredRenderer::getOverdrawCounts() {
+        return m_overdrawCounts.data();
+    }
+
+    float DeferredRenderer::getAverageOverdraw() {
+        return m_averageOverdraw;
+    }
+
+    uint32_t DeferredRenderer::getMaxOverdraw() {
+        return m_maxOverdraw;
+    }
+
+    void DeferredRenderer::setOcclusionCulling(bool occlusionCulling) {
+        m_occlusionCulling = occlusionCulling;
+    }
+
+    Handle<OcclusionCuller> DeferredRenderer::getOcclusionCuller() {
+        return Handle<OcclusionCuller>(m_occlusionCuller);
+    }
+
+    void DeferredRenderer::setOcclusionQueries(bool useOcclusionQueries) {
+        m_useOcclusionQueries = useOcclusionQueries;
+    }
+
+    Handle<OcclusionQueries> DeferredRenderer::getOcclusionQueries() {
+        return Handle<OcclusionQueries>(m_occlusionQueries);
+    }
+
+    void DeferredRenderer::setInstancing(bool instancing) {
+        m_instancing = instancing;
+    }
+
+    void DeferredRenderer::setDrawSorting(bool drawSorting) {
+        m_drawSorting = drawSorting;
+    }
+
+    void DeferredRenderer::setThreadPool(ThreadPool& threadPool) {
+        m_threadPool = &threadPool;
+        m_occlusionCuller.setThreadPool(threadPool);
+        m_lightGrid.setThreadPool(threadPool);
+    }
+
+    double DeferredRenderer::getDrawListTime() {
+        return m_drawListTime;
+    }
+
+    std::vector<uint32_t> DeferredRenderer::getDrawOrder() {
+        std::vector<uint32_t> order;
+        order.reserve(m_renderQueue.getSize());
+        for (uint32_t k = 0; k < m_renderQueue.getSize(); k++) order.push_back(m_drawCandidates[m_renderQueue.getValue(k)].index);
+        return order;
+    }
+
+    Handle<StaticBatcher> DeferredRenderer::getStaticBatcher() {
+        return Handle<StaticBatcher>(m_staticBatcher);
+    }
+
+    Handle<MaterialLibrary> DeferredRenderer::getMaterialLibrary() {
+        return Handle<MaterialLibrary>(m_materialLibrary);
+    }
+
+    Handle<LightGrid> DeferredRenderer::getLightGrid() {
+        return Handle<LightGrid>(m_lightGrid);
+    }
+
+    double DeferredRenderer::getLightCullTime() {
+        return m_lightCullTime;
+    }
+
+    double DeferredRenderer::getLightPassTime() {
+        return m_gpuProfiler ? m_gpuProfiler->getLatest("light") : 0.0;
+    }
+
+    int32_t DeferredRenderer::materialRecordIndex(uint32_t materialID) {
+        return m_materialLibrary.contains(materialID) ? static_cast<int32_t>(m_materialLibrary.getRecordIndex(materialID)) : -1;
+    }
+
+    void DeferredRenderer::cullObjects() {
+        VUL_PROFILE_ZONE("DeferredRenderer::cullObjects");
+
+        // Done before any GL work so only surviving objects cost driver time
+        auto start = std::chrono::steady_clock::now();
+
+        m_scene->updateWorldTransformations();
+        const uint32_t objectCount = m_scene->getSceneObjectCount(SceneObjectType::Renderable);
+        const uint16_t* flags = m_scene->getRenderableFlags();
+        const uint32_t* meshIDs = m_scene->getRenderableMeshIDs();
+        const glm::vec4* planes = m_camera->getFrustumPlanes();
+        const glm::vec4* worldSpheres = m_scene->getRenderableWorldSpheres();
+        const glm::vec4* worldExtents = m_scene->getRenderableWorldExtents();
+        const uint16_t visibleMask = static_cast<uint16_t>(RenderableObjectFlags::Visible)
+            | static_cast<uint16_t>(RenderableObjectFlags::MeshAttached);
+
+        // A few chunks per thread even out uneven work. Lists belong to chunks rather
+        // than threads so merging them keeps scene order whichever thread ran what
+        uint32_t chunkCount = 1;
+        if (m_threadPool)
+            chunkCount = std::max(1u, std::min(m_threadPool->getThreadCount() * 4, objectCount / minCullChunk));
+
+        m_cullResults.resize(objectCount);
+        m_drawLists.resize(chunkCount);
+
+        // Chunks of the scene are culled in parallel, each counting into its own list.
+        // Objects that would not be drawn anyway are neither counted nor occlusion tested.
+        // Batched static objects are culled per range by the batcher, occluders among
+        // them are kept so they are still rasterized by the occlusion culler
+        forEachChunk(m_threadPool, objectCount, chunkCount, [&](uint32_t begin, uint32_t end, uint32_t chunk) {
+            FrustumCuller::cull(planes, worldSpheres, worldExtents, begin, end, m_cullResults.data());
+
+            uint32_t culledCount = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                if ((flags[i] & visibleMask) != visibleMask || m_scene->getMesh(meshIDs[i]).vao == 0) m_cullResults[i] = 0;
+                else if (isStaticBatched(i, flags)) {
+                    if (!(flags[i] & static_cast<uint16_t>(RenderableObjectFlags::Occluder))) m_cullResults[i] = 0;
+                }
+                else if (!m_cullResults[i]) culledCount++;
+            }
+            m_drawLists[chunk].culledCount = culledCount;
+        });
+
+        uint32_t culledCount = 0;
+        for (auto& drawList : m_drawLists) culledCount += drawList.culledCount;
+
+        if (m_occlusionCulling)
+            culledCount += m_occlusionCuller.cull(*m_scene, m_camera->getProjMatrix() * m_camera->getViewMatrix(), m_cullResults.data());
+
+        if (m_staticBatcher.isBuilt())
+            culledCount += m_staticBatcher.cull(*m_scene, planes);
+
+        m_culledCount = culledCount;
+        m_cullTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool DeferredRenderer::isStaticBatched(uint32_t index, const uint16_t* flags) {
+        return (flags[index] & static_cast<uint16_t>(RenderableObjectFlags::Static)) && m_staticBatcher.isBuilt()
+            && m_staticBatcher.contains(m_scene->getRenderableID(index));
+    }
+
+    void DeferredRenderer::buildDrawBatches() {
+        VUL_PROFILE_ZONE("DeferredRenderer::buildDrawBatches");
+        auto start = std::chrono::steady_clock::now();
+
+        const uint32_t objectCount = static_cast<uint32_t>(m_cullResults.size());
+        const uint16_t* flags = m_scene->getRenderableFlags();
+        const uint32_t* meshIDs = m_scene->getRenderableMeshIDs();
+        const uint32_t* materialIDs = m_scene->getRenderableMaterialIDs();
+        const glm::mat4x3* worldMatrices = m_scene->getRenderableWorldMatrices();
+        const glm::mat3* worldNormalMatrices = m_scene->getRenderableWorldNormalMatrices();
+
+        // Boxes reaching past the near plane are clipped, their query results can't be trusted
+        const bool useQueries = m_useOcclusionQueries && m_occlusionQueries.isInitialized();
+        const glm::vec4* worldSpheres = m_scene->getRenderableWorldSpheres();
+        const glm::vec4* worldExtents = m_scene->getRenderableWorldExtents();
+        const glm::vec3 cameraPosition = m_camera->getPosition();
+        const float nearMargin = m_camera->getNear() * 4.f;
+        if (useQueries) m_occlusionQueries.beginFrame();
+
+        // Depth buckets come from each object's view space distance
+        const glm::mat4 view = m_camera->getViewMatrix();
+        const glm::vec4 viewDepthRow(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+        const float inverseFar = 1.f / m_camera->getFar();
+        const uint16_t skeletonFlag = static_cast<uint16_t>(RenderableObjectFlags::SkeletonAttached);
+
+        // Each chunk's survivors become draw packets and keys in that chunk's list, chunked
+        // as in cullObjects. Skinned objects keep a draw of their own on a later layer of
+        // the queue, objects that may be queried are only marked as results are read here
+        const uint32_t chunkCount = static_cast<uint32_t>(m_drawLists.size());
+        forEachChunk(m_threadPool, objectCount, chunkCount, [&](uint32_t begin, uint32_t end, uint32_t chunk) {
+            DrawList& drawList = m_drawLists[chunk];
+            drawList.candidates.clear();
+            drawList.keys.clear();
+            for (uint32_t i = begin; i < end; i++) {
+                if (!m_cullResults[i] || isStaticBatched(i, flags)) continue;
+
+                bool queried = false;
+                if (useQueries && worldSpheres[i].w < Scene::unboundedRadius) {
+                    glm::vec3 distance = glm::abs(cameraPosition - glm::vec3(worldSpheres[i])) - glm::vec3(worldExtents[i]);
+                    queried = glm::any(glm::greaterThan(distance, glm::vec3(nearMargin)));
+                }
+
+                const uint32_t layer = flags[i] & skeletonFlag ? 1 : 0;
+                const float depth = glm::dot(viewDepthRow, glm::vec4(glm::vec3(worldSpheres[i]), 1.f)) * inverseFar;
+                drawList.keys.push_back(m_drawSorting ? RenderQueue::makeKey(layer, 0, materialIDs[i], meshIDs[i], depth)
+                    : RenderQueue::makeKey(layer, 0, 0, 0, 0.f));
+                drawList.candidates.push_back({ meshIDs[i], materialIDs[i], 0, 1, i,
+                    queried ? m_scene->getRenderableID(i) : 0, QueryVisibility::Visible, queried });
+            }
+        });
+
+        // Lists are merged here, with occlusion query results applied
+        m_renderQueue.clear();
+        m_drawCandidates.clear();
+        for (auto& drawList : m_drawLists) {
+            for (size_t k = 0; k < drawList.candidates.size(); k++) {
+                DrawBatch& candidate = drawList.candidates[k];
+                uint64_t key = drawList.keys[k];
+                if (candidate.queried) {
+                    candidate.visibility = m_occlusionQueries.getVisibility(candidate.id);
+                    if (candidate.visibility == QueryVisibility::Hidden) {
+                        uint32_t i = candidate.index;
+                        m_occlusionQueries.skipDraw(candidate.id, glm::vec3(worldSpheres[i]), glm::vec3(worldExtents[i]));
+                        continue;
+                    }
+                    key = RenderQueue::setLayer(key, 1);
+                }
+
+                m_renderQueue.push(key, static_cast<uint32_t>(m_drawCandidates.size()));
+                m_drawCandidates.push_back(candidate);
+            }
+        }
+
+        // Objects sharing a mesh and material are now next to each other, front to back,
+        // and every draw's instance data sits at its position in the sorted queue
+        m_renderQueue.sort();
+        m_drawBatches.clear();
+        const uint32_t drawCount = m_renderQueue.getSize();
+        for (uint32_t k = 0; k < drawCount; k++) {
+            const DrawBatch& candidate = m_drawCandidates[m_renderQueue.getValue(k)];
+            const bool individual = candidate.queried || (flags[candidate.index] & skeletonFlag);
+            const DrawBatch* previous = m_drawBatches.empty() ? nullptr : &m_drawBatches.back();
+            if (!m_instancing || individual || !previous || previous->queried || (flags[previous->index] & skeletonFlag)
+                || previous->meshID != candidate.meshID || previous->materialID != candidate.materialID) {
+                m_drawBatches.push_back(candidate);
+                m_drawBatches.back().firstInstance = k;
+                m_drawBatches.back().instanceCount = 0;
+            }
+            m_drawBatches.back().instanceCount++;
+        }
+
+        m_instanceData.resize(drawCount);
+        forEachChunk(m_threadPool, drawCount, std::max(1u, std::min(chunkCount, drawCount / minCullChunk)),
+            [&](uint32_t begin, uint32_t end, uint32_t) {
+            for (uint32_t k = begin; k < end; k++) {
+                const DrawBatch& candidate = m_drawCandidates[m_renderQueue.getValue(k)];
+                m_instanceData[k] = { worldMatrices[candidate.index], worldNormalMatrices[candidate.index],
+                    materialRecordIndex(candidate.materialID) };
+            }
+        });
+        m_drawListTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
     void DeferredRenderer::geometryPass() {
+        VUL_PROFILE_ZONE("DeferredRenderer::geometryPass");
+
         // Here, all the data needed to compute the final scene is written into the g-buffer
         // This includes diffuse information, surface normals, UV (texture) coordinates, etc.
         // More can be added, such as a stencil map for special materials, specular maps, and so on
 
+        cullObjects();
+
+        auto submitStart = std::chrono::steady_clock::now();
+        buildDrawBatches();
+
+        GPUProfiler::Scope profile(m_gpuProfiler, "geometry");
         m_gbuffer.bindWrite();
 
         glDepthMask(GL_TRUE);
         glClearColor(1.f, 1.f, 1.f, 1.f);
+        // Only the rendered part is cleared
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0, 0, m_gbuffer.getRenderWidth(), m_gbuffer.getRenderHeight());
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
         glEnable(GL_DEPTH_TEST);
         if (m_wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
         glUseProgram(m_geometryShader->programHandle);
+        glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::SurfaceInAlbedo), m_gbufferLayout == GBufferLayout::Packed);
+
+        // Everything the pass reads this frame goes into the ring: camera data, the
+        // instance data of every draw with one identity instance per static batch after
+        // them, then the static batches' indirect commands
+        const bool baseInstance = GLEW_ARB_base_instance != GL_FALSE;
+        // Each static batch's command picks its identity instance through baseInstance,
+        // which has to be zero without ARB_base_instance
+        const bool multiDrawIndirect = GLEW_ARB_multi_draw_indirect != GL_FALSE && baseInstance;
+        const uint32_t staticBatchCount = m_staticBatcher.getBatchCount();
+        const uint32_t firstStaticInstance = static_cast<uint32_t>(m_instanceData.size());
+        const uint32_t instanceCount = firstStaticInstance + staticBatchCount;
+        uint32_t staticCommandCount = 0;
+        for (uint32_t b = 0; b < staticBatchCount; b++) staticCommandCount += m_staticBatcher.getDrawCount(b);
+        if (!multiDrawIndirect) staticCommandCount = 0;
+
+        m_frameRing.reserve(sizeof(FrameData) + m_uniformAlignment + (instanceCount + 1) * sizeof(InstanceData)
+            + (staticCommandCount + 1) * sizeof(DrawElementsIndirectCommand));
+        m_frameRing.beginFrame();
+
+        uint32_t frameOffset = 0, instanceOffset = 0, commandOffset = 0;
+        FrameData* frame = static_cast<FrameData*>(m_frameRing.allocate(sizeof(FrameData), m_uniformAlignment, frameOffset));
+        frame->viewMatrix = m_camera->getViewMatrix();
+        frame->projectionMatrix = m_camera->getProjMatrix();
+        frame->near = m_camera->getNear();
+
+        InstanceData* instances = static_cast<InstanceData*>(m_frameRing.allocate(instanceCount * sizeof(InstanceData),
+            sizeof(glm::vec4), instanceOffset));
+        std::copy(m_instanceData.begin(), m_instanceData.end(), instances);
+        for (uint32_t b = 0; b < staticBatchCount; b++) {
+            instances[firstStaticInstance + b] = { glm::mat4x3(1.f), glm::mat3(1.f),
+                materialRecordIndex(m_staticBatcher.getBatchMaterialID(b)) };
+        }
 
-        // TODO: use map or similar for better readability of uniform locations
-        //		 and stop using layout (location) on uniforms -- just look up the
-        //		 names when the shader is specified and cache locations
-        // Global transformations
-        glUniformMatrix4fv(static_cast<GLint>(DeferredGeometryUniformLocations::ViewMatrix), 1, GL_FALSE, &m_camera->getViewMatrix()[0][0]);
-        glUniformMatrix4fv(static_cast<GLint>(DeferredGeometryUniformLocations::ProjectionMatrix), 1, GL_FALSE, &m_camera->getProjMatrix()[0][0]);
+        DrawElementsIndirectCommand* commands = static_cast<DrawElementsIndirectCommand*>(m_frameRing.allocate(
+            staticCommandCount * sizeof(DrawElementsIndirectCommand), sizeof(uint32_t), commandOffset));
+        for (uint32_t b = 0, command = 0; b < staticBatchCount && staticCommandCount != 0; b++) {
+            m_staticBatcher.writeCommands(b, firstStaticInstance + b, commands + command);
+            command += m_staticBatcher.getDrawCount(b);
+        }
+
+        m_frameRing.flush();
+        glBindBufferRange(GL_UNIFORM_BUFFER, frameBlockBinding, m_frameRing.getHandle(), frameOffset, sizeof(FrameData));
+
+        const uint16_t* flags = m_scene->getRenderableFlags();
+        const GLuint modelLocation = static_cast<GLuint>(DeferredInstanceAttributeLocations::ModelMatrix);
+        const GLuint normalLocation = static_cast<GLuint>(DeferredInstanceAttributeLocations::NormalMatrix);
+        const GLuint materialLocation = static_cast<GLuint>(DeferredInstanceAttributeLocations::MaterialIndex);
+        const auto boneStateLocation = static_cast<GLint>(DeferredGeometryUniformLocations::BoneStateArray);
+        uint32_t boundMaterialID = SlotMap::invalidID;
+        uint32_t boundArrays[4] = { 0, 0, 0, 0 };
+        uint32_t boundPage = SlotMap::invalidID;
+        uint32_t boundVAO = 0;
+        uint32_t stateChangeCount = 1; // The geometry program
+        bool bonesCleared = false;
+
+        // Until shader-switching implemented, use zero-value quaternions and locations
+        auto clearBones = [&]() {
+            glm::vec3 zeroLocation;
+            glm::quat zeroQuaternion;
+            for (size_t i = 0; i < 255; i++) {
+                glUniform3fv(boneStateLocation + i * 3, 1, &zeroLocation[0]);
+                glUniform3fv(boneStateLocation + i * 3 + 1, 1, &zeroLocation[0]);
+                glUniform4fv(boneStateLocation + i * 3 + 2, 1, &zeroQuaternion[0]);
+            }
+        };
+
+        // Materials in the library only bind the arrays and record page that differ from
+        // the last one's, any others bind their textures like before the library existed
+        auto bindMaterial = [&](uint32_t materialID) {
+            if (materialID == boundMaterialID) return;
+            boundMaterialID = materialID;
+
+            if (m_materialLibrary.contains(materialID)) {
+                if (m_materialLibrary.getPage(materialID) != boundPage) {
+                    boundPage = m_materialLibrary.getPage(materialID);
+                    m_materialLibrary.bindPage(boundPage, materialBlockBinding);
+                    stateChangeCount++;
+                }
+
+                // Maps given by factors leave whatever is bound to their unit
+                for (uint32_t map = 0; map < 4; map++) {
+                    uint32_t array = m_materialLibrary.getArray(materialID, static_cast<MaterialMap>(map));
+                    if (array == 0 || array == boundArrays[map]) continue;
+
+                    glActiveTexture(GL_TEXTURE0 + firstArrayUnit + map);
+                    glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+                    boundArrays[map] = array;
+                    stateChangeCount++;
+                }
+                return;
+            }
+
+            const Material& material = m_scene->getMaterial(materialID);
+            stateChangeCount++;
 
-        uint32_t tmpPolycount = 0;
-        for (uint32_t i = 0; i < m_scene->getSceneObjectCount(SceneObjectType::Renderable); i++) {
-            Handle<RenderableObject> currentObject = m_scene->getRenderableObjectByIndex(i);
-            Handle<Mesh> mesh = currentObject->getMesh();
-            if (!currentObject->isVisible() || !mesh.isLoaded()) continue;
-
-            // Retrieve maps, defaults will be used if these aren't loaded
-            Handle<Texture> colorMap = currentObject->getColorMap();
-            Handle<Texture> normalMap = currentObject->getNormalMap();
-            Handle<Texture> roughnessMap = currentObject->getRoughnessMap();
-            Handle<Texture> metalMap = currentObject->getMetalMap();
-            tmpPolycount += mesh->ic / 3;
-
-            // Local transformations
-            glm::mat4 modelMatrix = currentObject->getTransformation().getTransformationMatrix();
-            glm::mat3 normalMatrix = currentObject->getTransformation().getNormalMatrix();
-
-            glUniformMatrix4fv(static_cast<GLint>(DeferredGeometryUniformLocations::ModelMatrix), 1, GL_FALSE, &modelMatrix[0][0]);
-            glUniformMatrix3fv(static_cast<GLint>(DeferredGeometryUniformLocations::NormalMatrix), 1, GL_FALSE, &normalMatrix[0][0]);
-
-            // Textures
             // Color map
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, colorMap.isLoaded() ? colorMap->textureHandle
+            glBindTexture(GL_TEXTURE_2D, material.colorMap.textureHandle != 0 ? material.colorMap.textureHandle
                 : m_defaultColorMap->textureHandle);
-            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::ColorMap), 0);
 
             // Normal map
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, normalMap.isLoaded() ? normalMap->textureHandle
+            glBindTexture(GL_TEXTURE_2D, material.normalMap.textureHandle != 0 ? material.normalMap.textureHandle
                 : m_defaultNormalMap->textureHandle);
-            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::NormalMap), 1);
 
             // Roughness map
             glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, roughnessMap.isLoaded() ? roughnessMap->textureHandle
+            glBindTexture(GL_TEXTURE_2D, material.roughnessMap.textureHandle != 0 ? material.roughnessMap.textureHandle
                 : m_defaultRoughnessMap->textureHandle);
-            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::RoughnessMap), 2);
 
-            // Roughness map
+            // Metal map
             glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, metalMap.isLoaded() ? metalMap->textureHandle
+            glBindTexture(GL_TEXTURE_2D, material.metalMap.textureHandle != 0 ? material.metalMap.textureHandle
                 : m_defaultMetalMap->textureHandle);
-            glUniform1i(static_cast<GLint>(DeferredGeometryUniformLocations::MetalMap), 3);
+        };
+
+        // Whether a material draws with what the last one bound, so both fit in one call
+        auto sharesBoundState = [&](uint32_t materialID) {
+            if (materialID == boundMaterialID) return true;
+            if (!m_materialLibrary.contains(materialID) || !m_materialLibrary.contains(boundMaterialID)
+                || m_materialLibrary.getPage(materialID) != boundPage) return false;
+
+            for (uint32_t map = 0; map < 4; map++) {
+                uint32_t array = m_materialLibrary.getArray(materialID, static_cast<MaterialMap>(map));
+                if (array != 0 && array != boundArrays[map]) return false;
+            }
+            return true;
+        };
+
+        // Instance attributes read from the ring, starting at firstInstance. With base
+        // instances they are set once per vertex array and draws pick their first instance
+        auto pointInstances = [&](uint32_t firstInstance) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_frameRing.getHandle());
+            const size_t offset = instanceOffset + firstInstance * sizeof(InstanceData);
+            for (GLuint column = 0; column < 4; column++) {
+                glVertexAttribPointer(modelLocation + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                    reinterpret_cast<const void*>(offset + offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec3)));
+                glVertexAttribDivisor(modelLocation + column, 1);
+                glEnableVertexAttribArray(modelLocation + column);
+            }
+            for (GLuint column = 0; column < 3; column++) {
+                glVertexAttribPointer(normalLocation + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                    reinterpret_cast<const void*>(offset + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+                glVertexAttribDivisor(normalLocation + column, 1);
+                glEnableVertexAttribArray(normalLocation + column);
+            }
+            glVertexAttribIPointer(materialLocation, 1, GL_INT, sizeof(InstanceData),
+                reinterpret_cast<const void*>(offset + offsetof(InstanceData, materialIndex)));
+            glVertexAttribDivisor(materialLocation, 1);
+            glEnableVertexAttribArray(materialLocation);
+        };
 
-            // Extra
-            glUniform1f(static_cast<GLint>(DeferredGeometryUniformLocations::Near), m_camera->getNear());
-
-            // Skeleton
-            auto skeleton = currentObject->getSkeleton();
-            if (skeleton.isLoaded()) {
-                auto frameState = skeleton->getCurrentFrameState(mesh->boneNameToIndex);
-                auto boneDetails = skeleton->getBoneDetailMap(mesh->boneNameToIndex);
-                const auto boneStateLocation = static_cast<GLint>(DeferredGeometryUniformLocations::BoneStateArray);
-                for (size_t i = 0; i < frameState.size(); i++) {
-                    glUniform3fv(boneStateLocation + i * 3, 1, &std::get<1>(boneDetails[i])[0]);
-                    glUniform3fv(boneStateLocation + i * 3 + 1, 1, &frameState[i].first[0]);
-                    glUniform4fv(boneStateLocation + i * 3 + 2, 1, &frameState[i].second[0]);
+        uint32_t tmpPolycount = 0;
+        uint32_t drawCallCount = 0;
+
+        // Every draw of the pass, either into the g-buffer or depth only for the prepass.
+        // The prepass needs no materials, and the bones aren't read by either vertex shader yet
+        auto submitDraws = [&](bool depthOnly) {
+            // Static geometry first, already in world space so its instances hold the identity.
+            // With indirect draws, consecutive batches whose materials share their bound
+            // state are drawn with one call, all of them for depth only
+            if (staticBatchCount > 0) {
+                if (!depthOnly) {
+                    clearBones();
+                    bonesCleared = true;
+                }
+                glBindVertexArray(m_staticBatcher.getVertexArray());
+                boundVAO = 0;
+                stateChangeCount++;
+
+                if (multiDrawIndirect) {
+                    pointInstances(0);
+                    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_frameRing.getHandle());
+
+                    uint32_t command = 0;
+                    for (uint32_t b = 0; b < staticBatchCount;) {
+                        if (!depthOnly) bindMaterial(m_staticBatcher.getBatchMaterialID(b));
+                        const uint32_t firstCommand = command;
+                        do {
+                            command += m_staticBatcher.getDrawCount(b);
+                            if (!depthOnly) tmpPolycount += m_staticBatcher.getTriangleCount(b);
+                            b++;
+                        } while (b < staticBatchCount && (depthOnly || sharesBoundState(m_staticBatcher.getBatchMaterialID(b))));
+
+                        if (command == firstCommand) continue;
+                        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                            reinterpret_cast<const void*>(commandOffset + firstCommand * sizeof(DrawElementsIndirectCommand)),
+                            command - firstCommand, 0);
+                        drawCallCount++;
+                    }
+                    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+                }
+                else {
+                    for (uint32_t b = 0; b < staticBatchCount; b++) {
+                        if (m_staticBatcher.getDrawCount(b) == 0) continue;
+
+                        if (!depthOnly) bindMaterial(m_staticBatcher.getBatchMaterialID(b));
+                        pointInstances(firstStaticInstance + b);
+                        const uint32_t triangleCount = m_staticBatcher.draw(b);
+                        if (!depthOnly) tmpPolycount += triangleCount;
+                        drawCallCount++;
+                    }
                 }
             }
-            else {
-                // Until shader-switching implemented, use zero-value quaternions and locations
-                glm::vec3 zeroLocation;
-                glm::quat zeroQuaternion;
-                const auto boneStateLocation = static_cast<GLint>(DeferredGeometryUniformLocations::BoneStateArray);
-                for (size_t i = 0; i < 255; i++) {
-                    glUniform3fv(boneStateLocation + i * 3, 1, &zeroLocation[0]);
-                    glUniform3fv(boneStateLocation + i * 3 + 1, 1, &zeroLocation[0]);
-                    glUniform4fv(boneStateLocation + i * 3 + 2, 1, &zeroQuaternion[0]);
+
+            for (const DrawBatch& batch : m_drawBatches) {
+                const Mesh& mesh = m_scene->getMesh(batch.meshID);
+
+                if (!depthOnly) {
+                    tmpPolycount += mesh.ic / 3 * batch.instanceCount;
+
+                    // Textures, defaults will be used for maps that aren't attached
+                    bindMaterial(batch.materialID);
+
+                    // Skeleton
+                    if (flags[batch.index] & static_cast<uint16_t>(RenderableObjectFlags::SkeletonAttached)) {
+                        auto skeleton = m_scene->getRenderableObjectByIndex(batch.index)->getSkeleton();
+                        auto frameState = skeleton->getCurrentFrameState(mesh.boneNameToIndex);
+                        auto boneDetails = skeleton->getBoneDetailMap(mesh.boneNameToIndex);
+                        for (size_t i = 0; i < frameState.size(); i++) {
+                            glUniform3fv(boneStateLocation + i * 3, 1, &std::get<1>(boneDetails[i])[0]);
+                            glUniform3fv(boneStateLocation + i * 3 + 1, 1, &frameState[i].first[0]);
+                            glUniform4fv(boneStateLocation + i * 3 + 2, 1, &frameState[i].second[0]);
+                        }
+                        bonesCleared = false;
+                    }
+                    else if (!bonesCleared) {
+                        // Only uploaded again after a skinned draw changed them
+                        clearBones();
+                        bonesCleared = true;
+                    }
                 }
+
+                // Meshes, with the instance attributes pointed at this batch's matrices
+                if (mesh.vao != boundVAO) {
+                    glBindVertexArray(mesh.vao);
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ib);
+                    boundVAO = mesh.vao;
+                    stateChangeCount++;
+                    if (baseInstance) pointInstances(0);
+                }
+                if (!baseInstance) pointInstances(batch.firstInstance);
+
+                // The prepass only follows the queries' results, the g-buffer pass issues them
+                const bool beginsQuery = batch.queried && batch.visibility == QueryVisibility::Visible;
+                const bool conditional = batch.queried && !beginsQuery;
+                if (beginsQuery && !depthOnly) m_occlusionQueries.beginQuery(batch.id);
+                else if (conditional) m_occlusionQueries.beginConditionalDraw(batch.id);
+                if (baseInstance) glDrawElementsInstancedBaseInstance(GL_TRIANGLES, mesh.ic, GL_UNSIGNED_INT, nullptr, batch.instanceCount, batch.firstInstance);
+                else glDrawElementsInstanced(GL_TRIANGLES, mesh.ic, GL_UNSIGNED_INT, nullptr, batch.instanceCount);
+                drawCallCount++;
+                if (beginsQuery && !depthOnly) m_occlusionQueries.endQuery();
+                else if (conditional) m_occlusionQueries.endConditionalDraw();
             }
+        };
 
-            // Meshes
-            glBindVertexArray(mesh->vao);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ib);
-            glDrawElements(GL_TRIANGLES, mesh->ic, GL_UNSIGNED_INT, nullptr);
+        // Depth first, then the g-buffer pass only shades the fragments that ended up in front
+        if (m_depthPrepass) {
+            glUseProgram(m_depthShader->programHandle);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            submitDraws(true);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+            glUseProgram(m_geometryShader->programHandle);
+            stateChangeCount += 2;
         }
 
+        // Each fragment the g-buffer pass shades increments its pixel's stencil
+        if (m_overdrawStatistics) {
+            glEnable(GL_STENCIL_TEST);
+            glStencilFunc(GL_ALWAYS, 0, 0xFF);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+        }
+
+        submitDraws(false);
+
+        if (m_overdrawStatistics) glDisable(GL_STENCIL_TEST);
+        glDepthFunc(GL_LESS);
+        glBindVertexArray(0);
+        m_frameRing.endFrame();
+
+        m_drawCallCount = drawCallCount;
+        m_stateChangeCount = stateChangeCount;
+        m_submitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
+
+        // Skipped objects are tested against the finished depth buffer, read next frame or later
+        if (m_useOcclusionQueries && m_occlusionQueries.isInitialized())
+            m_occlusionQueries.testBoxes(m_camera->getProjMatrix() * m_camera->getViewMatrix());
+
+        if (m_overdrawStatistics) readOverdraw();
+
         m_gbuffer.endWrite();
         glDepthMask(GL_FALSE);
         glDisable(GL_DEPTH_TEST);
@@ -204,7 +850,31 @@ namespace vul {
         m_polycount = tmpPolycount;
     }
 
+    void DeferredRenderer::readOverdraw() {
+        const uint32_t width = m_gbuffer.getRenderWidth();
+        const uint32_t height = m_gbuffer.getRenderHeight();
+        m_overdrawCounts.resize(width * height);
+
+        m_gbuffer.bindRead();
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, m_overdrawCounts.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        uint64_t fragmentCount = 0;
+        uint32_t coveredCount = 0;
+        m_maxOverdraw = 0;
+        for (uint8_t count : m_overdrawCounts) {
+            fragmentCount += count;
+            if (count != 0) coveredCount++;
+            m_maxOverdraw = std::max(m_maxOverdraw, static_cast<uint32_t>(count));
+        }
+        m_averageOverdraw = coveredCount != 0 ? static_cast<float>(fragmentCount) / coveredCount : 0.f;
+    }
+
     void DeferredRenderer::lightPass(RenderTarget* rt) {
+        VUL_PROFILE_ZONE("DeferredRenderer::lightPass");
+
         // The g-buffer has been populated with data, now it must be processed into
         // the final scene, then rendered on the screen
 
@@ -223,12 +893,14 @@ namespace vul {
         glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::NormalBuffer), 1);
 
         glActiveTexture(GL_TEXTURE2);
-        m_gbuffer.bindTexture(2);
+        m_gbuffer.bindDepthTexture();
         glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::DepthBuffer), 2);
 
+        const bool surfaceInAlbedo = m_gbufferLayout == GBufferLayout::Packed;
         glActiveTexture(GL_TEXTURE3);
-        m_gbuffer.bindTexture(3);
-        glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::MiscBuffer), 3);
+        if (!surfaceInAlbedo) m_gbuffer.bindTexture(2);
+        glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::SurfaceBuffer), 3);
+        glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::SurfaceInAlbedo), surfaceInAlbedo);
 
         glUniform1f(static_cast<GLint>(DeferredLightUniformLocations::Near), m_camera->getNear());
         glUniform1f(static_cast<GLint>(DeferredLightUniformLocations::Far), m_camera->getFar());
@@ -250,21 +922,85 @@ namespace vul {
         glBindTexture(GL_TEXTURE_2D, m_environmentLUT->textureHandle);
         glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::EnvironmentLUT), 6);
 
-        // Lights
-        for (uint32_t i = 0; i < m_scene->getSceneObjectCount(SceneObjectType::PointLight); i++) {
-            Handle<PointLight> hLight = m_scene->getPointLightByIndex(i);
-            glm::vec4 lightPosViewSpace = m_camera->getViewMatrix() * glm::vec4(hLight->getTransformation().getPosition(), 1.f);
-            glm::vec3 lightPosTransformed = glm::vec3(lightPosViewSpace) / lightPosViewSpace.w;
-
-            glUniform3fv(static_cast<GLint>(DeferredLightUniformLocations::LightArray) + i * 4,
-                1, &lightPosTransformed[0]);
-            glUniform3fv(static_cast<GLint>(DeferredLightUniformLocations::LightArray) + i * 4 + 1,
-                1, &hLight->getColor()[0]);
-            glUniform1f(static_cast<GLint>(DeferredLightUniformLocations::LightArray) + i * 4 + 2,
-                hLight->getBrightness());
-            glUniform1f(static_cast<GLint>(DeferredLightUniformLocations::LightArray) + i * 4 + 3,
-                hLight->getRadius());
+        const uint32_t renderWidth = m_gbuffer.getRenderWidth();
+        const uint32_t renderHeight = m_gbuffer.getRenderHeight();
+        glUniform2f(static_cast<GLint>(DeferredLightUniformLocations::UVScale),
+            static_cast<float>(renderWidth) / m_gbuffer.getWidth(), static_cast<float>(renderHeight) / m_gbuffer.getHeight());
+
+        // Lights, clustered by the view space position of the pixels they may reach
+        auto lightCullStart = std::chrono::steady_clock::now();
+        m_lightGrid.build(*m_scene, m_camera->getViewMatrix(), m_camera->getProjMatrix(), m_camera->getNear(),
+            m_camera->getFar(), renderWidth, renderHeight);
+        m_lightGrid.upload();
+        m_lightCullTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lightCullStart).count();
+
+        m_lightGrid.bind(firstLightGridUnit);
+        glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::ClusterRanges), firstLightGridUnit);
+        glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::LightIndices), firstLightGridUnit + 1);
+        glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::Lights), firstLightGridUnit + 2);
+        glUniform2f(static_cast<GLint>(DeferredLightUniformLocations::TileScale),
+            static_cast<float>(renderWidth) / LightGrid::tileSize, static_cast<float>(renderHeight) / LightGrid::tileSize);
+        glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::DepthSliceCount), m_lightGrid.getDepthSliceCount());
+        glUniform1f(static_cast<GLint>(DeferredLightUniformLocations::DepthSliceScale), m_lightGrid.getDepthSliceScale());
+        glUniform1f(static_cast<GLint>(DeferredLightUniformLocations::DepthSliceBias), m_lightGrid.getDepthSliceBias());
+
+        // Timed from here so the GPU doesn't count waiting on the clustering above
+        GPUProfiler::Scope profile(m_gpuProfiler, "light");
+
+        // Diffuse and environment lighting at half resolution first, the full resolution
+        // pass upsamples it and only adds point light specular
+        if (m_halfResolutionLighting) {
+            glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::LightingPass), 1);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_halfLightingFBO);
+            glViewport(0, 0, (renderWidth + 1) / 2, (renderHeight + 1) / 2);
+            glBindVertexArray(m_quadMesh.vao);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quadMesh.ib);
+            glDrawElements(GL_TRIANGLES, m_quadMesh.ic, GL_UNSIGNED_INT, nullptr);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glViewport(0, 0, m_camera->getWidth(), m_camera->getHeight());
+
+            for (GLint i = 0; i < 2; i++) {
+                glActiveTexture(GL_TEXTURE0 + firstHalfLightingUnit + i);
+                glBindTexture(GL_TEXTURE_2D, m_halfLightingTextures[i]);
+            }
+            glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::HalfDiffuse), firstHalfLightingUnit);
+            glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::HalfSpecular), firstHalfLightingUnit + 1);
+            glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::LightingPass), 2);
+        }
+        else glUniform1i(static_cast<GLint>(DeferredLightUniformLocations::LightingPass), 0);
+
+        // Below full resolution, the result is upscaled into the target afterwards
+        if (m_useDynamicResolution) {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_sceneColorFBO);
+            glViewport(0, 0, renderWidth, renderHeight);
         }
+        else if (rt) rt->beginWrite();
+
+        glBindVertexArray(m_quadMesh.vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quadMesh.ib);
+        glDrawElements(GL_TRIANGLES, m_quadMesh.ic, GL_UNSIGNED_INT, nullptr);
+
+        if (m_useDynamicResolution) {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glViewport(0, 0, m_camera->getWidth(), m_camera->getHeight());
+        }
+        else if (rt) rt->endWrite();
+    }
+
+    void DeferredRenderer::upscalePass(RenderTarget* rt) {
+        VUL_PROFILE_ZONE("DeferredRenderer::upscalePass");
+        GPUProfiler::Scope profile(m_gpuProfiler, "upscale");
+        glUseProgram(m_upscaleShader->programHandle);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_sceneColorTexture);
+        glUniform1i(static_cast<GLint>(DeferredUpscaleUniformLocations::SceneColor), 0);
+
+        const float width = static_cast<float>(m_gbuffer.getWidth());
+        const float height = static_cast<float>(m_gbuffer.getHeight());
+        glUniform2f(static_cast<GLint>(DeferredUpscaleUniformLocations::UVScale), m_gbuffer.getRenderWidth() / width, m_gbuffer.getRenderHeight() / height);
+        glUniform2f(static_cast<GLint>(DeferredUpscaleUniformLocations::TexelSize), 1.f / width, 1.f / height);
+        glUniform1i(static_cast<GLint>(DeferredUpscaleUniformLocations::EdgeAware), m_upscaleFilter == UpscaleFilter::EdgeAware);
 
         if (rt) rt->beginWrite();
         glBindVertexArray(m_quadMesh.vao);
@@ -273,6 +1009,79 @@ namespace vul {
         if (rt) rt->endWrite();
     }
 
+    bool DeferredRenderer::createSceneColor() {
+        releaseSceneColor();
+
+        // Full size like the g-buffer, the light pass only covers its rendered part
+        glGenTextures(1, &m_sceneColorTexture);
+        glBindTexture(GL_TEXTURE_2D, m_sceneColorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_gbuffer.getWidth(), m_gbuffer.getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenFramebuffers(1, &m_sceneColorFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_sceneColorFBO);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_sceneColorTexture, 0);
+
+        GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            Logger::log("vul::DeferredRenderer::createSceneColor: Framebuffer error (0x%x)", status);
+            releaseSceneColor();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool DeferredRenderer::createHalfLighting() {
+        releaseHalfLighting();
+
+        // Half the g-buffer's full size, rounded up so odd sizes keep their last column and row
+        const GLsizei width = (m_gbuffer.getWidth() + 1) / 2;
+        const GLsizei height = (m_gbuffer.getHeight() + 1) / 2;
+        glGenTextures(2, m_halfLightingTextures);
+        glGenFramebuffers(1, &m_halfLightingFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_halfLightingFBO);
+
+        for (GLenum i = 0; i < 2; i++) {
+            glBindTexture(GL_TEXTURE_2D, m_halfLightingTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_halfLightingTextures[i], 0);
+        }
+
+        const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+
+        GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            Logger::log("vul::DeferredRenderer::createHalfLighting: Framebuffer error (0x%x)", status);
+            releaseHalfLighting();
+            return false;
+        }
+
+        return true;
+    }
+
+    void DeferredRenderer::releaseHalfLighting() {
+        if (m_halfLightingFBO != 0) glDeleteFramebuffers(1, &m_halfLightingFBO);
+        if (m_halfLightingTextures[0] != 0) glDeleteTextures(2, m_halfLightingTextures);
+        m_halfLightingFBO = 0;
+        m_halfLightingTextures[0] = m_halfLightingTextures[1] = 0;
+    }
+
+    void DeferredRenderer::releaseSceneColor() {
+        if (m_sceneColorFBO != 0) glDeleteFramebuffers(1, &m_sceneColorFBO);
+        if (m_sceneColorTexture != 0) glDeleteTextures(1, &m_sceneColorTexture);
+        m_sceneColorFBO = 0;
+        m_sceneColorTexture = 0;
+    }
+
     void DeferredRenderer::createQuad() {
         // ResourceLoader not used as this quad has frustum rays to reconstruct positions
         float vertices[] = { -1.f, -1.f, 0.f,
@@ -0,0 +1,113 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <cmath>
+
+#include <vulpes/DynamicResolution.hpp>
+
+namespace vul {
+    namespace {
+        // Aim a little under the target so small spikes don't go over it
+        const double headroom = 0.95;
+
+        // Changes smaller than this are ignored so the resolution doesn't flicker
+        const float deadband = 0.02f;
+
+        // Share of the way to the ideal scale moved per measurement, and the largest step
+        const float shrinkRate = 0.5f;
+        const float growRate = 0.1f;
+        const float maxStep = 0.1f;
+    }
+
+    const char* const DynamicResolution::framePass = "frame";
+
+    DynamicResolution::DynamicResolution() : m_profiler(nullptr), m_collectedCount(0),
+        m_targetFrameTime(16.6), m_minimumScale(0.5f), m_maximumScale(1.f), m_scale(1.f) {
+    }
+
+    DynamicResolution::~DynamicResolution() {
+        release();
+    }
+
+    bool DynamicResolution::initialize(GPUProfiler& profiler) {
+        if (!profiler.initialize()) return false;
+
+        // Frames timed before are not ours
+        m_profiler = &profiler;
+        m_collectedCount = profiler.getTotalSampleCount(framePass);
+        m_timedScales.clear();
+        return true;
+    }
+
+    void DynamicResolution::release() {
+        m_profiler = nullptr;
+        m_timedScales.clear();
+    }
+
+    bool DynamicResolution::isInitialized() {
+        return m_profiler && m_profiler->isInitialized();
+    }
+
+    void DynamicResolution::setTargetFrameTime(double milliseconds) {
+        if (milliseconds > 0.0) m_targetFrameTime = milliseconds;
+    }
+
+    double DynamicResolution::getTargetFrameTime() {
+        return m_targetFrameTime;
+    }
+
+    void DynamicResolution::setScaleBounds(float minimum, float maximum) {
+        m_minimumScale = std::max(0.1f, std::min(minimum, maximum));
+        m_maximumScale = std::max(m_minimumScale, maximum);
+        m_scale = std::max(m_minimumScale, std::min(m_scale, m_maximumScale));
+    }
+
+    float DynamicResolution::getMinimumScale() {
+        return m_minimumScale;
+    }
+
+    float DynamicResolution::getMaximumScale() {
+        return m_maximumScale;
+    }
+
+    float DynamicResolution::getScale() {
+        return m_scale;
+    }
+
+    void DynamicResolution::beginFrame() {
+        if (!isInitialized()) return;
+
+        // The measurement is of a frame a few back, rendered at the scale it had then
+        const uint64_t totalCount = m_profiler->getTotalSampleCount(framePass);
+        const size_t collected = static_cast<size_t>(std::min<uint64_t>(totalCount - m_collectedCount, m_timedScales.size()));
+        m_collectedCount = totalCount;
+        if (collected > 0) {
+            const float timedScale = m_timedScales[collected - 1];
+            m_timedScales.erase(m_timedScales.begin(), m_timedScales.begin() + collected);
+            update(m_profiler->getLatest(framePass), timedScale);
+        }
+
+        m_profiler->begin(framePass);
+        m_timedScales.push_back(m_scale);
+    }
+
+    void DynamicResolution::endFrame() {
+        if (isInitialized()) m_profiler->end(framePass);
+    }
+
+    float DynamicResolution::update(double gpuTime, float timedScale) {
+        if (gpuTime <= 0.0 || timedScale <= 0.f) return m_scale;
+
+        const float ideal = timedScale * static_cast<float>(std::sqrt(m_targetFrameTime * headroom / gpuTime));
+        if (std::abs(ideal - m_scale) < deadband * m_scale) return m_scale;
+
+        float step = (ideal - m_scale) * (ideal < m_scale ? shrinkRate : growRate);
+        step = std::max(-maxStep, std::min(step, maxStep));
+        m_scale = std::max(m_minimumScale, std::min(m_scale + step, m_maximumScale));
+        return m_scale;
+    }
+
+    double DynamicResolution::getGPUTime() {
+        return m_profiler ? m_profiler->getLatest(framePass) : 0.0;
+    }
+}
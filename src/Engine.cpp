@@ -7,15 +7,19 @@
 #include <vulpes/Engine.hpp>
 #include <vulpes/Window.hpp>
 #include <vulpes/InputHandler.hpp>
+#include <vulpes/Profiler.hpp>
 
 #include "Logger.h"
 
 namespace vul {
     Engine::Engine(const WindowCreationParameters& param) : m_deltaTime(1.f), m_deltaTime64(1.0),
-        m_fps(0), m_window(param), m_inputHandler(m_window.m_window) {
-        if (initializeOpenGL())
+        m_fps(0), m_window(param), m_inputHandler(m_window.m_window),
+        m_threadPool(ThreadPool::getDefaultWorkerCount()) {
+        if (initializeOpenGL()) {
             Logger::log("Vulpes Engine initialized at %dx%d, OpenGL version %s",
                 m_window.getWidth(), m_window.getHeight(), glGetString(GL_VERSION));
+            m_gpuProfiler.initialize();
+        }
     }
 
     Engine::~Engine() {
@@ -49,7 +53,19 @@ namespace vul {
         return Handle<InputHandler>(m_inputHandler);
     }
 
+    Handle<ThreadPool> Engine::getThreadPool() {
+        return Handle<ThreadPool>(m_threadPool);
+    }
+
+    Handle<GPUProfiler> Engine::getGPUProfiler() {
+        return Handle<GPUProfiler>(m_gpuProfiler);
+    }
+
     void Engine::swapFrameBuffers() {
+        // Frames are marked here, so the swap and any vsync wait in it open the next one
+        VUL_PROFILE_FRAME();
+        VUL_PROFILE_ZONE("Engine::swapFrameBuffers");
+
         // Track delta time and FPS
         static auto curtime = std::chrono::system_clock::now(),
             prevtime = std::chrono::system_clock::now(),
@@ -66,6 +82,7 @@ namespace vul {
             sprevtime = curtime;
         }
 
+        m_gpuProfiler.endFrame();
         m_window.swapFrameBuffers();
 
 #if _DEBUG
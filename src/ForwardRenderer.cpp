@@ -1,30 +1,136 @@
 #define VULPESENGINE_EXPORT
 
+#include <chrono>
+
 #include <GL/glew.h>
 
 #include <vulpes/Camera.hpp>
 #include <vulpes/ForwardRenderer.hpp>
+#include <vulpes/FrustumCuller.hpp>
 #include <vulpes/Scene.hpp>
 
 #include "Logger.h"
 
 namespace vul {
-    ForwardRenderer::ForwardRenderer() {
-        m_error = true;
-        Logger::log("vul::ForwardRenderer::ForwardRenderer: Forward rendering not supported at this time");
+    namespace {
+        // Texture units, fixed for the lifetime of the programs
+        const GLint environmentUnit = 4;
+        const GLint diffuseEnvironmentUnit = 5;
+        const GLint environmentLUTUnit = 6;
+        const GLint firstLightGridUnit = 7;
+
+        double millisecondsSince(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    ForwardRenderer::ForwardRenderer(ResourceLoader& rl) : m_wireframe(false), m_depthPrepass(false),
+        m_prepassTime(0.0), m_lightCullTime(0.0), m_shadingTime(0.0) {
+        m_shadingShader = rl.loadShaderFromFile("data/forwardPass.vs", "data/forwardPass.fs");
+        if (!m_shadingShader.isLoaded()) {
+            Logger::log("vul::ForwardRenderer::ForwardRenderer: Unable to open forward shader");
+            m_error = true;
+        }
+
+        m_depthShader = rl.loadShaderFromFile("data/forwardPass.vs", "data/forwardDepth.fs");
+        if (!m_depthShader.isLoaded()) {
+            Logger::log("vul::ForwardRenderer::ForwardRenderer: Unable to open depth prepass shader");
+            m_error = true;
+        }
+
+        m_backgroundShader = rl.loadShaderFromFile("data/forwardBackground.vs", "data/forwardBackground.fs");
+        if (!m_backgroundShader.isLoaded()) {
+            Logger::log("vul::ForwardRenderer::ForwardRenderer: Unable to open background shader");
+            m_error = true;
+        }
+
+        if (!m_error) cacheUniformLocations();
+
+        m_defaultColorMap = rl.loadTextureFromColor(1.f, 1.f, 1.f);
+        m_defaultNormalMap = rl.loadTextureFromColor(.5f, .5f, 1.f);
+        m_defaultRoughnessMap = rl.loadTextureFromColor(.5f, 0.f, 0.f);
+        m_defaultMetalMap = rl.loadTextureFromColor(0.f, 0.f, 0.f);
+
+        m_environmentLUT = rl.loadTextureFromFile("__vul_IBLLUT");
+        m_quad = rl.getQuad();
+
+        for (int i = 0; i < 4; i++) m_color[i] = 1.f;
     }
 
     ForwardRenderer::~ForwardRenderer() {
     }
 
+    void ForwardRenderer::cacheUniformLocations() {
+        GLuint program = m_shadingShader->programHandle;
+        m_shadingUniforms.viewMatrix = glGetUniformLocation(program, "viewMat");
+        m_shadingUniforms.projectionMatrix = glGetUniformLocation(program, "projMat");
+        m_shadingUniforms.modelMatrix = glGetUniformLocation(program, "modelMat");
+        m_shadingUniforms.normalMatrix = glGetUniformLocation(program, "normalMat");
+        m_shadingUniforms.colorMap = glGetUniformLocation(program, "colorMap");
+        m_shadingUniforms.normalMap = glGetUniformLocation(program, "normalMap");
+        m_shadingUniforms.roughnessMap = glGetUniformLocation(program, "roughnessMap");
+        m_shadingUniforms.metalMap = glGetUniformLocation(program, "metalMap");
+        m_shadingUniforms.inverseViewMatrix = glGetUniformLocation(program, "invViewMat");
+        m_shadingUniforms.environmentMap = glGetUniformLocation(program, "tEnvironment");
+        m_shadingUniforms.diffuseEnvironmentMap = glGetUniformLocation(program, "tDiffuseEnvironment");
+        m_shadingUniforms.environmentMipMaps = glGetUniformLocation(program, "environmentMipMaps");
+        m_shadingUniforms.environmentLUT = glGetUniformLocation(program, "environmentLUT");
+        m_shadingUniforms.environmentLighting = glGetUniformLocation(program, "environmentLighting");
+        m_shadingUniforms.tileRanges = glGetUniformLocation(program, "tileRanges");
+        m_shadingUniforms.lightIndices = glGetUniformLocation(program, "lightIndices");
+        m_shadingUniforms.lights = glGetUniformLocation(program, "lights");
+        m_shadingUniforms.tileCountX = glGetUniformLocation(program, "tileCountX");
+        m_shadingUniforms.depthSliceCount = glGetUniformLocation(program, "depthSliceCount");
+        m_shadingUniforms.depthSliceScale = glGetUniformLocation(program, "depthSliceScale");
+        m_shadingUniforms.depthSliceBias = glGetUniformLocation(program, "depthSliceBias");
+
+        // Samplers never change units, so they are set here once
+        glUseProgram(program);
+        glUniform1i(m_shadingUniforms.colorMap, 0);
+        glUniform1i(m_shadingUniforms.normalMap, 1);
+        glUniform1i(m_shadingUniforms.roughnessMap, 2);
+        glUniform1i(m_shadingUniforms.metalMap, 3);
+        glUniform1i(m_shadingUniforms.environmentMap, environmentUnit);
+        glUniform1i(m_shadingUniforms.diffuseEnvironmentMap, diffuseEnvironmentUnit);
+        glUniform1i(m_shadingUniforms.environmentLUT, environmentLUTUnit);
+        glUniform1i(m_shadingUniforms.tileRanges, firstLightGridUnit);
+        glUniform1i(m_shadingUniforms.lightIndices, firstLightGridUnit + 1);
+        glUniform1i(m_shadingUniforms.lights, firstLightGridUnit + 2);
+        glUniform1f(m_shadingUniforms.environmentMipMaps, 9); // Same as DeferredRenderer, see its light pass
+
+        program = m_depthShader->programHandle;
+        m_depthUniforms.viewMatrix = glGetUniformLocation(program, "viewMat");
+        m_depthUniforms.projectionMatrix = glGetUniformLocation(program, "projMat");
+        m_depthUniforms.modelMatrix = glGetUniformLocation(program, "modelMat");
+
+        program = m_backgroundShader->programHandle;
+        m_backgroundUniforms.inverseViewMatrix = glGetUniformLocation(program, "invViewMat");
+        m_backgroundUniforms.inverseProjectionScale = glGetUniformLocation(program, "inverseProjectionScale");
+        m_backgroundUniforms.environmentMap = glGetUniformLocation(program, "tEnvironment");
+
+        glUseProgram(program);
+        glUniform1i(m_backgroundUniforms.environmentMap, environmentUnit);
+        glUseProgram(0);
+    }
+
+    void ForwardRenderer::setCamera(Camera& camera) {
+        m_camera = &camera;
+    }
+
+    void ForwardRenderer::setActiveEnvironment(Handle<Texture>& environmentMap) {
+        m_environmentMap = environmentMap;
+    }
+
+    void ForwardRenderer::setActiveDiffuseEnvironment(Handle<Texture>& diffuseEnvironmentMap) {
+        m_diffuseEnvironmentMap = diffuseEnvironmentMap;
+    }
+
     void ForwardRenderer::render() {
-        if (m_error) return;
+        render(nullptr);
+    }
 
-        if (!m_shader.isLoaded()) {
-            Logger::log("vul::ForwardRenderer::render: Forward PBR shader not loaded");
-            m_error = true;
-            return;
-        }
+    void ForwardRenderer::render(RenderTarget* rt) {
+        if (m_error) return;
 
         if (!m_scene) {
             Logger::log("vul::ForwardRenderer::render: No scene assigned to renderer");
@@ -38,56 +144,266 @@ namespace vul {
             return;
         }
 
-        glUseProgram(m_shader->programHandle);
+        cullObjects();
 
-        // Global transformations
-        uint32_t location = glGetUniformLocation(m_shader->programHandle, "viewMat");
-        glUniformMatrix4fv(location, 1, GL_FALSE, &m_camera->getViewMatrix()[0][0]);
-        location = glGetUniformLocation(m_shader->programHandle, "projMat");
-        glUniformMatrix4fv(location, 1, GL_FALSE, &m_camera->getProjMatrix()[0][0]);
+        if (rt) {
+            if (!rt->hasDepthBuffer()) rt->addDepthBuffer();
+            rt->beginWrite();
+        }
 
-        uint32_t tmpPolycount = 0;
-        for (uint32_t i = 0; i < m_scene->getSceneObjectCount(SceneObjectType::Renderable); i++) {
-            Handle<RenderableObject> currentObject = m_scene->getRenderableObjectByIndex(i);
-            Handle<Mesh> mesh = currentObject->getMesh();
-            Handle<Texture> colorMap = currentObject->getColorMap();
-            tmpPolycount += mesh->ic / 3;
-
-            // Local transformations
-            glm::mat4 modelMatrix = currentObject->getTransformation().getTransformationMatrix();
-            glm::mat3 normalMatrix = currentObject->getTransformation().getNormalMatrix();
-
-            location = glGetUniformLocation(m_shader->programHandle, "modelMat");
-            glUniformMatrix4fv(location, 1, GL_FALSE, &modelMatrix[0][0]);
-            location = glGetUniformLocation(m_shader->programHandle, "normalMat");
-            glUniformMatrix3fv(location, 1, GL_FALSE, &normalMatrix[0][0]);
-
-            // Textures
-            if (colorMap->textureHandle != 0) {
-                location = glGetUniformLocation(m_shader->programHandle, "tex");
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, colorMap->textureHandle);
+        glDepthMask(GL_TRUE);
+        glClearColor(m_color[0], m_color[1], m_color[2], m_color[3]);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        m_drawCallCount = 0;
+        m_stateChangeCount = 0;
+        m_prepassTime = 0.0;
+        if (m_depthPrepass) depthPrepass();
+        cullLights();
+        shadingPass();
+        m_submitTime = m_prepassTime + m_shadingTime;
+
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LESS);
+        glDisable(GL_DEPTH_TEST);
+
+        if (rt) rt->endWrite();
+    }
+
+    void ForwardRenderer::setWireframeMode(bool wireframe) {
+        m_wireframe = wireframe;
+    }
+
+    void ForwardRenderer::setClearColor(float r, float g, float b, float a) {
+        m_color[0] = r;
+        m_color[1] = g;
+        m_color[2] = b;
+        m_color[3] = a;
+    }
+
+    void ForwardRenderer::setDepthPrepass(bool depthPrepass) {
+        m_depthPrepass = depthPrepass;
+    }
 
-                glUniform1i(location, 0);
+    Handle<LightGrid> ForwardRenderer::getLightGrid() {
+        return Handle<LightGrid>(m_lightGrid);
+    }
+
+    double ForwardRenderer::getPrepassTime() {
+        return m_prepassTime;
+    }
+
+    double ForwardRenderer::getLightCullTime() {
+        return m_lightCullTime;
+    }
+
+    double ForwardRenderer::getShadingTime() {
+        return m_shadingTime;
+    }
+
+    void ForwardRenderer::cullObjects() {
+        auto start = std::chrono::steady_clock::now();
+
+        m_scene->updateWorldTransformations();
+        const uint32_t objectCount = m_scene->getSceneObjectCount(SceneObjectType::Renderable);
+        const uint16_t* flags = m_scene->getRenderableFlags();
+        const uint32_t* meshIDs = m_scene->getRenderableMeshIDs();
+        const uint32_t* materialIDs = m_scene->getRenderableMaterialIDs();
+        const glm::vec4* worldSpheres = m_scene->getRenderableWorldSpheres();
+        const uint16_t visibleMask = static_cast<uint16_t>(RenderableObjectFlags::Visible)
+            | static_cast<uint16_t>(RenderableObjectFlags::MeshAttached);
+        const uint16_t skeletonFlag = static_cast<uint16_t>(RenderableObjectFlags::SkeletonAttached);
+
+        m_cullResults.resize(objectCount);
+        FrustumCuller::cull(m_camera->getFrustumPlanes(), worldSpheres, m_scene->getRenderableWorldExtents(),
+            0, objectCount, m_cullResults.data());
+
+        // Survivors are ordered by material and mesh, then front to back
+        const glm::mat4 view = m_camera->getViewMatrix();
+        const glm::vec4 viewDepthRow(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+        const float inverseFar = 1.f / m_camera->getFar();
+
+        uint32_t culledCount = 0;
+        m_renderQueue.clear();
+        for (uint32_t i = 0; i < objectCount; i++) {
+            if ((flags[i] & visibleMask) != visibleMask || (flags[i] & skeletonFlag) || m_scene->getMesh(meshIDs[i]).vao == 0) continue;
+            if (!m_cullResults[i]) {
+                culledCount++;
+                continue;
             }
 
-            // Extra
-            location = glGetUniformLocation(m_shader->programHandle, "near");
-            glUniform1f(location, m_camera->getNear());
+            const float depth = glm::dot(viewDepthRow, glm::vec4(glm::vec3(worldSpheres[i]), 1.f)) * inverseFar;
+            m_renderQueue.push(RenderQueue::makeKey(0, 0, materialIDs[i], meshIDs[i], depth), i);
+        }
+        m_renderQueue.sort();
+
+        m_culledCount = culledCount;
+        m_cullTime = millisecondsSince(start);
+    }
+
+    void ForwardRenderer::depthPrepass() {
+        auto start = std::chrono::steady_clock::now();
+        GPUProfiler::Scope profile(m_gpuProfiler, "prepass");
+
+        const uint32_t* meshIDs = m_scene->getRenderableMeshIDs();
+        const glm::mat4x3* worldMatrices = m_scene->getRenderableWorldMatrices();
+
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+        glUseProgram(m_depthShader->programHandle);
+        const glm::mat4 viewMatrix = m_camera->getViewMatrix();
+        const glm::mat4 projectionMatrix = m_camera->getProjMatrix();
+        glUniformMatrix4fv(m_depthUniforms.viewMatrix, 1, GL_FALSE, &viewMatrix[0][0]);
+        glUniformMatrix4fv(m_depthUniforms.projectionMatrix, 1, GL_FALSE, &projectionMatrix[0][0]);
+        uint32_t stateChangeCount = 1;
+
+        uint32_t boundVAO = 0;
+        const uint32_t drawCount = m_renderQueue.getSize();
+        for (uint32_t k = 0; k < drawCount; k++) {
+            const uint32_t i = m_renderQueue.getValue(k);
+            const Mesh& mesh = m_scene->getMesh(meshIDs[i]);
+            if (mesh.vao != boundVAO) {
+                glBindVertexArray(mesh.vao);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ib);
+                boundVAO = mesh.vao;
+                stateChangeCount++;
+            }
+
+            glUniformMatrix4x3fv(m_depthUniforms.modelMatrix, 1, GL_FALSE, &worldMatrices[i][0][0]);
+            glDrawElements(GL_TRIANGLES, mesh.ic, GL_UNSIGNED_INT, nullptr);
+        }
+        glBindVertexArray(0);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-            location = glGetUniformLocation(m_shader->programHandle, "far");
-            glUniform1f(location, m_camera->getFar());
+        m_drawCallCount += drawCount;
+        m_stateChangeCount += stateChangeCount;
+        m_prepassTime = millisecondsSince(start);
+    }
+
+    void ForwardRenderer::cullLights() {
+        auto start = std::chrono::steady_clock::now();
+
+        m_lightGrid.build(*m_scene, m_camera->getViewMatrix(), m_camera->getProjMatrix(), m_camera->getNear(),
+            m_camera->getFar(), m_camera->getWidth(), m_camera->getHeight());
+        m_lightGrid.upload();
+
+        m_lightCullTime = millisecondsSince(start);
+    }
+
+    void ForwardRenderer::shadingPass() {
+        auto start = std::chrono::steady_clock::now();
+        GPUProfiler::Scope profile(m_gpuProfiler, "shading");
+
+        drawBackground();
+
+        const uint32_t* meshIDs = m_scene->getRenderableMeshIDs();
+        const uint32_t* materialIDs = m_scene->getRenderableMaterialIDs();
+        const glm::mat4x3* worldMatrices = m_scene->getRenderableWorldMatrices();
+        const glm::mat3* worldNormalMatrices = m_scene->getRenderableWorldNormalMatrices();
+
+        // After a prepass, depth is final and only the nearest fragments pass
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(m_depthPrepass ? GL_LEQUAL : GL_LESS);
+        glDepthMask(m_depthPrepass ? GL_FALSE : GL_TRUE);
+        if (m_wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+        glUseProgram(m_shadingShader->programHandle);
+        const glm::mat4 viewMatrix = m_camera->getViewMatrix();
+        const glm::mat4 projectionMatrix = m_camera->getProjMatrix();
+        const glm::mat3 inverseViewMatrix = glm::inverse(glm::mat3(viewMatrix));
+        glUniformMatrix4fv(m_shadingUniforms.viewMatrix, 1, GL_FALSE, &viewMatrix[0][0]);
+        glUniformMatrix4fv(m_shadingUniforms.projectionMatrix, 1, GL_FALSE, &projectionMatrix[0][0]);
+        glUniformMatrix3fv(m_shadingUniforms.inverseViewMatrix, 1, GL_FALSE, &inverseViewMatrix[0][0]);
+        glUniform1i(m_shadingUniforms.tileCountX, static_cast<GLint>(m_lightGrid.getTileCountX()));
+        glUniform1i(m_shadingUniforms.depthSliceCount, static_cast<GLint>(m_lightGrid.getDepthSliceCount()));
+        glUniform1f(m_shadingUniforms.depthSliceScale, m_lightGrid.getDepthSliceScale());
+        glUniform1f(m_shadingUniforms.depthSliceBias, m_lightGrid.getDepthSliceBias());
+
+        // Nothing is bound to the environment units without both environments
+        const bool environmentLighting = m_environmentMap.isLoaded() && m_diffuseEnvironmentMap.isLoaded()
+            && m_environmentLUT.isLoaded();
+        glUniform1i(m_shadingUniforms.environmentLighting, environmentLighting);
+        glActiveTexture(GL_TEXTURE0 + environmentUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environmentLighting ? m_environmentMap->textureHandle : 0);
+        glActiveTexture(GL_TEXTURE0 + diffuseEnvironmentUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environmentLighting ? m_diffuseEnvironmentMap->textureHandle : 0);
+        glActiveTexture(GL_TEXTURE0 + environmentLUTUnit);
+        glBindTexture(GL_TEXTURE_2D, environmentLighting ? m_environmentLUT->textureHandle : 0);
+        m_lightGrid.bind(firstLightGridUnit);
+        uint32_t stateChangeCount = 1;
+
+        uint32_t boundMaterialID = SlotMap::invalidID;
+        uint32_t boundVAO = 0;
+        uint32_t tmpPolycount = 0;
+        const uint32_t drawCount = m_renderQueue.getSize();
+        for (uint32_t k = 0; k < drawCount; k++) {
+            const uint32_t i = m_renderQueue.getValue(k);
+            const Mesh& mesh = m_scene->getMesh(meshIDs[i]);
+            tmpPolycount += mesh.ic / 3;
+
+            // Textures, defaults will be used for maps that aren't attached
+            if (materialIDs[i] != boundMaterialID) {
+                const Material& material = m_scene->getMaterial(materialIDs[i]);
+                boundMaterialID = materialIDs[i];
+                stateChangeCount++;
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, material.colorMap.textureHandle != 0 ? material.colorMap.textureHandle
+                    : m_defaultColorMap->textureHandle);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, material.normalMap.textureHandle != 0 ? material.normalMap.textureHandle
+                    : m_defaultNormalMap->textureHandle);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, material.roughnessMap.textureHandle != 0 ? material.roughnessMap.textureHandle
+                    : m_defaultRoughnessMap->textureHandle);
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, material.metalMap.textureHandle != 0 ? material.metalMap.textureHandle
+                    : m_defaultMetalMap->textureHandle);
+            }
+
+            if (mesh.vao != boundVAO) {
+                glBindVertexArray(mesh.vao);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ib);
+                boundVAO = mesh.vao;
+                stateChangeCount++;
+            }
 
-            // Meshes
-            glBindVertexArray(mesh->vao);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ib);
-            glDrawElements(GL_TRIANGLES, mesh->ic, GL_UNSIGNED_INT, nullptr);
+            glUniformMatrix4x3fv(m_shadingUniforms.modelMatrix, 1, GL_FALSE, &worldMatrices[i][0][0]);
+            glUniformMatrix3fv(m_shadingUniforms.normalMatrix, 1, GL_FALSE, &worldNormalMatrices[i][0][0]);
+            glDrawElements(GL_TRIANGLES, mesh.ic, GL_UNSIGNED_INT, nullptr);
         }
+        glBindVertexArray(0);
+        if (m_wireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
         m_polycount = tmpPolycount;
+        m_drawCallCount += drawCount;
+        m_stateChangeCount += stateChangeCount;
+        m_shadingTime = millisecondsSince(start);
     }
 
-    void ForwardRenderer::setWireframeMode(bool wireframe) {
-        glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+    void ForwardRenderer::drawBackground() {
+        // Without an environment the clear color is the background
+        if (!m_environmentMap.isLoaded() || !m_quad.isLoaded()) return;
+
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+
+        glUseProgram(m_backgroundShader->programHandle);
+        const glm::mat4 projectionMatrix = m_camera->getProjMatrix();
+        const glm::mat3 inverseViewMatrix = glm::inverse(glm::mat3(m_camera->getViewMatrix()));
+        const glm::vec2 inverseProjectionScale(1.f / projectionMatrix[0][0], 1.f / projectionMatrix[1][1]);
+        glUniformMatrix3fv(m_backgroundUniforms.inverseViewMatrix, 1, GL_FALSE, &inverseViewMatrix[0][0]);
+        glUniform2fv(m_backgroundUniforms.inverseProjectionScale, 1, &inverseProjectionScale[0]);
+
+        glActiveTexture(GL_TEXTURE0 + environmentUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_environmentMap->textureHandle);
+
+        glBindVertexArray(m_quad->vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quad->ib);
+        glDrawElements(GL_TRIANGLES, m_quad->ic, GL_UNSIGNED_INT, nullptr);
+        glBindVertexArray(0);
     }
 }
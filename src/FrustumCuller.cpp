@@ -0,0 +1,71 @@
+#define VULPESENGINE_EXPORT
+
+#include <cmath>
+
+#include <vulpes/FrustumCuller.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VUL_CULL_SSE
+#include <emmintrin.h>
+#endif // SSE2
+
+namespace vul {
+    void FrustumCuller::cull(const glm::vec4* planes, const glm::vec4* spheres, const glm::vec4* extents,
+        uint32_t begin, uint32_t end, uint8_t* results) {
+        uint32_t i = begin;
+
+#ifdef VUL_CULL_SSE
+        __m128 planeComponents[6][4], planeAbs[6][3];
+        const __m128 signMask = _mm_set1_ps(-0.f);
+        for (int p = 0; p < 6; p++) {
+            for (int k = 0; k < 4; k++) planeComponents[p][k] = _mm_set1_ps(planes[p][k]);
+            for (int k = 0; k < 3; k++) planeAbs[p][k] = _mm_andnot_ps(signMask, planeComponents[p][k]);
+        }
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 cx = _mm_loadu_ps(&spheres[i][0]), cy = _mm_loadu_ps(&spheres[i + 1][0]);
+            __m128 cz = _mm_loadu_ps(&spheres[i + 2][0]), radius = _mm_loadu_ps(&spheres[i + 3][0]);
+            _MM_TRANSPOSE4_PS(cx, cy, cz, radius);
+
+            __m128 ex = _mm_loadu_ps(&extents[i][0]), ey = _mm_loadu_ps(&extents[i + 1][0]);
+            __m128 ez = _mm_loadu_ps(&extents[i + 2][0]), ew = _mm_loadu_ps(&extents[i + 3][0]);
+            _MM_TRANSPOSE4_PS(ex, ey, ez, ew);
+
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < 6; p++) {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeComponents[p][0], cx),
+                    _mm_mul_ps(planeComponents[p][1], cy)), _mm_mul_ps(planeComponents[p][2], cz)),
+                    planeComponents[p][3]);
+                __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeAbs[p][0], ex),
+                    _mm_mul_ps(planeAbs[p][1], ey)), _mm_mul_ps(planeAbs[p][2], ez));
+
+                // Both volumes contain the object, so the tighter one decides
+                __m128 reach = _mm_min_ps(radius, boxRadius);
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), reach)));
+            }
+
+            int mask = _mm_movemask_ps(outside);
+            for (int k = 0; k < 4; k++) results[i + k] = (mask >> k) & 1 ? 0 : 1;
+        }
+#endif // VUL_CULL_SSE
+
+        cullScalar(planes, spheres, extents, i, end, results);
+    }
+
+    void FrustumCuller::cullScalar(const glm::vec4* planes, const glm::vec4* spheres, const glm::vec4* extents,
+        uint32_t begin, uint32_t end, uint8_t* results) {
+        for (uint32_t i = begin; i < end; i++) {
+            const glm::vec4& sphere = spheres[i];
+            const glm::vec4& extent = extents[i];
+
+            uint8_t visible = 1;
+            for (int p = 0; p < 6; p++) {
+                const glm::vec4& plane = planes[p];
+                float distance = plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w;
+                float boxRadius = std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y + std::abs(plane.z) * extent.z;
+                if (distance < -std::fmin(sphere.w, boxRadius)) visible = 0;
+            }
+            results[i] = visible;
+        }
+    }
+}
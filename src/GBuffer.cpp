@@ -1,5 +1,7 @@
 #define VULPESENGINE_EXPORT
 
+#include <algorithm>
+
 #include <GL/glew.h>
 
 #include <vulpes/GBuffer.hpp>
@@ -7,7 +9,22 @@
 #include "Logger.h"
 
 namespace vul {
-    GBuffer::GBuffer(uint32_t textureCount) : m_textureCount(textureCount), m_loaded(false) {
+    namespace {
+        // Pixel format matching a sized internal format, only used to allocate storage
+        GLenum baseFormat(GLenum internalFormat) {
+            switch (internalFormat) {
+            case GL_R8: case GL_R16: case GL_R16F: case GL_R32F: return GL_RED;
+            case GL_RG8: case GL_RG16: case GL_RG16F: case GL_RG32F: return GL_RG;
+            case GL_RGB8: case GL_RGB16F: case GL_R11F_G11F_B10F: return GL_RGB;
+            default: return GL_RGBA;
+            }
+        }
+    }
+
+    GBuffer::GBuffer(uint32_t textureCount) : m_textureCount(textureCount), m_depthStencil(false), m_windowWidth(0),
+        m_windowHeight(0), m_scalingFactor(1), m_renderWidth(0), m_renderHeight(0), m_loaded(false) {
+        for (uint32_t i = 0; i < m_maxTextures; i++) m_formats[i] = GL_RGBA8;
+        m_formats[1] = GL_RG16F;
     }
 
     GBuffer::~GBuffer() {
@@ -19,6 +36,8 @@ namespace vul {
         m_windowWidth = windowWidth;
         m_windowHeight = windowHeight;
         m_scalingFactor = scalingFactor;
+        m_renderWidth = windowWidth * scalingFactor;
+        m_renderHeight = windowHeight * scalingFactor;
 
         // Create FBO
         glGenFramebuffers(1, &m_fbo);
@@ -30,15 +49,23 @@ namespace vul {
 
         for (uint32_t i = 0; i < m_textureCount; i++) {
             glBindTexture(GL_TEXTURE_2D, m_textures[i]);
-            glTexImage2D(GL_TEXTURE_2D, 0, (i == 1) ? GL_RG16F : GL_RGBA8, windowWidth * scalingFactor, windowHeight * scalingFactor, 0, (i == 1) ? GL_RG : GL_RGBA, (i == 1) ? GL_HALF_FLOAT : GL_BYTE, nullptr);
+            glTexImage2D(GL_TEXTURE_2D, 0, m_formats[i], windowWidth * scalingFactor, windowHeight * scalingFactor, 0,
+                baseFormat(m_formats[i]), GL_UNSIGNED_BYTE, nullptr);
             glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
             glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_textures[i], 0);
         }
 
         glBindTexture(GL_TEXTURE_2D, m_depthTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, windowWidth * scalingFactor, windowHeight * scalingFactor, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+        if (m_depthStencil) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, windowWidth * scalingFactor, windowHeight * scalingFactor, 0,
+                GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, nullptr);
+        }
+        else glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, windowWidth * scalingFactor, windowHeight * scalingFactor, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, m_depthStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
 
         GLenum* drawBuffers = new GLenum[m_textureCount];
         for (uint32_t i = 0; i < m_textureCount; i++)
@@ -68,8 +95,62 @@ namespace vul {
         m_loaded = false;
     }
 
+    void GBuffer::setTextureCount(uint32_t textureCount) {
+        if (textureCount > m_maxTextures) {
+            Logger::log("vul::GBuffer::setTextureCount: At most %u textures are supported", m_maxTextures);
+            return;
+        }
+
+        if (m_loaded) release();
+        m_textureCount = textureCount;
+        if (m_windowWidth != 0) initialize(m_windowWidth, m_windowHeight, m_scalingFactor);
+    }
+
+    void GBuffer::setTextureFormat(uint32_t index, uint32_t internalFormat) {
+        if (index >= m_maxTextures) return;
+
+        m_formats[index] = internalFormat;
+        if (m_loaded && index < m_textureCount) initialize(m_windowWidth, m_windowHeight, m_scalingFactor);
+    }
+
+    void GBuffer::setDepthStencil(bool depthStencil) {
+        if (depthStencil == m_depthStencil) return;
+
+        m_depthStencil = depthStencil;
+        if (m_loaded) initialize(m_windowWidth, m_windowHeight, m_scalingFactor);
+    }
+
+    uint32_t GBuffer::getTextureCount() {
+        return m_textureCount;
+    }
+
+    uint32_t GBuffer::getTextureFormat(uint32_t index) {
+        return m_formats[index];
+    }
+
+    void GBuffer::setRenderSize(uint32_t width, uint32_t height) {
+        m_renderWidth = std::max(1u, std::min(width, m_windowWidth * m_scalingFactor));
+        m_renderHeight = std::max(1u, std::min(height, m_windowHeight * m_scalingFactor));
+    }
+
+    uint32_t GBuffer::getRenderWidth() {
+        return m_renderWidth;
+    }
+
+    uint32_t GBuffer::getRenderHeight() {
+        return m_renderHeight;
+    }
+
+    uint32_t GBuffer::getWidth() {
+        return m_windowWidth * m_scalingFactor;
+    }
+
+    uint32_t GBuffer::getHeight() {
+        return m_windowHeight * m_scalingFactor;
+    }
+
     void GBuffer::bindWrite() {
-        glViewport(0, 0, m_windowWidth * m_scalingFactor, m_windowHeight * m_scalingFactor);
+        glViewport(0, 0, m_renderWidth, m_renderHeight);
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
     }
 
@@ -89,4 +170,8 @@ namespace vul {
     void GBuffer::bindTexture(uint32_t index) {
         glBindTexture(GL_TEXTURE_2D, m_textures[index]);
     }
+
+    void GBuffer::bindDepthTexture() {
+        glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    }
 }
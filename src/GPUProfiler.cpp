@@ -0,0 +1,210 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <cmath>
+
+#include <GL/glew.h>
+
+#include <vulpes/GPUProfiler.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    GPUProfiler::GPUProfiler(uint32_t historyLength) : m_historyLength(std::max(1u, historyLength)), m_initialized(false) {
+    }
+
+    GPUProfiler::~GPUProfiler() {
+        release();
+    }
+
+    bool GPUProfiler::initialize() {
+        if (m_initialized) return true;
+
+        if (!GLEW_ARB_timer_query) {
+            Logger::log("vul::GPUProfiler::initialize: Timer queries are not supported");
+            return false;
+        }
+
+        m_frames.assign(1, std::vector<Interval>());
+        m_initialized = true;
+        return true;
+    }
+
+    void GPUProfiler::release() {
+        for (auto& frame : m_frames) {
+            for (const Interval& interval : frame) {
+                m_freeQueries.push_back(interval.start);
+                if (interval.end != 0) m_freeQueries.push_back(interval.end);
+            }
+        }
+        if (!m_freeQueries.empty()) glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()), m_freeQueries.data());
+
+        m_frames.clear();
+        m_openIntervals.clear();
+        m_freeQueries.clear();
+        m_initialized = false;
+    }
+
+    bool GPUProfiler::isInitialized() {
+        return m_initialized;
+    }
+
+    void GPUProfiler::begin(const std::string& pass) {
+        if (!m_initialized) return;
+
+        auto it = m_passIndices.find(pass);
+        if (it == m_passIndices.end()) {
+            it = m_passIndices.emplace(pass, static_cast<uint32_t>(m_passes.size())).first;
+            m_passes.push_back({ pass, std::vector<double>(m_historyLength, 0.0), 0, 0, 0, 0.0 });
+        }
+
+        std::vector<Interval>& frame = m_frames.back();
+        m_openIntervals.push_back(static_cast<uint32_t>(frame.size()));
+        frame.push_back({ it->second, getQuery(), 0 });
+        glQueryCounter(frame.back().start, GL_TIMESTAMP);
+    }
+
+    void GPUProfiler::end(const std::string& pass) {
+        if (!m_initialized) return;
+
+        auto it = m_passIndices.find(pass);
+        if (it == m_passIndices.end()) return;
+
+        // Usually the innermost open pass
+        std::vector<Interval>& frame = m_frames.back();
+        for (auto open = m_openIntervals.rbegin(); open != m_openIntervals.rend(); ++open) {
+            Interval& interval = frame[*open];
+            if (interval.pass != it->second) continue;
+
+            interval.end = getQuery();
+            glQueryCounter(interval.end, GL_TIMESTAMP);
+            m_openIntervals.erase(std::next(open).base());
+            return;
+        }
+    }
+
+    void GPUProfiler::endFrame() {
+        if (!m_initialized) return;
+
+        // Passes left open end with the frame
+        std::vector<Interval>& frame = m_frames.back();
+        for (uint32_t open : m_openIntervals) {
+            frame[open].end = getQuery();
+            glQueryCounter(frame[open].end, GL_TIMESTAMP);
+        }
+        m_openIntervals.clear();
+
+        // Frames finish in order, so reading stops at the first one still in flight
+        while (m_frames.size() > 0 && readFrame(m_frames.front())) {
+            for (const Interval& interval : m_frames.front()) {
+                m_freeQueries.push_back(interval.start);
+                m_freeQueries.push_back(interval.end);
+            }
+            m_frames.pop_front();
+        }
+        m_frames.push_back(std::vector<Interval>());
+    }
+
+    GPUProfiler::Scope::Scope(GPUProfiler* profiler, const char* pass) : m_profiler(profiler), m_pass(pass) {
+        if (m_profiler) m_profiler->begin(m_pass);
+    }
+
+    GPUProfiler::Scope::~Scope() {
+        if (m_profiler) m_profiler->end(m_pass);
+    }
+
+    std::vector<std::string> GPUProfiler::getPassNames() {
+        std::vector<std::string> names;
+        for (const Pass& pass : m_passes) names.push_back(pass.name);
+        return names;
+    }
+
+    uint32_t GPUProfiler::getSampleCount(const std::string& pass) {
+        Pass* p = findPass(pass);
+        return p ? p->count : 0;
+    }
+
+    double GPUProfiler::getLatest(const std::string& pass) {
+        Pass* p = findPass(pass);
+        if (!p || p->count == 0) return 0.0;
+        return p->history[(p->next + m_historyLength - 1) % m_historyLength];
+    }
+
+    double GPUProfiler::getAverage(const std::string& pass) {
+        Pass* p = findPass(pass);
+        if (!p || p->count == 0) return 0.0;
+
+        double sum = 0.0;
+        for (uint32_t i = 0; i < p->count; i++) sum += p->history[i];
+        return sum / p->count;
+    }
+
+    double GPUProfiler::getPercentile(const std::string& pass, double percentile) {
+        Pass* p = findPass(pass);
+        if (!p || p->count == 0) return 0.0;
+
+        // Nearest rank
+        m_scratch.assign(p->history.begin(), p->history.begin() + p->count);
+        const double rank = std::ceil(std::max(0.0, std::min(percentile, 100.0)) / 100.0 * p->count);
+        const size_t index = static_cast<size_t>(std::max(1.0, rank)) - 1;
+        std::nth_element(m_scratch.begin(), m_scratch.begin() + index, m_scratch.end());
+        return m_scratch[index];
+    }
+
+    uint64_t GPUProfiler::getTotalSampleCount(const std::string& pass) {
+        Pass* p = findPass(pass);
+        return p ? p->totalCount : 0;
+    }
+
+    void GPUProfiler::clearHistory() {
+        for (Pass& pass : m_passes) {
+            pass.next = 0;
+            pass.count = 0;
+        }
+    }
+
+    GPUProfiler::Pass* GPUProfiler::findPass(const std::string& pass) {
+        auto it = m_passIndices.find(pass);
+        return it != m_passIndices.end() ? &m_passes[it->second] : nullptr;
+    }
+
+    uint32_t GPUProfiler::getQuery() {
+        if (m_freeQueries.empty()) {
+            GLuint query = 0;
+            glGenQueries(1, &query);
+            return query;
+        }
+
+        uint32_t query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+        return query;
+    }
+
+    bool GPUProfiler::readFrame(const std::vector<Interval>& frame) {
+        for (const Interval& interval : frame) {
+            GLint available = 0;
+            glGetQueryObjectiv(interval.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return false;
+        }
+
+        for (Pass& pass : m_passes) pass.frameTime = -1.0;
+        for (const Interval& interval : frame) {
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(interval.start, GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(interval.end, GL_QUERY_RESULT, &end);
+
+            Pass& pass = m_passes[interval.pass];
+            pass.frameTime = std::max(pass.frameTime, 0.0) + static_cast<double>(end - start) / 1000000.0;
+        }
+
+        // Only passes that ran in the frame get a sample
+        for (Pass& pass : m_passes) {
+            if (pass.frameTime < 0.0) continue;
+            pass.history[pass.next] = pass.frameTime;
+            pass.next = (pass.next + 1) % m_historyLength;
+            pass.count = std::min(pass.count + 1, m_historyLength);
+            pass.totalCount++;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,303 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <cmath>
+
+#include <GL/glew.h>
+
+#include <vulpes/LightGrid.hpp>
+#include <vulpes/Scene.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VUL_LIGHTGRID_SSE
+#include <emmintrin.h>
+#endif // SSE2
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace vul {
+    const uint32_t LightGrid::tileSize;
+
+    namespace {
+        // Smallest share of columns, rows or tile rows handed to a thread
+        const uint32_t minPlaneChunk = 8;
+        const uint32_t minRowChunk = 2;
+
+        uint32_t lowestBit(uint32_t bits) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, bits);
+            return index;
+#else
+            return __builtin_ctz(bits);
+#endif // _MSC_VER
+        }
+
+        // Runs function(begin, end, threadIndex) over [0, count), on the pool when there is one
+        template <typename Function>
+        void forRange(ThreadPool* threadPool, uint32_t count, uint32_t minChunk, const Function& function) {
+            if (threadPool && count > minChunk) threadPool->parallelFor(count, minChunk, function);
+            else function(0, count, 0);
+        }
+    }
+
+    LightGrid::LightGrid() : m_tileCountX(0), m_tileCountY(0), m_depthSliceCount(1), m_depthSliceScale(0.f),
+        m_depthSliceBias(0.f), m_lightCount(0), m_maskWords(0), m_threadPool(nullptr) {
+        for (int i = 0; i < 3; i++) {
+            m_buffers[i] = 0;
+            m_textures[i] = 0;
+        }
+    }
+
+    LightGrid::~LightGrid() {
+        release();
+    }
+
+    void LightGrid::setDepthSliceCount(uint32_t depthSliceCount) {
+        m_depthSliceCount = std::max(1u, depthSliceCount);
+    }
+
+    uint32_t LightGrid::getDepthSliceCount() {
+        return m_depthSliceCount;
+    }
+
+    void LightGrid::setThreadPool(ThreadPool& threadPool) {
+        m_threadPool = &threadPool;
+    }
+
+    void LightGrid::build(Scene& scene, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
+        float near, float far, uint32_t width, uint32_t height) {
+        m_tileCountX = (width + tileSize - 1) / tileSize;
+        m_tileCountY = (height + tileSize - 1) / tileSize;
+        m_depthSliceScale = m_depthSliceCount / std::log(far / near);
+        m_depthSliceBias = -std::log(near) * m_depthSliceScale;
+
+        m_lightX.clear();
+        m_lightY.clear();
+        m_lightZ.clear();
+        m_lightRadius.clear();
+        m_lightData.clear();
+
+        const uint32_t sceneLightCount = scene.getSceneObjectCount(SceneObjectType::PointLight);
+        for (uint32_t i = 0; i < sceneLightCount; i++) {
+            Handle<PointLight> light = scene.getPointLightByIndex(i);
+            const glm::vec3 position = glm::vec3(viewMatrix * glm::vec4(light->getTransformation().getPosition(), 1.f));
+            const float radius = light->getRadius();
+            if (-position.z + radius < near || -position.z - radius > far) continue;
+
+            m_lightX.push_back(position.x);
+            m_lightY.push_back(position.y);
+            m_lightZ.push_back(position.z);
+            m_lightRadius.push_back(radius);
+            m_lightData.push_back(glm::vec4(position, radius));
+            m_lightData.push_back(glm::vec4(light->getColor() * light->getBrightness(), 0.f));
+        }
+
+        // Padding lights have a negative radius, which no plane test passes
+        m_lightCount = static_cast<uint32_t>(m_lightX.size());
+        const uint32_t paddedCount = (m_lightCount + 3) / 4 * 4;
+        m_lightX.resize(paddedCount, 0.f);
+        m_lightY.resize(paddedCount, 0.f);
+        m_lightZ.resize(paddedCount, 0.f);
+        m_lightRadius.resize(paddedCount, -1.f);
+
+        m_maskWords = (m_lightCount + 31) / 32;
+        m_columnMasks.assign(m_tileCountX * m_maskWords, 0);
+        m_rowMasks.assign(m_tileCountY * m_maskWords, 0);
+
+        // A tile edge at NDC x = X is the plane (P00, 0, P20 + X) through the eye,
+        // which faces into the tile on its left edge and out of it on its right
+        const float p00 = projectionMatrix[0][0], p20 = projectionMatrix[2][0];
+        const float p11 = projectionMatrix[1][1], p21 = projectionMatrix[2][1];
+        if (m_lightCount > 0) {
+            forRange(m_threadPool, m_tileCountX, minPlaneChunk, [&](uint32_t begin, uint32_t end, uint32_t) {
+                for (uint32_t x = begin; x < end; x++) {
+                    const float left = -1.f + 2.f * (x * tileSize) / width;
+                    const float right = std::min(1.f, -1.f + 2.f * ((x + 1) * tileSize) / width);
+                    testPlanes(glm::vec3(p00, 0.f, p20 + left), -glm::vec3(p00, 0.f, p20 + right), &m_columnMasks[x * m_maskWords]);
+                }
+            });
+            forRange(m_threadPool, m_tileCountY, minPlaneChunk, [&](uint32_t begin, uint32_t end, uint32_t) {
+                for (uint32_t y = begin; y < end; y++) {
+                    const float bottom = -1.f + 2.f * (y * tileSize) / height;
+                    const float top = std::min(1.f, -1.f + 2.f * ((y + 1) * tileSize) / height);
+                    testPlanes(glm::vec3(0.f, p11, p21 + bottom), -glm::vec3(0.f, p11, p21 + top), &m_rowMasks[y * m_maskWords]);
+                }
+            });
+        }
+
+        // Slices a light's depth range overlaps, from its nearest and farthest view depth
+        const int32_t lastSlice = static_cast<int32_t>(m_depthSliceCount) - 1;
+        m_lightSlices.resize(m_lightCount * 2);
+        for (uint32_t i = 0; i < m_lightCount; i++) {
+            const float nearest = std::max(-m_lightZ[i] - m_lightRadius[i], near);
+            const float farthest = std::min(-m_lightZ[i] + m_lightRadius[i], far);
+            const int32_t first = static_cast<int32_t>(std::floor(std::log(nearest) * m_depthSliceScale + m_depthSliceBias));
+            const int32_t last = static_cast<int32_t>(std::floor(std::log(farthest) * m_depthSliceScale + m_depthSliceBias));
+            m_lightSlices[i * 2] = std::min(std::max(first, 0), lastSlice);
+            m_lightSlices[i * 2 + 1] = std::min(std::max(last, 0), lastSlice);
+        }
+
+        // Tile rows are listed in parallel, each into its own list, then merged in order
+        m_clusterRanges.resize(m_tileCountX * m_tileCountY * m_depthSliceCount * 2);
+        m_rowIndices.resize(m_tileCountY);
+        m_scratch.resize(m_threadPool ? m_threadPool->getThreadCount() : 1);
+        forRange(m_threadPool, m_tileCountY, minRowChunk, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            for (uint32_t y = begin; y < end; y++) buildRow(y, m_scratch[threadIndex]);
+        });
+
+        m_lightIndices.clear();
+        const uint32_t rowClusterCount = m_tileCountX * m_depthSliceCount;
+        for (uint32_t y = 0; y < m_tileCountY; y++) {
+            const uint32_t rowOffset = static_cast<uint32_t>(m_lightIndices.size());
+            for (uint32_t cluster = y * rowClusterCount; cluster < (y + 1) * rowClusterCount; cluster++)
+                m_clusterRanges[cluster * 2] += rowOffset;
+            m_lightIndices.insert(m_lightIndices.end(), m_rowIndices[y].begin(), m_rowIndices[y].end());
+        }
+    }
+
+    void LightGrid::buildRow(uint32_t tileY, std::vector<uint32_t>& tileLights) {
+        std::vector<uint32_t>& indices = m_rowIndices[tileY];
+        indices.clear();
+
+        std::vector<uint32_t> sliceCounts(m_depthSliceCount);
+        const uint32_t* rowMask = m_maskWords > 0 ? &m_rowMasks[tileY * m_maskWords] : nullptr;
+        for (uint32_t x = 0; x < m_tileCountX; x++) {
+            // Lights the tile's column and row share, each counted in the slices it spans
+            const uint32_t* columnMask = m_maskWords > 0 ? &m_columnMasks[x * m_maskWords] : nullptr;
+            tileLights.clear();
+            std::fill(sliceCounts.begin(), sliceCounts.end(), 0);
+            for (uint32_t word = 0; word < m_maskWords; word++) {
+                for (uint32_t bits = columnMask[word] & rowMask[word]; bits != 0; bits &= bits - 1) {
+                    const uint32_t light = word * 32 + lowestBit(bits);
+                    tileLights.push_back(light);
+                    for (int32_t slice = m_lightSlices[light * 2]; slice <= m_lightSlices[light * 2 + 1]; slice++) sliceCounts[slice]++;
+                }
+            }
+
+            // Counts become each slice's write position, lights stay in scene order
+            const uint32_t firstCluster = (tileY * m_tileCountX + x) * m_depthSliceCount;
+            uint32_t first = static_cast<uint32_t>(indices.size());
+            for (uint32_t slice = 0; slice < m_depthSliceCount; slice++) {
+                m_clusterRanges[(firstCluster + slice) * 2] = first;
+                m_clusterRanges[(firstCluster + slice) * 2 + 1] = sliceCounts[slice];
+                const uint32_t count = sliceCounts[slice];
+                sliceCounts[slice] = first;
+                first += count;
+            }
+
+            indices.resize(first);
+            for (uint32_t light : tileLights) {
+                for (int32_t slice = m_lightSlices[light * 2]; slice <= m_lightSlices[light * 2 + 1]; slice++)
+                    indices[sliceCounts[slice]++] = light;
+            }
+        }
+    }
+
+    void LightGrid::testPlanes(const glm::vec3& first, const glm::vec3& second, uint32_t* mask) {
+        const glm::vec3 a = glm::normalize(first), b = glm::normalize(second);
+        uint32_t i = 0;
+
+#ifdef VUL_LIGHTGRID_SSE
+        const __m128 ax = _mm_set1_ps(a.x), ay = _mm_set1_ps(a.y), az = _mm_set1_ps(a.z);
+        const __m128 bx = _mm_set1_ps(b.x), by = _mm_set1_ps(b.y), bz = _mm_set1_ps(b.z);
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= m_lightX.size(); i += 4) {
+            const __m128 x = _mm_loadu_ps(&m_lightX[i]), y = _mm_loadu_ps(&m_lightY[i]);
+            const __m128 z = _mm_loadu_ps(&m_lightZ[i]);
+            const __m128 reach = _mm_sub_ps(zero, _mm_loadu_ps(&m_lightRadius[i]));
+
+            const __m128 distanceA = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, x), _mm_mul_ps(ay, y)), _mm_mul_ps(az, z));
+            const __m128 distanceB = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, x), _mm_mul_ps(by, y)), _mm_mul_ps(bz, z));
+            const __m128 inside = _mm_and_ps(_mm_cmpge_ps(distanceA, reach), _mm_cmpge_ps(distanceB, reach));
+
+            mask[i / 32] |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << (i % 32);
+        }
+#endif // VUL_LIGHTGRID_SSE
+
+        for (; i < m_lightCount; i++) {
+            const glm::vec3 position(m_lightX[i], m_lightY[i], m_lightZ[i]);
+            if (glm::dot(a, position) >= -m_lightRadius[i] && glm::dot(b, position) >= -m_lightRadius[i])
+                mask[i / 32] |= 1u << (i % 32);
+        }
+    }
+
+    void LightGrid::upload() {
+        if (m_buffers[0] == 0) {
+            const GLenum formats[3] = { GL_RG32UI, GL_R32UI, GL_RGBA32F };
+            glGenBuffers(3, m_buffers);
+            glGenTextures(3, m_textures);
+            for (int i = 0; i < 3; i++) {
+                glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+                glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+                glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+                glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_buffers[i]);
+            }
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // Empty lists still get a texel so no buffer is ever zero sized
+        const void* data[3] = { m_clusterRanges.data(), m_lightIndices.data(), m_lightData.data() };
+        const size_t sizes[3] = { m_clusterRanges.size() * sizeof(uint32_t), m_lightIndices.size() * sizeof(uint32_t),
+            m_lightData.size() * sizeof(glm::vec4) };
+        for (int i = 0; i < 3; i++) {
+            glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+            if (sizes[i] == 0) glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+            else glBufferData(GL_TEXTURE_BUFFER, sizes[i], data[i], GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void LightGrid::bind(uint32_t firstUnit) {
+        for (uint32_t i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+        }
+    }
+
+    void LightGrid::release() {
+        if (m_buffers[0] != 0) {
+            glDeleteTextures(3, m_textures);
+            glDeleteBuffers(3, m_buffers);
+        }
+
+        for (int i = 0; i < 3; i++) {
+            m_buffers[i] = 0;
+            m_textures[i] = 0;
+        }
+    }
+
+    uint32_t LightGrid::getTileCountX() {
+        return m_tileCountX;
+    }
+
+    uint32_t LightGrid::getTileCountY() {
+        return m_tileCountY;
+    }
+
+    uint32_t LightGrid::getLightCount() {
+        return m_lightCount;
+    }
+
+    uint32_t LightGrid::getIndexCount() {
+        return static_cast<uint32_t>(m_lightIndices.size());
+    }
+
+    float LightGrid::getDepthSliceScale() {
+        return m_depthSliceScale;
+    }
+
+    float LightGrid::getDepthSliceBias() {
+        return m_depthSliceBias;
+    }
+
+    uint32_t LightGrid::getTileLightCount(uint32_t tileX, uint32_t tileY, uint32_t slice) {
+        return m_clusterRanges[((tileY * m_tileCountX + tileX) * m_depthSliceCount + slice) * 2 + 1];
+    }
+
+    const uint32_t* LightGrid::getTileLights(uint32_t tileX, uint32_t tileY, uint32_t slice) {
+        return m_lightIndices.data() + m_clusterRanges[((tileY * m_tileCountX + tileX) * m_depthSliceCount + slice) * 2];
+    }
+}
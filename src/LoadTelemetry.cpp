@@ -0,0 +1,164 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <vulpes/LoadTelemetry.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    LoadTelemetry::LoadTelemetry(uint32_t capacity) : m_next(0), m_count(0) {
+        m_records.resize(capacity > 0 ? capacity : 1);
+    }
+
+    LoadTelemetry::~LoadTelemetry() {
+    }
+
+    void LoadTelemetry::addRecord(const LoadRecord& record) {
+        m_records[m_next] = record;
+        m_next = (m_next + 1) % m_records.size();
+        if (m_count < m_records.size()) m_count++;
+    }
+
+    void LoadTelemetry::clear() {
+        m_next = 0;
+        m_count = 0;
+    }
+
+    uint32_t LoadTelemetry::getRecordCount() {
+        return m_count;
+    }
+
+    LoadRecord LoadTelemetry::getRecord(uint32_t index) {
+        // Once the ring has wrapped, the oldest record is the one about to be overwritten
+        uint32_t capacity = static_cast<uint32_t>(m_records.size());
+        uint32_t first = (m_count < capacity) ? 0 : m_next;
+        return m_records[(first + index) % capacity];
+    }
+
+    bool LoadTelemetry::dumpCSV(const std::string& path) {
+        std::ofstream o(path, std::ofstream::out | std::ofstream::trunc);
+        if (!o) {
+            Logger::log("vul::LoadTelemetry::dumpCSV: Unable to open '%s'", path.c_str());
+            return false;
+        }
+
+        o << "path,type,cache_hit,succeeded,read_ms,parse_ms,upload_ms,total_ms,bytes_read,bytes_uploaded\n";
+        o << std::fixed << std::setprecision(3);
+        for (uint32_t i = 0; i < m_count; i++) {
+            LoadRecord record = getRecord(i);
+
+            // Quote paths since they may contain commas, doubling any quotes
+            std::string path = record.path;
+            for (size_t pos = path.find('"'); pos != std::string::npos; pos = path.find('"', pos + 2))
+                path.insert(pos, 1, '"');
+
+            o << '"' << path << "\"," << getAssetTypeName(record.type) << ','
+                << (record.cacheHit ? 1 : 0) << ',' << (record.succeeded ? 1 : 0) << ','
+                << record.readTime << ',' << record.parseTime << ',' << record.uploadTime << ','
+                << record.getTotalTime() << ',' << record.bytesRead << ',' << record.bytesUploaded << '\n';
+        }
+
+        return true;
+    }
+
+    bool LoadTelemetry::dumpJSON(const std::string& path) {
+        std::ofstream o(path, std::ofstream::out | std::ofstream::trunc);
+        if (!o) {
+            Logger::log("vul::LoadTelemetry::dumpJSON: Unable to open '%s'", path.c_str());
+            return false;
+        }
+
+        o << "[\n" << std::fixed << std::setprecision(3);
+        for (uint32_t i = 0; i < m_count; i++) {
+            LoadRecord record = getRecord(i);
+
+            std::string escapedPath;
+            for (char c : record.path) {
+                if (c == '"' || c == '\\') escapedPath.push_back('\\');
+                escapedPath.push_back(c);
+            }
+
+            o << "  {\"path\": \"" << escapedPath
+                << "\", \"type\": \"" << getAssetTypeName(record.type)
+                << "\", \"cacheHit\": " << (record.cacheHit ? "true" : "false")
+                << ", \"succeeded\": " << (record.succeeded ? "true" : "false")
+                << ", \"readMs\": " << record.readTime
+                << ", \"parseMs\": " << record.parseTime
+                << ", \"uploadMs\": " << record.uploadTime
+                << ", \"bytesRead\": " << record.bytesRead
+                << ", \"bytesUploaded\": " << record.bytesUploaded << "}"
+                << (i + 1 < m_count ? ",\n" : "\n");
+        }
+        o << "]\n";
+
+        return true;
+    }
+
+    std::string LoadTelemetry::getReport(uint32_t slowestCount) {
+        std::vector<LoadRecord> misses;
+        const uint32_t typeCount = static_cast<uint32_t>(AssetType::Count);
+        LoadRecord totals[typeCount];
+        uint32_t loads[typeCount] = {};
+        uint32_t hits[typeCount] = {};
+
+        for (uint32_t i = 0; i < m_count; i++) {
+            LoadRecord record = getRecord(i);
+            uint32_t type = static_cast<uint32_t>(record.type);
+
+            if (record.cacheHit) {
+                hits[type]++;
+                continue;
+            }
+
+            loads[type]++;
+            totals[type].readTime += record.readTime;
+            totals[type].parseTime += record.parseTime;
+            totals[type].uploadTime += record.uploadTime;
+            totals[type].bytesRead += record.bytesRead;
+            totals[type].bytesUploaded += record.bytesUploaded;
+            misses.push_back(record);
+        }
+
+        std::sort(misses.begin(), misses.end(), [](const LoadRecord& a, const LoadRecord& b) {
+            return a.getTotalTime() > b.getTotalTime();
+        });
+        if (misses.size() > slowestCount) misses.resize(slowestCount);
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(2);
+        report << "Slowest assets (total / read / parse / upload ms):\n";
+        for (auto& record : misses) {
+            report << "  " << std::setw(9) << record.getTotalTime()
+                << " / " << record.readTime << " / " << record.parseTime << " / " << record.uploadTime
+                << "  [" << getAssetTypeName(record.type) << "] " << record.path << '\n';
+        }
+
+        report << "Totals per asset type:\n";
+        for (uint32_t i = 0; i < typeCount; i++) {
+            if (loads[i] == 0 && hits[i] == 0) continue;
+
+            report << "  " << std::setw(8) << std::left << getAssetTypeName(static_cast<AssetType>(i)) << std::right
+                << " loads " << loads[i] << ", cache hits " << hits[i]
+                << ", read " << totals[i].readTime << " ms, parse " << totals[i].parseTime
+                << " ms, upload " << totals[i].uploadTime << " ms, "
+                << totals[i].bytesRead << " bytes read, " << totals[i].bytesUploaded << " bytes uploaded\n";
+        }
+
+        return report.str();
+    }
+
+    const char* LoadTelemetry::getAssetTypeName(AssetType type) {
+        switch (type) {
+        case AssetType::Mesh: return "mesh";
+        case AssetType::Texture: return "texture";
+        case AssetType::CubeMap: return "cubemap";
+        case AssetType::Shader: return "shader";
+        case AssetType::Skeleton: return "skeleton";
+        default: return "unknown";
+        }
+    }
+}
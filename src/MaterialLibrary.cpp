@@ -0,0 +1,264 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include <vulpes/MaterialLibrary.hpp>
+#include <vulpes/Scene.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    const uint32_t MaterialLibrary::recordsPerPage;
+
+    namespace {
+        // Where a source texture ended up, layer is -1 for constants
+        struct PackedMap {
+            int32_t array = -1;
+            int32_t layer = -1;
+            glm::vec4 texel;
+            bool readable = true;
+        };
+
+        // Same values as the renderer's default 1x1 maps
+        const glm::vec4 defaultFactors[4] = {
+            glm::vec4(1.f, 1.f, 1.f, 1.f),
+            glm::vec4(.5f, .5f, 1.f, 1.f),
+            glm::vec4(.5f, 0.f, 0.f, 1.f),
+            glm::vec4(0.f, 0.f, 0.f, 1.f)
+        };
+
+        uint32_t levelSize(uint32_t size, uint32_t level) {
+            return std::max(1u, size >> level);
+        }
+    }
+
+    MaterialLibrary::MaterialLibrary() : m_buffer(0), m_pageStride(0), m_materialCount(0),
+        m_packedMapCount(0), m_constantMapCount(0), m_built(false) {
+    }
+
+    MaterialLibrary::~MaterialLibrary() {
+        release();
+    }
+
+    bool MaterialLibrary::build(Scene& scene) {
+        release();
+
+        GLint maxLayers = 256;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+        // Every distinct texture is inspected once, those of equal size, format and
+        // mipmap count go into the same array until it is full
+        const uint32_t materialCount = scene.getMaterialCount();
+        std::unordered_map<uint32_t, PackedMap> packedMaps;
+        std::map<std::tuple<uint32_t, uint32_t, GLint, uint32_t>, uint32_t> openArrays;
+        for (uint32_t materialID = 0; materialID < materialCount; materialID++) {
+            const Material& material = scene.getMaterial(materialID);
+            const Texture* maps[4] = { &material.colorMap, &material.normalMap, &material.roughnessMap, &material.metalMap };
+            for (const Texture* map : maps) {
+                const uint32_t texture = map->textureHandle;
+                if (texture == 0 || packedMaps.count(texture) != 0) continue;
+
+                PackedMap& packed = packedMaps[texture];
+                GLint width = 0, height = 0, internalFormat = 0, compressed = GL_FALSE;
+                if (glIsTexture(texture)) {
+                    glBindTexture(GL_TEXTURE_2D, texture);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+                }
+
+                if (width == 0 || height == 0) {
+                    Logger::log("vul::MaterialLibrary::build: Texture %u has no image, the default is used instead", texture);
+                    packed.readable = false;
+                    continue;
+                }
+
+                // Constant colors, as made by ResourceLoader::loadTextureFromColor
+                if (width == 1 && height == 1) {
+                    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &packed.texel[0]);
+                    continue;
+                }
+
+                uint32_t levelCount = 1;
+                for (GLint levelWidth = 0; levelCount < 32; levelCount++) {
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, levelCount, GL_TEXTURE_WIDTH, &levelWidth);
+                    if (levelWidth == 0) break;
+                }
+
+                auto key = std::make_tuple(static_cast<uint32_t>(width), static_cast<uint32_t>(height), internalFormat, levelCount);
+                auto open = openArrays.find(key);
+                if (open == openArrays.end() || m_arrays[open->second].textures.size() >= static_cast<size_t>(maxLayers)) {
+                    Array array;
+                    array.width = width;
+                    array.height = height;
+                    array.internalFormat = internalFormat;
+                    array.levelCount = levelCount;
+                    array.compressed = compressed != GL_FALSE;
+                    m_arrays.push_back(array);
+
+                    // A full array is replaced by the new one for later textures
+                    openArrays[key] = static_cast<uint32_t>(m_arrays.size() - 1);
+                    open = openArrays.find(key);
+                }
+
+                packed.array = static_cast<int32_t>(open->second);
+                packed.layer = static_cast<int32_t>(m_arrays[open->second].textures.size());
+                m_arrays[open->second].textures.push_back(texture);
+            }
+        }
+
+        // Layers are copied level by level, compressed data as it is
+        std::vector<uint8_t> data;
+        for (auto& array : m_arrays) {
+            const GLsizei layerCount = static_cast<GLsizei>(array.textures.size());
+            glGenTextures(1, &array.handle);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.handle);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, array.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levelCount - 1);
+            glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, 8.f);
+
+            for (uint32_t level = 0; level < array.levelCount; level++) {
+                const GLsizei width = levelSize(array.width, level);
+                const GLsizei height = levelSize(array.height, level);
+
+                GLint imageSize = width * height * 4 * sizeof(float);
+                if (array.compressed) {
+                    glBindTexture(GL_TEXTURE_2D, array.textures[0]);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &imageSize);
+                    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, array.internalFormat, width, height, layerCount, 0,
+                        imageSize * layerCount, nullptr);
+                }
+                else {
+                    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, array.internalFormat, width, height, layerCount, 0,
+                        GL_RGBA, GL_FLOAT, nullptr);
+                }
+
+                data.resize(imageSize);
+                for (GLsizei layer = 0; layer < layerCount; layer++) {
+                    glBindTexture(GL_TEXTURE_2D, array.textures[layer]);
+                    if (array.compressed) {
+                        glGetCompressedTexImage(GL_TEXTURE_2D, level, data.data());
+                        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1,
+                            array.internalFormat, imageSize, data.data());
+                    }
+                    else {
+                        glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_FLOAT, data.data());
+                        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_FLOAT, data.data());
+                    }
+                }
+            }
+            m_packedMapCount += layerCount;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        // Records, with missing and unreadable maps falling back to the default factors
+        std::vector<Record> records(materialCount);
+        m_materialArrays.resize(materialCount);
+        for (uint32_t materialID = 0; materialID < materialCount; materialID++) {
+            const Material& material = scene.getMaterial(materialID);
+            const Texture* maps[4] = { &material.colorMap, &material.normalMap, &material.roughnessMap, &material.metalMap };
+
+            glm::vec4 factors[4];
+            for (uint32_t map = 0; map < 4; map++) {
+                factors[map] = defaultFactors[map];
+                records[materialID].layers[map] = -1;
+                m_materialArrays[materialID][map] = 0;
+                if (maps[map]->textureHandle == 0) continue;
+
+                const PackedMap& packed = packedMaps[maps[map]->textureHandle];
+                if (packed.array >= 0) {
+                    records[materialID].layers[map] = packed.layer;
+                    m_materialArrays[materialID][map] = m_arrays[packed.array].handle;
+                    continue;
+                }
+
+                if (packed.readable) factors[map] = packed.texel;
+                m_constantMapCount++;
+            }
+
+            records[materialID].colorFactor = factors[0];
+            records[materialID].normalFactor = factors[1];
+            records[materialID].surfaceFactor = glm::vec4(factors[2].x, factors[3].x, 0.f, 0.f);
+        }
+
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        const uint32_t pageSize = recordsPerPage * sizeof(Record);
+        m_pageStride = (pageSize + alignment - 1) / alignment * alignment;
+
+        const uint32_t pageCount = (materialCount + recordsPerPage - 1) / recordsPerPage;
+        std::vector<uint8_t> pages(pageCount * m_pageStride);
+        for (uint32_t page = 0; page < pageCount; page++) {
+            const uint32_t first = page * recordsPerPage;
+            const uint32_t count = std::min(recordsPerPage, materialCount - first);
+            std::copy(reinterpret_cast<const uint8_t*>(&records[first]), reinterpret_cast<const uint8_t*>(&records[first] + count),
+                pages.begin() + page * m_pageStride);
+        }
+
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, pages.size(), pages.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        m_materialCount = materialCount;
+        m_built = true;
+        return true;
+    }
+
+    void MaterialLibrary::release() {
+        for (auto& array : m_arrays) glDeleteTextures(1, &array.handle);
+        if (m_buffer != 0) glDeleteBuffers(1, &m_buffer);
+
+        m_arrays.clear();
+        m_materialArrays.clear();
+        m_buffer = 0;
+        m_materialCount = 0;
+        m_packedMapCount = 0;
+        m_constantMapCount = 0;
+        m_built = false;
+    }
+
+    bool MaterialLibrary::isBuilt() {
+        return m_built;
+    }
+
+    bool MaterialLibrary::contains(uint32_t materialID) {
+        return materialID < m_materialCount;
+    }
+
+    uint32_t MaterialLibrary::getArray(uint32_t materialID, MaterialMap map) {
+        return m_materialArrays[materialID][static_cast<uint32_t>(map)];
+    }
+
+    uint32_t MaterialLibrary::getPage(uint32_t materialID) {
+        return materialID / recordsPerPage;
+    }
+
+    uint32_t MaterialLibrary::getRecordIndex(uint32_t materialID) {
+        return materialID % recordsPerPage;
+    }
+
+    void MaterialLibrary::bindPage(uint32_t page, uint32_t blockBinding) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, blockBinding, m_buffer, page * m_pageStride, recordsPerPage * sizeof(Record));
+    }
+
+    uint32_t MaterialLibrary::getArrayCount() {
+        return static_cast<uint32_t>(m_arrays.size());
+    }
+
+    uint32_t MaterialLibrary::getPackedMapCount() {
+        return m_packedMapCount;
+    }
+
+    uint32_t MaterialLibrary::getConstantMapCount() {
+        return m_constantMapCount;
+    }
+}
@@ -0,0 +1,447 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <vulpes/OcclusionCuller.hpp>
+#include <vulpes/Scene.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VUL_OCCLUSION_SSE
+#include <emmintrin.h>
+#endif // SSE2
+
+namespace vul {
+    namespace {
+        const uint32_t tileSize = 8;
+        const uint32_t minOccluderChunk = 4;
+        const uint32_t minTestChunk = 1024;
+
+        // Occluders are never hidden by their own depth, even where a face lies on the bounds
+        const float depthBias = 1e-3f;
+
+        double elapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+#ifdef VUL_OCCLUSION_SSE
+        float horizontalMin(__m128 v) {
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(_mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+
+        float horizontalMax(__m128 v) {
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(_mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+#endif // VUL_OCCLUSION_SSE
+    }
+
+    OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height) : m_threadPool(nullptr),
+        m_occluderCount(0), m_triangleCount(0), m_testedCount(0), m_occludedCount(0),
+        m_rasterTime(0.0), m_testTime(0.0) {
+        m_tilesX = std::max(1u, (width + tileSize - 1) / tileSize);
+        m_tilesY = std::max(1u, (height + tileSize - 1) / tileSize);
+        m_width = m_tilesX * tileSize;
+        m_height = m_tilesY * tileSize;
+
+        m_depth.resize(m_width * m_height);
+        m_tileFarthest.resize(m_tilesX * m_tilesY);
+        m_tileNearest.resize(m_tilesX * m_tilesY);
+        clear();
+    }
+
+    OcclusionCuller::~OcclusionCuller() {
+    }
+
+    void OcclusionCuller::setThreadPool(ThreadPool& threadPool) {
+        m_threadPool = &threadPool;
+    }
+
+    uint32_t OcclusionCuller::cull(Scene& scene, const glm::mat4& viewProjection, uint8_t* results) {
+        auto start = std::chrono::steady_clock::now();
+        clear();
+        rasterizeOccluders(scene, viewProjection, results);
+        m_rasterTime = elapsedMilliseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        const uint32_t count = scene.getSceneObjectCount(SceneObjectType::Renderable);
+        const glm::vec4* spheres = scene.getRenderableWorldSpheres();
+        const glm::vec4* extents = scene.getRenderableWorldExtents();
+
+        // Two counters per thread: tested, occluded
+        uint32_t threadCount = m_threadPool ? m_threadPool->getThreadCount() : 1;
+        m_threadCounts.assign(threadCount * 2, 0);
+
+        auto test = [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            uint32_t tested = 0, occluded = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                if (!results[i] || spheres[i].w >= Scene::unboundedRadius) continue;
+
+                tested++;
+                if (isOccluded(glm::vec3(spheres[i]), glm::vec3(extents[i]), viewProjection)) {
+                    results[i] = 0;
+                    occluded++;
+                }
+            }
+            m_threadCounts[threadIndex * 2] += tested;
+            m_threadCounts[threadIndex * 2 + 1] += occluded;
+        };
+
+        if (m_threadPool) m_threadPool->parallelFor(count, minTestChunk, test);
+        else test(0, count, 0);
+
+        m_testedCount = m_occludedCount = 0;
+        for (uint32_t i = 0; i < threadCount; i++) {
+            m_testedCount += m_threadCounts[i * 2];
+            m_occludedCount += m_threadCounts[i * 2 + 1];
+        }
+
+        m_testTime = elapsedMilliseconds(start);
+        return m_occludedCount;
+    }
+
+    void OcclusionCuller::clear() {
+        std::fill(m_depth.begin(), m_depth.end(), 0.f);
+        std::fill(m_tileFarthest.begin(), m_tileFarthest.end(), 0.f);
+        std::fill(m_tileNearest.begin(), m_tileNearest.end(), 0.f);
+    }
+
+    void OcclusionCuller::rasterizeOccluders(Scene& scene, const glm::mat4& viewProjection, const uint8_t* results) {
+        const uint32_t count = scene.getSceneObjectCount(SceneObjectType::Renderable);
+        const uint16_t* flags = scene.getRenderableFlags();
+        const uint32_t* meshIDs = scene.getRenderableMeshIDs();
+        const glm::mat4x3* worldMatrices = scene.getRenderableWorldMatrices();
+        const uint16_t occluderMask = static_cast<uint16_t>(RenderableObjectFlags::Visible)
+            | static_cast<uint16_t>(RenderableObjectFlags::MeshAttached)
+            | static_cast<uint16_t>(RenderableObjectFlags::Occluder);
+
+        m_occluderIndices.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            if (results[i] && (flags[i] & occluderMask) == occluderMask && !scene.getMesh(meshIDs[i]).occluderIndices.empty())
+                m_occluderIndices.push_back(i);
+        }
+        m_occluderCount = static_cast<uint32_t>(m_occluderIndices.size());
+
+        uint32_t threadCount = m_threadPool ? m_threadPool->getThreadCount() : 1;
+        m_triangles.resize(threadCount);
+        m_clipVertices.resize(threadCount);
+        for (auto& triangles : m_triangles) triangles.clear();
+
+        // Transform and clip in parallel over occluders, each thread keeps its own triangles
+        auto setup = [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            std::vector<glm::vec4>& clipVertices = m_clipVertices[threadIndex];
+            for (uint32_t i = begin; i < end; i++) {
+                uint32_t index = m_occluderIndices[i];
+                const Mesh& mesh = scene.getMesh(meshIDs[index]);
+                glm::mat4 transform = viewProjection * glm::mat4(worldMatrices[index]);
+
+                clipVertices.resize(mesh.occluderVertices.size());
+                for (size_t v = 0; v < mesh.occluderVertices.size(); v++)
+                    clipVertices[v] = transform * glm::vec4(mesh.occluderVertices[v], 1.f);
+
+                for (size_t t = 0; t + 2 < mesh.occluderIndices.size(); t += 3) {
+                    glm::vec4 triangle[3] = { clipVertices[mesh.occluderIndices[t]],
+                        clipVertices[mesh.occluderIndices[t + 1]], clipVertices[mesh.occluderIndices[t + 2]] };
+                    setupTriangle(triangle, m_triangles[threadIndex]);
+                }
+            }
+        };
+
+        // Each band of tile rows is written by one thread only, so no locking is needed
+        auto rasterize = [&](uint32_t begin, uint32_t end, uint32_t) {
+            for (uint32_t tileRow = begin; tileRow < end; tileRow++) rasterizeBand(tileRow);
+        };
+
+        if (m_threadPool) {
+            m_threadPool->parallelFor(m_occluderCount, minOccluderChunk, setup);
+            m_threadPool->parallelFor(m_tilesY, 1, rasterize);
+        }
+        else {
+            setup(0, m_occluderCount, 0);
+            rasterize(0, m_tilesY, 0);
+        }
+
+        m_triangleCount = 0;
+        for (auto& triangles : m_triangles) m_triangleCount += static_cast<uint32_t>(triangles.size());
+    }
+
+    bool OcclusionCuller::isOccluded(const glm::vec3& center, const glm::vec3& extents, const glm::mat4& viewProjection) const {
+        // Corners are the projected center plus or minus each projected half axis
+        float minX, minY, maxX, maxY, nearest;
+#ifdef VUL_OCCLUSION_SSE
+        // Clip space x, y, z, w of corners 0-3 in low[], of corners 4-7 in high[]
+        const float* m = &viewProjection[0][0];
+        const __m128 signX = _mm_setr_ps(-1.f, 1.f, -1.f, 1.f), signY = _mm_setr_ps(-1.f, -1.f, 1.f, 1.f);
+        __m128 low[4], high[4];
+        for (int k = 0; k < 4; k++) {
+            float projected = m[k] * center.x + m[4 + k] * center.y + m[8 + k] * center.z + m[12 + k];
+            __m128 partial = _mm_add_ps(_mm_set1_ps(projected), _mm_add_ps(_mm_mul_ps(signX, _mm_set1_ps(m[k] * extents.x)),
+                _mm_mul_ps(signY, _mm_set1_ps(m[4 + k] * extents.y))));
+            __m128 axisZ = _mm_set1_ps(m[8 + k] * extents.z);
+            low[k] = _mm_sub_ps(partial, axisZ);
+            high[k] = _mm_add_ps(partial, axisZ);
+        }
+
+        // Bounds reaching through the near plane cover the camera, treat them as visible
+        const __m128 zero = _mm_setzero_ps();
+        __m128 behind = _mm_or_ps(_mm_cmplt_ps(_mm_add_ps(low[2], low[3]), zero), _mm_cmplt_ps(_mm_add_ps(high[2], high[3]), zero));
+        behind = _mm_or_ps(behind, _mm_or_ps(_mm_cmple_ps(low[3], zero), _mm_cmple_ps(high[3], zero)));
+        if (_mm_movemask_ps(behind)) return false;
+
+        __m128 invWLow = _mm_div_ps(_mm_set1_ps(1.f), low[3]), invWHigh = _mm_div_ps(_mm_set1_ps(1.f), high[3]);
+        __m128 xLow = _mm_mul_ps(low[0], invWLow), xHigh = _mm_mul_ps(high[0], invWHigh);
+        __m128 yLow = _mm_mul_ps(low[1], invWLow), yHigh = _mm_mul_ps(high[1], invWHigh);
+
+        // Viewport mapping is increasing, so the NDC extremes map to the screen extremes
+        minX = (horizontalMin(_mm_min_ps(xLow, xHigh)) * .5f + .5f) * m_width;
+        maxX = (horizontalMax(_mm_max_ps(xLow, xHigh)) * .5f + .5f) * m_width;
+        minY = (horizontalMin(_mm_min_ps(yLow, yHigh)) * .5f + .5f) * m_height;
+        maxY = (horizontalMax(_mm_max_ps(yLow, yHigh)) * .5f + .5f) * m_height;
+        nearest = horizontalMax(_mm_max_ps(invWLow, invWHigh));
+#else
+        glm::vec4 clipCenter = viewProjection * glm::vec4(center, 1.f);
+        glm::vec4 axes[3] = { viewProjection[0] * extents.x, viewProjection[1] * extents.y, viewProjection[2] * extents.z };
+
+        minX = minY = 1e30f;
+        maxX = maxY = -1e30f;
+        nearest = 0.f;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec4 clip = clipCenter + ((corner & 1) ? axes[0] : -axes[0])
+                + ((corner & 2) ? axes[1] : -axes[1]) + ((corner & 4) ? axes[2] : -axes[2]);
+
+            // Bounds reaching through the near plane cover the camera, treat them as visible
+            if (clip.z + clip.w < 0.f || clip.w <= 0.f) return false;
+
+            float invW = 1.f / clip.w;
+            float x = (clip.x * invW * .5f + .5f) * m_width;
+            float y = (clip.y * invW * .5f + .5f) * m_height;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            nearest = std::max(nearest, invW);
+        }
+#endif // VUL_OCCLUSION_SSE
+
+        // Every pixel the projected box touches, not just those whose centers it covers
+        minX = std::max(minX, 0.f);
+        minY = std::max(minY, 0.f);
+        maxX = std::min(maxX, static_cast<float>(m_width));
+        maxY = std::min(maxY, static_cast<float>(m_height));
+        if (minX >= maxX || minY >= maxY) return false; // Off screen, left to the frustum test
+
+        uint32_t x0 = static_cast<uint32_t>(minX), x1 = static_cast<uint32_t>(std::ceil(maxX));
+        uint32_t y0 = static_cast<uint32_t>(minY), y1 = static_cast<uint32_t>(std::ceil(maxY));
+        float threshold = nearest * (1.f + depthBias);
+
+        for (uint32_t ty = y0 / tileSize; ty <= (y1 - 1) / tileSize; ty++) {
+            for (uint32_t tx = x0 / tileSize; tx <= (x1 - 1) / tileSize; tx++) {
+                uint32_t tile = ty * m_tilesX + tx;
+                if (m_tileFarthest[tile] > threshold) continue; // Whole tile is in front
+                if (m_tileNearest[tile] <= threshold) return false; // Nothing in the tile is in front
+
+                uint32_t pxBegin = std::max(x0, tx * tileSize), pxEnd = std::min(x1, (tx + 1) * tileSize);
+                uint32_t pyBegin = std::max(y0, ty * tileSize), pyEnd = std::min(y1, (ty + 1) * tileSize);
+                for (uint32_t py = pyBegin; py < pyEnd; py++) {
+                    const float* row = &m_depth[py * m_width];
+                    for (uint32_t px = pxBegin; px < pxEnd; px++) {
+                        if (row[px] <= threshold) return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    uint32_t OcclusionCuller::getWidth() const {
+        return m_width;
+    }
+
+    uint32_t OcclusionCuller::getHeight() const {
+        return m_height;
+    }
+
+    const float* OcclusionCuller::getDepthBuffer() const {
+        return m_depth.data();
+    }
+
+    uint32_t OcclusionCuller::getOccluderCount() {
+        return m_occluderCount;
+    }
+
+    uint32_t OcclusionCuller::getTriangleCount() {
+        return m_triangleCount;
+    }
+
+    uint32_t OcclusionCuller::getTestedCount() {
+        return m_testedCount;
+    }
+
+    uint32_t OcclusionCuller::getOccludedCount() {
+        return m_occludedCount;
+    }
+
+    float OcclusionCuller::getOcclusionRate() {
+        return m_testedCount > 0 ? static_cast<float>(m_occludedCount) / m_testedCount : 0.f;
+    }
+
+    double OcclusionCuller::getRasterTime() {
+        return m_rasterTime;
+    }
+
+    double OcclusionCuller::getTestTime() {
+        return m_testTime;
+    }
+
+    const char* OcclusionCuller::getInstructionSet() {
+#ifdef VUL_OCCLUSION_SSE
+        return "SSE2";
+#else
+        return "scalar";
+#endif // VUL_OCCLUSION_SSE
+    }
+
+    void OcclusionCuller::setupTriangle(const glm::vec4* clip, std::vector<Triangle>& triangles) const {
+        // Clip against the near plane (z >= -w), which leaves at most a quad
+        glm::vec4 polygon[4];
+        int vertexCount = 0;
+        for (int i = 0; i < 3; i++) {
+            const glm::vec4& a = clip[i];
+            const glm::vec4& b = clip[(i + 1) % 3];
+            float da = a.z + a.w, db = b.z + b.w;
+
+            if (da >= 0.f) polygon[vertexCount++] = a;
+            if ((da >= 0.f) != (db >= 0.f)) polygon[vertexCount++] = a + (b - a) * (da / (da - db));
+        }
+        if (vertexCount < 3) return;
+
+        float x[4], y[4], depth[4];
+        for (int i = 0; i < vertexCount; i++) {
+            float invW = 1.f / polygon[i].w;
+            x[i] = (polygon[i].x * invW * .5f + .5f) * m_width;
+            y[i] = (polygon[i].y * invW * .5f + .5f) * m_height;
+            depth[i] = invW;
+        }
+
+        for (int i = 1; i + 1 < vertexCount; i++) {
+            int v[3] = { 0, i, i + 1 };
+
+            float minX = std::min(x[v[0]], std::min(x[v[1]], x[v[2]])), maxX = std::max(x[v[0]], std::max(x[v[1]], x[v[2]]));
+            float minY = std::min(y[v[0]], std::min(y[v[1]], y[v[2]])), maxY = std::max(y[v[0]], std::max(y[v[1]], y[v[2]]));
+            if (maxX < 0.f || maxY < 0.f || minX > m_width || minY > m_height) continue;
+
+            Triangle triangle;
+            for (int k = 0; k < 3; k++) {
+                triangle.x[k] = x[v[k]];
+                triangle.y[k] = y[v[k]];
+                triangle.depth[k] = depth[v[k]];
+            }
+            triangles.push_back(triangle);
+        }
+    }
+
+    void OcclusionCuller::rasterizeBand(uint32_t tileRow) {
+        const int bandBegin = tileRow * tileSize, bandEnd = bandBegin + tileSize;
+
+        for (auto& triangles : m_triangles) {
+            for (const Triangle& triangle : triangles) {
+                float x0 = triangle.x[0], y0 = triangle.y[0], z0 = triangle.depth[0];
+                float x1 = triangle.x[1], y1 = triangle.y[1], z1 = triangle.depth[1];
+                float x2 = triangle.x[2], y2 = triangle.y[2], z2 = triangle.depth[2];
+
+                // Pixels whose centers may fall inside, limited to this band
+                float minY = std::min(y0, std::min(y1, y2)), maxY = std::max(y0, std::max(y1, y2));
+                int rowBegin = std::max(bandBegin, static_cast<int>(std::max(std::floor(minY), -1.f)));
+                int rowEnd = std::min(bandEnd, static_cast<int>(std::min(std::ceil(maxY), static_cast<float>(m_height))));
+                if (rowBegin >= rowEnd) continue;
+
+                float minX = std::min(x0, std::min(x1, x2)), maxX = std::max(x0, std::max(x1, x2));
+                int columnBegin = std::max(0, static_cast<int>(std::max(std::floor(minX), -1.f)));
+                int columnEnd = std::min(static_cast<int>(m_width), static_cast<int>(std::min(std::ceil(maxX), static_cast<float>(m_width))));
+                if (columnBegin >= columnEnd) continue;
+
+                // Wind counter-clockwise so all edge functions are positive inside
+                float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+                if (std::abs(area) < 1e-6f) continue;
+                if (area < 0.f) {
+                    std::swap(x1, x2);
+                    std::swap(y1, y2);
+                    std::swap(z1, z2);
+                    area = -area;
+                }
+
+                // Edge i is opposite vertex i: e = a * x + b * y + c
+                float edgeA[3] = { y1 - y2, y2 - y0, y0 - y1 };
+                float edgeB[3] = { x2 - x1, x0 - x2, x1 - x0 };
+                float edgeC[3] = { -(edgeA[0] * x1 + edgeB[0] * y1), -(edgeA[1] * x2 + edgeB[1] * y2),
+                    -(edgeA[2] * x0 + edgeB[2] * y0) };
+
+                // 1/w is linear in screen space
+                float depthX = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+                float depthY = ((x1 - x0) * (z2 - z0) - (x2 - x0) * (z1 - z0)) / area;
+                float depthC = z0 - depthX * x0 - depthY * y0;
+
+#ifdef VUL_OCCLUSION_SSE
+                // Rows are a multiple of 4 wide, so whole aligned groups stay in bounds
+                columnBegin &= ~3;
+                const __m128 laneOffsets = _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f);
+                const __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+                const __m128 slopeX = _mm_set1_ps(depthX);
+
+                for (int py = rowBegin; py < rowEnd; py++) {
+                    float centerY = py + .5f;
+                    __m128 row0 = _mm_set1_ps(edgeB[0] * centerY + edgeC[0]);
+                    __m128 row1 = _mm_set1_ps(edgeB[1] * centerY + edgeC[1]);
+                    __m128 row2 = _mm_set1_ps(edgeB[2] * centerY + edgeC[2]);
+                    __m128 rowDepth = _mm_set1_ps(depthY * centerY + depthC);
+                    float* row = &m_depth[py * m_width];
+
+                    for (int px = columnBegin; px < columnEnd; px += 4) {
+                        __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), laneOffsets);
+                        __m128 inside = _mm_and_ps(_mm_and_ps(
+                            _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, centerX), row0), _mm_setzero_ps()),
+                            _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, centerX), row1), _mm_setzero_ps())),
+                            _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, centerX), row2), _mm_setzero_ps()));
+                        if (_mm_movemask_ps(inside) == 0) continue;
+
+                        __m128 previous = _mm_loadu_ps(row + px);
+                        __m128 depth = _mm_max_ps(previous, _mm_add_ps(_mm_mul_ps(slopeX, centerX), rowDepth));
+                        _mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, previous)));
+                    }
+                }
+#else
+                for (int py = rowBegin; py < rowEnd; py++) {
+                    float centerY = py + .5f;
+                    float* row = &m_depth[py * m_width];
+
+                    for (int px = columnBegin; px < columnEnd; px++) {
+                        float centerX = px + .5f;
+                        if (edgeA[0] * centerX + edgeB[0] * centerY + edgeC[0] < 0.f
+                            || edgeA[1] * centerX + edgeB[1] * centerY + edgeC[1] < 0.f
+                            || edgeA[2] * centerX + edgeB[2] * centerY + edgeC[2] < 0.f) continue;
+
+                        row[px] = std::max(row[px], depthX * centerX + depthY * centerY + depthC);
+                    }
+                }
+#endif // VUL_OCCLUSION_SSE
+            }
+        }
+
+        // Tile bounds let most tests finish without touching pixels
+        for (uint32_t tx = 0; tx < m_tilesX; tx++) {
+            float farthest = 1e30f, nearest = 0.f;
+            for (uint32_t py = bandBegin; py < static_cast<uint32_t>(bandEnd); py++) {
+                const float* row = &m_depth[py * m_width + tx * tileSize];
+                for (uint32_t px = 0; px < tileSize; px++) {
+                    farthest = std::min(farthest, row[px]);
+                    nearest = std::max(nearest, row[px]);
+                }
+            }
+            m_tileFarthest[tileRow * m_tilesX + tx] = farthest;
+            m_tileNearest[tileRow * m_tilesX + tx] = nearest;
+        }
+    }
+}
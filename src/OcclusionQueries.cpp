@@ -0,0 +1,211 @@
+#define VULPESENGINE_EXPORT
+
+#include <GL/glew.h>
+
+#include <vulpes/OcclusionQueries.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    namespace {
+        // Queries of objects that stopped being drawn are recycled after this many frames
+        const uint64_t queryLifetime = 64;
+    }
+
+    OcclusionQueries::OcclusionQueries() : m_boxVertexBuffer(0), m_frame(0), m_initialized(false),
+        m_queryCount(0), m_skippedDrawCount(0), m_conditionalDrawCount(0) {
+    }
+
+    OcclusionQueries::~OcclusionQueries() {
+        release();
+    }
+
+    bool OcclusionQueries::initialize(ResourceLoader& rl) {
+        if (m_initialized) return true;
+
+        m_boxShader = rl.loadShaderFromFile("data/occlusionBox.vs", "data/occlusionBox.fs");
+        if (!m_boxShader.isLoaded()) {
+            Logger::log("vul::OcclusionQueries::initialize: Unable to open occlusion box shader");
+            return false;
+        }
+
+        createBox();
+        m_initialized = true;
+        return true;
+    }
+
+    void OcclusionQueries::release() {
+        for (auto& query : m_queries) glDeleteQueries(1, &query.second.handle);
+        if (!m_freeHandles.empty()) glDeleteQueries(static_cast<GLsizei>(m_freeHandles.size()), m_freeHandles.data());
+        m_queries.clear();
+        m_freeHandles.clear();
+        m_boxTests.clear();
+
+        if (m_initialized) {
+            glDeleteVertexArrays(1, &m_boxMesh.vao);
+            glDeleteBuffers(1, &m_boxMesh.ib);
+            glDeleteBuffers(1, &m_boxVertexBuffer);
+            m_boxMesh = Mesh();
+            m_boxVertexBuffer = 0;
+        }
+        m_initialized = false;
+    }
+
+    bool OcclusionQueries::isInitialized() {
+        return m_initialized;
+    }
+
+    void OcclusionQueries::beginFrame() {
+        m_frame++;
+        m_queryCount = m_skippedDrawCount = m_conditionalDrawCount = 0;
+        m_boxTests.clear();
+
+        for (auto it = m_queries.begin(); it != m_queries.end();) {
+            Query& query = it->second;
+
+            // Availability is checked first so reading the result never waits on the GPU
+            if (query.pending) {
+                GLuint available = 0;
+                glGetQueryObjectuiv(query.handle, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available) {
+                    GLuint samplesPassed = 0;
+                    glGetQueryObjectuiv(query.handle, GL_QUERY_RESULT, &samplesPassed);
+                    query.visible = samplesPassed != 0;
+                    query.pending = false;
+                }
+            }
+
+            // Removed or long culled objects give their query back
+            if (!query.pending && m_frame - query.lastUsedFrame > queryLifetime) {
+                m_freeHandles.push_back(query.handle);
+                it = m_queries.erase(it);
+            }
+            else ++it;
+        }
+    }
+
+    QueryVisibility OcclusionQueries::getVisibility(uint32_t id) {
+        auto it = m_queries.find(id);
+        if (it == m_queries.end()) return QueryVisibility::Visible;
+
+        it->second.lastUsedFrame = m_frame;
+        if (it->second.pending) return QueryVisibility::Pending;
+        return it->second.visible ? QueryVisibility::Visible : QueryVisibility::Hidden;
+    }
+
+    void OcclusionQueries::beginQuery(uint32_t id) {
+        Query& query = getQuery(id);
+        query.pending = true;
+        m_queryCount++;
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query.handle);
+    }
+
+    void OcclusionQueries::endQuery() {
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+    }
+
+    void OcclusionQueries::beginConditionalDraw(uint32_t id) {
+        // Without a result the GPU draws anyway instead of waiting for it
+        m_conditionalDrawCount++;
+        glBeginConditionalRender(getQuery(id).handle, GL_QUERY_NO_WAIT);
+    }
+
+    void OcclusionQueries::endConditionalDraw() {
+        glEndConditionalRender();
+    }
+
+    void OcclusionQueries::skipDraw(uint32_t id, const glm::vec3& center, const glm::vec3& extents) {
+        m_skippedDrawCount++;
+        m_boxTests.push_back({ id, center, extents });
+    }
+
+    void OcclusionQueries::testBoxes(const glm::mat4& viewProjection) {
+        if (m_boxTests.empty() || !m_initialized) return;
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE); // The camera may be inside a box
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        glUseProgram(m_boxShader->programHandle);
+        glUniformMatrix4fv(static_cast<GLint>(OcclusionBoxUniformLocations::ViewProjectionMatrix), 1, GL_FALSE, &viewProjection[0][0]);
+        glBindVertexArray(m_boxMesh.vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_boxMesh.ib);
+
+        for (auto& boxTest : m_boxTests) {
+            glUniform3fv(static_cast<GLint>(OcclusionBoxUniformLocations::Center), 1, &boxTest.center[0]);
+            glUniform3fv(static_cast<GLint>(OcclusionBoxUniformLocations::Extents), 1, &boxTest.extents[0]);
+
+            beginQuery(boxTest.id);
+            glDrawElements(GL_TRIANGLES, m_boxMesh.ic, GL_UNSIGNED_INT, nullptr);
+            endQuery();
+        }
+
+        glEnable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        m_boxTests.clear();
+    }
+
+    uint32_t OcclusionQueries::getQueryCount() {
+        return m_queryCount;
+    }
+
+    uint32_t OcclusionQueries::getSkippedDrawCount() {
+        return m_skippedDrawCount;
+    }
+
+    uint32_t OcclusionQueries::getConditionalDrawCount() {
+        return m_conditionalDrawCount;
+    }
+
+    OcclusionQueries::Query& OcclusionQueries::getQuery(uint32_t id) {
+        Query& query = m_queries[id];
+        if (query.handle == 0) {
+            if (!m_freeHandles.empty()) {
+                query.handle = m_freeHandles.back();
+                m_freeHandles.pop_back();
+            }
+            else glGenQueries(1, &query.handle);
+        }
+
+        query.lastUsedFrame = m_frame;
+        return query;
+    }
+
+    void OcclusionQueries::createBox() {
+        // Unit cube, scaled and moved into place by the box shader
+        float vertices[] = { -1.f, -1.f, -1.f,
+                            1.f, -1.f, -1.f,
+                            -1.f, 1.f, -1.f,
+                            1.f, 1.f, -1.f,
+                            -1.f, -1.f, 1.f,
+                            1.f, -1.f, 1.f,
+                            -1.f, 1.f, 1.f,
+                            1.f, 1.f, 1.f };
+
+        uint32_t indices[] = { 0, 2, 3, 0, 3, 1,
+                            4, 5, 7, 4, 7, 6,
+                            0, 1, 5, 0, 5, 4,
+                            2, 6, 7, 2, 7, 3,
+                            0, 4, 6, 0, 6, 2,
+                            1, 3, 7, 1, 7, 5 };
+
+        m_boxMesh.ic = 36;
+
+        glGenVertexArrays(1, &m_boxMesh.vao);
+        glBindVertexArray(m_boxMesh.vao);
+
+        glGenBuffers(1, &m_boxVertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_boxVertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(0);
+
+        glBindVertexArray(0);
+
+        glGenBuffers(1, &m_boxMesh.ib);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_boxMesh.ib);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    }
+}
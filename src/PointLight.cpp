@@ -8,11 +8,16 @@ namespace vul {
     }
 
     PointLight::PointLight(const PointLight& other) : SceneObject(other) {
+        m_transformation = other.m_transformation;
         m_color = other.m_color;
         m_brightness = other.m_brightness;
         m_radius = other.m_radius;
     }
 
+    Transformation& PointLight::getTransformation() {
+        return m_transformation;
+    }
+
     void PointLight::setColor(const glm::vec3& color) {
         m_color = color;
     }
@@ -0,0 +1,219 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulpes/Profiler.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    namespace {
+        // Zones per thread, a power of two. At 24 bytes each this is 1.5 MB per thread
+        const uint64_t zoneCapacity = 1 << 16;
+        const uint64_t frameCapacity = 256;
+
+        // Relaxed atomics so reading while the owner writes is defined, they compile
+        // to plain stores
+        struct Zone {
+            std::atomic<const char*> name;
+            std::atomic<uint64_t> start, end;
+        };
+
+        struct ThreadBuffer {
+            std::unique_ptr<Zone[]> zones{ new Zone[zoneCapacity] };
+            std::atomic<uint64_t> written{ 0 };
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers; // Kept after their threads exit
+        };
+
+        Registry& getRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        thread_local ThreadBuffer* t_buffer = nullptr;
+
+        std::atomic<uint64_t> frames[frameCapacity];
+        std::atomic<uint64_t> framesMarked{ 0 };
+
+        uint64_t getNanoseconds() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // Both clocks read at the first zone or frame, the ratio to another reading
+        // at export time gives nanoseconds per tick over the whole session
+        struct Calibration {
+            uint64_t ticks = Profiler::now();
+            uint64_t nanoseconds = getNanoseconds();
+        };
+
+        const Calibration& getCalibration() {
+            static Calibration calibration;
+            return calibration;
+        }
+
+        double getTickPeriod() {
+#ifdef VUL_PROFILE_TSC
+            const Calibration& calibration = getCalibration();
+            const uint64_t ticks = Profiler::now() - calibration.ticks;
+            const uint64_t nanoseconds = getNanoseconds() - calibration.nanoseconds;
+            return ticks > 0 && nanoseconds > 0 ? static_cast<double>(nanoseconds) / ticks : 1.0;
+#else
+            return 1.0;
+#endif // VUL_PROFILE_TSC
+        }
+
+        ThreadBuffer* registerThread() {
+            getCalibration();
+
+            Registry& registry = getRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.buffers.emplace_back(new ThreadBuffer());
+            return registry.buffers.back().get();
+        }
+
+        struct ZoneCopy {
+            const char* name;
+            uint64_t start, end;
+        };
+
+        // Zones the owner may have overwritten during the copy are dropped
+        void copyZones(const ThreadBuffer& buffer, std::vector<ZoneCopy>& out) {
+            const uint64_t written = buffer.written.load(std::memory_order_acquire);
+            const size_t offset = out.size();
+            for (uint64_t i = written > zoneCapacity ? written - zoneCapacity : 0; i < written; i++) {
+                const Zone& zone = buffer.zones[i & (zoneCapacity - 1)];
+                out.push_back({ zone.name.load(std::memory_order_relaxed),
+                    zone.start.load(std::memory_order_relaxed), zone.end.load(std::memory_order_relaxed) });
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t after = buffer.written.load(std::memory_order_relaxed);
+            const uint64_t first = written > zoneCapacity ? written - zoneCapacity : 0;
+            const uint64_t overwritten = after > zoneCapacity ? after - zoneCapacity : 0;
+            if (overwritten > first)
+                out.erase(out.begin() + offset, out.begin() + offset + static_cast<size_t>(std::min(overwritten - first, written - first)));
+        }
+
+        std::string escape(const char* name) {
+            std::string escaped;
+            for (const char* c = name; *c; c++) {
+                if (*c == '"' || *c == '\\') escaped.push_back('\\');
+                escaped.push_back(*c);
+            }
+            return escaped;
+        }
+    }
+
+    void Profiler::recordZone(const char* name, uint64_t start, uint64_t end) {
+        ThreadBuffer* buffer = t_buffer;
+        if (!buffer) buffer = t_buffer = registerThread();
+
+        const uint64_t index = buffer->written.load(std::memory_order_relaxed);
+        Zone& zone = buffer->zones[index & (zoneCapacity - 1)];
+        zone.name.store(name, std::memory_order_relaxed);
+        zone.start.store(start, std::memory_order_relaxed);
+        zone.end.store(end, std::memory_order_relaxed);
+        buffer->written.store(index + 1, std::memory_order_release);
+    }
+
+    void Profiler::markFrame() {
+        getCalibration();
+
+        const uint64_t index = framesMarked.load(std::memory_order_relaxed);
+        frames[index % frameCapacity].store(now(), std::memory_order_relaxed);
+        framesMarked.store(index + 1, std::memory_order_release);
+    }
+
+    bool Profiler::writeChromeTrace(const std::string& path, uint32_t frameCount) {
+        if (!isEnabled()) {
+            Logger::log("vul::Profiler::writeChromeTrace: Built without VULPES_PROFILING");
+            return false;
+        }
+
+        // Window from the mark frameCount frames before the latest one, a frame is
+        // complete once the next one has been marked
+        const uint64_t marked = framesMarked.load(std::memory_order_acquire);
+        const uint64_t available = std::min(marked, frameCapacity);
+        const uint64_t span = available > 1 ? std::min<uint64_t>(std::max(1u, frameCount), available - 1) : 0;
+        uint64_t begin = 0, end = now();
+        if (span > 0) {
+            begin = frames[(marked - 1 - span) % frameCapacity].load(std::memory_order_relaxed);
+            end = frames[(marked - 1) % frameCapacity].load(std::memory_order_relaxed);
+        }
+
+        std::vector<std::vector<ZoneCopy>> threads;
+        {
+            Registry& registry = getRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (const auto& buffer : registry.buffers) {
+                threads.emplace_back();
+                copyZones(*buffer, threads.back());
+            }
+        }
+
+        uint64_t origin = begin;
+        if (span == 0) {
+            origin = end;
+            for (const auto& zones : threads)
+                for (const ZoneCopy& zone : zones) origin = std::min(origin, zone.start);
+        }
+
+        std::ofstream o(path, std::ofstream::out | std::ofstream::trunc);
+        if (!o) {
+            Logger::log("vul::Profiler::writeChromeTrace: Unable to open '%s'", path.c_str());
+            return false;
+        }
+
+        // Microseconds from the start of the window, zones straddling it start before 0
+        const double tickPeriod = getTickPeriod() / 1000.0;
+        auto timestamp = [origin, tickPeriod](uint64_t time) { return static_cast<double>(static_cast<int64_t>(time - origin)) * tickPeriod; };
+
+        o << "{\"traceEvents\": [\n" << std::fixed << std::setprecision(3);
+        for (size_t thread = 0; thread < threads.size(); thread++) {
+            o << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread
+                << ", \"args\": {\"name\": \"Thread " << thread << "\"}},\n";
+
+            for (const ZoneCopy& zone : threads[thread]) {
+                if (zone.end < begin || zone.start > end) continue;
+
+                o << "  {\"name\": \"" << escape(zone.name)
+                    << "\", \"cat\": \"cpu\", \"ph\": \"X\", \"ts\": " << timestamp(zone.start)
+                    << ", \"dur\": " << static_cast<double>(zone.end - zone.start) * tickPeriod
+                    << ", \"pid\": 1, \"tid\": " << thread << "},\n";
+            }
+        }
+
+        if (span > 0) {
+            for (uint64_t i = marked - 1 - span; i < marked; i++) {
+                o << "  {\"name\": \"Frame\", \"ph\": \"i\", \"s\": \"g\", \"ts\": "
+                    << timestamp(frames[i % frameCapacity].load(std::memory_order_relaxed)) << ", \"pid\": 1, \"tid\": 0},\n";
+            }
+        }
+
+        // Closes the trailing comma of the last event
+        o << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Vulpes\"}}\n";
+        o << "], \"displayTimeUnit\": \"ms\"}\n";
+
+        return true;
+    }
+
+    bool Profiler::isEnabled() {
+#ifdef VULPES_PROFILING
+        return true;
+#else
+        return false;
+#endif // VULPES_PROFILING
+    }
+}
@@ -0,0 +1,96 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+
+#include <vulpes/RenderQueue.hpp>
+
+namespace vul {
+    const uint32_t RenderQueue::layerBits;
+    const uint32_t RenderQueue::programBits;
+    const uint32_t RenderQueue::materialBits;
+    const uint32_t RenderQueue::meshBits;
+    const uint32_t RenderQueue::depthBits;
+
+    namespace {
+        uint64_t field(uint32_t value, uint32_t bits, uint32_t shift) {
+            return (static_cast<uint64_t>(value) & ((uint64_t(1) << bits) - 1)) << shift;
+        }
+    }
+
+    RenderQueue::RenderQueue() {
+    }
+
+    uint64_t RenderQueue::makeKey(uint32_t layer, uint32_t program, uint32_t materialID, uint32_t meshID, float depth) {
+        const uint32_t depthShift = 0;
+        const uint32_t meshShift = depthShift + depthBits;
+        const uint32_t materialShift = meshShift + meshBits;
+        const uint32_t programShift = materialShift + materialBits;
+        const uint32_t layerShift = programShift + programBits;
+
+        const uint32_t maxDepth = (1u << depthBits) - 1;
+        uint32_t depthBucket = static_cast<uint32_t>(std::min(std::max(depth, 0.f), 1.f) * maxDepth);
+
+        return field(layer, layerBits, layerShift) | field(program, programBits, programShift)
+            | field(materialID, materialBits, materialShift) | field(meshID, meshBits, meshShift)
+            | field(depthBucket, depthBits, depthShift);
+    }
+
+    uint64_t RenderQueue::setLayer(uint64_t key, uint32_t layer) {
+        const uint32_t layerShift = 64 - layerBits;
+        return (key & ~field(~0u, layerBits, layerShift)) | field(layer, layerBits, layerShift);
+    }
+
+    void RenderQueue::clear() {
+        m_entries.clear();
+    }
+
+    void RenderQueue::reserve(uint32_t count) {
+        m_entries.reserve(count);
+        m_scratch.reserve(count);
+    }
+
+    void RenderQueue::push(uint64_t key, uint32_t value) {
+        m_entries.push_back({ key, value });
+    }
+
+    void RenderQueue::sort() {
+        const size_t count = m_entries.size();
+        if (count < 2) return;
+
+        // Histograms of all eight bytes in one pass
+        uint32_t histograms[8][256] = {};
+        for (const Entry& entry : m_entries) {
+            for (int pass = 0; pass < 8; pass++) histograms[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+        }
+
+        m_scratch.resize(count);
+        for (int pass = 0; pass < 8; pass++) {
+            // Bytes every key shares, such as unused fields, need no pass
+            uint32_t* histogram = histograms[pass];
+            if (histogram[(m_entries[0].key >> (pass * 8)) & 0xFF] == count) continue;
+
+            uint32_t offsets[256];
+            uint32_t sum = 0;
+            for (int digit = 0; digit < 256; digit++) {
+                offsets[digit] = sum;
+                sum += histogram[digit];
+            }
+
+            for (const Entry& entry : m_entries)
+                m_scratch[offsets[(entry.key >> (pass * 8)) & 0xFF]++] = entry;
+            m_entries.swap(m_scratch);
+        }
+    }
+
+    uint32_t RenderQueue::getSize() const {
+        return static_cast<uint32_t>(m_entries.size());
+    }
+
+    uint64_t RenderQueue::getKey(uint32_t i) const {
+        return m_entries[i].key;
+    }
+
+    uint32_t RenderQueue::getValue(uint32_t i) const {
+        return m_entries[i].value;
+    }
+}
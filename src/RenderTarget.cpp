@@ -9,7 +9,7 @@
 
 namespace vul {
     RenderTarget::RenderTarget(uint32_t width, uint32_t height, uint32_t numTargets)
-        : m_width(width), m_height(height), m_numTargets(numTargets), m_loaded(false) {
+        : m_width(width), m_height(height), m_depthBuffer(0), m_numTargets(numTargets), m_loaded(false) {
         glGetIntegerv(GL_VIEWPORT, m_defaultViewport);
         m_loaded = initialize();
     }
@@ -53,6 +53,25 @@ namespace vul {
         return true;
     }
 
+    bool RenderTarget::addDepthBuffer() {
+        if (!m_loaded || m_depthBuffer != 0) return false;
+
+        glGenRenderbuffers(1, &m_depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+        glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+        return true;
+    }
+
+    bool RenderTarget::hasDepthBuffer() {
+        return m_depthBuffer != 0;
+    }
+
     bool RenderTarget::initialize() {
         // Create FBO
         glGenFramebuffers(1, &m_fbo);
@@ -95,6 +114,8 @@ namespace vul {
         for (uint32_t i = 0; i < m_numTargets; i++) {
             if (!m_texturesCached[i]) glDeleteTextures(1, &m_textures[i]->textureHandle);
         }
+        if (m_depthBuffer != 0) glDeleteRenderbuffers(1, &m_depthBuffer);
+        m_depthBuffer = 0;
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
         glDeleteFramebuffers(1, &m_fbo);
         m_loaded = false;
@@ -1,86 +1,156 @@
 #define VULPESENGINE_EXPORT
 
 #include <vulpes/RenderableObject.hpp>
+#include <vulpes/Scene.hpp>
 
 namespace vul {
-    RenderableObject::RenderableObject(uint32_t id)
-        : SceneObject(id, SceneObjectType::Renderable), m_flags(0) {
-        m_flags |= static_cast<uint8_t>(RenderableObjectFlags::Visible);
+    RenderableObject::RenderableObject(Scene& scene, uint32_t id)
+        : SceneObject(id, SceneObjectType::Renderable), m_scene(&scene) {
     }
 
-    RenderableObject::RenderableObject(const RenderableObject& other) : SceneObject(other) {
-        m_mesh = other.m_mesh;
-        m_colorMap = other.m_colorMap;
-        m_normalMap = other.m_normalMap;
-        m_roughnessMap = other.m_roughnessMap;
-        m_metalMap = other.m_metalMap;
-        m_flags = other.m_flags;
+    RenderableObject::RenderableObject(const RenderableObject& other)
+        : SceneObject(other), m_scene(other.m_scene) {
+    }
+
+    Transformation& RenderableObject::getTransformation() {
+        // Callers may modify the returned transformation, so the world matrix must be refreshed
+        uint32_t index = getIndex();
+        m_scene->markTransformationDirty(index);
+        return m_scene->m_transformations[index];
+    }
+
+    void RenderableObject::setTransformation(const Transformation& transformation) {
+        uint32_t index = getIndex();
+        m_scene->m_transformations[index] = transformation;
+        m_scene->m_transformations[index].markDirty();
+        m_scene->markTransformationDirty(index);
     }
 
     void RenderableObject::attachMesh(const Handle<Mesh>& mesh) {
-        m_flags |= static_cast<uint8_t>(RenderableObjectFlags::MeshAttached);
-        m_mesh = mesh.makeCopy();
+        setFlag(RenderableObjectFlags::MeshAttached, true);
+        uint32_t index = getIndex();
+        m_scene->m_meshIDs[index] = m_scene->addMesh(mesh.makeCopy());
+        m_scene->updateWorldBounds(index);
     }
 
     void RenderableObject::attachColorMap(const Handle<Texture>& tex) {
-        m_flags |= static_cast<uint8_t>(RenderableObjectFlags::ColorMapAttached);
-        m_colorMap = tex.makeCopy();
+        setFlag(RenderableObjectFlags::ColorMapAttached, true);
+        uint32_t index = getIndex();
+        Material material = m_scene->m_materials[m_scene->m_materialIDs[index]];
+        material.colorMap = tex.makeCopy();
+        m_scene->m_materialIDs[index] = m_scene->addMaterial(material);
     }
 
     void RenderableObject::attachNormalMap(const Handle<Texture>& tex) {
-        m_flags |= static_cast<uint8_t>(RenderableObjectFlags::NormalMapAttached);
-        m_normalMap = tex.makeCopy();
+        setFlag(RenderableObjectFlags::NormalMapAttached, true);
+        uint32_t index = getIndex();
+        Material material = m_scene->m_materials[m_scene->m_materialIDs[index]];
+        material.normalMap = tex.makeCopy();
+        m_scene->m_materialIDs[index] = m_scene->addMaterial(material);
     }
 
     void RenderableObject::attachRoughnessMap(const Handle<Texture>& tex) {
-        m_flags |= static_cast<uint8_t>(RenderableObjectFlags::RoughnessMapAttached);
-        m_roughnessMap = tex.makeCopy();
+        setFlag(RenderableObjectFlags::RoughnessMapAttached, true);
+        uint32_t index = getIndex();
+        Material material = m_scene->m_materials[m_scene->m_materialIDs[index]];
+        material.roughnessMap = tex.makeCopy();
+        m_scene->m_materialIDs[index] = m_scene->addMaterial(material);
     }
 
     void RenderableObject::attachMetalMap(const Handle<Texture>& tex) {
-        m_flags |= static_cast<uint8_t>(RenderableObjectFlags::MetalMapAttached);
-        m_metalMap = tex.makeCopy();
+        setFlag(RenderableObjectFlags::MetalMapAttached, true);
+        uint32_t index = getIndex();
+        Material material = m_scene->m_materials[m_scene->m_materialIDs[index]];
+        material.metalMap = tex.makeCopy();
+        m_scene->m_materialIDs[index] = m_scene->addMaterial(material);
     }
 
     void RenderableObject::attachSkeleton(const Handle<Skeleton>& skeleton) {
-        m_flags |= static_cast<uint8_t>(RenderableObjectFlags::SkeletonAttached);
-        m_skeleton = skeleton;
+        // The renderer only looks skeletons up for objects flagged as skinned
+        Handle<Skeleton> attached = skeleton;
+        setFlag(RenderableObjectFlags::SkeletonAttached, attached.isLoaded());
+        m_scene->m_skeletons.erase(m_id);
+        if (attached.isLoaded()) m_scene->m_skeletons.emplace(m_id, attached);
+        m_scene->updateWorldBounds(getIndex());
     }
 
     void RenderableObject::setVisible(bool visible) {
-        visible ? m_flags |= static_cast<uint8_t>(RenderableObjectFlags::Visible)
-            : m_flags &= ~static_cast<uint8_t>(RenderableObjectFlags::Visible);
+        setFlag(RenderableObjectFlags::Visible, visible);
+    }
+
+    void RenderableObject::setParent(uint32_t parentID) {
+        m_scene->setParent(m_id, parentID);
+    }
+
+    void RenderableObject::setOccluder(bool occluder) {
+        setFlag(RenderableObjectFlags::Occluder, occluder);
+    }
+
+    void RenderableObject::setStatic(bool isStatic) {
+        setFlag(RenderableObjectFlags::Static, isStatic);
     }
 
     Handle<Mesh> RenderableObject::getMesh() {
-        return m_flags & static_cast<uint8_t>(RenderableObjectFlags::MeshAttached) ?
-            Handle<Mesh>(m_mesh) : Handle<Mesh>();
+        return hasFlag(RenderableObjectFlags::MeshAttached) ?
+            Handle<Mesh>(m_scene->m_meshes[m_scene->m_meshIDs[getIndex()]]) : Handle<Mesh>();
     }
 
     Handle<Texture> RenderableObject::getColorMap() {
-        return m_flags & static_cast<uint8_t>(RenderableObjectFlags::ColorMapAttached) ?
-            Handle<Texture>(m_colorMap) : Handle<Texture>();
+        return hasFlag(RenderableObjectFlags::ColorMapAttached) ?
+            Handle<Texture>(m_scene->m_materials[m_scene->m_materialIDs[getIndex()]].colorMap) : Handle<Texture>();
     }
 
     Handle<Texture> RenderableObject::getNormalMap() {
-        return m_flags & static_cast<uint8_t>(RenderableObjectFlags::NormalMapAttached) ?
-            Handle<Texture>(m_normalMap) : Handle<Texture>();
+        return hasFlag(RenderableObjectFlags::NormalMapAttached) ?
+            Handle<Texture>(m_scene->m_materials[m_scene->m_materialIDs[getIndex()]].normalMap) : Handle<Texture>();
     }
 
     Handle<Texture> RenderableObject::getRoughnessMap() {
-        return m_flags & static_cast<uint8_t>(RenderableObjectFlags::RoughnessMapAttached) ?
-            Handle<Texture>(m_roughnessMap) : Handle<Texture>();
+        return hasFlag(RenderableObjectFlags::RoughnessMapAttached) ?
+            Handle<Texture>(m_scene->m_materials[m_scene->m_materialIDs[getIndex()]].roughnessMap) : Handle<Texture>();
     }
 
     Handle<Texture> RenderableObject::getMetalMap() {
-        return m_metalMap;
+        return hasFlag(RenderableObjectFlags::MetalMapAttached) ?
+            Handle<Texture>(m_scene->m_materials[m_scene->m_materialIDs[getIndex()]].metalMap) : Handle<Texture>();
     }
 
     Handle<Skeleton> RenderableObject::getSkeleton() {
-        return m_skeleton;
+        auto it = m_scene->m_skeletons.find(m_id);
+        return it != m_scene->m_skeletons.end() ? it->second : Handle<Skeleton>();
     }
-    
+
     bool RenderableObject::isVisible() {
-        return m_flags & static_cast<uint8_t>(RenderableObjectFlags::Visible);
+        return hasFlag(RenderableObjectFlags::Visible);
+    }
+
+    bool RenderableObject::isOccluder() {
+        return hasFlag(RenderableObjectFlags::Occluder);
+    }
+
+    bool RenderableObject::isStatic() {
+        return hasFlag(RenderableObjectFlags::Static);
+    }
+
+    uint32_t RenderableObject::getParent() {
+        return m_scene->getParent(m_id);
+    }
+
+    const glm::mat4x3& RenderableObject::getWorldMatrix() {
+        m_scene->updateWorldTransformations();
+        return m_scene->m_worldMatrices[getIndex()];
+    }
+
+    uint32_t RenderableObject::getIndex() const {
+        return m_scene->m_renderableIDs.getIndex(m_id);
+    }
+
+    bool RenderableObject::hasFlag(RenderableObjectFlags flag) const {
+        return (m_scene->m_renderableFlags[getIndex()] & static_cast<uint16_t>(flag)) != 0;
+    }
+
+    void RenderableObject::setFlag(RenderableObjectFlags flag, bool value) {
+        uint16_t& flags = m_scene->m_renderableFlags[getIndex()];
+        value ? flags |= static_cast<uint16_t>(flag) : flags &= ~static_cast<uint16_t>(flag);
     }
 }
@@ -3,7 +3,8 @@
 #include <vulpes/Renderer.hpp>
 
 namespace vul {
-    Renderer::Renderer() : m_scene(nullptr), m_camera(nullptr), m_polycount(0), m_error(false) {
+    Renderer::Renderer() : m_scene(nullptr), m_camera(nullptr), m_polycount(0),
+        m_culledCount(0), m_cullTime(0.0), m_drawCallCount(0), m_submitTime(0.0), m_stateChangeCount(0), m_error(false), m_gpuProfiler(nullptr) {
     }
 
     void Renderer::setScene(Scene& scene) {
@@ -14,7 +15,31 @@ namespace vul {
         m_camera = &camera;
     }
 
+    void Renderer::setGPUProfiler(GPUProfiler& gpuProfiler) {
+        m_gpuProfiler = &gpuProfiler;
+    }
+
     uint32_t Renderer::getPolygonCount() {
         return m_polycount;
     }
+
+    uint32_t Renderer::getCulledObjectCount() {
+        return m_culledCount;
+    }
+
+    double Renderer::getCullTime() {
+        return m_cullTime;
+    }
+
+    uint32_t Renderer::getDrawCallCount() {
+        return m_drawCallCount;
+    }
+
+    double Renderer::getSubmitTime() {
+        return m_submitTime;
+    }
+
+    uint32_t Renderer::getStateChangeCount() {
+        return m_stateChangeCount;
+    }
 }
@@ -33,6 +33,27 @@ namespace vul {
         return m_skeletons[path];
     }
 
+    std::string ResourceCache::getMeshPath(uint32_t vao) {
+        for (auto& mesh : m_meshes) {
+            if (mesh.second->vao == vao) return mesh.first;
+        }
+        return std::string();
+    }
+
+    std::string ResourceCache::getTexturePath(uint32_t textureHandle) {
+        for (auto& texture : m_textures) {
+            if (texture.second->textureHandle == textureHandle) return texture.first;
+        }
+        return std::string();
+    }
+
+    std::string ResourceCache::getSkeletonPath(Handle<Skeleton> skeleton) {
+        for (auto& entry : m_skeletons) {
+            if (&*entry.second == &*skeleton) return entry.first;
+        }
+        return std::string();
+    }
+
     void ResourceCache::addMesh(const std::string& path, Handle<Mesh> mesh) {
         m_meshes[path] = mesh;
     }
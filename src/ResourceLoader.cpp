@@ -1,5 +1,9 @@
 #define VULPESENGINE_EXPORT
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <fstream>
 
@@ -9,11 +13,40 @@
 #include <vulpes/ResourceLoader.hpp>
 #include <vulpes/RenderTarget.hpp>
 #include <vulpes/CustomRenderer.hpp>
+#include <vulpes/Profiler.hpp>
 
 #include "Logger.h"
 
+namespace {
+    // Measures the milliseconds between successive laps, used for load telemetry
+    class Stopwatch {
+    public:
+        Stopwatch() : m_last(std::chrono::steady_clock::now()) {}
+
+        double lap() {
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double, std::milli>(now - m_last).count();
+            m_last = now;
+            return elapsed;
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_last;
+    };
+
+    uint64_t getFileSize(const std::vector<uint8_t>& fileData) {
+        // readFile appends a terminating character to non-empty files
+        return fileData.empty() ? 0 : fileData.size() - 1;
+    }
+}
+
 namespace vul {
-    ResourceLoader::ResourceLoader() {
+    ResourceLoader::ResourceLoader(const std::string& startupManifestPath) : m_bytesUploaded(0),
+        m_manifestPath(startupManifestPath), m_recordingStartup(!startupManifestPath.empty()),
+        m_startupBegin(std::chrono::steady_clock::now()), m_startupTime(0.0) {
+        if (m_recordingStartup && m_prefetcher.loadManifest(m_manifestPath))
+            m_prefetcher.start(std::max(2u, std::thread::hardware_concurrency()));
+
         createPlane();
         createSphere();
         createQuad();
@@ -23,23 +56,76 @@ namespace vul {
     ResourceLoader::~ResourceLoader() {
     }
 
-    Handle<Mesh> ResourceLoader::loadMeshFromFile(const std::string& path) {
-        if (m_resourceCache.hasResource(path))
-            return m_resourceCache.getMesh(path);
+    void ResourceLoader::endStartup() {
+        if (!m_recordingStartup) return;
+        m_recordingStartup = false;
+
+        m_startupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startupBegin).count();
+
+        // A run without a manifest to replay is the cold baseline that later runs are compared against
+        double coldStartupTime = m_startupTime;
+        if (m_prefetcher.getManifestFileCount() > 0) {
+            coldStartupTime = m_prefetcher.getManifestColdStartupTime();
+            Logger::log("vul::ResourceLoader::endStartup: Warm startup took %.1f ms (cold %.1f ms, previous %.1f ms), prefetched %u of %u files (%llu bytes)",
+                m_startupTime, coldStartupTime, m_prefetcher.getManifestStartupTime(),
+                m_prefetcher.getPrefetchedFileCount(), m_prefetcher.getManifestFileCount(),
+                static_cast<unsigned long long>(m_prefetcher.getPrefetchedBytes()));
+        }
+        else {
+            Logger::log("vul::ResourceLoader::endStartup: Cold startup took %.1f ms, writing manifest '%s'",
+                m_startupTime, m_manifestPath.c_str());
+        }
+
+        m_prefetcher.saveManifest(m_manifestPath, m_startupTime, coldStartupTime);
+    }
+
+    double ResourceLoader::getStartupTime() {
+        return m_startupTime;
+    }
 
+    Handle<Mesh> ResourceLoader::loadMeshFromFile(const std::string& path, bool keepOccluderData) {
+        VUL_PROFILE_ZONE("ResourceLoader::loadMeshFromFile");
+
+        LoadRecord record;
+        record.path = path;
+        record.type = AssetType::Mesh;
+
+        if (m_resourceCache.hasResource(path)) {
+            record.cacheHit = true;
+            record.succeeded = true;
+            m_telemetry.addRecord(record);
+
+            Handle<Mesh> mesh = m_resourceCache.getMesh(path);
+            if (keepOccluderData && mesh->occluderIndices.empty())
+                Logger::log("vul::ResourceLoader::loadMeshFromFile: '%s' was cached without occluder data", path.c_str());
+            return mesh;
+        }
+
+        Stopwatch stopwatch;
         std::vector<uint8_t> fileData = readFile(path);
+        record.readTime = stopwatch.lap();
+        record.bytesRead = getFileSize(fileData);
         if (fileData.size() == 0) {
             Logger::log("vul::ResourceLoader::loadMeshFromFile: Returned empty '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Mesh>();
         }
 
         MeshData meshData;
-        if (!m_parserVEM.parse(&meshData, fileData.data(), fileData.size())) {
+        bool parsed = m_parserVEM.parse(&meshData, fileData.data(), fileData.size());
+        record.parseTime = stopwatch.lap();
+        if (!parsed) {
             Logger::log("vul::ResourceLoader::loadMeshFromFile: Unable to load '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Mesh>();
         }
 
-        Handle<Mesh> mesh = loadMeshFromData(meshData);
+        uint64_t bytesUploaded = m_bytesUploaded;
+        Handle<Mesh> mesh = loadMeshFromData(meshData, keepOccluderData);
+        record.uploadTime = stopwatch.lap();
+        record.bytesUploaded = m_bytesUploaded - bytesUploaded;
+        record.succeeded = mesh.isLoaded();
+        m_telemetry.addRecord(record);
 
         if (mesh.isLoaded())
             m_resourceCache.addMesh(path, mesh);
@@ -47,7 +133,9 @@ namespace vul {
         return mesh;
     }
 
-    Handle<Mesh> ResourceLoader::loadMeshFromData(const MeshData& meshData) {
+    Handle<Mesh> ResourceLoader::loadMeshFromData(const MeshData& meshData, bool keepOccluderData) {
+        VUL_PROFILE_ZONE("ResourceLoader::loadMeshFromData");
+
         if (meshData.vertices.empty()) {
             Logger::log("vul::ResourceLoader::loadMeshFromData: No data in vertices");
             return Handle<Mesh>();
@@ -62,6 +150,35 @@ namespace vul {
         mesh->ic = meshData.indices.size();
         uint32_t vbo[7];
 
+        // Bounds, the sphere is centered on the box but sized to the farthest vertex
+        glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+        for (size_t i = 0; i + 2 < meshData.vertices.size(); i += 3) {
+            glm::vec3 vertex(meshData.vertices[i], meshData.vertices[i + 1], meshData.vertices[i + 2]);
+            boundsMin = glm::min(boundsMin, vertex);
+            boundsMax = glm::max(boundsMax, vertex);
+        }
+
+        glm::vec3 center = (boundsMin + boundsMax) * .5f;
+        float radiusSquared = 0.f;
+        for (size_t i = 0; i + 2 < meshData.vertices.size(); i += 3) {
+            glm::vec3 offset = glm::vec3(meshData.vertices[i], meshData.vertices[i + 1], meshData.vertices[i + 2]) - center;
+            radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+        }
+
+        if (meshData.vertices.size() >= 3) {
+            mesh->boundsMin = boundsMin;
+            mesh->boundsMax = boundsMax;
+            mesh->boundingCenter = center;
+            mesh->boundingRadius = std::sqrt(radiusSquared);
+        }
+
+        if (keepOccluderData) {
+            mesh->occluderVertices.resize(meshData.vertices.size() / 3);
+            for (size_t i = 0; i < mesh->occluderVertices.size(); i++)
+                mesh->occluderVertices[i] = glm::vec3(meshData.vertices[i * 3], meshData.vertices[i * 3 + 1], meshData.vertices[i * 3 + 2]);
+            mesh->occluderIndices = meshData.indices;
+        }
+
         glGenVertexArrays(1, &mesh->vao);
         glBindVertexArray(mesh->vao);
 
@@ -129,25 +246,46 @@ namespace vul {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ib);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshData.indices.size() * sizeof(uint32_t), meshData.indices.data(), GL_STATIC_DRAW);
 
+        m_bytesUploaded += (meshData.vertices.size() + meshData.normals.size() + meshData.tangents.size()
+            + meshData.bitangents.size() + meshData.UVCoordinates.size() + meshData.vertexWeights.size()) * sizeof(float)
+            + meshData.vertexBones.size() * sizeof(uint8_t) + meshData.indices.size() * sizeof(uint32_t);
+
         mesh.setLoaded();
         return mesh;
     }
 
     Handle<Texture> ResourceLoader::loadTextureFromFile(const std::string& path) {
-        if (m_resourceCache.hasResource(path))
+        VUL_PROFILE_ZONE("ResourceLoader::loadTextureFromFile");
+
+        LoadRecord record;
+        record.path = path;
+        record.type = AssetType::Texture;
+
+        if (m_resourceCache.hasResource(path)) {
+            record.cacheHit = true;
+            record.succeeded = true;
+            m_telemetry.addRecord(record);
             return m_resourceCache.getTexture(path);
+        }
 
         // Read file
+        Stopwatch stopwatch;
         std::vector<uint8_t> fileData = readFile(path);
+        record.readTime = stopwatch.lap();
+        record.bytesRead = getFileSize(fileData);
         if (fileData.size() == 0) {
             Logger::log("vul::ResourceLoader::loadTextureFromFile: Returned empty '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Texture>();
         }
 
         // Parse data
         const uint8_t* buffer = reinterpret_cast<const uint8_t*>(fileData.data());
-        if (!m_imageParser.parse(buffer, fileData.size())) {
+        bool parsed = m_imageParser.parse(buffer, fileData.size());
+        record.parseTime = stopwatch.lap();
+        if (!parsed) {
             Logger::log("vul::ResourceLoader::loadTextureFromFile: Unable to load '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Texture>();
         }
 
@@ -166,26 +304,35 @@ namespace vul {
         // Upload all mipmaps
         uint32_t width = info.width;
         uint32_t height = info.height;
+        record.uploadTime = stopwatch.lap();
         for (uint32_t i = 0; i < info.numMipMaps; i++) {
             uint32_t size = m_imageParser.getSize(i);
             if (info.s3tc) {
                 uint8_t* data = new uint8_t[size];
                 m_imageParser.getIntImage(data, i);
+                record.parseTime += stopwatch.lap();
                 glCompressedTexImage2D(GL_TEXTURE_2D, i, info.internalFormat, width, height, 0, size, data);
+                record.bytesUploaded += size;
                 delete[] data;
             }
             else {
                 // Since only DDS and HDR are supported, uncompressed images are assumed to be floating point textures
                 float* data = new float[size];
                 m_imageParser.getFloatImage(data, i);
+                record.parseTime += stopwatch.lap();
                 glTexImage2D(GL_TEXTURE_2D, i, info.internalFormat, width, height, 0, info.format, info.channelType, data);
+                record.bytesUploaded += size * sizeof(float);
                 delete[] data;
             }
+            record.uploadTime += stopwatch.lap();
             width /= 2;
             height /= 2;
         }
+        m_bytesUploaded += record.bytesUploaded;
 
         texture.setLoaded();
+        record.succeeded = true;
+        m_telemetry.addRecord(record);
 
         if (texture.isLoaded())
             m_resourceCache.addTexture(path, texture);
@@ -209,6 +356,7 @@ namespace vul {
         glGenTextures(1, &texture->textureHandle);
         glBindTexture(GL_TEXTURE_2D, texture->textureHandle);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_FLOAT, data);
+        m_bytesUploaded += 3 * sizeof(float);
 
         delete[] data;
 
@@ -219,10 +367,21 @@ namespace vul {
     }
 
     Handle<Texture> ResourceLoader::loadCubeMap(const std::string& frontPath, const std::string & backPath, const std::string & topPath, const std::string & bottomPath, const std::string & leftPath, const std::string & rightPath, bool prefilter) {
+        VUL_PROFILE_ZONE("ResourceLoader::loadCubeMap");
+
         std::string resourcePath = frontPath + backPath + topPath + bottomPath + leftPath + rightPath;
-        if (m_resourceCache.hasResource(resourcePath))
+        LoadRecord record;
+        record.path = resourcePath;
+        record.type = AssetType::CubeMap;
+
+        if (m_resourceCache.hasResource(resourcePath)) {
+            record.cacheHit = true;
+            record.succeeded = true;
+            m_telemetry.addRecord(record);
             return m_resourceCache.getTexture(resourcePath);
+        }
 
+        uint64_t bytesUploaded = m_bytesUploaded;
         Handle<Texture> texture;
         glGenTextures(1, &texture->textureHandle);
         glBindTexture(GL_TEXTURE_CUBE_MAP, texture->textureHandle);
@@ -234,19 +393,26 @@ namespace vul {
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
         uint32_t width = 0;
-        bool result = loadCubeMapSide(rightPath, texture, 0, &width);
-        result &= loadCubeMapSide(leftPath, texture, 1);
-        result &= loadCubeMapSide(topPath, texture, 2);
-        result &= loadCubeMapSide(bottomPath, texture, 3);
-        result &= loadCubeMapSide(frontPath, texture, 4);
-        result &= loadCubeMapSide(backPath, texture, 5);
+        bool result = loadCubeMapSide(rightPath, texture, 0, record, &width);
+        result &= loadCubeMapSide(leftPath, texture, 1, record);
+        result &= loadCubeMapSide(topPath, texture, 2, record);
+        result &= loadCubeMapSide(bottomPath, texture, 3, record);
+        result &= loadCubeMapSide(frontPath, texture, 4, record);
+        result &= loadCubeMapSide(backPath, texture, 5, record);
 
         if (!result) {
             glDeleteTextures(1, &texture->textureHandle);
+            m_telemetry.addRecord(record);
             return texture; // Error message in loadCubeMapSide
         }
 
+        // Prefiltering is GPU work on already uploaded data, so it counts towards upload time
+        Stopwatch stopwatch;
         if (prefilter) prefilterCubeMap(texture, width);
+        record.uploadTime += stopwatch.lap();
+        record.bytesUploaded = m_bytesUploaded - bytesUploaded;
+        record.succeeded = true;
+        m_telemetry.addRecord(record);
 
         m_resourceCache.addTexture(resourcePath, texture);
 
@@ -255,20 +421,37 @@ namespace vul {
     }
 
     Handle<Texture> ResourceLoader::loadCubeMapCross(const std::string& path, bool prefilter) {
-        if (m_resourceCache.hasResource(path))
+        VUL_PROFILE_ZONE("ResourceLoader::loadCubeMapCross");
+
+        LoadRecord record;
+        record.path = path;
+        record.type = AssetType::CubeMap;
+
+        if (m_resourceCache.hasResource(path)) {
+            record.cacheHit = true;
+            record.succeeded = true;
+            m_telemetry.addRecord(record);
             return m_resourceCache.getTexture(path);
+        }
 
         // Read file
+        Stopwatch stopwatch;
         std::vector<uint8_t> fileData = readFile(path);
+        record.readTime = stopwatch.lap();
+        record.bytesRead = getFileSize(fileData);
         if (fileData.size() == 0) {
             Logger::log("vul::ResourceLoader::loadCubeMapCross: Returned empty '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Texture>();
         }
 
         // Parse data
         const uint8_t* buffer = reinterpret_cast<const uint8_t*>(fileData.data());
-        if (!m_imageParser.parse(buffer, fileData.size())) {
+        bool parsed = m_imageParser.parse(buffer, fileData.size());
+        record.parseTime = stopwatch.lap();
+        if (!parsed) {
             Logger::log("vul::ResourceLoader::loadCubeMapCross: Unable to load '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Texture>();
         }
 
@@ -278,6 +461,7 @@ namespace vul {
         // Cannot splice compressed images
         if (info.s3tc) {
             Logger::log("vul::ResourceLoader::loadCubeMapCross: Cannot splice compressed images '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Texture>();
         }
 
@@ -287,6 +471,7 @@ namespace vul {
         else if (info.width / 4 == info.height / 3) vertical = false; // Horizontal
         else {
             Logger::log("vul::ResourceLoader::loadCubeMapCross: Incorrect aspect ratio '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Texture>();
         }
 
@@ -309,7 +494,9 @@ namespace vul {
             // TODO: Only HDR/float textures supported for cubemap cross right now, update for future formats
             float* data = new float[m_imageParser.getSize(i)];
             float* sideData = new float[sideWidth * sideWidth * info.numChannels];
+            record.uploadTime += stopwatch.lap();
             m_imageParser.getFloatImage(data, i); // TODO: check rtn
+            record.parseTime += stopwatch.lap();
 
             for (uint32_t k = 0; k < 6; k++) {
                 uint32_t yStart, yEnd, xStart, xEnd;
@@ -378,6 +565,7 @@ namespace vul {
                 }
 
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + k, i, info.internalFormat, sideWidth, sideWidth, 0, info.format, info.channelType, sideData);
+                record.bytesUploaded += sideWidth * sideWidth * info.numChannels * sizeof(float);
             }
 
             delete[] sideData;
@@ -387,10 +575,14 @@ namespace vul {
             height >>= 1;
         }
         if (info.numMipMaps == 1) glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        m_bytesUploaded += record.bytesUploaded;
 
         if (prefilter) prefilterCubeMap(texture, vertical ? info.width / 3 : info.width / 4);
+        record.uploadTime += stopwatch.lap();
 
         texture.setLoaded();
+        record.succeeded = true;
+        m_telemetry.addRecord(record);
 
         if (texture.isLoaded())
             m_resourceCache.addTexture(path, texture);
@@ -399,22 +591,43 @@ namespace vul {
     }
 
     Handle<Shader> ResourceLoader::loadShaderFromFile(const std::string& vsPath, const std::string& fsPath) {
-        if (m_resourceCache.hasResource(vsPath + fsPath))
-            m_resourceCache.getShader(vsPath + fsPath);
+        VUL_PROFILE_ZONE("ResourceLoader::loadShaderFromFile");
+
+        LoadRecord record;
+        record.path = vsPath + fsPath;
+        record.type = AssetType::Shader;
 
+        if (m_resourceCache.hasResource(vsPath + fsPath)) {
+            record.cacheHit = true;
+            record.succeeded = true;
+            m_telemetry.addRecord(record);
+            return m_resourceCache.getShader(vsPath + fsPath);
+        }
+
+        Stopwatch stopwatch;
         std::vector<uint8_t> vsData = readFile(vsPath);
         if (vsData.size() == 0) {
             Logger::log("vul::ResourceLoader::loadShaderFromFile: '%s' returned empty", vsPath.c_str());
+            record.readTime = stopwatch.lap();
+            m_telemetry.addRecord(record);
             return Handle<Shader>();
         }
 
         std::vector<uint8_t> fsData = readFile(fsPath);
+        record.readTime = stopwatch.lap();
+        record.bytesRead = getFileSize(vsData) + getFileSize(fsData);
         if (fsData.size() == 0) {
             Logger::log("vul::ResourceLoader::loadShaderFromFile: '%s' returned empty", fsPath.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Shader>();
         }
 
+        // Compiling and linking is done by the driver, so it is counted as upload
         Handle<Shader> shader = loadShaderFromText(vsData.data(), fsData.data());
+        record.uploadTime = stopwatch.lap();
+        record.bytesUploaded = record.bytesRead;
+        record.succeeded = shader.isLoaded();
+        m_telemetry.addRecord(record);
 
         if (shader.isLoaded())
             m_resourceCache.addShader(vsPath + fsPath, shader);
@@ -449,22 +662,41 @@ namespace vul {
     }
 
     Handle<Skeleton> ResourceLoader::loadSkeletonFromFile(const std::string& path) {
-        if (m_resourceCache.hasResource(path))
+        VUL_PROFILE_ZONE("ResourceLoader::loadSkeletonFromFile");
+
+        LoadRecord record;
+        record.path = path;
+        record.type = AssetType::Skeleton;
+
+        if (m_resourceCache.hasResource(path)) {
+            record.cacheHit = true;
+            record.succeeded = true;
+            m_telemetry.addRecord(record);
             return m_resourceCache.getSkeleton(path);
+        }
 
+        Stopwatch stopwatch;
         std::vector<uint8_t> fileData = readFile(path);
+        record.readTime = stopwatch.lap();
+        record.bytesRead = getFileSize(fileData);
         if (fileData.size() == 0) {
             Logger::log("vul::ResourceLoader::loadSkeletonFromFile: Returned empty '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Skeleton>();
         }
 
         Handle<Skeleton> skeleton;
-        if (!m_parserVES.parse(skeleton, fileData.data(), fileData.size())) {
+        bool parsed = m_parserVES.parse(skeleton, fileData.data(), fileData.size());
+        record.parseTime = stopwatch.lap();
+        if (!parsed) {
             Logger::log("vul::ResourceLoader::loadSkeletonFromFile: Unable to load '%s'", path.c_str());
+            m_telemetry.addRecord(record);
             return Handle<Skeleton>();
         }
 
         skeleton.setLoaded();
+        record.succeeded = true;
+        m_telemetry.addRecord(record);
 
         m_resourceCache.addSkeleton(path, skeleton);
 
@@ -487,40 +719,38 @@ namespace vul {
         return Handle<ResourceCache>(m_resourceCache);
     }
 
+    Handle<LoadTelemetry> ResourceLoader::getLoadTelemetry() {
+        return Handle<LoadTelemetry>(m_telemetry);
+    }
+
     bool ResourceLoader::validateShader(uint32_t shaderHandle) {
+        // Some drivers fill the info log with warnings, only the status tells failure
+        GLint status = GL_FALSE;
+        glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &status);
+        if (status == GL_TRUE) return true;
+
         char buffer[2048];
         memset(buffer, 0, 2048);
         GLsizei len = 0;
-
         glGetShaderInfoLog(shaderHandle, 2048, &len, buffer);
-        if (len > 0) {
-            Logger::log("vul::ResourceLoader::validateShader: Failed to compile shader:\n%s", buffer);
-            return false;
-        }
-
-        return true;
+        Logger::log("vul::ResourceLoader::validateShader: Failed to compile shader:\n%s", buffer);
+        return false;
     }
 
     bool ResourceLoader::validateProgram(uint32_t programHandle) {
+        // Linking only, glValidateProgram checks the current texture bindings as well,
+        // which aren't set up until the program is used. Samplers of different types
+        // all start out on unit 0, which strict drivers reject
+        GLint status = GL_FALSE;
+        glGetProgramiv(programHandle, GL_LINK_STATUS, &status);
+        if (status == GL_TRUE) return true;
+
         char buffer[2048];
         memset(buffer, 0, 2048);
         GLsizei len = 0;
-
         glGetProgramInfoLog(programHandle, 2048, &len, buffer);
-        if (len > 0) {
-            Logger::log("vul::ResourceLoader::validateProgram: Failed to link program:\n%s", buffer);
-            return false;
-        }
-
-        glValidateProgram(programHandle);
-        GLint status;
-        glGetProgramiv(programHandle, GL_VALIDATE_STATUS, &status);
-        if (status == GL_FALSE) {
-            Logger::log("vul::ResourceLoader::validateProgram: Failed to validate program");
-            return false;
-        }
-
-        return true;
+        Logger::log("vul::ResourceLoader::validateProgram: Failed to link program:\n%s", buffer);
+        return false;
     }
 
     void ResourceLoader::createPlane() {
@@ -763,6 +993,8 @@ namespace vul {
     }
 
     std::vector<uint8_t> ResourceLoader::readFile(const std::string& path) {
+        if (m_recordingStartup) m_prefetcher.record(path);
+
         // I chose to represent this data with uint8_t as
         // most file formats are expected to be binary
         std::ifstream f(path, std::ios::binary);
@@ -798,9 +1030,12 @@ namespace vul {
         return data;
     }
 
-    bool ResourceLoader::loadCubeMapSide(const std::string& path, Handle<Texture> texture, uint32_t side, uint32_t* ptrWidth) {
+    bool ResourceLoader::loadCubeMapSide(const std::string& path, Handle<Texture> texture, uint32_t side, LoadRecord& record, uint32_t* ptrWidth) {
         // Read file
+        Stopwatch stopwatch;
         std::vector<uint8_t> fileData = readFile(path);
+        record.readTime += stopwatch.lap();
+        record.bytesRead += getFileSize(fileData);
         if (fileData.size() == 0) {
             Logger::log("vul::ResourceLoader::loadCubeMapSide: Returned empty '%s'", path.c_str());
             return false;
@@ -808,7 +1043,9 @@ namespace vul {
 
         // Parse data
         const uint8_t* buffer = reinterpret_cast<const uint8_t*>(fileData.data());
-        if (!m_imageParser.parse(buffer, fileData.size())) {
+        bool parsed = m_imageParser.parse(buffer, fileData.size());
+        record.parseTime += stopwatch.lap();
+        if (!parsed) {
             Logger::log("vul::ResourceLoader::loadCubeMapSide: Unable to load '%s'", path.c_str());
             return false;
         }
@@ -828,21 +1065,27 @@ namespace vul {
         // Upload all mipmaps
         uint32_t width = info.width;
         uint32_t height = info.height;
+        record.uploadTime += stopwatch.lap();
         for (uint32_t i = 0; i < info.numMipMaps; i++) {
             uint32_t size = m_imageParser.getSize(i);
             if (info.s3tc) {
                 uint8_t* data = new uint8_t[size];
                 m_imageParser.getIntImage(data, i);
+                record.parseTime += stopwatch.lap();
                 glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, i, info.internalFormat, width, height, 0, size, data);
+                m_bytesUploaded += size;
                 delete[] data;
             }
             else {
                 // Since only DDS and HDR are supported, uncompressed images are assumed to be floating point textures
                 float* data = new float[size];
                 m_imageParser.getFloatImage(data, i);
+                record.parseTime += stopwatch.lap();
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, i, info.internalFormat, width, height, 0, info.format, info.channelType, data);
+                m_bytesUploaded += size * sizeof(float);
                 delete[] data;
             }
+            record.uploadTime += stopwatch.lap();
             width /= 2;
             height /= 2;
         }
@@ -852,6 +1095,8 @@ namespace vul {
     }
 
     void ResourceLoader::prefilterCubeMap(Handle<Texture>& texture, uint32_t width) {
+        VUL_PROFILE_ZONE("ResourceLoader::prefilterCubeMap");
+
         // Prefilter is for fast real time IBL
         CustomRenderer cr(*this);
         auto shader = loadShaderFromFile("data/prefilter.vs", "data/prefilter.fs");
@@ -0,0 +1,148 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include <vulpes/RingBuffer.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    RingBuffer::RingBuffer() : m_buffer(0), m_mapped(nullptr), m_sectionSize(0), m_sectionCount(0),
+        m_section(0), m_used(0), m_flushed(0), m_persistent(false) {
+    }
+
+    RingBuffer::~RingBuffer() {
+        release();
+    }
+
+    bool RingBuffer::initialize(uint32_t sectionSize, uint32_t sectionCount) {
+        release();
+        if (sectionSize == 0 || sectionCount == 0) return false;
+
+        m_sectionSize = sectionSize;
+        m_sectionCount = sectionCount;
+        m_section = sectionCount - 1; // beginFrame moves to the first
+        m_used = 0;
+        m_flushed = 0;
+        m_fences.assign(sectionCount, nullptr);
+
+        const GLsizeiptr size = static_cast<GLsizeiptr>(sectionSize) * sectionCount;
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+
+        m_persistent = GLEW_ARB_buffer_storage != GL_FALSE;
+        if (m_persistent) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+            m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+            if (m_mapped == nullptr) {
+                Logger::log("vul::RingBuffer::initialize: Unable to map the buffer persistently");
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+                glDeleteBuffers(1, &m_buffer);
+                glGenBuffers(1, &m_buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+                m_persistent = false;
+            }
+        }
+
+        if (!m_persistent) {
+            glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            m_staging.resize(sectionSize);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return true;
+    }
+
+    void RingBuffer::release() {
+        for (void*& fence : m_fences) {
+            if (fence != nullptr) glDeleteSync(static_cast<GLsync>(fence));
+            fence = nullptr;
+        }
+        m_fences.clear();
+
+        if (m_buffer != 0) {
+            if (m_mapped != nullptr) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &m_buffer);
+        }
+
+        m_buffer = 0;
+        m_mapped = nullptr;
+        m_staging.clear();
+        m_sectionSize = 0;
+        m_sectionCount = 0;
+        m_persistent = false;
+    }
+
+    bool RingBuffer::isInitialized() {
+        return m_buffer != 0;
+    }
+
+    bool RingBuffer::isPersistent() {
+        return m_persistent;
+    }
+
+    void RingBuffer::reserve(uint32_t frameSize) {
+        if (frameSize <= m_sectionSize) return;
+
+        // Other sections may still be read, so they are waited on before the buffer goes
+        for (void* fence : m_fences) {
+            if (fence != nullptr) glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+
+        uint32_t sectionCount = m_sectionCount != 0 ? m_sectionCount : 3;
+        initialize(std::max(frameSize, m_sectionSize * 2), sectionCount);
+    }
+
+    void RingBuffer::beginFrame() {
+        m_section = (m_section + 1) % m_sectionCount;
+        m_used = 0;
+        m_flushed = 0;
+
+        // Usually signalled long ago, a wait here means the GPU is frames behind
+        GLsync fence = static_cast<GLsync>(m_fences[m_section]);
+        if (fence != nullptr) {
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (result == GL_TIMEOUT_EXPIRED) glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence);
+            m_fences[m_section] = nullptr;
+        }
+    }
+
+    void* RingBuffer::allocate(uint32_t size, uint32_t alignment, uint32_t& offset) {
+        uint32_t start = alignment > 1 ? (m_used + alignment - 1) / alignment * alignment : m_used;
+        if (start + size > m_sectionSize) return nullptr;
+
+        m_used = start + size;
+        offset = m_section * m_sectionSize + start;
+        return m_persistent ? m_mapped + offset : m_staging.data() + start;
+    }
+
+    void RingBuffer::flush() {
+        if (m_persistent || m_used == m_flushed) return;
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, m_section * m_sectionSize + m_flushed, m_used - m_flushed, m_staging.data() + m_flushed);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_flushed = m_used;
+    }
+
+    void RingBuffer::endFrame() {
+        flush();
+        m_fences[m_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    uint32_t RingBuffer::getHandle() {
+        return m_buffer;
+    }
+
+    uint32_t RingBuffer::getSectionSize() {
+        return m_sectionSize;
+    }
+}
@@ -1,11 +1,29 @@
 #define VULPESENGINE_EXPORT
 
 #include <algorithm>
+#include <cmath>
 
+#include <vulpes/FrustumCuller.hpp>
+#include <vulpes/Profiler.hpp>
 #include <vulpes/Scene.hpp>
 
+#include "Logger.h"
+
 namespace vul {
-    Scene::Scene() : m_nextID(0) {
+    namespace {
+        // Below this many objects the batch setup costs more than it saves
+        const uint32_t minBatchedUpdate = 64;
+        const uint32_t minUpdateChunk = 2048;
+    }
+
+    // Large enough to never be culled, small enough to stay finite in plane tests
+    const float Scene::unboundedRadius = 1e30f;
+
+    Scene::Scene() : m_hierarchyChanged(false), m_threadPool(nullptr) {
+        m_meshes.push_back(Mesh());
+        m_meshLookup[0] = 0;
+        m_materials.push_back(Material());
+        m_materialLookup[{ { 0, 0, 0, 0 } }] = 0;
     }
 
     Scene::~Scene() {
@@ -15,22 +33,23 @@ namespace vul {
         switch (type) {
         case SceneObjectType::Renderable:
         {
-            m_renderableObjects.push_back(RenderableObject(m_nextID));
-            m_sceneIDs[m_nextID] = m_renderableObjects.size() - 1;
-        } break;
+            if (createRenderables(1) == 0) return SlotMap::invalidID;
+            return m_renderableIDs.getID(m_renderableIDs.getSize() - 1);
+        }
         case SceneObjectType::PointLight:
         {
-            m_pointLights.push_back(PointLight(m_nextID));
-            m_sceneIDs[m_nextID] = m_pointLights.size() - 1;
-        } break;
-        default: return 0;
-        }
+            uint32_t id = m_pointLightIDs.create();
+            if (id == SlotMap::invalidID) return id;
 
-        return m_nextID++;
+            m_pointLights.push_back(PointLight(id));
+            return id;
+        }
+        default: return SlotMap::invalidID;
+        }
     }
 
     Handle<RenderableObject> Scene::getRenderableObject(uint32_t id) {
-        return Handle<RenderableObject>(m_renderableObjects[m_sceneIDs[id]]);
+        return Handle<RenderableObject>(m_renderableObjects[m_renderableIDs.getIndex(id)]);
     }
 
     Handle<RenderableObject> Scene::getRenderableObjectByIndex(uint32_t index) {
@@ -38,41 +57,503 @@ namespace vul {
     }
 
     Handle<PointLight> Scene::getPointLight(uint32_t id) {
-        return Handle<PointLight>(m_pointLights[m_sceneIDs[id]]);
+        return Handle<PointLight>(m_pointLights[m_pointLightIDs.getIndex(id)]);
     }
 
     Handle<PointLight> Scene::getPointLightByIndex(uint32_t index) {
         return Handle<PointLight>(m_pointLights[index]);
     }
 
+    bool Scene::hasSceneObject(SceneObjectType type, uint32_t id) {
+        switch (type) {
+        case SceneObjectType::Renderable: return m_renderableIDs.contains(id);
+        case SceneObjectType::PointLight: return m_pointLightIDs.contains(id);
+        default: return false;
+        }
+    }
+
     uint32_t Scene::getSceneObjectCount(SceneObjectType type) {
         switch (type) {
-        case SceneObjectType::Renderable: return m_renderableObjects.size();
-        case SceneObjectType::PointLight: return m_pointLights.size();
+        case SceneObjectType::Renderable: return m_renderableIDs.getSize();
+        case SceneObjectType::PointLight: return m_pointLightIDs.getSize();
         default: return 0;
         }
     }
 
     void Scene::removeSceneObject(SceneObjectType type, uint32_t id) {
-        uint32_t index = m_sceneIDs[id];
-        uint32_t modifiedID;
+        if (!hasSceneObject(type, id)) {
+            Logger::log("vul::Scene::removeSceneObject: Invalid ID %u", id);
+            return;
+        }
+
+        switch (type) {
+        case SceneObjectType::Renderable:
+        {
+            // Every array mirrors the slot map: move the back element into the hole
+            uint32_t proxy = m_treeProxies[m_renderableIDs.getIndex(id)];
+            if (proxy != AABBTree::nullNode) m_spatialTree.destroyProxy(proxy);
+
+            uint32_t index = m_renderableIDs.remove(id);
+            swapRemove(m_renderableObjects, index);
+            swapRemove(m_transformations, index);
+            swapRemove(m_renderableFlags, index);
+            swapRemove(m_meshIDs, index);
+            swapRemove(m_materialIDs, index);
+            swapRemove(m_parentIDs, index);
+            swapRemove(m_worldMatrices, index);
+            swapRemove(m_worldNormalMatrices, index);
+            swapRemove(m_worldSpheres, index);
+            swapRemove(m_worldExtents, index);
+            swapRemove(m_treeProxies, index);
+            swapRemove(m_transformationDirty, index);
+            swapRemove(m_hierarchyPositions, index);
+            m_skeletons.erase(id);
+
+            // Indices moved, and children of the removed object become roots when the
+            // hierarchy is rebuilt. Only those children's subtrees get recomputed
+            m_hierarchyChanged = true;
+        } break;
+        case SceneObjectType::PointLight:
+        {
+            uint32_t index = m_pointLightIDs.remove(id);
+            swapRemove(m_pointLights, index);
+        } break;
+        default: break;
+        }
+    }
 
+    void Scene::reserve(SceneObjectType type, uint32_t count) {
         switch (type) {
         case SceneObjectType::Renderable:
         {
-            modifiedID = m_renderableObjects.back().getID();
-            std::swap(m_renderableObjects[index], m_renderableObjects.back());
-            m_renderableObjects.pop_back();
+            m_renderableIDs.reserve(count);
+            m_renderableObjects.reserve(count);
+            m_transformations.reserve(count);
+            m_renderableFlags.reserve(count);
+            m_meshIDs.reserve(count);
+            m_materialIDs.reserve(count);
+            m_parentIDs.reserve(count);
+            m_worldMatrices.reserve(count);
+            m_worldNormalMatrices.reserve(count);
+            m_worldSpheres.reserve(count);
+            m_worldExtents.reserve(count);
+            m_treeProxies.reserve(count);
+            m_transformationDirty.reserve(count);
+            m_hierarchyPositions.reserve(count);
+            m_hierarchyOrder.reserve(count);
+            m_hierarchyParents.reserve(count);
+            m_subtreeSizes.reserve(count);
         } break;
         case SceneObjectType::PointLight:
         {
-            modifiedID = m_pointLights.back().getID();
-            std::swap(m_pointLights[index], m_pointLights.back());
-            m_pointLights.pop_back();
+            m_pointLightIDs.reserve(count);
+            m_pointLights.reserve(count);
         } break;
+        default: break;
         }
+    }
+
+    void Scene::setThreadPool(ThreadPool& threadPool) {
+        m_threadPool = &threadPool;
+    }
+
+    uint32_t Scene::getRenderableID(uint32_t index) const {
+        return m_renderableIDs.getID(index);
+    }
+
+    uint32_t Scene::getRenderableIndex(uint32_t id) const {
+        return m_renderableIDs.contains(id) ? m_renderableIDs.getIndex(id) : SlotMap::invalidID;
+    }
+
+    const Transformation* Scene::getRenderableTransformations() const {
+        return m_transformations.data();
+    }
+
+    const uint16_t* Scene::getRenderableFlags() const {
+        return m_renderableFlags.data();
+    }
+
+    const uint32_t* Scene::getRenderableMeshIDs() const {
+        return m_meshIDs.data();
+    }
+
+    const uint32_t* Scene::getRenderableMaterialIDs() const {
+        return m_materialIDs.data();
+    }
+
+    void Scene::setParent(uint32_t childID, uint32_t parentID) {
+        if (!m_renderableIDs.contains(childID)) {
+            Logger::log("vul::Scene::setParent: Invalid child ID %u", childID);
+            return;
+        }
+
+        if (parentID != SlotMap::invalidID) {
+            if (!m_renderableIDs.contains(parentID)) {
+                Logger::log("vul::Scene::setParent: Invalid parent ID %u", parentID);
+                return;
+            }
+
+            // Refuse to create cycles
+            for (uint32_t ancestor = parentID; m_renderableIDs.contains(ancestor);
+                ancestor = m_parentIDs[m_renderableIDs.getIndex(ancestor)]) {
+                if (ancestor == childID) {
+                    Logger::log("vul::Scene::setParent: %u is a descendant of %u", parentID, childID);
+                    return;
+                }
+            }
+        }
+
+        uint32_t index = m_renderableIDs.getIndex(childID);
+        if (m_parentIDs[index] == parentID) return;
+
+        m_parentIDs[index] = parentID;
+        m_reparentedIDs.push_back(childID);
+        m_hierarchyChanged = true;
+    }
+
+    uint32_t Scene::getParent(uint32_t id) {
+        uint32_t parentID = m_parentIDs[m_renderableIDs.getIndex(id)];
+        return m_renderableIDs.contains(parentID) ? parentID : SlotMap::invalidID;
+    }
+
+    void Scene::updateWorldTransformations() {
+        VUL_PROFILE_ZONE("Scene::updateWorldTransformations");
+
+        // The order is cheap to rebuild, but world matrices, bounds and tree proxies
+        // are only recomputed below objects that moved or were reparented
+        m_updatePositions.clear();
+        if (m_hierarchyChanged) rebuildHierarchy();
+        if (m_dirtyIDs.empty() && m_reparentedIDs.empty()) return;
+
+        // Sorting the dirty positions lets subtrees nested in an earlier dirty subtree be skipped
+        std::vector<uint32_t> positions;
+        positions.reserve(m_dirtyIDs.size() + m_reparentedIDs.size());
+        for (uint32_t id : m_dirtyIDs) {
+            if (!m_renderableIDs.contains(id)) continue;
+
+            // Objects whose transformation was only read don't need updating
+            uint32_t index = m_renderableIDs.getIndex(id);
+            m_transformationDirty[index] = 0;
+            if (m_transformations[index].isDirty()) positions.push_back(m_hierarchyPositions[index]);
+        }
+        for (uint32_t id : m_reparentedIDs) {
+            if (m_renderableIDs.contains(id)) positions.push_back(m_hierarchyPositions[m_renderableIDs.getIndex(id)]);
+        }
+        m_dirtyIDs.clear();
+        m_reparentedIDs.clear();
+        std::sort(positions.begin(), positions.end());
+
+        // Gather every affected subtree so they can be computed as one batch
+        uint32_t end = 0;
+        for (uint32_t position : positions) {
+            if (position < end) continue;
+
+            end = position + m_subtreeSizes[position];
+            for (uint32_t p = position; p < end; p++) m_updatePositions.push_back(p);
+        }
+        updateWorldTransformations(m_updatePositions);
+    }
+
+    const glm::mat4x3* Scene::getRenderableWorldMatrices() const {
+        return m_worldMatrices.data();
+    }
+
+    const glm::mat3* Scene::getRenderableWorldNormalMatrices() const {
+        return m_worldNormalMatrices.data();
+    }
+
+    const glm::vec4* Scene::getRenderableWorldSpheres() const {
+        return m_worldSpheres.data();
+    }
+
+    const glm::vec4* Scene::getRenderableWorldExtents() const {
+        return m_worldExtents.data();
+    }
+
+    void Scene::queryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& ids) {
+        updateWorldTransformations();
+        ids.clear();
+        m_queryCandidates.clear();
+        m_spatialTree.queryAABB(min, max, m_queryCandidates);
+
+        // The tree tests fattened bounds, refine against the actual ones
+        for (uint32_t id : m_queryCandidates) {
+            uint32_t index = m_renderableIDs.getIndex(id);
+            glm::vec3 center(m_worldSpheres[index]), extents(m_worldExtents[index]);
+            if (glm::all(glm::lessThanEqual(min, center + extents)) && glm::all(glm::lessThanEqual(center - extents, max)))
+                ids.push_back(id);
+        }
+    }
+
+    void Scene::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& ids) {
+        updateWorldTransformations();
+        ids.clear();
+        m_queryCandidates.clear();
+        m_spatialTree.querySphere(center, radius, m_queryCandidates);
+
+        for (uint32_t id : m_queryCandidates) {
+            uint32_t index = m_renderableIDs.getIndex(id);
+            glm::vec3 boxCenter(m_worldSpheres[index]), extents(m_worldExtents[index]);
+            glm::vec3 offset = center - glm::clamp(center, boxCenter - extents, boxCenter + extents);
+            if (glm::dot(offset, offset) <= radius * radius) ids.push_back(id);
+        }
+    }
+
+    void Scene::queryFrustum(const glm::vec4* planes, std::vector<uint32_t>& ids) {
+        updateWorldTransformations();
+        ids.clear();
+        m_queryCandidates.clear();
+        m_spatialTree.queryFrustum(planes, m_queryCandidates);
+
+        for (uint32_t id : m_queryCandidates) {
+            uint32_t index = m_renderableIDs.getIndex(id);
+            uint8_t visible;
+            FrustumCuller::cullScalar(planes, &m_worldSpheres[index], &m_worldExtents[index], 0, 1, &visible);
+            if (visible) ids.push_back(id);
+        }
+    }
+
+    bool Scene::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+        uint32_t& id, float& distance) {
+        updateWorldTransformations();
+
+        bool hit = false;
+        glm::vec3 inverseDirection = 1.f / direction;
+        m_spatialTree.raycast(origin, direction, maxDistance, [&](uint32_t candidate, float maxCandidateDistance) {
+            uint32_t index = m_renderableIDs.getIndex(candidate);
+            glm::vec3 center(m_worldSpheres[index]), extents(m_worldExtents[index]);
+
+            float candidateDistance;
+            if (!AABBTree::intersectRay(origin, inverseDirection, maxCandidateDistance,
+                center - extents, center + extents, candidateDistance)) return maxCandidateDistance;
+
+            // Closer hits shrink the search, so farther branches get skipped
+            hit = true;
+            id = candidate;
+            distance = candidateDistance;
+            return candidateDistance;
+        });
+
+        return hit;
+    }
+
+    const AABBTree& Scene::getSpatialTree() const {
+        return m_spatialTree;
+    }
+
+    const Mesh& Scene::getMesh(uint32_t meshID) const {
+        return m_meshes[meshID];
+    }
+
+    const Material& Scene::getMaterial(uint32_t materialID) const {
+        return m_materials[materialID];
+    }
+
+    uint32_t Scene::getMaterialCount() const {
+        return static_cast<uint32_t>(m_materials.size());
+    }
+
+    void Scene::markTransformationDirty(uint32_t index) {
+        if (m_transformationDirty[index]) return;
+
+        m_transformationDirty[index] = 1;
+        m_dirtyIDs.push_back(m_renderableIDs.getID(index));
+    }
+
+    void Scene::updateWorldBounds(uint32_t index) {
+        const Mesh& mesh = m_meshes[m_meshIDs[index]];
+        const glm::mat4x3& world = m_worldMatrices[index];
+
+        // Animation can move vertices anywhere, so skinned objects are never culled
+        uint32_t& proxy = m_treeProxies[index];
+        if (mesh.boundingRadius < 0.f || (m_renderableFlags[index] & static_cast<uint16_t>(RenderableObjectFlags::SkeletonAttached))) {
+            m_worldSpheres[index] = glm::vec4(world[3], unboundedRadius);
+            m_worldExtents[index] = glm::vec4(unboundedRadius);
+            if (proxy != AABBTree::nullNode) m_spatialTree.destroyProxy(proxy);
+            proxy = AABBTree::nullNode;
+            return;
+        }
+
+        glm::vec3 center = world[0] * mesh.boundingCenter.x + world[1] * mesh.boundingCenter.y
+            + world[2] * mesh.boundingCenter.z + world[3];
+        float maxScale = std::sqrt(std::max(glm::dot(world[0], world[0]),
+            std::max(glm::dot(world[1], world[1]), glm::dot(world[2], world[2]))));
+        m_worldSpheres[index] = glm::vec4(center, mesh.boundingRadius * maxScale);
+
+        // Box extents under rotation: sum of the half sizes projected onto each world axis
+        glm::vec3 halfSize = (mesh.boundsMax - mesh.boundsMin) * .5f;
+        glm::vec3 extents = glm::abs(world[0]) * halfSize.x + glm::abs(world[1]) * halfSize.y
+            + glm::abs(world[2]) * halfSize.z;
+        m_worldExtents[index] = glm::vec4(extents, 0.f);
+
+        // The tree only restructures when an object leaves its fattened bounds
+        if (proxy == AABBTree::nullNode) proxy = m_spatialTree.createProxy(center - extents, center + extents, m_renderableIDs.getID(index));
+        else m_spatialTree.moveProxy(proxy, center - extents, center + extents);
+    }
+
+    void Scene::rebuildHierarchy() {
+        VUL_PROFILE_ZONE("Scene::rebuildHierarchy");
+
+        const uint32_t count = m_renderableIDs.getSize();
+        const uint32_t none = SlotMap::invalidID;
+
+        // Bucket children by parent index
+        std::vector<uint32_t> parents(count), childOffsets(count + 1, 0), children(count);
+        for (uint32_t i = 0; i < count; i++) {
+            // Children of removed objects are promoted to roots
+            if (m_parentIDs[i] != none && !m_renderableIDs.contains(m_parentIDs[i])) {
+                m_parentIDs[i] = none;
+                m_reparentedIDs.push_back(m_renderableIDs.getID(i));
+            }
+            parents[i] = m_parentIDs[i] == none ? none : m_renderableIDs.getIndex(m_parentIDs[i]);
+            if (parents[i] != none) childOffsets[parents[i] + 1]++;
+        }
+        for (uint32_t i = 0; i < count; i++) childOffsets[i + 1] += childOffsets[i];
+
+        std::vector<uint32_t> cursor(childOffsets.begin(), childOffsets.end() - 1);
+        for (uint32_t i = 0; i < count; i++) {
+            if (parents[i] != none) children[cursor[parents[i]]++] = i;
+        }
+
+        // Depth-first walk from every root
+        m_hierarchyOrder.clear();
+        m_hierarchyParents.clear();
+        std::vector<uint32_t> stack;
+        for (uint32_t root = 0; root < count; root++) {
+            if (parents[root] != none) continue;
+
+            stack.push_back(root);
+            while (!stack.empty()) {
+                uint32_t index = stack.back();
+                stack.pop_back();
+
+                m_hierarchyPositions[index] = static_cast<uint32_t>(m_hierarchyOrder.size());
+                m_hierarchyOrder.push_back(index);
+                m_hierarchyParents.push_back(parents[index]);
+                for (uint32_t c = childOffsets[index + 1]; c > childOffsets[index]; c--)
+                    stack.push_back(children[c - 1]);
+            }
+        }
+
+        // Children always follow their parent, so sizes accumulate in one backwards pass
+        m_subtreeSizes.assign(count, 1);
+        for (uint32_t position = count; position-- > 0;) {
+            if (m_hierarchyParents[position] != none)
+                m_subtreeSizes[m_hierarchyPositions[m_hierarchyParents[position]]] += m_subtreeSizes[position];
+        }
+
+        m_hierarchyChanged = false;
+    }
+
+    void Scene::updateWorldTransformations(const std::vector<uint32_t>& positions) {
+        const uint32_t count = static_cast<uint32_t>(positions.size());
+
+        if (count < minBatchedUpdate) {
+            for (uint32_t position : positions) {
+                uint32_t index = m_hierarchyOrder[position];
+                uint32_t parent = m_hierarchyParents[position];
+                Transformation& local = m_transformations[index];
+                local.clearDirty();
+
+                if (parent == SlotMap::invalidID) {
+                    m_worldMatrices[index] = local.getAffineMatrix();
+                    m_worldNormalMatrices[index] = local.getNormalMatrix();
+                }
+                else {
+                    m_worldMatrices[index] = Transformation::combine(m_worldMatrices[parent], local.getAffineMatrix());
+                    m_worldNormalMatrices[index] = m_worldNormalMatrices[parent] * local.getNormalMatrix();
+                }
+                updateWorldBounds(index);
+            }
+            return;
+        }
+
+        // Local matrices don't depend on each other, so they are built in parallel
+        m_transformBatch.resize(count);
+        m_localMatrices.resize(count);
+        m_localNormalMatrices.resize(count);
+        auto computeLocal = [&](uint32_t begin, uint32_t end, uint32_t) {
+            for (uint32_t i = begin; i < end; i++)
+                m_transformBatch.set(i, m_transformations[m_hierarchyOrder[positions[i]]]);
+            m_transformBatch.compute(begin, end, m_localMatrices.data(), m_localNormalMatrices.data());
+        };
+        if (m_threadPool) m_threadPool->parallelFor(count, minUpdateChunk, computeLocal);
+        else computeLocal(0, count, 0);
+
+        // Positions are ascending, so parents are always resolved before their children
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = m_hierarchyOrder[positions[i]];
+            uint32_t parent = m_hierarchyParents[positions[i]];
+            m_transformations[index].clearDirty();
+
+            if (parent == SlotMap::invalidID) {
+                m_worldMatrices[index] = m_localMatrices[i];
+                m_worldNormalMatrices[index] = m_localNormalMatrices[i];
+            }
+            else {
+                m_worldMatrices[index] = Transformation::combine(m_worldMatrices[parent], m_localMatrices[i]);
+                m_worldNormalMatrices[index] = m_worldNormalMatrices[parent] * m_localNormalMatrices[i];
+            }
+            updateWorldBounds(index);
+        }
+    }
+
+    uint32_t Scene::createRenderables(uint32_t count) {
+        uint32_t first = m_renderableIDs.getSize();
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t id = m_renderableIDs.create();
+            if (id == SlotMap::invalidID) {
+                count = i;
+                break;
+            }
+            m_renderableObjects.push_back(RenderableObject(*this, id));
+        }
+
+        // Every packed array grows once, however many objects are added
+        uint32_t size = first + count;
+        m_transformations.resize(size);
+        m_renderableFlags.resize(size, static_cast<uint16_t>(RenderableObjectFlags::Visible));
+        m_meshIDs.resize(size, 0);
+        m_materialIDs.resize(size, 0);
+        m_parentIDs.resize(size, SlotMap::invalidID);
+        m_worldMatrices.resize(size, glm::mat4x3(1.f));
+        m_worldNormalMatrices.resize(size, glm::mat3(1.f));
+        m_worldSpheres.resize(size, glm::vec4(0.f, 0.f, 0.f, unboundedRadius));
+        m_worldExtents.resize(size, glm::vec4(unboundedRadius));
+        m_treeProxies.resize(size, AABBTree::nullNode);
+        m_transformationDirty.resize(size, 0);
+
+        // New objects are roots, appending them keeps the existing order valid
+        for (uint32_t index = first; index < size; index++) {
+            m_hierarchyPositions.push_back(static_cast<uint32_t>(m_hierarchyOrder.size()));
+            m_hierarchyOrder.push_back(index);
+            m_hierarchyParents.push_back(SlotMap::invalidID);
+            m_subtreeSizes.push_back(1);
+        }
+
+        return count;
+    }
+
+    uint32_t Scene::addMesh(const Mesh& mesh) {
+        // Meshes are identified by their VAO so each one is only stored once per scene
+        auto it = m_meshLookup.find(mesh.vao);
+        if (it != m_meshLookup.end()) return it->second;
+
+        uint32_t meshID = static_cast<uint32_t>(m_meshes.size());
+        m_meshes.push_back(mesh);
+        m_meshLookup[mesh.vao] = meshID;
+        return meshID;
+    }
+
+    uint32_t Scene::addMaterial(const Material& material) {
+        std::array<uint32_t, 4> key = { { material.colorMap.textureHandle, material.normalMap.textureHandle,
+            material.roughnessMap.textureHandle, material.metalMap.textureHandle } };
+        auto it = m_materialLookup.find(key);
+        if (it != m_materialLookup.end()) return it->second;
 
-        m_sceneIDs[modifiedID] = index;
-        m_sceneIDs.erase(m_sceneIDs.find(id));
+        uint32_t materialID = static_cast<uint32_t>(m_materials.size());
+        m_materials.push_back(material);
+        m_materialLookup[key] = materialID;
+        return materialID;
     }
 }
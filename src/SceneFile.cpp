@@ -0,0 +1,512 @@
+#define VULPESENGINE_EXPORT
+
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include <vulpes/LoadTelemetry.hpp>
+#include <vulpes/SceneFile.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    const uint32_t SceneFile::version;
+
+    namespace {
+        /* File layout, all values little endian
+            FileHeader
+            Sections, each starting on a 16 byte boundary at the offset the header gives:
+                Transforms       TransformRecord[renderableCount]
+                Flags            uint16_t[renderableCount] (RenderableObjectFlags)
+                MeshHashes       uint64_t[renderableCount], 0 if no mesh
+                MaterialIndices  uint32_t[renderableCount], into Materials
+                ParentIndices    uint32_t[renderableCount], always below the object's own index
+                SkeletonHashes   uint64_t[renderableCount], 0 if no skeleton
+                Materials        MaterialRecord[materialCount]
+                PointLights      PointLightRecord[pointLightCount]
+                Assets           AssetRecord[assetCount]
+                Strings          char[stringTableSize], asset paths without terminators
+            Renderables are stored parents first, in the scene's hierarchy order
+        */
+        enum Section {
+            Transforms, Flags, MeshHashes, MaterialIndices, ParentIndices, SkeletonHashes,
+            Materials, PointLights, Assets, Strings, SectionCount
+        };
+
+        const char fileMagic[4] = { 'V', 'U', 'L', 'S' };
+        const uint32_t endianCheck = 0x01020304;
+        const uint32_t noParent = 0xFFFFFFFF;
+        const uint64_t sectionAlignment = 16;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t endianCheck;
+            uint32_t renderableCount;
+            uint32_t materialCount;
+            uint32_t pointLightCount;
+            uint32_t assetCount;
+            uint32_t stringTableSize;
+            uint64_t sectionOffsets[SectionCount];
+        };
+
+        struct TransformRecord {
+            float position[3];
+            float orientation[4]; // x, y, z, w
+            float scale[3];
+        };
+
+        struct MaterialRecord {
+            uint64_t textureHashes[4]; // Color, normal, roughness, metal
+        };
+
+        struct PointLightRecord {
+            TransformRecord transform;
+            float color[3];
+            float brightness;
+            float radius;
+        };
+
+        struct AssetRecord {
+            uint64_t hash;
+            uint32_t type; // AssetType
+            uint32_t pathOffset; // Into the string table
+            uint32_t pathLength;
+            uint32_t padding;
+        };
+
+        const uint16_t textureFlags[4] = {
+            static_cast<uint16_t>(RenderableObjectFlags::ColorMapAttached),
+            static_cast<uint16_t>(RenderableObjectFlags::NormalMapAttached),
+            static_cast<uint16_t>(RenderableObjectFlags::RoughnessMapAttached),
+            static_cast<uint16_t>(RenderableObjectFlags::MetalMapAttached)
+        };
+
+        uint64_t getSectionSize(const FileHeader& header, int section) {
+            switch (section) {
+            case Transforms: return uint64_t(header.renderableCount) * sizeof(TransformRecord);
+            case Flags: return uint64_t(header.renderableCount) * sizeof(uint16_t);
+            case MeshHashes: return uint64_t(header.renderableCount) * sizeof(uint64_t);
+            case MaterialIndices: return uint64_t(header.renderableCount) * sizeof(uint32_t);
+            case ParentIndices: return uint64_t(header.renderableCount) * sizeof(uint32_t);
+            case SkeletonHashes: return uint64_t(header.renderableCount) * sizeof(uint64_t);
+            case Materials: return uint64_t(header.materialCount) * sizeof(MaterialRecord);
+            case PointLights: return uint64_t(header.pointLightCount) * sizeof(PointLightRecord);
+            case Assets: return uint64_t(header.assetCount) * sizeof(AssetRecord);
+            case Strings: return header.stringTableSize;
+            default: return 0;
+            }
+        }
+
+        TransformRecord makeTransformRecord(const Transformation& transformation) {
+            const glm::vec3& position = transformation.getPosition();
+            const glm::quat& orientation = transformation.getOrientation();
+            const glm::vec3& scale = transformation.getScale();
+            TransformRecord record = { { position.x, position.y, position.z },
+                { orientation.x, orientation.y, orientation.z, orientation.w },
+                { scale.x, scale.y, scale.z } };
+            return record;
+        }
+
+        void applyTransformRecord(const TransformRecord& record, Transformation& transformation) {
+            transformation.setPosition(record.position[0], record.position[1], record.position[2]);
+            transformation.setOrientation(glm::quat(record.orientation[3], record.orientation[0],
+                record.orientation[1], record.orientation[2]));
+            transformation.setScale(record.scale[0], record.scale[1], record.scale[2]);
+        }
+
+        // Read-only view of a whole file, mapped where the platform allows it
+        class MappedFile {
+        public:
+            MappedFile() : m_data(nullptr), m_size(0) {
+#if defined(_WIN32) && !defined(__unix__)
+                m_file = INVALID_HANDLE_VALUE;
+                m_mapping = nullptr;
+#endif
+            }
+
+            ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+                if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+#elif defined(_WIN32)
+                if (m_data) UnmapViewOfFile(m_data);
+                if (m_mapping) CloseHandle(m_mapping);
+                if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#endif
+            }
+
+            bool open(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0) return false;
+
+                struct stat info;
+                if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+                    close(fd);
+                    return false;
+                }
+
+                void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd); // The mapping keeps its own reference
+                if (data == MAP_FAILED) return false;
+
+                m_data = static_cast<const uint8_t*>(data);
+                m_size = static_cast<size_t>(info.st_size);
+                return true;
+#elif defined(_WIN32)
+                m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+                if (m_file == INVALID_HANDLE_VALUE) return false;
+
+                LARGE_INTEGER size;
+                if (!GetFileSizeEx(m_file, &size) || size.QuadPart <= 0) return false;
+
+                m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (!m_mapping) return false;
+
+                m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+                m_size = static_cast<size_t>(size.QuadPart);
+                return m_data != nullptr;
+#else
+                std::ifstream f(path, std::ios::binary | std::ios::ate);
+                if (!f) return false;
+
+                m_buffer.resize(static_cast<size_t>(f.tellg()));
+                f.seekg(0);
+                if (m_buffer.empty() || !f.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size())) return false;
+
+                m_data = m_buffer.data();
+                m_size = m_buffer.size();
+                return true;
+#endif
+            }
+
+            const uint8_t* getData() const { return m_data; }
+            size_t getSize() const { return m_size; }
+
+        private:
+            const uint8_t* m_data;
+            size_t m_size;
+#if defined(__unix__) || defined(__APPLE__)
+#elif defined(_WIN32)
+            HANDLE m_file;
+            HANDLE m_mapping;
+#else
+            std::vector<uint8_t> m_buffer;
+#endif
+        };
+    }
+
+    bool SceneFile::load(const std::string& path, Scene& scene, ResourceLoader& rl) {
+        MappedFile file;
+        if (!file.open(path)) {
+            Logger::log("vul::SceneFile::load: Unable to open '%s'", path.c_str());
+            return false;
+        }
+
+        FileHeader header;
+        if (file.getSize() < sizeof(FileHeader)) {
+            Logger::log("vul::SceneFile::load: '%s' is too small to be a scene file", path.c_str());
+            return false;
+        }
+        std::memcpy(&header, file.getData(), sizeof(FileHeader));
+
+        if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.endianCheck != endianCheck) {
+            Logger::log("vul::SceneFile::load: '%s' is not a scene file", path.c_str());
+            return false;
+        }
+
+        if (header.version != version) {
+            Logger::log("vul::SceneFile::load: '%s' has version %u, expected %u", path.c_str(), header.version, version);
+            return false;
+        }
+
+        for (int section = 0; section < SectionCount; section++) {
+            uint64_t offset = header.sectionOffsets[section];
+            if (offset % sectionAlignment != 0 || offset > file.getSize() || getSectionSize(header, section) > file.getSize() - offset) {
+                Logger::log("vul::SceneFile::load: '%s' is truncated or corrupt", path.c_str());
+                return false;
+            }
+        }
+
+        const uint8_t* data = file.getData();
+        const AssetRecord* assets = reinterpret_cast<const AssetRecord*>(data + header.sectionOffsets[Assets]);
+        const char* strings = reinterpret_cast<const char*>(data + header.sectionOffsets[Strings]);
+
+        // Every distinct asset is looked up once, objects only carry its hash
+        std::unordered_map<uint64_t, uint32_t> meshIDs;
+        std::unordered_map<uint64_t, Texture> textures;
+        std::unordered_map<uint64_t, Handle<Skeleton>> skeletons;
+        for (uint32_t i = 0; i < header.assetCount; i++) {
+            const AssetRecord& asset = assets[i];
+            if (uint64_t(asset.pathOffset) + asset.pathLength > header.stringTableSize) {
+                Logger::log("vul::SceneFile::load: Asset %u in '%s' has an invalid path", i, path.c_str());
+                continue;
+            }
+
+            std::string assetPath(strings + asset.pathOffset, asset.pathLength);
+            if (hashPath(assetPath) != asset.hash) {
+                Logger::log("vul::SceneFile::load: Hash mismatch for '%s' in '%s'", assetPath.c_str(), path.c_str());
+                continue;
+            }
+
+            switch (static_cast<AssetType>(asset.type)) {
+            case AssetType::Mesh:
+            {
+                Handle<Mesh> mesh = rl.loadMeshFromFile(assetPath);
+                if (mesh.isLoaded()) meshIDs[asset.hash] = scene.addMesh(mesh.makeCopy());
+            } break;
+            case AssetType::Texture:
+            {
+                Handle<Texture> texture = rl.loadTextureFromFile(assetPath);
+                if (texture.isLoaded()) textures[asset.hash] = texture.makeCopy();
+            } break;
+            case AssetType::Skeleton:
+            {
+                Handle<Skeleton> skeleton = rl.loadSkeletonFromFile(assetPath);
+                if (skeleton.isLoaded()) skeletons.emplace(asset.hash, skeleton);
+            } break;
+            default:
+                Logger::log("vul::SceneFile::load: Unknown asset type %u in '%s'", asset.type, path.c_str());
+                break;
+            }
+        }
+
+        // Materials, with the attachment flags they imply
+        const MaterialRecord* materialRecords = reinterpret_cast<const MaterialRecord*>(data + header.sectionOffsets[Materials]);
+        std::vector<uint32_t> materialIDs(header.materialCount);
+        std::vector<uint16_t> materialFlags(header.materialCount);
+        for (uint32_t i = 0; i < header.materialCount; i++) {
+            Material material;
+            Texture* maps[4] = { &material.colorMap, &material.normalMap, &material.roughnessMap, &material.metalMap };
+            for (int k = 0; k < 4; k++) {
+                auto it = textures.find(materialRecords[i].textureHashes[k]);
+                if (it == textures.end()) continue;
+
+                *maps[k] = it->second;
+                materialFlags[i] |= textureFlags[k];
+            }
+            materialIDs[i] = scene.addMaterial(material);
+        }
+
+        // Renderables, the packed arrays grow once and are filled straight from the mapping
+        uint32_t first = scene.m_renderableIDs.getSize();
+        uint32_t count = scene.createRenderables(header.renderableCount);
+        if (count < header.renderableCount)
+            Logger::log("vul::SceneFile::load: Only %u of %u objects in '%s' fit in the scene", count, header.renderableCount, path.c_str());
+
+        const TransformRecord* transforms = reinterpret_cast<const TransformRecord*>(data + header.sectionOffsets[Transforms]);
+        const uint64_t* meshHashes = reinterpret_cast<const uint64_t*>(data + header.sectionOffsets[MeshHashes]);
+        const uint32_t* materialIndices = reinterpret_cast<const uint32_t*>(data + header.sectionOffsets[MaterialIndices]);
+        const uint32_t* parentIndices = reinterpret_cast<const uint32_t*>(data + header.sectionOffsets[ParentIndices]);
+        const uint64_t* skeletonHashes = reinterpret_cast<const uint64_t*>(data + header.sectionOffsets[SkeletonHashes]);
+
+        std::memcpy(&scene.m_renderableFlags[first], data + header.sectionOffsets[Flags], count * sizeof(uint16_t));
+
+        const uint16_t meshFlag = static_cast<uint16_t>(RenderableObjectFlags::MeshAttached);
+        const uint16_t skeletonFlag = static_cast<uint16_t>(RenderableObjectFlags::SkeletonAttached);
+        const uint16_t allTextureFlags = textureFlags[0] | textureFlags[1] | textureFlags[2] | textureFlags[3];
+        uint64_t lastMeshHash = 0;
+        uint32_t lastMeshID = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = first + i;
+            applyTransformRecord(transforms[i], scene.m_transformations[index]);
+            uint16_t& flags = scene.m_renderableFlags[index];
+
+            // Objects sharing a mesh tend to be stored together
+            if (meshHashes[i] != lastMeshHash) {
+                auto it = meshIDs.find(meshHashes[i]);
+                lastMeshHash = meshHashes[i];
+                lastMeshID = it != meshIDs.end() ? it->second : 0;
+            }
+            scene.m_meshIDs[index] = lastMeshID;
+            flags = lastMeshID != 0 ? flags | meshFlag : flags & ~meshFlag;
+
+            uint32_t material = materialIndices[i];
+            scene.m_materialIDs[index] = material < header.materialCount ? materialIDs[material] : 0;
+            flags = (flags & ~allTextureFlags) | (material < header.materialCount ? materialFlags[material] : 0);
+
+            // Parents come first, anything else could form a cycle
+            uint32_t parent = parentIndices[i];
+            scene.m_parentIDs[index] = parent < i ? scene.m_renderableIDs.getID(first + parent) : SlotMap::invalidID;
+            if (parent >= i) scene.m_reparentedIDs.push_back(scene.m_renderableIDs.getID(index));
+
+            flags &= ~skeletonFlag;
+            if (skeletonHashes[i] != 0) {
+                auto it = skeletons.find(skeletonHashes[i]);
+                if (it != skeletons.end()) {
+                    scene.m_skeletons.emplace(scene.m_renderableIDs.getID(index), it->second);
+                    flags |= skeletonFlag;
+                }
+            }
+        }
+
+        // World matrices and bounds below every loaded root are computed on the next update
+        scene.m_hierarchyChanged = true;
+
+        const PointLightRecord* lights = reinterpret_cast<const PointLightRecord*>(data + header.sectionOffsets[PointLights]);
+        scene.reserve(SceneObjectType::PointLight, scene.getSceneObjectCount(SceneObjectType::PointLight) + header.pointLightCount);
+        for (uint32_t i = 0; i < header.pointLightCount; i++) {
+            uint32_t id = scene.createSceneObject(SceneObjectType::PointLight);
+            if (id == SlotMap::invalidID) break;
+
+            Handle<PointLight> light = scene.getPointLight(id);
+            applyTransformRecord(lights[i].transform, light->getTransformation());
+            light->setColor(glm::vec3(lights[i].color[0], lights[i].color[1], lights[i].color[2]));
+            light->setBrightness(lights[i].brightness);
+            light->setRadius(lights[i].radius);
+        }
+
+        return true;
+    }
+
+    bool SceneFile::write(const std::string& path, Scene& scene, ResourceLoader& rl) {
+        // Brings the hierarchy order up to date so parents are written first
+        scene.updateWorldTransformations();
+        Handle<ResourceCache> cache = rl.getResourceCache();
+
+        std::vector<AssetRecord> assets;
+        std::string strings;
+        std::unordered_map<uint64_t, std::string> assetPaths;
+        bool collision = false;
+        auto addAsset = [&](AssetType type, const std::string& assetPath) -> uint64_t {
+            if (assetPath.empty()) return 0;
+
+            uint64_t hash = hashPath(assetPath);
+            auto it = assetPaths.find(hash);
+            if (it != assetPaths.end()) {
+                if (it->second != assetPath) {
+                    Logger::log("vul::SceneFile::write: '%s' and '%s' have the same hash", assetPath.c_str(), it->second.c_str());
+                    collision = true;
+                }
+                return hash;
+            }
+
+            assetPaths.emplace(hash, assetPath);
+            AssetRecord record = { hash, static_cast<uint32_t>(type), static_cast<uint32_t>(strings.size()),
+                static_cast<uint32_t>(assetPath.size()), 0 };
+            assets.push_back(record);
+            strings += assetPath;
+            return hash;
+        };
+
+        // Scene meshes and materials are few, resolve their paths once each
+        std::vector<uint64_t> meshHashByID(scene.m_meshes.size(), 0);
+        for (size_t id = 1; id < scene.m_meshes.size(); id++) {
+            std::string meshPath = cache->getMeshPath(scene.m_meshes[id].vao);
+            if (meshPath.empty()) Logger::log("vul::SceneFile::write: Mesh %u was not loaded from a file, skipped", static_cast<uint32_t>(id));
+            meshHashByID[id] = addAsset(AssetType::Mesh, meshPath);
+        }
+
+        std::vector<MaterialRecord> materials(scene.m_materials.size());
+        for (size_t id = 0; id < scene.m_materials.size(); id++) {
+            const Material& material = scene.m_materials[id];
+            const Texture* maps[4] = { &material.colorMap, &material.normalMap, &material.roughnessMap, &material.metalMap };
+            for (int k = 0; k < 4; k++) {
+                materials[id].textureHashes[k] = 0;
+                if (maps[k]->textureHandle == 0) continue;
+
+                std::string texturePath = cache->getTexturePath(maps[k]->textureHandle);
+                if (texturePath.empty()) Logger::log("vul::SceneFile::write: Texture %u was not loaded from a file, skipped", maps[k]->textureHandle);
+                materials[id].textureHashes[k] = addAsset(AssetType::Texture, texturePath);
+            }
+        }
+
+        const uint32_t count = scene.m_renderableIDs.getSize();
+        std::vector<TransformRecord> transforms(count);
+        std::vector<uint16_t> flags(count);
+        std::vector<uint64_t> meshHashes(count);
+        std::vector<uint32_t> materialIndices(count);
+        std::vector<uint32_t> parentIndices(count);
+        std::vector<uint64_t> skeletonHashes(count, 0);
+        for (uint32_t position = 0; position < count; position++) {
+            uint32_t index = scene.m_hierarchyOrder[position];
+            transforms[position] = makeTransformRecord(scene.m_transformations[index]);
+            flags[position] = scene.m_renderableFlags[index];
+            meshHashes[position] = meshHashByID[scene.m_meshIDs[index]];
+            materialIndices[position] = scene.m_materialIDs[index];
+
+            uint32_t parent = scene.m_hierarchyParents[position];
+            parentIndices[position] = parent != SlotMap::invalidID ? scene.m_hierarchyPositions[parent] : noParent;
+
+            auto skeleton = scene.m_skeletons.find(scene.m_renderableIDs.getID(index));
+            if (skeleton != scene.m_skeletons.end())
+                skeletonHashes[position] = addAsset(AssetType::Skeleton, cache->getSkeletonPath(skeleton->second));
+        }
+
+        if (collision) return false;
+
+        const uint32_t lightCount = scene.m_pointLightIDs.getSize();
+        std::vector<PointLightRecord> lights(lightCount);
+        for (uint32_t i = 0; i < lightCount; i++) {
+            PointLight& light = scene.m_pointLights[i];
+            lights[i].transform = makeTransformRecord(light.getTransformation());
+            const glm::vec3& color = light.getColor();
+            for (int k = 0; k < 3; k++) lights[i].color[k] = color[k];
+            lights[i].brightness = light.getBrightness();
+            lights[i].radius = light.getRadius();
+        }
+
+        FileHeader header;
+        std::memset(&header, 0, sizeof(FileHeader));
+        std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = version;
+        header.endianCheck = endianCheck;
+        header.renderableCount = count;
+        header.materialCount = static_cast<uint32_t>(materials.size());
+        header.pointLightCount = lightCount;
+        header.assetCount = static_cast<uint32_t>(assets.size());
+        header.stringTableSize = static_cast<uint32_t>(strings.size());
+
+        const void* sections[SectionCount] = { transforms.data(), flags.data(), meshHashes.data(), materialIndices.data(),
+            parentIndices.data(), skeletonHashes.data(), materials.data(), lights.data(), assets.data(), strings.data() };
+        uint64_t offset = (sizeof(FileHeader) + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+        for (int section = 0; section < SectionCount; section++) {
+            header.sectionOffsets[section] = offset;
+            offset += (getSectionSize(header, section) + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+        }
+
+        std::ofstream o(path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!o) {
+            Logger::log("vul::SceneFile::write: Unable to open '%s'", path.c_str());
+            return false;
+        }
+
+        const char padding[sectionAlignment] = {};
+        o.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        uint64_t written = sizeof(FileHeader);
+        for (int section = 0; section < SectionCount; section++) {
+            o.write(padding, header.sectionOffsets[section] - written);
+            o.write(static_cast<const char*>(sections[section]), getSectionSize(header, section));
+            written = header.sectionOffsets[section] + getSectionSize(header, section);
+        }
+
+        if (!o) {
+            Logger::log("vul::SceneFile::write: Failed writing '%s'", path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    uint64_t SceneFile::hashPath(const std::string& path) {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : path) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
@@ -7,7 +7,7 @@ namespace vul {
     }
 
     SceneObject::SceneObject(const SceneObject& other)
-        : m_id(other.m_id), m_transformation(other.m_transformation), m_type(other.m_type) {
+        : m_id(other.m_id), m_type(other.m_type) {
     }
 
     uint32_t SceneObject::getID() const {
@@ -17,8 +17,4 @@ namespace vul {
     SceneObjectType SceneObject::getType() const {
         return m_type;
     }
-
-    Transformation& SceneObject::getTransformation() {
-        return m_transformation;
-    }
 }
@@ -3,6 +3,7 @@
 #include <vulpes/Skeleton.hpp>
 #include <vulpes/ResourceLoader.hpp>
 #include <vulpes/Mesh.hpp>
+#include <vulpes/Profiler.hpp>
 
 #include "Logger.h"
 
@@ -12,6 +13,8 @@ namespace vul {
     }
 
     void Skeleton::update(float deltaTime) noexcept {
+        VUL_PROFILE_ZONE("Skeleton::update");
+
         if (m_actions.find(m_currentAction) == m_actions.end()) {
             return;
         }
@@ -0,0 +1,89 @@
+#define VULPESENGINE_EXPORT
+
+#include <vulpes/SlotMap.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    const uint32_t SlotMap::invalidID;
+
+    SlotMap::SlotMap() {
+    }
+
+    SlotMap::~SlotMap() {
+    }
+
+    uint32_t SlotMap::create() {
+        uint32_t slot;
+        if (!m_freeSlots.empty()) {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else {
+            if (m_slotIndices.size() >= m_maxSlots) {
+                Logger::log("vul::SlotMap::create: Out of slots (%u)", m_maxSlots);
+                return invalidID;
+            }
+
+            slot = static_cast<uint32_t>(m_slotIndices.size());
+            m_slotIndices.push_back(0);
+            m_slotGenerations.push_back(0);
+        }
+
+        uint32_t id = (m_slotGenerations[slot] << m_slotBits) | slot;
+        m_slotIndices[slot] = static_cast<uint32_t>(m_denseIDs.size());
+        m_denseIDs.push_back(id);
+        return id;
+    }
+
+    uint32_t SlotMap::remove(uint32_t id) {
+        uint32_t slot = id & m_slotMask;
+        uint32_t index = m_slotIndices[slot];
+
+        // Move the last element into the hole
+        uint32_t movedID = m_denseIDs.back();
+        m_denseIDs[index] = movedID;
+        m_slotIndices[movedID & m_slotMask] = index;
+        m_denseIDs.pop_back();
+
+        // Invalidate every outstanding copy of the removed ID
+        m_slotGenerations[slot] = (m_slotGenerations[slot] + 1) & m_generationMask;
+        m_freeSlots.push_back(slot);
+
+        return index;
+    }
+
+    bool SlotMap::contains(uint32_t id) const {
+        uint32_t slot = id & m_slotMask;
+        return slot < m_slotIndices.size() && m_slotGenerations[slot] == (id >> m_slotBits)
+            && m_slotIndices[slot] < m_denseIDs.size() && m_denseIDs[m_slotIndices[slot]] == id;
+    }
+
+    uint32_t SlotMap::getIndex(uint32_t id) const {
+        return m_slotIndices[id & m_slotMask];
+    }
+
+    uint32_t SlotMap::getID(uint32_t index) const {
+        return m_denseIDs[index];
+    }
+
+    uint32_t SlotMap::getSize() const {
+        return static_cast<uint32_t>(m_denseIDs.size());
+    }
+
+    void SlotMap::reserve(uint32_t size) {
+        m_slotIndices.reserve(size);
+        m_slotGenerations.reserve(size);
+        m_denseIDs.reserve(size);
+    }
+
+    void SlotMap::clear() {
+        // Bump every live slot's generation so stale IDs stay invalid after clearing
+        for (uint32_t id : m_denseIDs) {
+            uint32_t slot = id & m_slotMask;
+            m_slotGenerations[slot] = (m_slotGenerations[slot] + 1) & m_generationMask;
+            m_freeSlots.push_back(slot);
+        }
+        m_denseIDs.clear();
+    }
+}
@@ -0,0 +1,318 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include <vulpes/FrustumCuller.hpp>
+#include <vulpes/Scene.hpp>
+#include <vulpes/StaticBatcher.hpp>
+
+#include "Logger.h"
+
+namespace vul {
+    namespace {
+        // Interleaved, at the attribute locations ResourceLoader gives meshes
+        struct StaticVertex {
+            glm::vec3 position;
+            glm::vec3 normal;
+            glm::vec3 tangent;
+            glm::vec3 bitangent;
+            glm::vec2 UVCoordinates;
+        };
+
+        // CPU copy of a mesh's attributes, empty vectors for attributes it lacks
+        struct SourceMesh {
+            std::vector<float> attributes[5]; // Position, normal, tangent, bitangent, UV coordinates
+            std::vector<uint32_t> indices;
+            uint32_t vertexCount = 0;
+        };
+
+        const GLint attributeComponents[5] = { 3, 3, 3, 3, 2 };
+
+        std::vector<float> readAttribute(GLuint location, GLint components, uint32_t vertexCount) {
+            // ResourceLoader stores every attribute in its own tightly packed float buffer
+            GLint buffer = 0, size = 0, type = 0, stride = 0;
+            glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+            glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+            glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+            glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+            if (buffer == 0 || size != components || type != GL_FLOAT || stride != 0) return std::vector<float>();
+
+            GLint bytes = 0;
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &bytes);
+
+            std::vector<float> data(bytes / sizeof(float));
+            if (vertexCount != 0 && data.size() != vertexCount * components) return std::vector<float>();
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, data.size() * sizeof(float), data.data());
+            return data;
+        }
+
+        bool readMesh(const Mesh& mesh, SourceMesh& source) {
+            if (mesh.vao == 0 || mesh.ib == 0 || mesh.ic == 0) return false;
+
+            glBindVertexArray(mesh.vao);
+            source.attributes[0] = readAttribute(0, attributeComponents[0], 0);
+            source.vertexCount = static_cast<uint32_t>(source.attributes[0].size() / 3);
+            for (GLuint location = 1; location < 5; location++)
+                source.attributes[location] = readAttribute(location, attributeComponents[location], source.vertexCount);
+            glBindVertexArray(0);
+
+            source.indices.resize(mesh.ic);
+            glBindBuffer(GL_COPY_READ_BUFFER, mesh.ib);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, mesh.ic * sizeof(uint32_t), source.indices.data());
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+            for (uint32_t index : source.indices) {
+                if (index >= source.vertexCount) return false;
+            }
+            return source.vertexCount != 0;
+        }
+
+        glm::vec3 readVec3(const std::vector<float>& attribute, uint32_t vertex) {
+            if (attribute.empty()) return glm::vec3(0.f);
+            return glm::vec3(attribute[vertex * 3], attribute[vertex * 3 + 1], attribute[vertex * 3 + 2]);
+        }
+
+        glm::vec3 safeNormalize(const glm::vec3& v) {
+            float lengthSquared = glm::dot(v, v);
+            return lengthSquared > 0.f ? v / std::sqrt(lengthSquared) : v;
+        }
+    }
+
+    StaticBatcher::StaticBatcher() : m_vao(0), m_vbo(0), m_ib(0), m_built(false) {
+    }
+
+    StaticBatcher::~StaticBatcher() {
+        release();
+    }
+
+    bool StaticBatcher::build(Scene& scene) {
+        release();
+        scene.updateWorldTransformations();
+
+        const uint32_t objectCount = scene.getSceneObjectCount(SceneObjectType::Renderable);
+        const uint16_t* flags = scene.getRenderableFlags();
+        const uint32_t* meshIDs = scene.getRenderableMeshIDs();
+        const uint32_t* materialIDs = scene.getRenderableMaterialIDs();
+        const glm::mat4x3* worldMatrices = scene.getRenderableWorldMatrices();
+        const glm::mat3* worldNormalMatrices = scene.getRenderableWorldNormalMatrices();
+        const glm::vec4* worldSpheres = scene.getRenderableWorldSpheres();
+        const glm::vec4* worldExtents = scene.getRenderableWorldExtents();
+        const uint16_t staticMask = static_cast<uint16_t>(RenderableObjectFlags::Static)
+            | static_cast<uint16_t>(RenderableObjectFlags::MeshAttached);
+
+        // Grouped by material, then by mesh so each mesh's vertices are read back once
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < objectCount; i++) {
+            if ((flags[i] & staticMask) == staticMask && !(flags[i] & static_cast<uint16_t>(RenderableObjectFlags::SkeletonAttached)))
+                candidates.push_back(i);
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+            return materialIDs[a] != materialIDs[b] ? materialIDs[a] < materialIDs[b] : meshIDs[a] < meshIDs[b];
+        });
+
+        // Every batch shares one vertex and index buffer, so batches can be drawn together
+        std::unordered_map<uint32_t, SourceMesh> sources;
+        std::vector<StaticVertex> vertices;
+        std::vector<uint32_t> indices;
+        for (size_t c = 0; c < candidates.size();) {
+            Batch batch;
+            batch.materialID = materialIDs[candidates[c]];
+            batch.firstRange = static_cast<uint32_t>(m_rangeIDs.size());
+            batch.firstDraw = batch.drawCount = batch.triangleCount = 0;
+
+            for (; c < candidates.size() && materialIDs[candidates[c]] == batch.materialID; c++) {
+                uint32_t i = candidates[c];
+                auto source = sources.find(meshIDs[i]);
+                if (source == sources.end()) {
+                    source = sources.emplace(meshIDs[i], SourceMesh()).first;
+                    if (!readMesh(scene.getMesh(meshIDs[i]), source->second))
+                        Logger::log("vul::StaticBatcher::build: Unable to read back mesh %u, its objects are drawn unbatched", meshIDs[i]);
+                }
+
+                const SourceMesh& mesh = source->second;
+                if (mesh.vertexCount == 0 || mesh.indices.empty()) continue;
+
+                // Pre-transformed into world space, the geometry pass then applies the identity
+                const glm::mat4x3& world = worldMatrices[i];
+                const glm::mat3 rotationScale(world[0], world[1], world[2]);
+                const uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+                for (uint32_t v = 0; v < mesh.vertexCount; v++) {
+                    StaticVertex vertex;
+                    vertex.position = world * glm::vec4(readVec3(mesh.attributes[0], v), 1.f);
+                    vertex.normal = safeNormalize(worldNormalMatrices[i] * readVec3(mesh.attributes[1], v));
+                    vertex.tangent = safeNormalize(rotationScale * readVec3(mesh.attributes[2], v));
+                    vertex.bitangent = safeNormalize(rotationScale * readVec3(mesh.attributes[3], v));
+                    vertex.UVCoordinates = mesh.attributes[4].empty() ? glm::vec2(0.f)
+                        : glm::vec2(mesh.attributes[4][v * 2], mesh.attributes[4][v * 2 + 1]);
+                    vertices.push_back(vertex);
+                }
+
+                m_rangeIDs.push_back(scene.getRenderableID(i));
+                m_rangeFirstIndices.push_back(static_cast<uint32_t>(indices.size()));
+                m_rangeIndexCounts.push_back(static_cast<uint32_t>(mesh.indices.size()));
+                m_rangeSpheres.push_back(worldSpheres[i]);
+                m_rangeExtents.push_back(worldExtents[i]);
+                for (uint32_t index : mesh.indices) indices.push_back(baseVertex + index);
+            }
+
+            batch.rangeCount = static_cast<uint32_t>(m_rangeIDs.size()) - batch.firstRange;
+            if (batch.rangeCount != 0) m_batches.push_back(batch);
+        }
+
+        if (!m_batches.empty()) {
+            glGenVertexArrays(1, &m_vao);
+            glBindVertexArray(m_vao);
+
+            glGenBuffers(1, &m_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(StaticVertex), vertices.data(), GL_STATIC_DRAW);
+
+            const size_t attributeOffsets[5] = { offsetof(StaticVertex, position), offsetof(StaticVertex, normal),
+                offsetof(StaticVertex, tangent), offsetof(StaticVertex, bitangent), offsetof(StaticVertex, UVCoordinates) };
+            for (GLuint location = 0; location < 5; location++) {
+                glVertexAttribPointer(location, attributeComponents[location], GL_FLOAT, GL_FALSE, sizeof(StaticVertex),
+                    reinterpret_cast<const void*>(attributeOffsets[location]));
+                glEnableVertexAttribArray(location);
+            }
+
+            glGenBuffers(1, &m_ib);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+
+            glBindVertexArray(0);
+        }
+
+        m_sortedIDs = m_rangeIDs;
+        std::sort(m_sortedIDs.begin(), m_sortedIDs.end());
+        m_built = true;
+        return true;
+    }
+
+    void StaticBatcher::release() {
+        if (m_vao != 0) {
+            glDeleteVertexArrays(1, &m_vao);
+            glDeleteBuffers(1, &m_vbo);
+            glDeleteBuffers(1, &m_ib);
+        }
+
+        m_vao = m_vbo = m_ib = 0;
+        m_batches.clear();
+        m_rangeIDs.clear();
+        m_rangeFirstIndices.clear();
+        m_rangeIndexCounts.clear();
+        m_rangeSpheres.clear();
+        m_rangeExtents.clear();
+        m_rangeResults.clear();
+        m_sortedIDs.clear();
+        m_drawCounts.clear();
+        m_drawOffsets.clear();
+        m_built = false;
+    }
+
+    bool StaticBatcher::isBuilt() {
+        return m_built;
+    }
+
+    bool StaticBatcher::contains(uint32_t id) {
+        return std::binary_search(m_sortedIDs.begin(), m_sortedIDs.end(), id);
+    }
+
+    uint32_t StaticBatcher::cull(Scene& scene, const glm::vec4* planes) {
+        m_drawCounts.clear();
+        m_drawOffsets.clear();
+        if (m_rangeIDs.empty()) return 0;
+
+        const uint32_t rangeCount = static_cast<uint32_t>(m_rangeIDs.size());
+        m_rangeResults.resize(rangeCount);
+        FrustumCuller::cull(planes, m_rangeSpheres.data(), m_rangeExtents.data(), 0, rangeCount, m_rangeResults.data());
+
+        const uint16_t* flags = scene.getRenderableFlags();
+        uint32_t culledCount = 0;
+        for (auto& batch : m_batches) {
+            batch.firstDraw = static_cast<uint32_t>(m_drawCounts.size());
+            batch.triangleCount = 0;
+
+            // Neighbouring visible ranges are contiguous in the index buffer and share a draw
+            uint32_t runStart = 0, runCount = 0;
+            for (uint32_t r = batch.firstRange; r < batch.firstRange + batch.rangeCount; r++) {
+                if (!m_rangeResults[r]) {
+                    culledCount++;
+                    continue;
+                }
+
+                uint32_t index = scene.getRenderableIndex(m_rangeIDs[r]);
+                if (index == SlotMap::invalidID || !(flags[index] & static_cast<uint16_t>(RenderableObjectFlags::Visible))) continue;
+
+                batch.triangleCount += m_rangeIndexCounts[r] / 3;
+                if (runCount != 0 && runStart + runCount == m_rangeFirstIndices[r]) {
+                    runCount += m_rangeIndexCounts[r];
+                    continue;
+                }
+
+                if (runCount != 0) {
+                    m_drawCounts.push_back(static_cast<int32_t>(runCount));
+                    m_drawOffsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(runStart) * sizeof(uint32_t)));
+                }
+                runStart = m_rangeFirstIndices[r];
+                runCount = m_rangeIndexCounts[r];
+            }
+
+            if (runCount != 0) {
+                m_drawCounts.push_back(static_cast<int32_t>(runCount));
+                m_drawOffsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(runStart) * sizeof(uint32_t)));
+            }
+            batch.drawCount = static_cast<uint32_t>(m_drawCounts.size()) - batch.firstDraw;
+        }
+
+        return culledCount;
+    }
+
+    uint32_t StaticBatcher::getBatchCount() {
+        return static_cast<uint32_t>(m_batches.size());
+    }
+
+    uint32_t StaticBatcher::getBatchMaterialID(uint32_t batch) {
+        return m_batches[batch].materialID;
+    }
+
+    uint32_t StaticBatcher::draw(uint32_t batchIndex) {
+        const Batch& batch = m_batches[batchIndex];
+        if (batch.drawCount == 0) return 0;
+
+        glBindVertexArray(m_vao);
+        glMultiDrawElements(GL_TRIANGLES, &m_drawCounts[batch.firstDraw], GL_UNSIGNED_INT,
+            &m_drawOffsets[batch.firstDraw], batch.drawCount);
+        return batch.triangleCount;
+    }
+
+    uint32_t StaticBatcher::getVertexArray() {
+        return m_vao;
+    }
+
+    uint32_t StaticBatcher::getDrawCount(uint32_t batch) {
+        return m_batches[batch].drawCount;
+    }
+
+    uint32_t StaticBatcher::getTriangleCount(uint32_t batch) {
+        return m_batches[batch].triangleCount;
+    }
+
+    void StaticBatcher::writeCommands(uint32_t batchIndex, uint32_t baseInstance, DrawElementsIndirectCommand* commands) {
+        const Batch& batch = m_batches[batchIndex];
+        for (uint32_t d = 0; d < batch.drawCount; d++) {
+            const size_t offset = reinterpret_cast<size_t>(m_drawOffsets[batch.firstDraw + d]);
+            commands[d] = { static_cast<uint32_t>(m_drawCounts[batch.firstDraw + d]), 1,
+                static_cast<uint32_t>(offset / sizeof(uint32_t)), 0, baseInstance };
+        }
+    }
+
+    uint32_t StaticBatcher::getRangeCount() {
+        return static_cast<uint32_t>(m_rangeIDs.size());
+    }
+}
@@ -0,0 +1,89 @@
+#define VULPESENGINE_EXPORT
+
+#include <algorithm>
+
+#include <vulpes/ThreadPool.hpp>
+
+namespace vul {
+    ThreadPool::ThreadPool() : ThreadPool(0) {
+    }
+
+    ThreadPool::ThreadPool(uint32_t workerCount) : m_generation(0), m_busyWorkers(0), m_stopping(false),
+        m_function(nullptr), m_count(0), m_chunk(1), m_nextIndex(0) {
+        for (uint32_t i = 0; i < workerCount; i++)
+            m_threads.emplace_back(&ThreadPool::worker, this, i + 1);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+
+        for (auto& thread : m_threads) thread.join();
+    }
+
+    void ThreadPool::parallelFor(uint32_t count, uint32_t minChunk, const RangeFunction& function) {
+        if (count == 0) return;
+        if (minChunk == 0) minChunk = 1;
+
+        if (m_threads.empty() || count <= minChunk) {
+            function(0, count, 0);
+            return;
+        }
+
+        // A few chunks per thread evens out uneven work without much contention
+        uint32_t threadCount = getThreadCount();
+        uint32_t chunk = std::max(minChunk, (count + threadCount * 4 - 1) / (threadCount * 4));
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_function = &function;
+            m_count = count;
+            m_chunk = chunk;
+            m_nextIndex = 0;
+            m_busyWorkers = static_cast<uint32_t>(m_threads.size());
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        runChunks(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+        m_function = nullptr;
+    }
+
+    uint32_t ThreadPool::getThreadCount() {
+        return static_cast<uint32_t>(m_threads.size()) + 1;
+    }
+
+    uint32_t ThreadPool::getDefaultWorkerCount() {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    void ThreadPool::worker(uint32_t threadIndex) {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+                if (m_stopping) return;
+                seenGeneration = m_generation;
+            }
+
+            runChunks(threadIndex);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busyWorkers == 0) m_done.notify_one();
+        }
+    }
+
+    void ThreadPool::runChunks(uint32_t threadIndex) {
+        uint32_t begin;
+        while ((begin = m_nextIndex.fetch_add(m_chunk)) < m_count)
+            (*m_function)(begin, std::min(begin + m_chunk, m_count), threadIndex);
+    }
+}
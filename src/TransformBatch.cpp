@@ -0,0 +1,174 @@
+#define VULPESENGINE_EXPORT
+
+#include <vulpes/TransformBatch.hpp>
+
+#if defined(__AVX__)
+#define VUL_TRANSFORM_AVX
+#include <immintrin.h>
+#endif // defined(__AVX__)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VUL_TRANSFORM_SSE
+#include <emmintrin.h>
+#endif // SSE2
+
+namespace vul {
+#ifdef VUL_TRANSFORM_SSE
+    namespace {
+        // r holds 21 values for 4 objects: 12 for the affine matrix, then 9 for the
+        // normal matrix, both column major. Transpose so each object is contiguous
+        void storeMatrices(__m128* r, float* affine, float* normal) {
+            _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+            _MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+            _MM_TRANSPOSE4_PS(r[8], r[9], r[10], r[11]);
+            for (int i = 0; i < 4; i++) {
+                _mm_storeu_ps(affine + i * 12, r[i]);
+                _mm_storeu_ps(affine + i * 12 + 4, r[i + 4]);
+                _mm_storeu_ps(affine + i * 12 + 8, r[i + 8]);
+            }
+
+            float last[4];
+            _mm_storeu_ps(last, r[20]);
+            _MM_TRANSPOSE4_PS(r[12], r[13], r[14], r[15]);
+            _MM_TRANSPOSE4_PS(r[16], r[17], r[18], r[19]);
+            for (int i = 0; i < 4; i++) {
+                _mm_storeu_ps(normal + i * 9, r[12 + i]);
+                _mm_storeu_ps(normal + i * 9 + 4, r[16 + i]);
+                normal[i * 9 + 8] = last[i];
+            }
+        }
+    }
+#endif // VUL_TRANSFORM_SSE
+
+    TransformBatch::TransformBatch() {
+    }
+
+    TransformBatch::~TransformBatch() {
+    }
+
+    void TransformBatch::resize(uint32_t size) {
+        for (auto& v : m_position) v.resize(size);
+        for (auto& v : m_orientation) v.resize(size);
+        for (auto& v : m_scale) v.resize(size);
+    }
+
+    uint32_t TransformBatch::getSize() const {
+        return static_cast<uint32_t>(m_position[0].size());
+    }
+
+    void TransformBatch::set(uint32_t index, const Transformation& transformation) {
+        const glm::vec3& position = transformation.getPosition();
+        const glm::quat& orientation = transformation.getOrientation();
+        const glm::vec3& scale = transformation.getScale();
+
+        for (int i = 0; i < 3; i++) {
+            m_position[i][index] = position[i];
+            m_scale[i][index] = scale[i];
+        }
+        m_orientation[0][index] = orientation.x;
+        m_orientation[1][index] = orientation.y;
+        m_orientation[2][index] = orientation.z;
+        m_orientation[3][index] = orientation.w;
+    }
+
+    void TransformBatch::compute(uint32_t begin, uint32_t end, glm::mat4x3* affineMatrices, glm::mat3* normalMatrices) const {
+        uint32_t i = begin;
+
+#ifdef VUL_TRANSFORM_AVX
+        const __m256 one8 = _mm256_set1_ps(1.f), two8 = _mm256_set1_ps(2.f);
+        for (; i + 8 <= end; i += 8) {
+            __m256 qx = _mm256_loadu_ps(&m_orientation[0][i]), qy = _mm256_loadu_ps(&m_orientation[1][i]);
+            __m256 qz = _mm256_loadu_ps(&m_orientation[2][i]), qw = _mm256_loadu_ps(&m_orientation[3][i]);
+
+            __m256 x2 = _mm256_mul_ps(qx, two8), y2 = _mm256_mul_ps(qy, two8), z2 = _mm256_mul_ps(qz, two8);
+            __m256 xx = _mm256_mul_ps(qx, x2), yy = _mm256_mul_ps(qy, y2), zz = _mm256_mul_ps(qz, z2);
+            __m256 xy = _mm256_mul_ps(qx, y2), xz = _mm256_mul_ps(qx, z2), yz = _mm256_mul_ps(qy, z2);
+            __m256 wx = _mm256_mul_ps(qw, x2), wy = _mm256_mul_ps(qw, y2), wz = _mm256_mul_ps(qw, z2);
+
+            // Same terms as glm::mat3_cast
+            __m256 r[21];
+            r[12] = _mm256_sub_ps(one8, _mm256_add_ps(yy, zz));
+            r[13] = _mm256_add_ps(xy, wz);
+            r[14] = _mm256_sub_ps(xz, wy);
+            r[15] = _mm256_sub_ps(xy, wz);
+            r[16] = _mm256_sub_ps(one8, _mm256_add_ps(xx, zz));
+            r[17] = _mm256_add_ps(yz, wx);
+            r[18] = _mm256_add_ps(xz, wy);
+            r[19] = _mm256_sub_ps(yz, wx);
+            r[20] = _mm256_sub_ps(one8, _mm256_add_ps(xx, yy));
+
+            for (int c = 0; c < 3; c++) {
+                __m256 s = _mm256_loadu_ps(&m_scale[c][i]);
+                for (int k = 0; k < 3; k++) r[c * 3 + k] = _mm256_mul_ps(r[12 + c * 3 + k], s);
+            }
+            for (int k = 0; k < 3; k++) r[9 + k] = _mm256_loadu_ps(&m_position[k][i]);
+
+            // Store each half of the 8 lanes with the 4-wide transpose
+            __m128 low[21], high[21];
+            for (int k = 0; k < 21; k++) {
+                low[k] = _mm256_castps256_ps128(r[k]);
+                high[k] = _mm256_extractf128_ps(r[k], 1);
+            }
+            storeMatrices(low, &affineMatrices[i][0][0], &normalMatrices[i][0][0]);
+            storeMatrices(high, &affineMatrices[i + 4][0][0], &normalMatrices[i + 4][0][0]);
+        }
+#endif // VUL_TRANSFORM_AVX
+
+#ifdef VUL_TRANSFORM_SSE
+        const __m128 one = _mm_set1_ps(1.f), two = _mm_set1_ps(2.f);
+        for (; i + 4 <= end; i += 4) {
+            __m128 qx = _mm_loadu_ps(&m_orientation[0][i]), qy = _mm_loadu_ps(&m_orientation[1][i]);
+            __m128 qz = _mm_loadu_ps(&m_orientation[2][i]), qw = _mm_loadu_ps(&m_orientation[3][i]);
+
+            __m128 x2 = _mm_mul_ps(qx, two), y2 = _mm_mul_ps(qy, two), z2 = _mm_mul_ps(qz, two);
+            __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+            __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+            __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+
+            __m128 r[21];
+            r[12] = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+            r[13] = _mm_add_ps(xy, wz);
+            r[14] = _mm_sub_ps(xz, wy);
+            r[15] = _mm_sub_ps(xy, wz);
+            r[16] = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+            r[17] = _mm_add_ps(yz, wx);
+            r[18] = _mm_add_ps(xz, wy);
+            r[19] = _mm_sub_ps(yz, wx);
+            r[20] = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+            for (int c = 0; c < 3; c++) {
+                __m128 s = _mm_loadu_ps(&m_scale[c][i]);
+                for (int k = 0; k < 3; k++) r[c * 3 + k] = _mm_mul_ps(r[12 + c * 3 + k], s);
+            }
+            for (int k = 0; k < 3; k++) r[9 + k] = _mm_loadu_ps(&m_position[k][i]);
+
+            storeMatrices(r, &affineMatrices[i][0][0], &normalMatrices[i][0][0]);
+        }
+#endif // VUL_TRANSFORM_SSE
+
+        // Remainder, or everything on targets without SIMD
+        computeScalar(i, end, affineMatrices, normalMatrices);
+    }
+
+    void TransformBatch::computeScalar(uint32_t begin, uint32_t end, glm::mat4x3* affineMatrices, glm::mat3* normalMatrices) const {
+        for (uint32_t i = begin; i < end; i++) {
+            glm::quat q(m_orientation[3][i], m_orientation[0][i], m_orientation[1][i], m_orientation[2][i]);
+            glm::mat3 rotation = glm::mat3_cast(q);
+
+            glm::mat4x3& affine = affineMatrices[i];
+            for (int c = 0; c < 3; c++) affine[c] = rotation[c] * m_scale[c][i];
+            affine[3] = glm::vec3(m_position[0][i], m_position[1][i], m_position[2][i]);
+            normalMatrices[i] = rotation;
+        }
+    }
+
+    const char* TransformBatch::getInstructionSet() {
+#if defined(VUL_TRANSFORM_AVX)
+        return "AVX";
+#elif defined(VUL_TRANSFORM_SSE)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -1,32 +1,12 @@
 #define VULPESENGINE_EXPORT
-#define GLM_ENABLE_EXPERIMENTAL
 
-#include <cstdio>
-
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/euler_angles.hpp>
+#include <cmath>
 
 #include <vulpes/Transformation.hpp>
 
 namespace vul {
-    Transformation::Transformation() : m_position(glm::vec3()), m_rotation(glm::vec3()),
-        m_scale(glm::vec3(1.f, 1.f, 1.f)) {
-        m_positionMatrix = glm::translate(glm::mat4(1.f), m_position);
-        m_rotationMatrix = glm::eulerAngleYXZ(m_rotation.y, m_rotation.x, m_rotation.z);
-        m_normalMatrix = glm::mat3(m_rotationMatrix);
-        m_scaleMatrix = glm::scale(glm::mat4(1.f), m_scale);
-        m_transformationMatrix = m_positionMatrix * m_rotationMatrix * m_scaleMatrix;
-    }
-
-    Transformation::Transformation(const Transformation& other) {
-        m_position = other.m_position;
-        m_rotation = other.m_rotation;
-        m_scale = other.m_scale;
-        m_positionMatrix = other.m_positionMatrix;
-        m_rotationMatrix = other.m_rotationMatrix;
-        m_normalMatrix = other.m_normalMatrix;
-        m_scaleMatrix = other.m_scaleMatrix;
-        m_transformationMatrix = other.m_transformationMatrix;
+    Transformation::Transformation() : m_position(glm::vec3()), m_orientation(1.f, 0.f, 0.f, 0.f),
+        m_rotation(glm::vec3()), m_scale(glm::vec3(1.f, 1.f, 1.f)), m_dirty(true) {
     }
 
     // Position
@@ -37,22 +17,22 @@ namespace vul {
 
     void Transformation::setPosition(const glm::vec3& position) {
         m_position = position;
-        calculatePositionMatrix();
+        m_dirty = true;
     }
 
     void Transformation::setX(float x) {
         m_position.x = x;
-        calculatePositionMatrix();
+        m_dirty = true;
     }
 
     void Transformation::setY(float y) {
         m_position.y = y;
-        calculatePositionMatrix();
+        m_dirty = true;
     }
 
     void Transformation::setZ(float z) {
         m_position.z = z;
-        calculatePositionMatrix();
+        m_dirty = true;
     }
 
     const glm::vec3& Transformation::getPosition() const {
@@ -66,29 +46,50 @@ namespace vul {
     }
 
     void Transformation::setRotation(const glm::vec3& rotation) {
+        // Same as eulerAngleYXZ: yaw, then pitch, then roll. Built by hand since
+        // glm::angleAxis switched from degrees to radians between glm versions
+        glm::vec3 half = rotation * .5f;
+        glm::quat yaw(std::cos(half.y), 0.f, std::sin(half.y), 0.f);
+        glm::quat pitch(std::cos(half.x), std::sin(half.x), 0.f, 0.f);
+        glm::quat roll(std::cos(half.z), 0.f, 0.f, std::sin(half.z));
+        m_orientation = glm::normalize(yaw * pitch * roll);
         m_rotation = rotation;
-        calculateRotationMatrix();
+        m_dirty = true;
     }
 
     void Transformation::setXRotation(float x) {
-        m_rotation.x = x;
-        calculateRotationMatrix();
+        setRotation(glm::vec3(x, m_rotation.y, m_rotation.z));
     }
 
     void Transformation::setYRotation(float y) {
-        m_rotation.y = y;
-        calculateRotationMatrix();
+        setRotation(glm::vec3(m_rotation.x, y, m_rotation.z));
     }
 
     void Transformation::setZRotation(float z) {
-        m_rotation.z = z;
-        calculateRotationMatrix();
+        setRotation(glm::vec3(m_rotation.x, m_rotation.y, z));
     }
 
     const glm::vec3& Transformation::getRotation() const {
         return m_rotation;
     }
 
+    void Transformation::setOrientation(const glm::quat& orientation) {
+        m_orientation = glm::normalize(orientation);
+
+        // Inverse of the YXZ composition in setRotation
+        glm::mat3 r = glm::mat3_cast(m_orientation);
+        float yaw = std::atan2(r[2][0], r[2][2]);
+        float pitch = std::atan2(-r[2][1], std::sqrt(r[0][1] * r[0][1] + r[1][1] * r[1][1]));
+        float s = std::sin(yaw), c = std::cos(yaw);
+        float roll = std::atan2(s * r[1][2] - c * r[1][0], c * r[0][0] - s * r[0][2]);
+        m_rotation = glm::vec3(pitch, yaw, roll);
+        m_dirty = true;
+    }
+
+    const glm::quat& Transformation::getOrientation() const {
+        return m_orientation;
+    }
+
     // Scale
 
     void Transformation::setScale(float scale) {
@@ -101,34 +102,54 @@ namespace vul {
 
     void Transformation::setScale(const glm::vec3& scale) {
         m_scale = scale;
-        calculateScaleMatrix();
+        m_dirty = true;
     }
 
     const glm::vec3& Transformation::getScale() const {
         return m_scale;
     }
 
-    const glm::mat4& Transformation::getTransformationMatrix() const {
-        return m_transformationMatrix;
+    // Matrices
+
+    glm::mat4x3 Transformation::getAffineMatrix() const {
+        glm::mat3 r = glm::mat3_cast(m_orientation);
+        glm::mat4x3 m;
+        m[0] = r[0] * m_scale.x;
+        m[1] = r[1] * m_scale.y;
+        m[2] = r[2] * m_scale.z;
+        m[3] = m_position;
+        return m;
+    }
+
+    glm::mat4 Transformation::getTransformationMatrix() const {
+        glm::mat4x3 affine = getAffineMatrix();
+        glm::mat4 m(1.f);
+        for (int i = 0; i < 4; i++) m[i] = glm::vec4(affine[i], i == 3 ? 1.f : 0.f);
+        return m;
+    }
+
+    glm::mat3 Transformation::getNormalMatrix() const {
+        // Rotation only, matching what the shaders expect
+        return glm::mat3_cast(m_orientation);
     }
 
-    const glm::mat3& Transformation::getNormalMatrix() const {
-        return m_normalMatrix;
+    bool Transformation::isDirty() const {
+        return m_dirty;
     }
 
-    void Transformation::calculatePositionMatrix() {
-        m_positionMatrix = glm::translate(glm::mat4(1.f), m_position);
-        m_transformationMatrix = m_positionMatrix * m_rotationMatrix * m_scaleMatrix;
+    void Transformation::markDirty() {
+        m_dirty = true;
     }
 
-    void Transformation::calculateRotationMatrix() {
-        m_rotationMatrix = glm::eulerAngleYXZ(m_rotation.y, m_rotation.x, m_rotation.z);
-        m_transformationMatrix = m_positionMatrix * m_rotationMatrix * m_scaleMatrix;
-        m_normalMatrix = glm::mat3(m_rotationMatrix);
+    void Transformation::clearDirty() {
+        m_dirty = false;
     }
 
-    void Transformation::calculateScaleMatrix() {
-        m_scaleMatrix = glm::scale(glm::mat4(1.f), m_scale);
-        m_transformationMatrix = m_positionMatrix * m_rotationMatrix * m_scaleMatrix;
+    glm::mat4x3 Transformation::combine(const glm::mat4x3& parent, const glm::mat4x3& local) {
+        glm::mat4x3 m;
+        for (int i = 0; i < 4; i++)
+            m[i] = parent[0] * local[i].x + parent[1] * local[i].y + parent[2] * local[i].z;
+        m[3] += parent[3];
+        return m;
     }
 }
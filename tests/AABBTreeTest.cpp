@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <vulpes/AABBTree.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t objectCount = 100000;
+    const uint32_t queryCount = 200;
+    const float worldExtent = 500.f;
+
+    struct Box {
+        uint32_t proxy;
+        glm::vec3 min, max;
+    };
+
+    glm::vec3 randomPoint(std::mt19937& random, float extent) {
+        std::uniform_real_distribution<float> coordinate(-extent, extent);
+        return glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+    }
+
+    glm::vec3 randomSize(std::mt19937& random, float minimum, float maximum) {
+        std::uniform_real_distribution<float> size(minimum, maximum);
+        return glm::vec3(size(random), size(random), size(random));
+    }
+
+    // Boxes are found by their index in boxes, which is also the proxy's user data
+    void fillTree(AABBTree& tree, std::vector<Box>& boxes, uint32_t count, std::mt19937& random) {
+        for (uint32_t i = 0; i < count; i++) {
+            Box box;
+            box.min = randomPoint(random, worldExtent);
+            box.max = box.min + randomSize(random, .5f, 5.f);
+            box.proxy = tree.createProxy(box.min, box.max, static_cast<uint32_t>(boxes.size()));
+            boxes.push_back(box);
+        }
+    }
+
+    // Brute force over the same fattened bounds the tree tests against, so any
+    // difference comes from the traversal and not from the margin
+    template <typename Predicate>
+    std::vector<uint32_t> bruteForce(const AABBTree& tree, const std::vector<Box>& boxes, const Predicate& passes) {
+        std::vector<uint32_t> results;
+        for (uint32_t i = 0; i < boxes.size(); i++) {
+            if (boxes[i].proxy == AABBTree::nullNode) continue;
+
+            glm::vec3 min, max;
+            tree.getFatBounds(boxes[i].proxy, min, max);
+            if (passes(min, max)) results.push_back(i);
+        }
+        return results;
+    }
+
+    bool sameResults(std::vector<uint32_t> results, const std::vector<uint32_t>& expected) {
+        std::sort(results.begin(), results.end());
+        return results == expected;
+    }
+
+    // Inward planes of an axis aligned box, which queryFrustum accepts like any other frustum
+    void getBoxPlanes(const glm::vec3& min, const glm::vec3& max, glm::vec4* planes) {
+        for (int axis = 0; axis < 3; axis++) {
+            glm::vec3 normal(0.f);
+            normal[axis] = 1.f;
+            planes[axis * 2] = glm::vec4(normal, -min[axis]);
+            planes[axis * 2 + 1] = glm::vec4(-normal, max[axis]);
+        }
+    }
+}
+
+int main() {
+    std::mt19937 random(4321);
+    AABBTree tree;
+    std::vector<Box> boxes;
+    fillTree(tree, boxes, objectCount, random);
+
+    // Half the moves stay inside the fat bounds, the rest reinsert
+    uint32_t reinserted = 0;
+    for (uint32_t i = 0; i < objectCount / 5; i++) {
+        Box& box = boxes[random() % boxes.size()];
+        const glm::vec3 offset = i % 2 ? randomPoint(random, .01f) : randomPoint(random, 50.f);
+        box.min += offset;
+        box.max += offset;
+        if (tree.moveProxy(box.proxy, box.min, box.max)) reinserted++;
+    }
+    VUL_CHECK(reinserted > 0 && reinserted < objectCount / 5);
+
+    for (uint32_t i = 0; i < objectCount; i += 10) {
+        tree.destroyProxy(boxes[i].proxy);
+        boxes[i].proxy = AABBTree::nullNode;
+    }
+    const uint32_t proxyCount = objectCount - objectCount / 10;
+    VUL_CHECK(tree.getProxyCount() == proxyCount);
+
+    // Fat bounds must still contain every box after the moves
+    uint32_t uncovered = 0;
+    for (const Box& box : boxes) {
+        if (box.proxy == AABBTree::nullNode) continue;
+
+        glm::vec3 min, max;
+        tree.getFatBounds(box.proxy, min, max);
+        if (glm::any(glm::lessThan(box.min, min)) || glm::any(glm::greaterThan(box.max, max))) uncovered++;
+    }
+    VUL_CHECK(uncovered == 0);
+
+    // Rotations keep the tree shallow without strictly balancing it
+    const uint32_t heightBound = 2 * static_cast<uint32_t>(std::ceil(std::log2(static_cast<double>(proxyCount))));
+    std::printf("Tree height %u for %u proxies\n", tree.getHeight(), proxyCount);
+    VUL_CHECK(tree.getHeight() <= heightBound);
+
+    // Objects created before they are placed all share one box at the origin, which
+    // no rotation shrinks, the tree still has to stay shallow
+    AABBTree stacked;
+    const uint32_t stackedCount = 20000;
+    for (uint32_t i = 0; i < stackedCount; i++) {
+        const glm::vec3 extent = i % 2 ? glm::vec3(1.f, 0.f, 1.f) : glm::vec3(1.f, 1.f, 0.f);
+        stacked.createProxy(-extent, extent, i);
+    }
+    std::printf("Tree height %u for %u coinciding proxies\n", stacked.getHeight(), stackedCount);
+    VUL_CHECK(stacked.getHeight() <= 2 * static_cast<uint32_t>(std::ceil(std::log2(static_cast<double>(stackedCount)))));
+
+    std::vector<uint32_t> results;
+    uint32_t totalResults = 0;
+    for (uint32_t q = 0; q < queryCount; q++) {
+        const glm::vec3 min = randomPoint(random, worldExtent), max = min + randomSize(random, 10.f, 80.f);
+
+        results.clear();
+        tree.queryAABB(min, max, results);
+        totalResults += static_cast<uint32_t>(results.size());
+        VUL_CHECK(sameResults(results, bruteForce(tree, boxes, [&](const glm::vec3& a, const glm::vec3& b) {
+            return !glm::any(glm::lessThan(b, min)) && !glm::any(glm::lessThan(max, a));
+        })));
+
+        const glm::vec3 center = (min + max) * .5f;
+        const float radius = max.x - min.x;
+        results.clear();
+        tree.querySphere(center, radius, results);
+        VUL_CHECK(sameResults(results, bruteForce(tree, boxes, [&](const glm::vec3& a, const glm::vec3& b) {
+            const glm::vec3 offset = center - glm::clamp(center, a, b);
+            return glm::dot(offset, offset) <= radius * radius;
+        })));
+
+        glm::vec4 planes[6];
+        getBoxPlanes(min, max, planes);
+        results.clear();
+        tree.queryFrustum(planes, results);
+        VUL_CHECK(sameResults(results, bruteForce(tree, boxes, [&](const glm::vec3& a, const glm::vec3& b) {
+            return !glm::any(glm::lessThan(b, min)) && !glm::any(glm::lessThan(max, a));
+        })));
+
+        // A callback that keeps the distance unchanged visits every box along the ray
+        const glm::vec3 origin = randomPoint(random, worldExtent);
+        const glm::vec3 direction = glm::normalize(randomPoint(random, 1.f));
+        const float maxDistance = 300.f;
+        results.clear();
+        tree.raycast(origin, direction, maxDistance, [&](uint32_t userData, float distance) {
+            results.push_back(userData);
+            return distance;
+        });
+        VUL_CHECK(sameResults(results, bruteForce(tree, boxes, [&](const glm::vec3& a, const glm::vec3& b) {
+            float distance;
+            return AABBTree::intersectRay(origin, 1.f / direction, maxDistance, a, b, distance);
+        })));
+    }
+    std::printf("%u queries of each kind checked against brute force, %u AABB query results\n", queryCount, totalResults);
+
+    // Benchmark: small queries at growing sizes should cost about log(n), not n
+    for (uint32_t count : { 1000u, 10000u, 100000u }) {
+        AABBTree sized;
+        const float extent = worldExtent * std::cbrt(count / static_cast<float>(objectCount)); // Same density
+        std::mt19937 sizedRandom(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const glm::vec3 min = randomPoint(sizedRandom, extent);
+            sized.createProxy(min, min + randomSize(sizedRandom, .5f, 5.f), i);
+        }
+
+        const uint32_t iterations = 100000;
+        uint32_t found = 0;
+        test::Timer timer;
+        for (uint32_t i = 0; i < iterations; i++) {
+            const glm::vec3 min = randomPoint(sizedRandom, extent);
+            results.clear();
+            sized.queryAABB(min, min + glm::vec3(5.f), results);
+            found += static_cast<uint32_t>(results.size());
+        }
+        std::printf("%u proxies: %.3f us per AABB query (%.2f results, height %u)\n", count,
+            timer.getMilliseconds() * 1000.0 / iterations, found / static_cast<double>(iterations), sized.getHeight());
+    }
+
+    return test::finish();
+}
@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <vulpes/Camera.hpp>
+#include <vulpes/DeferredRenderer.hpp>
+#include <vulpes/Engine.hpp>
+#include <vulpes/RenderTarget.hpp>
+#include <vulpes/ResourceLoader.hpp>
+#include <vulpes/Scene.hpp>
+#include <vulpes/ThreadPool.hpp>
+
+#include "GLTestUtils.hpp"
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    // Small, the frames are about the CPU side of the geometry pass
+    const uint32_t width = 320;
+    const uint32_t height = 180;
+
+    // Not a multiple of the chunk sizes, so the last chunk is partial
+    const uint32_t objectCount = 200003;
+    const uint32_t workerCounts[] = { 0, 3, 7, 15 };
+    const uint32_t frameCount = 10;
+
+    // 1x1 color maps, each one gives the objects using it a material of their own
+    uint32_t makeColorMap(uint8_t red, uint8_t green, uint8_t blue) {
+        const uint8_t pixel[4] = { red, green, blue, 255 };
+        uint32_t handle = 0;
+        glGenTextures(1, &handle);
+        glBindTexture(GL_TEXTURE_2D, handle);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return handle;
+    }
+
+    // Quads and planes with a few materials scattered around and behind the camera, so
+    // about half survive culling and the sort has meshes, materials and depths to order
+    void fillScene(Scene& scene, ResourceLoader& rl, std::vector<Handle<Texture>>& colorMaps, std::mt19937& random) {
+        const Handle<Mesh> meshes[2] = { rl.getQuad(), rl.getPlane() };
+        std::uniform_real_distribution<float> position(-400.f, 400.f), scale(.2f, 1.f);
+        std::uniform_int_distribution<uint32_t> pick(0, 7);
+
+        scene.reserve(SceneObjectType::Renderable, objectCount);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            Handle<RenderableObject> object = scene.getRenderableObject(scene.createSceneObject(SceneObjectType::Renderable));
+            const uint32_t variant = pick(random);
+            object->attachMesh(meshes[variant & 1]);
+            if (variant >> 1) object->attachColorMap(colorMaps[(variant >> 1) - 1]);
+            object->getTransformation().setPosition(position(random), position(random) * .1f, position(random));
+            object->getTransformation().setScale(scale(random));
+        }
+        scene.updateWorldTransformations();
+    }
+
+    struct Frame {
+        std::vector<uint32_t> drawOrder;
+        uint32_t culledCount;
+        uint32_t drawCallCount;
+        double cullTime; // Averages over the frames
+        double drawListTime;
+    };
+
+    Frame renderFrames(DeferredRenderer& renderer, RenderTarget& target) {
+        Frame frame = { {}, 0, 0, 0.0, 0.0 };
+        for (uint32_t i = 0; i < frameCount; i++) {
+            renderer.render(&target);
+            frame.cullTime += renderer.getCullTime() / frameCount;
+            frame.drawListTime += renderer.getDrawListTime() / frameCount;
+        }
+        glFinish();
+        frame.drawOrder = renderer.getDrawOrder();
+        frame.culledCount = renderer.getCulledObjectCount();
+        frame.drawCallCount = renderer.getDrawCallCount();
+        return frame;
+    }
+}
+
+int main() {
+    if (!test::canCreateContext()) {
+        std::printf("Unable to create an OpenGL context, skipped\n");
+        return test::skipped;
+    }
+
+    WindowCreationParameters parameters;
+    parameters.width = width;
+    parameters.height = height;
+    parameters.title = "DrawListTest";
+    Engine engine(parameters);
+    if (!GLEW_ARB_explicit_uniform_location) {
+        std::printf("ARB_explicit_uniform_location is not supported, skipped\n");
+        return test::skipped;
+    }
+
+    std::vector<Texture> textures(3);
+    textures[0].textureHandle = makeColorMap(200, 60, 60);
+    textures[1].textureHandle = makeColorMap(60, 200, 60);
+    textures[2].textureHandle = makeColorMap(60, 60, 200);
+    {
+        std::vector<Handle<Texture>> colorMaps;
+        for (auto& texture : textures) colorMaps.push_back(Handle<Texture>(texture));
+
+        ResourceLoader rl;
+        Scene scene;
+        std::mt19937 random(40);
+        fillScene(scene, rl, colorMaps, random);
+        Camera camera(engine, glm::vec3(0.f, 5.f, 0.f), glm::vec3(0.f, 0.f, -50.f));
+        RenderTarget target(width, height);
+
+        // Without a pool the scene is one chunk, the lists every pool builds have to
+        // merge into the same draws in the same order
+        DeferredRenderer reference(rl);
+        reference.setScene(scene);
+        reference.setCamera(camera);
+        const Frame expected = renderFrames(reference, target);
+        std::printf("%u renderables, no pool: cull %.3f ms, draw list %.3f ms (%u culled, %u instances, %u draws)\n",
+            objectCount, expected.cullTime, expected.drawListTime, expected.culledCount,
+            static_cast<uint32_t>(expected.drawOrder.size()), expected.drawCallCount);
+        VUL_CHECK(!expected.drawOrder.empty());
+        VUL_CHECK(expected.culledCount > 0);
+        VUL_CHECK(expected.culledCount + expected.drawOrder.size() == objectCount);
+
+        for (uint32_t workerCount : workerCounts) {
+            ThreadPool threadPool(workerCount);
+            DeferredRenderer renderer(rl);
+            renderer.setScene(scene);
+            renderer.setCamera(camera);
+            renderer.setThreadPool(threadPool);
+
+            const Frame frame = renderFrames(renderer, target);
+            std::printf("%u renderables, %u worker(s): cull %.3f ms, draw list %.3f ms\n",
+                objectCount, workerCount, frame.cullTime, frame.drawListTime);
+            VUL_CHECK(frame.culledCount == expected.culledCount);
+            VUL_CHECK(frame.drawCallCount == expected.drawCallCount);
+            VUL_CHECK(frame.drawOrder == expected.drawOrder);
+        }
+    }
+    for (auto& texture : textures) glDeleteTextures(1, &texture.textureHandle);
+
+    return test::finish();
+}
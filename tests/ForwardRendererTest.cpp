@@ -0,0 +1,103 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <vulpes/Camera.hpp>
+#include <vulpes/DeferredRenderer.hpp>
+#include <vulpes/Engine.hpp>
+#include <vulpes/ForwardRenderer.hpp>
+#include <vulpes/RenderTarget.hpp>
+#include <vulpes/ResourceLoader.hpp>
+#include <vulpes/Scene.hpp>
+
+#include "GLTestUtils.hpp"
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t width = 960;
+    const uint32_t height = 540;
+
+    // Both paths run the same lighting math, they differ where the g-buffer's packed
+    // normals and depth lose precision
+    const double maxMeanDifference = .01;
+    const double maxOutlierShare = .01;
+
+    void checkAgainstDeferred(const char* name, const std::vector<float>& deferred, const std::vector<float>& forward) {
+        const test::ImageDifference difference = test::compareImages(deferred, forward);
+        std::printf("%s against deferred: mean %.4f, max %.3f, %.2f%% of pixels over .1\n",
+            name, difference.mean, difference.max, difference.outlierShare * 100.0);
+        VUL_CHECK(difference.mean < maxMeanDifference);
+        VUL_CHECK(difference.outlierShare < maxOutlierShare);
+    }
+}
+
+int main() {
+    if (!test::canCreateContext()) {
+        std::printf("Unable to create an OpenGL context, skipped\n");
+        return test::skipped;
+    }
+
+    WindowCreationParameters parameters;
+    parameters.width = width;
+    parameters.height = height;
+    parameters.title = "ForwardRendererTest";
+    Engine engine(parameters);
+    if (!GLEW_ARB_explicit_uniform_location) {
+        std::printf("ARB_explicit_uniform_location is not supported, skipped\n");
+        return test::skipped;
+    }
+
+    Texture environment = test::makeCubeMap(.05f, .06f, .08f);
+    Texture diffuseEnvironment = test::makeCubeMap(.02f, .025f, .03f);
+    {
+        ResourceLoader rl;
+        Scene scene;
+        test::fillRenderScene(scene, rl);
+        Camera camera(engine, glm::vec3(0.f, 8.f, 14.f), glm::vec3(0.f));
+        Handle<Texture> environmentHandle(environment), diffuseEnvironmentHandle(diffuseEnvironment);
+        RenderTarget target(width, height);
+
+        DeferredRenderer deferredRenderer(rl);
+        deferredRenderer.setScene(scene);
+        deferredRenderer.setCamera(camera);
+        deferredRenderer.setActiveEnvironment(environmentHandle);
+        deferredRenderer.setActiveDiffuseEnvironment(diffuseEnvironmentHandle);
+        deferredRenderer.render(&target);
+        const std::vector<float> deferred = test::readTexture(target.getTexture(), width, height);
+        VUL_CHECK(!test::isUniform(deferred));
+
+        ForwardRenderer forwardRenderer(rl);
+        forwardRenderer.setScene(scene);
+        forwardRenderer.setCamera(camera);
+        forwardRenderer.setActiveEnvironment(environmentHandle);
+        forwardRenderer.setActiveDiffuseEnvironment(diffuseEnvironmentHandle);
+
+        // Screen tiles only, then clusters with as many slices as the deferred renderer's
+        forwardRenderer.render(&target);
+        checkAgainstDeferred("Forward, 1 slice", deferred, test::readTexture(target.getTexture(), width, height));
+
+        forwardRenderer.getLightGrid()->setDepthSliceCount(16);
+        forwardRenderer.render(&target);
+        checkAgainstDeferred("Forward, 16 slices", deferred, test::readTexture(target.getTexture(), width, height));
+
+        forwardRenderer.setDepthPrepass(true);
+        forwardRenderer.render(&target);
+        checkAgainstDeferred("Forward with prepass", deferred, test::readTexture(target.getTexture(), width, height));
+
+        // Without environments there is no image based lighting, the point lights still show
+        ForwardRenderer plainRenderer(rl);
+        plainRenderer.setScene(scene);
+        plainRenderer.setCamera(camera);
+        plainRenderer.setClearColor(0.f, 0.f, 0.f);
+        plainRenderer.render(&target);
+        VUL_CHECK(!test::isUniform(test::readTexture(target.getTexture(), width, height)));
+    }
+    glDeleteTextures(1, &environment.textureHandle);
+    glDeleteTextures(1, &diffuseEnvironment.textureHandle);
+
+    return test::finish();
+}
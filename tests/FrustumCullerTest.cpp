@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vulpes/FrustumCuller.hpp>
+#include <vulpes/Scene.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t objectCount = 100003; // Not a multiple of 4, so the scalar remainder runs too
+    const uint32_t iterations = 20;
+
+    // Unaligned starts and lengths, down to ranges shorter than one SSE group
+    const uint32_t ranges[][2] = { { 0, 0 }, { 0, 3 }, { 1, 6 }, { 2, 11 }, { 3, 1002 }, { 5, objectCount } };
+
+    // As Camera::getFrustumPlanes, from the rows of the view-projection matrix
+    void getPlanes(const glm::mat4& viewProjection, glm::vec4* planes) {
+        const glm::mat4 transposed = glm::transpose(viewProjection);
+        for (int i = 0; i < 3; i++) {
+            planes[i * 2] = transposed[3] + transposed[i];
+            planes[i * 2 + 1] = transposed[3] - transposed[i];
+        }
+        for (int i = 0; i < 6; i++) planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+
+    // Spheres with boxes sometimes tighter and sometimes looser than them, so either may
+    // decide, and a few unbounded objects as Scene stores them. Most sit around the
+    // frustum's sides so both outcomes are common
+    void fillObjects(std::vector<glm::vec4>& spheres, std::vector<glm::vec4>& extents, std::mt19937& random) {
+        std::uniform_real_distribution<float> position(-150.f, 150.f), size(.1f, 20.f), unit(0.f, 1.f);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            const glm::vec3 center(position(random), position(random) * .5f, position(random) - 60.f);
+            if (unit(random) < .02f) {
+                spheres.push_back(glm::vec4(center, Scene::unboundedRadius));
+                extents.push_back(glm::vec4(Scene::unboundedRadius));
+                continue;
+            }
+
+            const glm::vec3 extent(size(random), size(random), size(random));
+            const float radius = glm::length(extent) * (.5f + unit(random));
+            spheres.push_back(glm::vec4(center, radius));
+            extents.push_back(glm::vec4(extent, 0.f));
+        }
+    }
+}
+
+int main() {
+    std::mt19937 random(32);
+    std::vector<glm::vec4> spheres, extents;
+    fillObjects(spheres, extents, random);
+
+    const glm::mat4 view = glm::lookAt(glm::vec3(5.f, 10.f, 20.f), glm::vec3(0.f, 0.f, -60.f), glm::vec3(0.f, 1.f, 0.f));
+    const glm::mat4 projection = glm::perspective(60.f, 16.f / 9.f, .1f, 150.f);
+    glm::vec4 planes[6];
+    getPlanes(projection * view, planes);
+
+    // Untouched entries outside the range stay 2 in both
+    uint32_t mismatches = 0, visible = 0;
+    for (const auto& range : ranges) {
+        std::vector<uint8_t> results(objectCount, 2), scalarResults(objectCount, 2);
+        FrustumCuller::cull(planes, spheres.data(), extents.data(), range[0], range[1], results.data());
+        FrustumCuller::cullScalar(planes, spheres.data(), extents.data(), range[0], range[1], scalarResults.data());
+        for (uint32_t i = 0; i < objectCount; i++) {
+            if (results[i] != scalarResults[i]) mismatches++;
+            if (i >= range[0] && i < range[1] && results[i] > 1) mismatches++;
+        }
+
+        if (range[1] == objectCount) {
+            uint32_t unboundedCulled = 0;
+            for (uint32_t i = range[0]; i < range[1]; i++) {
+                visible += results[i];
+                if (spheres[i].w == Scene::unboundedRadius && !results[i]) unboundedCulled++;
+            }
+            VUL_CHECK(unboundedCulled == 0);
+        }
+    }
+    std::printf("%u objects, %u visible, %u mismatches against the scalar path\n", objectCount, visible, mismatches);
+    VUL_CHECK(mismatches == 0);
+    VUL_CHECK(visible > 0 && visible < objectCount - ranges[5][0]);
+
+    // Benchmark: SSE against scalar over all objects
+    std::vector<uint8_t> results(objectCount);
+    for (int sse = 0; sse < 2; sse++) {
+        test::Timer timer;
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+            if (sse) FrustumCuller::cull(planes, spheres.data(), extents.data(), 0, objectCount, results.data());
+            else FrustumCuller::cullScalar(planes, spheres.data(), extents.data(), 0, objectCount, results.data());
+        }
+        std::printf("Culling %u objects, %s: %.3f ms\n", objectCount, sse ? "SSE" : "scalar", timer.getMilliseconds() / iterations);
+    }
+
+    return test::finish();
+}
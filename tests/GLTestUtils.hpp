@@ -0,0 +1,136 @@
+#ifndef _VUL_GLTESTUTILS_HPP
+#define _VUL_GLTESTUTILS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <vulpes/Handle.hpp>
+#include <vulpes/ResourceLoader.hpp>
+#include <vulpes/Scene.hpp>
+#include <vulpes/Texture.hpp>
+
+// For the tests that render, they need a display and the shaders in data/ next to
+// the working directory, which tests/CMakeLists.txt copies there
+namespace vul {
+    namespace test {
+        // ctest reports the test as skipped
+        const int skipped = 77;
+
+        // Windows created afterwards stay hidden, the Engine's included
+        inline bool canCreateContext() {
+            if (!glfwInit()) return false;
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            GLFWwindow* window = glfwCreateWindow(64, 64, "Probe", nullptr, nullptr);
+            if (!window) return false;
+            glfwDestroyWindow(window);
+            return true;
+        }
+
+        // One color in every direction, with mipmaps for the prefiltered lookups
+        inline Texture makeCubeMap(float red, float green, float blue) {
+            const uint32_t size = 16;
+            std::vector<float> pixels(size * size * 3);
+            for (uint32_t i = 0; i < size * size; i++) {
+                pixels[i * 3] = red;
+                pixels[i * 3 + 1] = green;
+                pixels[i * 3 + 2] = blue;
+            }
+
+            Texture texture;
+            glGenTextures(1, &texture.textureHandle);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, texture.textureHandle);
+            for (GLenum face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, pixels.data());
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            return texture;
+        }
+
+        // A floor, a grid of spheres and colored point lights between them, seen by a
+        // camera at (0, 8, 14) looking at the origin
+        inline void fillRenderScene(Scene& scene, ResourceLoader& rl, uint32_t lightCount = 48) {
+            const uint32_t floorID = scene.createSceneObject(SceneObjectType::Renderable);
+            Handle<RenderableObject> floor = scene.getRenderableObject(floorID);
+            floor->attachMesh(rl.getPlane());
+            floor->getTransformation().setScale(20.f);
+
+            Handle<Mesh> sphere = rl.getSphere();
+            for (int z = -2; z <= 2; z++) {
+                for (int x = -2; x <= 2; x++) {
+                    const uint32_t id = scene.createSceneObject(SceneObjectType::Renderable);
+                    Handle<RenderableObject> object = scene.getRenderableObject(id);
+                    object->attachMesh(sphere);
+                    object->getTransformation().setPosition(x * 3.f, 1.f, z * 3.f);
+                }
+            }
+
+            for (uint32_t i = 0; i < lightCount; i++) {
+                const float angle = i * 2.39996f; // Golden angle, spreads them evenly
+                const float distance = 1.f + 11.f * std::sqrt((i + .5f) / lightCount);
+                const uint32_t id = scene.createSceneObject(SceneObjectType::PointLight);
+                Handle<PointLight> light = scene.getPointLight(id);
+                light->getTransformation().setPosition(std::cos(angle) * distance, .5f + (i % 3), std::sin(angle) * distance);
+                light->setColor(glm::vec3(.5f + .5f * std::cos(angle), .5f + .5f * std::sin(angle), 1.f - .5f * (i % 2)));
+                light->setBrightness(10.f);
+                light->setRadius(5.f);
+            }
+            scene.updateWorldTransformations();
+        }
+
+        inline std::vector<float> readTexture(Handle<Texture> texture, uint32_t width, uint32_t height) {
+            std::vector<float> pixels(width * height * 4);
+            glBindTexture(GL_TEXTURE_2D, texture->textureHandle);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, pixels.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return pixels;
+        }
+
+        // RGBA, true when every pixel has the first one's color
+        inline bool isUniform(const std::vector<float>& image, float tolerance = .01f) {
+            for (size_t i = 4; i + 3 < image.size(); i += 4) {
+                for (size_t c = 0; c < 3; c++)
+                    if (std::abs(image[i + c] - image[c]) > tolerance) return false;
+            }
+            return true;
+        }
+
+        struct ImageDifference {
+            double mean; // Per color channel
+            float max;
+            double outlierShare; // Pixels with a channel off by more than the threshold
+        };
+
+        // RGBA images of the same size, alpha is ignored
+        inline ImageDifference compareImages(const std::vector<float>& a, const std::vector<float>& b, float outlierThreshold = .1f) {
+            ImageDifference difference = { 0.0, 0.f, 0.0 };
+            const size_t pixelCount = std::min(a.size(), b.size()) / 4;
+            size_t outliers = 0;
+            for (size_t i = 0; i < pixelCount; i++) {
+                float pixelMax = 0.f;
+                for (size_t c = 0; c < 3; c++) {
+                    const float channel = std::abs(a[i * 4 + c] - b[i * 4 + c]);
+                    difference.mean += channel;
+                    pixelMax = std::max(pixelMax, channel);
+                }
+                difference.max = std::max(difference.max, pixelMax);
+                if (pixelMax > outlierThreshold) outliers++;
+            }
+            if (pixelCount > 0) {
+                difference.mean /= pixelCount * 3.0;
+                difference.outlierShare = static_cast<double>(outliers) / pixelCount;
+            }
+            return difference;
+        }
+    }
+}
+
+#endif // _VUL_GLTESTUTILS_HPP
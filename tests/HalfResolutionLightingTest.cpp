@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <vulpes/Camera.hpp>
+#include <vulpes/DeferredRenderer.hpp>
+#include <vulpes/Engine.hpp>
+#include <vulpes/RenderTarget.hpp>
+#include <vulpes/ResourceLoader.hpp>
+#include <vulpes/Scene.hpp>
+
+#include "GLTestUtils.hpp"
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t width = 960;
+    const uint32_t height = 540;
+    const uint32_t frameCount = 20;
+
+    // Gamma corrected colors. Half resolution diffuse only differs along depth and
+    // normal edges the upsample can't fully recover, a mean around .002
+    const double maxMeanDifference = .01;
+    const double maxOutlierShare = .01;
+}
+
+int main() {
+    if (!test::canCreateContext()) {
+        std::printf("Unable to create an OpenGL context, skipped\n");
+        return test::skipped;
+    }
+
+    WindowCreationParameters parameters;
+    parameters.width = width;
+    parameters.height = height;
+    parameters.title = "HalfResolutionLightingTest";
+    Engine engine(parameters);
+    if (!GLEW_ARB_explicit_uniform_location) {
+        std::printf("ARB_explicit_uniform_location is not supported, skipped\n");
+        return test::skipped;
+    }
+
+    // A dim environment, so the point lights' diffuse light dominates the image
+    Texture environment = test::makeCubeMap(.05f, .06f, .08f);
+    Texture diffuseEnvironment = test::makeCubeMap(.02f, .025f, .03f);
+    {
+        ResourceLoader rl;
+        Scene scene;
+        test::fillRenderScene(scene, rl);
+        Camera camera(engine, glm::vec3(0.f, 8.f, 14.f), glm::vec3(0.f));
+
+        Handle<Texture> environmentHandle(environment), diffuseEnvironmentHandle(diffuseEnvironment);
+        DeferredRenderer renderer(rl);
+        renderer.setScene(scene);
+        renderer.setCamera(camera);
+        renderer.setActiveEnvironment(environmentHandle);
+        renderer.setActiveDiffuseEnvironment(diffuseEnvironmentHandle);
+
+        Handle<GPUProfiler> profiler = engine.getGPUProfiler();
+        renderer.setGPUProfiler(*profiler);
+        RenderTarget target(width, height);
+
+        // The light pass time is the profiler's average over the run, its latest
+        // sample is a few frames old when the loop ends
+        auto renderFrames = [&](bool halfResolutionLighting, double& lightPassTime) {
+            renderer.setHalfResolutionLighting(halfResolutionLighting);
+            profiler->clearHistory();
+            for (uint32_t frame = 0; frame < frameCount; frame++) {
+                renderer.render(&target);
+                engine.swapFrameBuffers();
+            }
+            glFinish();
+            engine.swapFrameBuffers();
+            lightPassTime = profiler->getAverage("light");
+            std::printf("  latest light pass %.3f ms\n", renderer.getLightPassTime());
+            return test::readTexture(target.getTexture(), width, height);
+        };
+
+        double fullTime = 0.0, halfTime = 0.0;
+        const std::vector<float> full = renderFrames(false, fullTime);
+        const std::vector<float> half = renderFrames(true, halfTime);
+        if (profiler->isInitialized()) {
+            std::printf("Light pass at %ux%u: full resolution %.3f ms, half resolution lighting %.3f ms\n",
+                width, height, fullTime, halfTime);
+        }
+        else std::printf("No timer queries, light pass times not measured\n");
+
+        // Shaders that failed to load leave both images the clear color, which would match
+        VUL_CHECK(!test::isUniform(full));
+
+        const test::ImageDifference difference = test::compareImages(full, half);
+        std::printf("Image difference: mean %.4f, max %.3f, %.2f%% of pixels over .1\n",
+            difference.mean, difference.max, difference.outlierShare * 100.0);
+        VUL_CHECK(difference.mean < maxMeanDifference);
+        VUL_CHECK(difference.outlierShare < maxOutlierShare);
+    }
+    glDeleteTextures(1, &environment.textureHandle);
+    glDeleteTextures(1, &diffuseEnvironment.textureHandle);
+
+    return test::finish();
+}
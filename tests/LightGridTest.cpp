@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vulpes/LightGrid.hpp>
+#include <vulpes/Scene.hpp>
+#include <vulpes/ThreadPool.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    // Not multiples of the tile size, so the last column and row are partial
+    const uint32_t width = 500;
+    const uint32_t height = 290;
+    const float near = .1f;
+    const float far = 200.f;
+
+    // Light counts off every multiple of 4 and 32, so the SSE remainder and the last
+    // mask word are partly filled
+    const uint32_t lightCounts[] = { 1, 7, 33, 250, 1001 };
+    const uint32_t sliceCounts[] = { 1, 16 };
+
+    const uint32_t benchmarkLightCount = 4096;
+    const uint32_t benchmarkWidth = 1920;
+    const uint32_t benchmarkHeight = 1080;
+    const uint32_t iterations = 20;
+
+    // Lights this close to a cluster boundary may go either way
+    const float planeTolerance = 1e-3f;
+    const float depthTolerance = 1e-4f; // Relative to the depth
+
+    struct Cluster {
+        glm::vec3 planes[4]; // Unit normals of the side planes through the eye, facing in
+        float nearDepth, farDepth;
+    };
+
+    void fillLights(Scene& scene, uint32_t count, std::mt19937& random) {
+        // Some behind the camera or past far, so those get dropped as well
+        std::uniform_real_distribution<float> x(-80.f, 80.f), y(-50.f, 50.f), z(-230.f, 20.f), radius(.5f, 15.f);
+        for (uint32_t i = 0; i < count; i++) {
+            Handle<PointLight> light = scene.getPointLight(scene.createSceneObject(SceneObjectType::PointLight));
+            light->getTransformation().setPosition(x(random), y(random), z(random));
+            light->setRadius(radius(random));
+        }
+    }
+
+    glm::vec3 unproject(const glm::mat4& inverseProjection, float x, float y) {
+        const glm::vec4 point = inverseProjection * glm::vec4(x, y, -1.f, 1.f);
+        return glm::vec3(point) / point.w;
+    }
+
+    // From the corners of each tile instead of the grid's plane equations, and the slice
+    // bounds from exponential spacing instead of the grid's logarithm
+    std::vector<Cluster> makeClusters(const glm::mat4& projection, uint32_t w, uint32_t h, uint32_t sliceCount) {
+        const glm::mat4 inverseProjection = glm::inverse(projection);
+        const uint32_t tileCountX = (w + LightGrid::tileSize - 1) / LightGrid::tileSize;
+        const uint32_t tileCountY = (h + LightGrid::tileSize - 1) / LightGrid::tileSize;
+
+        std::vector<Cluster> clusters;
+        for (uint32_t y = 0; y < tileCountY; y++) {
+            for (uint32_t x = 0; x < tileCountX; x++) {
+                const float left = -1.f + 2.f * (x * LightGrid::tileSize) / w;
+                const float right = std::min(1.f, -1.f + 2.f * ((x + 1) * LightGrid::tileSize) / w);
+                const float bottom = -1.f + 2.f * (y * LightGrid::tileSize) / h;
+                const float top = std::min(1.f, -1.f + 2.f * ((y + 1) * LightGrid::tileSize) / h);
+                const glm::vec3 corners[4] = { unproject(inverseProjection, left, bottom), unproject(inverseProjection, right, bottom),
+                    unproject(inverseProjection, right, top), unproject(inverseProjection, left, top) };
+                const glm::vec3 center = unproject(inverseProjection, (left + right) * .5f, (bottom + top) * .5f);
+
+                Cluster cluster;
+                for (int i = 0; i < 4; i++) {
+                    const glm::vec3 normal = glm::normalize(glm::cross(corners[i], corners[(i + 1) % 4]));
+                    cluster.planes[i] = glm::dot(normal, center) > 0.f ? normal : -normal;
+                }
+                for (uint32_t slice = 0; slice < sliceCount; slice++) {
+                    cluster.nearDepth = near * std::pow(far / near, static_cast<float>(slice) / sliceCount);
+                    cluster.farDepth = near * std::pow(far / near, static_cast<float>(slice + 1) / sliceCount);
+                    clusters.push_back(cluster);
+                }
+            }
+        }
+        return clusters;
+    }
+
+    // Smallest margin over the cluster's tests, negative when the sphere misses it
+    float getMargin(const Cluster& cluster, const glm::vec4& light) {
+        const glm::vec3 center(light);
+        float margin = 1e30f;
+        for (int i = 0; i < 4; i++) margin = std::min(margin, glm::dot(cluster.planes[i], center) + light.w);
+
+        // Depth margins are scaled into the plane tolerance's units
+        const float nearest = std::max(-center.z - light.w, near), farthest = std::min(-center.z + light.w, far);
+        const float depthScale = planeTolerance / (depthTolerance * cluster.farDepth);
+        margin = std::min(margin, (cluster.farDepth - nearest) * depthScale);
+        margin = std::min(margin, (farthest - cluster.nearDepth) * depthScale);
+        return margin;
+    }
+
+    // Returns the number of mismatches between the grid's lists and the brute force ones
+    uint32_t compareWithBruteForce(LightGrid& grid, Scene& scene, const glm::mat4& view, const glm::mat4& projection, uint32_t sliceCount) {
+        // Kept lights in scene order, the ones reaching between near and far
+        std::vector<glm::vec4> lights;
+        for (uint32_t i = 0; i < scene.getSceneObjectCount(SceneObjectType::PointLight); i++) {
+            Handle<PointLight> light = scene.getPointLightByIndex(i);
+            const glm::vec3 position = glm::vec3(view * glm::vec4(light->getTransformation().getPosition(), 1.f));
+            const float radius = light->getRadius();
+            if (-position.z + radius < near || -position.z - radius > far) continue;
+            lights.push_back(glm::vec4(position, radius));
+        }
+        if (!VUL_CHECK(grid.getLightCount() == lights.size())) return 1;
+
+        const std::vector<Cluster> clusters = makeClusters(projection, width, height, sliceCount);
+        uint32_t mismatches = 0;
+        for (uint32_t y = 0; y < grid.getTileCountY(); y++) {
+            for (uint32_t x = 0; x < grid.getTileCountX(); x++) {
+                for (uint32_t slice = 0; slice < sliceCount; slice++) {
+                    const Cluster& cluster = clusters[(y * grid.getTileCountX() + x) * sliceCount + slice];
+                    const uint32_t count = grid.getTileLightCount(x, y, slice);
+                    const uint32_t* listed = grid.getTileLights(x, y, slice);
+
+                    // Lists are in scene order, every light clearly inside is listed and
+                    // every listed one is at least close
+                    uint32_t next = 0;
+                    for (uint32_t light = 0; light < lights.size(); light++) {
+                        const bool isListed = next < count && listed[next] == light;
+                        if (isListed) next++;
+
+                        const float margin = getMargin(cluster, lights[light]);
+                        if ((margin > planeTolerance && !isListed) || (margin < -planeTolerance && isListed)) mismatches++;
+                    }
+                    if (next != count) mismatches++;
+                }
+            }
+        }
+        return mismatches;
+    }
+
+    bool sameLists(LightGrid& a, LightGrid& b, uint32_t sliceCount) {
+        if (a.getIndexCount() != b.getIndexCount()) return false;
+        for (uint32_t y = 0; y < a.getTileCountY(); y++) {
+            for (uint32_t x = 0; x < a.getTileCountX(); x++) {
+                for (uint32_t slice = 0; slice < sliceCount; slice++) {
+                    const uint32_t count = a.getTileLightCount(x, y, slice);
+                    if (count != b.getTileLightCount(x, y, slice)
+                        || !std::equal(a.getTileLights(x, y, slice), a.getTileLights(x, y, slice) + count, b.getTileLights(x, y, slice)))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    const glm::mat4 view = glm::lookAt(glm::vec3(3.f, 4.f, 10.f), glm::vec3(0.f, 0.f, -20.f), glm::vec3(0.f, 1.f, 0.f));
+    const glm::mat4 projection = glm::perspective(60.f, static_cast<float>(width) / height, near, far);
+
+    ThreadPool threadPool(3);
+    std::mt19937 random(44);
+    for (uint32_t lightCount : lightCounts) {
+        Scene scene;
+        fillLights(scene, lightCount, random);
+
+        for (uint32_t sliceCount : sliceCounts) {
+            LightGrid grid, threadedGrid;
+            grid.setDepthSliceCount(sliceCount);
+            threadedGrid.setDepthSliceCount(sliceCount);
+            threadedGrid.setThreadPool(threadPool);
+            grid.build(scene, view, projection, near, far, width, height);
+            threadedGrid.build(scene, view, projection, near, far, width, height);
+
+            const uint32_t mismatches = compareWithBruteForce(grid, scene, view, projection, sliceCount);
+            const uint32_t threadedMismatches = compareWithBruteForce(threadedGrid, scene, view, projection, sliceCount);
+            std::printf("%u lights, %u slices: %u kept, %u indices, %u mismatches, %u with threads\n",
+                lightCount, sliceCount, grid.getLightCount(), grid.getIndexCount(), mismatches, threadedMismatches);
+            VUL_CHECK(mismatches == 0);
+            VUL_CHECK(threadedMismatches == 0);
+            VUL_CHECK(sameLists(grid, threadedGrid, sliceCount));
+        }
+    }
+
+    // Benchmark: building the grid for many lights at full HD
+    Scene scene;
+    fillLights(scene, benchmarkLightCount, random);
+    const glm::mat4 benchmarkProjection = glm::perspective(60.f,
+        static_cast<float>(benchmarkWidth) / benchmarkHeight, near, far);
+    ThreadPool benchmarkPool(ThreadPool::getDefaultWorkerCount());
+    for (uint32_t threaded = 0; threaded < 2; threaded++) {
+        LightGrid grid;
+        grid.setDepthSliceCount(16);
+        if (threaded) grid.setThreadPool(benchmarkPool);
+        grid.build(scene, view, benchmarkProjection, near, far, benchmarkWidth, benchmarkHeight);
+
+        test::Timer timer;
+        for (uint32_t iteration = 0; iteration < iterations; iteration++)
+            grid.build(scene, view, benchmarkProjection, near, far, benchmarkWidth, benchmarkHeight);
+        std::printf("Building for %u lights at %ux%u with 16 slices, %u thread(s): %.3f ms (%u kept, %u indices)\n",
+            benchmarkLightCount, benchmarkWidth, benchmarkHeight, threaded ? benchmarkPool.getThreadCount() : 1,
+            timer.getMilliseconds() / iterations, grid.getLightCount(), grid.getIndexCount());
+    }
+
+    return test::finish();
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulpes/Profiler.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t zoneCount = 1000000;
+    const uint32_t runs = 5; // The fastest run counts, the others absorb noise
+    const double zoneBudget = 50.0; // Nanoseconds, only held to in optimized builds
+
+    const uint32_t frameCount = 5;
+    const uint32_t traceFrames = 2;
+    const char* const mainZones[frameCount] = { "Main 0", "Main 1", "Main 2", "Main 3", "Main 4" };
+    const char* const workerZones[frameCount] = { "Worker 0", "Worker 1", "Worker 2", "Worker 3", "Worker 4" };
+    const char* const tracePath = "ProfilerTest.json";
+
+    volatile uint32_t sink;
+
+    double timeLoop(bool zones) {
+        double fastest = 1e30;
+        for (uint32_t run = 0; run < runs; run++) {
+            test::Timer timer;
+            if (zones) {
+                for (uint32_t i = 0; i < zoneCount; i++) {
+                    VUL_PROFILE_ZONE("Overhead");
+                    sink = i;
+                }
+            }
+            else {
+                for (uint32_t i = 0; i < zoneCount; i++) sink = i;
+            }
+            fastest = std::min(fastest, timer.getMilliseconds());
+        }
+        return fastest;
+    }
+
+    // A zone of about a tenth of a millisecond, so zones have a length to check
+    void work(const char* name) {
+        VUL_PROFILE_ZONE(name);
+        test::Timer timer;
+        while (timer.getMilliseconds() < .1) sink = sink + 1;
+    }
+
+    struct Event {
+        std::string name, phase;
+        double ts, dur;
+        int tid;
+    };
+
+    // Numbers and strings after "key": on one event line, the trace writes one per line
+    bool findValue(const std::string& line, const char* key, std::string& value) {
+        const std::string pattern = std::string("\"") + key + "\": ";
+        const size_t position = line.find(pattern);
+        if (position == std::string::npos) return false;
+
+        size_t begin = position + pattern.size(), end;
+        if (line[begin] == '"') end = line.find('"', ++begin);
+        else end = line.find_first_of(",}", begin);
+        if (end == std::string::npos) return false;
+        value = line.substr(begin, end - begin);
+        return true;
+    }
+
+    // Checks the file is one object holding the event array, one event per line with
+    // commas between them, and reads the events back
+    bool readTrace(const char* path, std::vector<Event>& events) {
+        std::ifstream file(path);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);) lines.push_back(line);
+        if (!VUL_CHECK(lines.size() >= 3)) return false;
+        if (!VUL_CHECK(lines.front() == "{\"traceEvents\": [")) return false;
+        if (!VUL_CHECK(lines.back() == "], \"displayTimeUnit\": \"ms\"}")) return false;
+
+        for (size_t i = 1; i + 1 < lines.size(); i++) {
+            const std::string& line = lines[i];
+            const bool last = i + 2 == lines.size();
+            const std::string ending = last ? "}" : "},";
+            if (!VUL_CHECK(line.compare(0, 3, "  {") == 0)) return false;
+            if (!VUL_CHECK(line.size() > ending.size() && line.compare(line.size() - ending.size(), ending.size(), ending) == 0)) return false;
+            if (!VUL_CHECK(std::count(line.begin(), line.end(), '{') == std::count(line.begin(), line.end(), '}'))) return false;
+
+            Event event = { "", "", 0.0, 0.0, -1 };
+            std::string value;
+            if (!VUL_CHECK(findValue(line, "name", event.name) && findValue(line, "ph", event.phase))) return false;
+            if (findValue(line, "ts", value)) event.ts = std::atof(value.c_str());
+            if (findValue(line, "dur", value)) event.dur = std::atof(value.c_str());
+            if (findValue(line, "tid", value)) event.tid = std::atoi(value.c_str());
+            events.push_back(event);
+        }
+        return true;
+    }
+
+    // Index into names, or -1
+    int findName(const std::string& name, const char* const* names) {
+        for (uint32_t i = 0; i < frameCount; i++)
+            if (name == names[i]) return static_cast<int>(i);
+        return -1;
+    }
+}
+
+int main() {
+    VUL_CHECK(Profiler::isEnabled());
+
+    // Overhead: a million zones against the same loop without them
+    const double empty = timeLoop(false);
+    const double zoned = timeLoop(true);
+    const double perZone = (zoned - empty) * 1e6 / zoneCount;
+    std::printf("%u zones: %.3f ms, empty loop %.3f ms, %.1f ns per zone\n", zoneCount, zoned, empty, perZone);
+#ifdef NDEBUG
+    VUL_CHECK(perZone < zoneBudget);
+#else
+    std::printf("Unoptimized build, the %.0f ns budget is not checked\n", zoneBudget);
+#endif // NDEBUG
+
+    // Two threads record a zone in each frame, the worker's ring registers on its first
+    std::atomic<int> frameStarted(-1), frameDone(-1);
+    std::thread worker([&] {
+        for (int frame = 0; frame < static_cast<int>(frameCount); frame++) {
+            while (frameStarted.load() < frame) std::this_thread::yield();
+            work(workerZones[frame]);
+            frameDone.store(frame);
+        }
+    });
+    for (int frame = 0; frame < static_cast<int>(frameCount); frame++) {
+        Profiler::markFrame();
+        frameStarted.store(frame);
+        work(mainZones[frame]);
+        while (frameDone.load() < frame) std::this_thread::yield();
+    }
+    Profiler::markFrame();
+    worker.join();
+
+    // Only the last traceFrames frames, the overhead zones and earlier frames are out
+    VUL_CHECK(Profiler::writeChromeTrace(tracePath, traceFrames));
+    std::vector<Event> events;
+    if (readTrace(tracePath, events)) {
+        uint32_t threadNames = 0, frameMarks = 0, mainFound = 0, workerFound = 0, outside = 0, misplaced = 0;
+        int mainTid = -1, workerTid = -1;
+        double lastMark = 0.0;
+        for (const Event& event : events) {
+            if (event.phase == "M") {
+                if (event.name == "thread_name") threadNames++;
+                continue;
+            }
+            if (event.phase == "i") {
+                frameMarks++;
+                lastMark = std::max(lastMark, event.ts);
+                continue;
+            }
+            if (!VUL_CHECK(event.phase == "X")) continue;
+
+            const int mainFrame = findName(event.name, mainZones), workerFrame = findName(event.name, workerZones);
+            const int frame = std::max(mainFrame, workerFrame);
+            if (frame < static_cast<int>(frameCount - traceFrames)) outside++;
+            else if (mainFrame >= 0) {
+                mainFound++;
+                if (mainTid < 0) mainTid = event.tid;
+                else if (mainTid != event.tid) misplaced++;
+            }
+            else {
+                workerFound++;
+                if (workerTid < 0) workerTid = event.tid;
+                else if (workerTid != event.tid) misplaced++;
+            }
+            if (event.ts < 0.0 || event.dur < 90.0) misplaced++;
+        }
+
+        // Zones end before the frame's closing mark, which is the window's end
+        for (const Event& event : events)
+            if (event.phase == "X" && event.ts + event.dur > lastMark) misplaced++;
+
+        std::printf("Trace of %u frames: %u events, %u threads, %u frame marks\n",
+            traceFrames, static_cast<uint32_t>(events.size()), threadNames, frameMarks);
+        VUL_CHECK(threadNames == 2);
+        VUL_CHECK(frameMarks == traceFrames + 1);
+        VUL_CHECK(mainFound == traceFrames);
+        VUL_CHECK(workerFound == traceFrames);
+        VUL_CHECK(outside == 0);
+        VUL_CHECK(misplaced == 0);
+        VUL_CHECK(mainTid >= 0 && workerTid >= 0 && mainTid != workerTid);
+    }
+    std::remove(tracePath);
+
+    return test::finish();
+}
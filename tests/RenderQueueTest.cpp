@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <vulpes/RenderQueue.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    // Empty, trivial and off every power of two
+    const uint32_t counts[] = { 0, 1, 2, 3, 255, 257, 1000, 100003 };
+
+    const uint32_t benchmarkCount = 100000;
+    const uint32_t iterations = 20;
+
+    typedef std::pair<uint64_t, uint32_t> Entry;
+
+    enum struct Keys {
+        Random,
+        FewDistinct, // Long runs of equal keys, where only stability decides the order
+        SharedBytes, // Bytes 1, 4, 6 and 7 the same in every key, so their passes are skipped
+        AllEqual,
+        Sorted,
+        Reversed,
+        DrawKeys // From makeKey, with few materials and meshes and some layers
+    };
+
+    const Keys keyTypes[] = { Keys::Random, Keys::FewDistinct, Keys::SharedBytes, Keys::AllEqual,
+        Keys::Sorted, Keys::Reversed, Keys::DrawKeys };
+    const char* const keyNames[] = { "random", "few distinct", "shared bytes", "all equal", "sorted", "reversed", "draw keys" };
+
+    std::vector<uint64_t> makeKeys(Keys type, uint32_t count, std::mt19937_64& random) {
+        std::vector<uint64_t> keys(count);
+        std::uniform_int_distribution<uint32_t> small(0, 7);
+        std::uniform_real_distribution<float> depth(-.1f, 1.1f); // Clamped by makeKey
+        for (uint32_t i = 0; i < count; i++) {
+            switch (type) {
+            case Keys::Random: keys[i] = random(); break;
+            case Keys::FewDistinct: keys[i] = static_cast<uint64_t>(small(random)) << (small(random) * 8); break;
+            case Keys::SharedBytes: keys[i] = (random() & 0x0000FF00FFFF00FFull) | 0x5A3C00A500001E00ull; break;
+            case Keys::AllEqual: keys[i] = 0x0123456789ABCDEFull; break;
+            case Keys::Sorted: case Keys::Reversed: keys[i] = random() >> 8; break;
+            case Keys::DrawKeys: {
+                uint64_t key = RenderQueue::makeKey(small(random) / 4, 0, small(random), small(random) % 3, depth(random));
+                keys[i] = small(random) == 0 ? RenderQueue::setLayer(key, 1) : key;
+                break;
+            }
+            }
+        }
+        if (type == Keys::Sorted) std::sort(keys.begin(), keys.end());
+        if (type == Keys::Reversed) std::sort(keys.begin(), keys.end(), [](uint64_t a, uint64_t b) { return a > b; });
+        return keys;
+    }
+
+    // Values are the push order, so a stable sort has one right answer
+    bool sortsLikeStableSort(RenderQueue& queue, const std::vector<uint64_t>& keys) {
+        std::vector<Entry> expected;
+        queue.clear();
+        for (uint32_t i = 0; i < keys.size(); i++) {
+            queue.push(keys[i], i);
+            expected.push_back(Entry(keys[i], i));
+        }
+        queue.sort();
+        std::stable_sort(expected.begin(), expected.end(), [](const Entry& a, const Entry& b) { return a.first < b.first; });
+
+        if (queue.getSize() != expected.size()) return false;
+        for (uint32_t i = 0; i < queue.getSize(); i++)
+            if (queue.getKey(i) != expected[i].first || queue.getValue(i) != expected[i].second) return false;
+        return true;
+    }
+}
+
+int main() {
+    std::mt19937_64 random(39);
+
+    // One queue throughout, so scratch left from larger sorts is reused
+    RenderQueue queue;
+    for (uint32_t t = 0; t < sizeof(keyTypes) / sizeof(keyTypes[0]); t++) {
+        for (uint32_t count : counts) {
+            if (!VUL_CHECK(sortsLikeStableSort(queue, makeKeys(keyTypes[t], count, random))))
+                std::printf("  %s keys, %u entries\n", keyNames[t], count);
+        }
+    }
+
+    // makeKey orders by layer, program, material, mesh, then depth
+    VUL_CHECK(RenderQueue::makeKey(0, 15, 1000, 1000, 1.f) < RenderQueue::makeKey(1, 0, 0, 0, 0.f));
+    VUL_CHECK(RenderQueue::makeKey(0, 1, 0, 0, 0.f) > RenderQueue::makeKey(0, 0, 1000, 1000, 1.f));
+    VUL_CHECK(RenderQueue::makeKey(0, 0, 2, 0, 0.f) > RenderQueue::makeKey(0, 0, 1, 1000, 1.f));
+    VUL_CHECK(RenderQueue::makeKey(0, 0, 1, 2, 0.f) > RenderQueue::makeKey(0, 0, 1, 1, 1.f));
+    VUL_CHECK(RenderQueue::makeKey(0, 0, 1, 1, .5f) > RenderQueue::makeKey(0, 0, 1, 1, .25f));
+    VUL_CHECK(RenderQueue::setLayer(RenderQueue::makeKey(0, 3, 5, 7, .5f), 2) == RenderQueue::makeKey(2, 3, 5, 7, .5f));
+
+    // Benchmark: draw keys as the renderers build them
+    const std::vector<uint64_t> keys = makeKeys(Keys::DrawKeys, benchmarkCount, random);
+    double radixTime = 0.0, stableSortTime = 0.0;
+    std::vector<Entry> entries;
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        queue.clear();
+        for (uint32_t i = 0; i < benchmarkCount; i++) queue.push(keys[i], i);
+        test::Timer radixTimer;
+        queue.sort();
+        radixTime += radixTimer.getMilliseconds();
+
+        entries.clear();
+        for (uint32_t i = 0; i < benchmarkCount; i++) entries.push_back(Entry(keys[i], i));
+        test::Timer stableSortTimer;
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.first < b.first; });
+        stableSortTime += stableSortTimer.getMilliseconds();
+    }
+    std::printf("Sorting %u draw keys: radix %.3f ms, std::stable_sort %.3f ms\n",
+        benchmarkCount, radixTime / iterations, stableSortTime / iterations);
+
+    return test::finish();
+}
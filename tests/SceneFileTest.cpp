@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <vulpes/ResourceLoader.hpp>
+#include <vulpes/Scene.hpp>
+#include <vulpes/SceneFile.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t objectCount = 50000;
+    const uint32_t lightCount = 100;
+    const uint32_t iterations = 5;
+    const char* path = "SceneFileTest.vuls";
+    const char* newerPath = "SceneFileTestNewer.vuls";
+
+    // ctest reports the test as skipped
+    const int skipped = 77;
+
+    void fillScene(Scene& scene) {
+        scene.reserve(SceneObjectType::Renderable, objectCount);
+        uint32_t parentID = SlotMap::invalidID;
+        for (uint32_t i = 0; i < objectCount; i++) {
+            const uint32_t id = scene.createSceneObject(SceneObjectType::Renderable);
+            Handle<RenderableObject> object = scene.getRenderableObject(id);
+            Transformation& transformation = object->getTransformation();
+            transformation.setPosition(static_cast<float>(i % 100), static_cast<float>(i / 100), 0.f);
+            transformation.setRotation(0.f, i * .01f, 0.f);
+            transformation.setScale(1.f + (i % 7) * .1f);
+            object->setStatic(i % 3 == 0);
+
+            // Groups of ten under one parent, so the file carries a hierarchy too
+            if (i % 10 == 0) parentID = id;
+            else object->setParent(parentID);
+        }
+
+        for (uint32_t i = 0; i < lightCount; i++) {
+            const uint32_t id = scene.createSceneObject(SceneObjectType::PointLight);
+            Handle<PointLight> light = scene.getPointLight(id);
+            light->getTransformation().setPosition(static_cast<float>(i), 5.f, 0.f);
+            light->setRadius(2.f + i);
+        }
+        scene.updateWorldTransformations();
+    }
+
+    // Same world matrices and flags by index. The source was built parents first, so its
+    // packed order is the hierarchy order the file stores. Orientations are normalized
+    // on load, which can move the last bit
+    bool sameWorldMatrices(Scene& a, Scene& b) {
+        a.updateWorldTransformations();
+        b.updateWorldTransformations();
+        const uint32_t count = a.getSceneObjectCount(SceneObjectType::Renderable);
+        if (b.getSceneObjectCount(SceneObjectType::Renderable) != count) return false;
+
+        for (uint32_t i = 0; i < count; i++) {
+            const glm::mat4x3& x = a.getRenderableWorldMatrices()[i];
+            const glm::mat4x3& y = b.getRenderableWorldMatrices()[i];
+            for (int c = 0; c < 4; c++) {
+                const float tolerance = 1e-5f * std::max(1.f, glm::length(x[c]));
+                if (glm::any(glm::greaterThan(glm::abs(x[c] - y[c]), glm::vec3(tolerance)))) return false;
+            }
+            if (a.getRenderableFlags()[i] != b.getRenderableFlags()[i]) return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    // ResourceLoader creates its built in meshes on construction, so it needs a context
+    if (!glfwInit()) {
+        std::printf("Unable to initialize GLFW, skipped\n");
+        return skipped;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "SceneFileTest", nullptr, nullptr);
+    if (!window) {
+        std::printf("Unable to create an OpenGL context, skipped\n");
+        glfwTerminate();
+        return skipped;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::printf("Unable to initialize GLEW, skipped\n");
+        glfwTerminate();
+        return skipped;
+    }
+
+    {
+        ResourceLoader loader;
+        Scene source;
+        fillScene(source);
+
+        test::Timer writeTimer;
+        VUL_CHECK(SceneFile::write(path, source, loader));
+        const double writeTime = writeTimer.getMilliseconds();
+
+        double loadTime = 0.0;
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+            Scene loaded;
+            test::Timer loadTimer;
+            VUL_CHECK(SceneFile::load(path, loaded, loader));
+            loadTime += loadTimer.getMilliseconds();
+
+            VUL_CHECK(loaded.getSceneObjectCount(SceneObjectType::PointLight) == lightCount);
+            if (iteration == 0) VUL_CHECK(sameWorldMatrices(source, loaded));
+        }
+        std::printf("%u objects and %u lights: write %.2f ms, load %.2f ms\n", objectCount, lightCount, writeTime, loadTime / iterations);
+
+        // A file from a newer version must be refused, not misread. The version
+        // follows the 4 byte magic
+        std::ifstream in(path, std::ifstream::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const uint32_t newerVersion = SceneFile::version + 1;
+        std::memcpy(bytes.data() + 4, &newerVersion, sizeof(newerVersion));
+        std::ofstream(newerPath, std::ofstream::binary).write(bytes.data(), bytes.size());
+
+        Scene rejected;
+        VUL_CHECK(!SceneFile::load(newerPath, rejected, loader));
+        VUL_CHECK(rejected.getSceneObjectCount(SceneObjectType::Renderable) == 0);
+    }
+    std::remove(path);
+    std::remove(newerPath);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return test::finish();
+}
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <vulpes/Scene.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t objectCount = 100000;
+    const uint32_t iterations = 100;
+    const uint32_t hierarchyObjectCount = 1000;
+    const uint32_t hierarchyEdits = 200;
+
+    glm::vec3 getWorldPosition(Scene& scene, uint32_t id) {
+        return scene.getRenderableWorldMatrices()[scene.getRenderableIndex(id)][3];
+    }
+
+    // World matrix from the parent chain, independent of the scene's update order
+    glm::mat4x3 getExpectedWorldMatrix(Scene& scene, uint32_t id) {
+        const glm::mat4x3 local = scene.getRenderableTransformations()[scene.getRenderableIndex(id)].getAffineMatrix();
+        const uint32_t parent = scene.getParent(id);
+        return parent == SlotMap::invalidID ? local : Transformation::combine(getExpectedWorldMatrix(scene, parent), local);
+    }
+
+    float getError(const glm::mat4x3& a, const glm::mat4x3& b) {
+        float error = 0.f;
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 3; r++) error = std::max(error, std::abs(a[c][r] - b[c][r]));
+        }
+        return error;
+    }
+
+    void testHierarchy() {
+        Scene scene;
+        const uint32_t root = scene.createSceneObject(SceneObjectType::Renderable);
+        const uint32_t child = scene.createSceneObject(SceneObjectType::Renderable);
+        const uint32_t grandchild = scene.createSceneObject(SceneObjectType::Renderable);
+        const uint32_t other = scene.createSceneObject(SceneObjectType::Renderable);
+        scene.getRenderableObject(root)->getTransformation().setX(1.f);
+        scene.getRenderableObject(child)->getTransformation().setX(2.f);
+        scene.getRenderableObject(grandchild)->getTransformation().setX(3.f);
+        scene.getRenderableObject(other)->getTransformation().setY(7.f);
+        scene.setParent(child, root);
+        scene.setParent(grandchild, child);
+        scene.updateWorldTransformations();
+        VUL_CHECK(getWorldPosition(scene, grandchild) == glm::vec3(6.f, 0.f, 0.f));
+
+        // Moving a parent carries its whole subtree along
+        scene.getRenderableObject(root)->getTransformation().setX(10.f);
+        scene.updateWorldTransformations();
+        VUL_CHECK(getWorldPosition(scene, child) == glm::vec3(12.f, 0.f, 0.f));
+        VUL_CHECK(getWorldPosition(scene, grandchild) == glm::vec3(15.f, 0.f, 0.f));
+
+        // Reparenting alone, without touching any transformation, updates the moved subtree
+        scene.setParent(child, other);
+        scene.updateWorldTransformations();
+        VUL_CHECK(scene.getParent(child) == other);
+        VUL_CHECK(getWorldPosition(scene, child) == glm::vec3(2.f, 7.f, 0.f));
+        VUL_CHECK(getWorldPosition(scene, grandchild) == glm::vec3(5.f, 7.f, 0.f));
+        VUL_CHECK(getWorldPosition(scene, root) == glm::vec3(10.f, 0.f, 0.f));
+
+        scene.setParent(grandchild, SlotMap::invalidID);
+        scene.updateWorldTransformations();
+        VUL_CHECK(getWorldPosition(scene, grandchild) == glm::vec3(3.f, 0.f, 0.f));
+        scene.setParent(grandchild, child);
+
+        // Cycles are refused and leave the hierarchy as it was
+        scene.setParent(other, grandchild);
+        scene.setParent(child, child);
+        VUL_CHECK(scene.getParent(other) == SlotMap::invalidID);
+        VUL_CHECK(scene.getParent(child) == other);
+        scene.updateWorldTransformations();
+        VUL_CHECK(getWorldPosition(scene, grandchild) == glm::vec3(5.f, 7.f, 0.f));
+
+        // Children of a removed object become roots and keep only their own transformation
+        scene.removeSceneObject(SceneObjectType::Renderable, child);
+        VUL_CHECK(scene.getParent(grandchild) == SlotMap::invalidID);
+        scene.updateWorldTransformations();
+        VUL_CHECK(getWorldPosition(scene, grandchild) == glm::vec3(3.f, 0.f, 0.f));
+        VUL_CHECK(getWorldPosition(scene, other) == glm::vec3(0.f, 7.f, 0.f));
+        VUL_CHECK(getWorldPosition(scene, root) == glm::vec3(10.f, 0.f, 0.f));
+
+        // Random moves, reparenting and removals, checked against the parent chains
+        std::mt19937 random(29);
+        std::uniform_real_distribution<float> offset(-10.f, 10.f), angle(-3.1f, 3.1f);
+        std::vector<uint32_t> ids;
+        for (uint32_t i = 0; i < hierarchyObjectCount; i++) {
+            const uint32_t id = scene.createSceneObject(SceneObjectType::Renderable);
+            Transformation& transformation = scene.getRenderableObject(id)->getTransformation();
+            transformation.setPosition(offset(random), offset(random), offset(random));
+            transformation.setRotation(angle(random), angle(random), angle(random));
+            if (i > 0) scene.setParent(id, ids[random() % ids.size()]);
+            ids.push_back(id);
+        }
+        scene.updateWorldTransformations();
+
+        uint32_t mismatches = 0;
+        for (uint32_t edit = 0; edit < hierarchyEdits; edit++) {
+            const uint32_t id = ids[random() % ids.size()];
+            switch (random() % 4) {
+            case 0: scene.getRenderableObject(id)->getTransformation().setY(offset(random)); break;
+            case 1: scene.setParent(id, ids[random() % ids.size()]); break;
+            case 2: scene.setParent(id, SlotMap::invalidID); break;
+            case 3:
+                scene.removeSceneObject(SceneObjectType::Renderable, id);
+                ids.erase(std::find(ids.begin(), ids.end(), id));
+                break;
+            }
+
+            // Several edits between some updates, so changes pile up
+            if (edit % 3 != 0) continue;
+            scene.updateWorldTransformations();
+            for (uint32_t check : ids) {
+                const glm::mat4x3& world = scene.getRenderableWorldMatrices()[scene.getRenderableIndex(check)];
+                if (getError(world, getExpectedWorldMatrix(scene, check)) > 1e-3f) mismatches++;
+            }
+        }
+        VUL_CHECK(mismatches == 0);
+    }
+}
+
+int main() {
+    testHierarchy();
+
+    Scene scene;
+    scene.reserve(SceneObjectType::Renderable, objectCount);
+
+    std::vector<uint32_t> ids;
+    std::unordered_map<uint32_t, float> positions;
+    for (uint32_t i = 0; i < objectCount; i++) {
+        const uint32_t id = scene.createSceneObject(SceneObjectType::Renderable);
+        scene.getRenderableObject(id)->getTransformation().setX(static_cast<float>(i));
+        ids.push_back(id);
+        positions[id] = static_cast<float>(i);
+    }
+    VUL_CHECK(scene.getSceneObjectCount(SceneObjectType::Renderable) == objectCount);
+
+    // Every other object removed, the rest must keep their data as the arrays are compacted
+    std::vector<uint32_t> removed;
+    for (uint32_t i = 0; i < objectCount; i += 2) {
+        scene.removeSceneObject(SceneObjectType::Renderable, ids[i]);
+        removed.push_back(ids[i]);
+        positions.erase(ids[i]);
+    }
+    VUL_CHECK(scene.getSceneObjectCount(SceneObjectType::Renderable) == objectCount / 2);
+
+    scene.updateWorldTransformations();
+    const glm::mat4x3* world = scene.getRenderableWorldMatrices();
+    uint32_t mismatches = 0;
+    for (const auto& object : positions) {
+        const uint32_t index = scene.getRenderableIndex(object.first);
+        if (index == SlotMap::invalidID || world[index][3].x != object.second) mismatches++;
+    }
+    VUL_CHECK(mismatches == 0);
+
+    // Reused slots get a new generation, so removed IDs stay invalid
+    for (uint32_t i = 0; i < objectCount / 2; i++) scene.createSceneObject(SceneObjectType::Renderable);
+    uint32_t stale = 0;
+    for (uint32_t id : removed) {
+        if (scene.hasSceneObject(SceneObjectType::Renderable, id) || scene.getRenderableIndex(id) != SlotMap::invalidID) stale++;
+    }
+    VUL_CHECK(stale == 0);
+
+    // Changes reach the world matrix when the transformation is fetched for each one,
+    // or set as a whole
+    const uint32_t id = ids[1];
+    scene.getRenderableObject(id)->getTransformation().setY(3.f);
+    scene.updateWorldTransformations();
+    VUL_CHECK(scene.getRenderableWorldMatrices()[scene.getRenderableIndex(id)][3].y == 3.f);
+
+    Transformation transformation;
+    transformation.setZ(5.f);
+    scene.getRenderableObject(id)->setTransformation(transformation);
+    scene.updateWorldTransformations();
+    VUL_CHECK(scene.getRenderableWorldMatrices()[scene.getRenderableIndex(id)][3].z == 5.f);
+
+    // Benchmark: the per object data the geometry pass reads, walked in packed order
+    const uint32_t count = scene.getSceneObjectCount(SceneObjectType::Renderable);
+    const uint16_t* flags = scene.getRenderableFlags();
+    const uint32_t* meshIDs = scene.getRenderableMeshIDs();
+    const uint32_t* materialIDs = scene.getRenderableMaterialIDs();
+    world = scene.getRenderableWorldMatrices();
+
+    float checksum = 0.f;
+    test::Timer timer;
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (flags[i] == 0xFFFF) continue;
+            checksum += world[i][3].x + static_cast<float>(meshIDs[i] + materialIDs[i]);
+        }
+    }
+    const double milliseconds = timer.getMilliseconds() / iterations;
+    std::printf("Iterating %u renderables: %.3f ms (%.2f ns per object, checksum %g)\n",
+        count, milliseconds, milliseconds * 1000000.0 / count, checksum);
+
+    return test::finish();
+}
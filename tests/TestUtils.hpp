@@ -0,0 +1,45 @@
+#ifndef _VUL_TESTUTILS_HPP
+#define _VUL_TESTUTILS_HPP
+
+#include <chrono>
+#include <cstdio>
+
+// Records a failure and carries on, so a run reports every broken check
+#define VUL_CHECK(condition) ::vul::test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace vul {
+    namespace test {
+        inline int& getFailureCount() {
+            static int failures = 0;
+            return failures;
+        }
+
+        inline bool check(bool passed, const char* condition, const char* file, int line) {
+            if (!passed) {
+                std::printf("%s:%d: check failed: %s\n", file, line, condition);
+                getFailureCount()++;
+            }
+            return passed;
+        }
+
+        // Exit code for main
+        inline int finish() {
+            if (getFailureCount() > 0) std::printf("%d check(s) failed\n", getFailureCount());
+            return getFailureCount() > 0 ? 1 : 0;
+        }
+
+        class Timer {
+        public:
+            Timer() : m_start(std::chrono::steady_clock::now()) {}
+
+            double getMilliseconds() const {
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+            }
+
+        private:
+            std::chrono::steady_clock::time_point m_start;
+        };
+    }
+}
+
+#endif // _VUL_TESTUTILS_HPP
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <vulpes/ThreadPool.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t workerCounts[] = { 0, 1, 3, 7, 15 };
+
+    // Below, at and past the chunk sizes, and off every multiple of the thread counts
+    const uint32_t counts[] = { 0, 1, 5, 63, 64, 65, 1000, 100003 };
+    const uint32_t minChunks[] = { 0, 1, 64, 5000 };
+
+    const uint32_t repeatCount = 2000;
+
+    // Every index is visited exactly once, by a thread the pool has, in ranges of at
+    // least minChunk apart from the last one
+    bool coversExactlyOnce(ThreadPool& threadPool, uint32_t count, uint32_t minChunk) {
+        std::vector<std::atomic<uint32_t>> visits(count);
+        for (auto& visit : visits) visit = 0;
+        std::atomic<uint32_t> badRanges(0), badThreads(0);
+
+        threadPool.parallelFor(count, minChunk, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            if (begin >= end || end > count || (end - begin < minChunk && end != count)) badRanges++;
+            if (threadIndex >= threadPool.getThreadCount()) badThreads++;
+            for (uint32_t i = begin; i < std::min(end, count); i++) visits[i]++;
+        });
+
+        uint32_t wrongCounts = 0;
+        for (auto& visit : visits) if (visit != 1) wrongCounts++;
+        if (wrongCounts || badRanges || badThreads)
+            std::printf("  %u indices, chunks of %u: %u visited other than once, %u bad ranges, %u bad thread indices\n",
+                count, minChunk, wrongCounts, badRanges.load(), badThreads.load());
+        return wrongCounts == 0 && badRanges == 0 && badThreads == 0;
+    }
+}
+
+int main() {
+    VUL_CHECK(ThreadPool().getThreadCount() == 1);
+
+    for (uint32_t workerCount : workerCounts) {
+        ThreadPool threadPool(workerCount);
+        VUL_CHECK(threadPool.getThreadCount() == workerCount + 1);
+
+        for (uint32_t count : counts) {
+            for (uint32_t minChunk : minChunks)
+                VUL_CHECK(coversExactlyOnce(threadPool, count, minChunk));
+        }
+
+        // Many short loops back to back, each has to see all of its own work done
+        // before returning and none of the previous loop's
+        std::atomic<uint32_t> sum(0);
+        uint32_t incomplete = 0;
+        for (uint32_t repeat = 0; repeat < repeatCount; repeat++) {
+            sum = 0;
+            threadPool.parallelFor(64, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+                for (uint32_t i = begin; i < end; i++) sum += i + 1;
+            });
+            if (sum != 64 * 65 / 2) incomplete++;
+        }
+        VUL_CHECK(incomplete == 0);
+
+        // Uneven work still finishes with every chunk run
+        std::atomic<uint64_t> work(0);
+        threadPool.parallelFor(1000, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+            for (uint32_t i = begin; i < end; i++) {
+                uint64_t local = 0;
+                for (uint32_t j = 0; j < (i % 17) * 1000; j++) local += j ^ i;
+                work += local ? 1 : 0;
+            }
+        });
+        VUL_CHECK(work == 1000 - (1000 + 16) / 17);
+
+        std::printf("%u worker(s): %u threads, %u loops back to back\n", workerCount, threadPool.getThreadCount(), repeatCount);
+    }
+
+    return test::finish();
+}
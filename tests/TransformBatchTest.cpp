@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <vulpes/Scene.hpp>
+#include <vulpes/ThreadPool.hpp>
+#include <vulpes/TransformBatch.hpp>
+
+#include "TestUtils.hpp"
+
+using namespace vul;
+
+namespace {
+    const uint32_t objectCount = 100003; // Not a multiple of 8, so the scalar remainder runs too
+    const uint32_t iterations = 20;
+
+    Transformation makeTransformation(std::mt19937& random) {
+        std::uniform_real_distribution<float> position(-1000.f, 1000.f), angle(-6.3f, 6.3f), scale(.1f, 10.f);
+        Transformation transformation;
+        transformation.setPosition(position(random), position(random), position(random));
+        transformation.setRotation(angle(random), angle(random), angle(random));
+        transformation.setScale(scale(random), scale(random), scale(random));
+        return transformation;
+    }
+
+    // Largest difference relative to the magnitude of the column, so large translations
+    // don't hide errors in small rotation terms
+    float getError(const glm::mat4x3& a, const glm::mat4x3& b) {
+        float error = 0.f;
+        for (int c = 0; c < 4; c++) {
+            const float magnitude = std::max(1.f, glm::length(b[c]));
+            for (int r = 0; r < 3; r++) error = std::max(error, std::abs(a[c][r] - b[c][r]) / magnitude);
+        }
+        return error;
+    }
+
+    float getError(const glm::mat3& a, const glm::mat3& b) {
+        float error = 0.f;
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++) error = std::max(error, std::abs(a[c][r] - b[c][r]));
+        return error;
+    }
+}
+
+int main() {
+    std::mt19937 random(1234);
+    std::vector<Transformation> transformations;
+    for (uint32_t i = 0; i < objectCount; i++) transformations.push_back(makeTransformation(random));
+
+    TransformBatch batch;
+    batch.resize(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++) batch.set(i, transformations[i]);
+
+    std::vector<glm::mat4x3> affine(objectCount), affineScalar(objectCount);
+    std::vector<glm::mat3> normal(objectCount), normalScalar(objectCount);
+    batch.compute(0, objectCount, affine.data(), normal.data());
+    batch.computeScalar(0, objectCount, affineScalar.data(), normalScalar.data());
+
+    float affineError = 0.f, normalError = 0.f, referenceError = 0.f;
+    for (uint32_t i = 0; i < objectCount; i++) {
+        affineError = std::max(affineError, getError(affine[i], affineScalar[i]));
+        normalError = std::max(normalError, getError(normal[i], normalScalar[i]));
+        referenceError = std::max(referenceError, getError(affineScalar[i], transformations[i].getAffineMatrix()));
+    }
+    std::printf("%s against scalar: affine error %g, normal error %g\n", TransformBatch::getInstructionSet(), affineError, normalError);
+    VUL_CHECK(affineError < 1e-5f);
+    VUL_CHECK(normalError < 1e-5f);
+    VUL_CHECK(referenceError < 1e-5f);
+
+    // Ranges that start and end off the vector width must match too
+    for (uint32_t begin = 0; begin < 9; begin++) {
+        for (uint32_t end = begin; end < begin + 19; end++) {
+            std::vector<glm::mat4x3> a(end);
+            std::vector<glm::mat3> n(end);
+            batch.compute(begin, end, a.data(), n.data());
+            for (uint32_t i = begin; i < end; i++) {
+                if (!VUL_CHECK(getError(a[i], affineScalar[i]) < 1e-5f && getError(n[i], normalScalar[i]) < 1e-5f)) {
+                    std::printf("  range [%u, %u), object %u\n", begin, end, i);
+                    return test::finish();
+                }
+            }
+        }
+    }
+
+    // Scene updates split across worker threads must match a single threaded scene. Chunk
+    // boundaries change which objects take the scalar remainder, so this isn't exact either
+    Scene single, threaded;
+    ThreadPool threadPool(3);
+    threaded.setThreadPool(threadPool);
+    const uint32_t sceneCount = 20000;
+    for (Scene* scene : { &single, &threaded }) {
+        for (uint32_t i = 0; i < sceneCount; i++) {
+            const uint32_t id = scene->createSceneObject(SceneObjectType::Renderable);
+            scene->getRenderableObject(id)->setTransformation(transformations[i]);
+        }
+        scene->updateWorldTransformations();
+    }
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < sceneCount; i++) {
+        if (getError(single.getRenderableWorldMatrices()[i], threaded.getRenderableWorldMatrices()[i]) > 1e-5f) mismatches++;
+    }
+    VUL_CHECK(mismatches == 0);
+
+    // Benchmark
+    test::Timer batchTimer;
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) batch.compute(0, objectCount, affine.data(), normal.data());
+    const double batchTime = batchTimer.getMilliseconds() / iterations;
+
+    test::Timer scalarTimer;
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) batch.computeScalar(0, objectCount, affineScalar.data(), normalScalar.data());
+    const double scalarTime = scalarTimer.getMilliseconds() / iterations;
+
+    std::printf("%u objects: %s %.3f ms (%.1f M objects/s), scalar %.3f ms (%.1f M objects/s)\n", objectCount,
+        TransformBatch::getInstructionSet(), batchTime, objectCount / batchTime / 1000.0, scalarTime, objectCount / scalarTime / 1000.0);
+
+    return test::finish();
+}